@@ -17,11 +17,16 @@
 #include "panel.h"
 #include "timer.h"
 #include "common.h"
+#include "icon_cache.h"
+#include "sampler.h"
+#include "svg_loader.h"
+#include "tooltip.h"
 
 char *button_get_tooltip(void *obj);
 void button_init_fonts();
 int button_compute_desired_size(void *obj);
 void button_dump_geometry(void *obj, int indent);
+static void button_sampler_update(void *obj);
 
 void default_button()
 {
@@ -52,9 +57,8 @@ void destroy_button(void *obj)
     Button *button = (Button *)obj;
     if (button->frontend) {
         // This is a frontend element
-        free_icon(button->frontend->icon);
-        free_icon(button->frontend->icon_hover);
-        free_icon(button->frontend->icon_pressed);
+        cancel_image_loads(button);
+        cached_icon_unref(button->frontend->cached_icon);
         button->backend->instances = g_list_remove_all(button->backend->instances, button);
         free_and_null(button->frontend);
         remove_area(&button->area);
@@ -62,6 +66,10 @@ void destroy_button(void *obj)
         free_and_null(button);
     } else {
         // This is a backend element
+        if (button->backend->text_template || button->backend->tooltip_template)
+            sampler_unsubscribe(button_sampler_update, button);
+        free_and_null(button->backend->text_template);
+        free_and_null(button->backend->tooltip_template);
         free_and_null(button->backend->text);
         free_and_null(button->backend->icon_name);
         free_and_null(button->backend->tooltip);
@@ -114,6 +122,51 @@ void init_button()
         // Set missing config options
         if (!button->backend->bg)
             button->backend->bg = &g_array_index(backgrounds, Background, 0);
+
+        if (sampler_has_tokens(button->backend->text)) {
+            button->backend->text_template = button->backend->text;
+            button->backend->text = NULL;
+        }
+        if (sampler_has_tokens(button->backend->tooltip)) {
+            button->backend->tooltip_template = button->backend->tooltip;
+            button->backend->tooltip = NULL;
+        }
+        if (button->backend->text_template || button->backend->tooltip_template)
+            sampler_subscribe(button_sampler_update, button);
+    }
+}
+
+// Called for backend elements after each sample
+static void button_sampler_update(void *obj)
+{
+    Button *button = (Button *)obj;
+    char buffer[512];
+
+    if (button->backend->text_template) {
+        sampler_expand(button->backend->text_template, buffer, sizeof(buffer));
+        if (!button->backend->text || strcmp(buffer, button->backend->text) != 0) {
+            free(button->backend->text);
+            button->backend->text = strdup(buffer);
+            for (GList *l = button->backend->instances; l; l = l->next) {
+                Button *instance = (Button *)l->data;
+                instance->area.resize_needed = TRUE;
+                schedule_redraw(&instance->area);
+            }
+            schedule_panel_redraw();
+        }
+    }
+
+    if (button->backend->tooltip_template) {
+        sampler_expand(button->backend->tooltip_template, buffer, sizeof(buffer));
+        free(button->backend->tooltip);
+        button->backend->tooltip = strdup(buffer);
+        for (GList *l = button->backend->instances; l; l = l->next) {
+            Button *instance = (Button *)l->data;
+            if (g_tooltip.mapped && g_tooltip.area == &instance->area) {
+                tooltip_update_contents_for(&instance->area);
+                tooltip_update();
+            }
+        }
     }
 }
 
@@ -199,45 +252,36 @@ void button_default_font_changed()
     schedule_panel_redraw();
 }
 
+void button_icon_image_loaded(void *arg)
+{
+    button_reload_icon((Button *)arg);
+    schedule_panel_redraw();
+}
+
 void button_reload_icon(Button *button)
 {
-    free_icon(button->frontend->icon);
-    free_icon(button->frontend->icon_hover);
-    free_icon(button->frontend->icon_pressed);
+    CachedIcon *old_icon = button->frontend->cached_icon;
+
+    cancel_image_loads(button);
+    button->frontend->cached_icon = NULL;
     button->frontend->icon = NULL;
     button->frontend->icon_hover = NULL;
     button->frontend->icon_pressed = NULL;
 
     button->frontend->icon_load_size = button->frontend->iconw;
 
-    if (!button->backend->icon_name)
+    if (!button->backend->icon_name) {
+        cached_icon_unref(old_icon);
         return;
-
-    char *new_icon_path = get_icon_path(icon_theme_wrapper, button->backend->icon_name, button->frontend->iconw, TRUE);
-    if (new_icon_path)
-        button->frontend->icon = load_image(new_icon_path, TRUE);
-    free(new_icon_path);
-    // On loading error, fallback to default
-    if (!button->frontend->icon) {
-        new_icon_path = get_icon_path(icon_theme_wrapper, DEFAULT_ICON, button->frontend->iconw, TRUE);
-        if (new_icon_path)
-            button->frontend->icon = load_image(new_icon_path, TRUE);
-        free(new_icon_path);
-    }
-    Imlib_Image original = button->frontend->icon;
-    button->frontend->icon = scale_icon(button->frontend->icon, button->frontend->iconw);
-    free_icon(original);
-
-    if (panel_config.mouse_effects) {
-        button->frontend->icon_hover = adjust_icon(button->frontend->icon,
-                                                   panel_config.mouse_over_alpha,
-                                                   panel_config.mouse_over_saturation,
-                                                   panel_config.mouse_over_brightness);
-        button->frontend->icon_pressed = adjust_icon(button->frontend->icon,
-                                                     panel_config.mouse_pressed_alpha,
-                                                     panel_config.mouse_pressed_saturation,
-                                                     panel_config.mouse_pressed_brightness);
     }
+
+    button->frontend->cached_icon =
+        get_cached_icon(button->backend->icon_name, button->frontend->iconw, button_icon_image_loaded, button, NULL);
+    button->frontend->icon = button->frontend->cached_icon->image;
+    button->frontend->icon_hover = button->frontend->cached_icon->image_hover;
+    button->frontend->icon_pressed = button->frontend->cached_icon->image_pressed;
+    // Released after the lookup, so that reloading an icon that did not change reuses the cached images
+    cached_icon_unref(old_icon);
     schedule_redraw(&button->area);
 }
 
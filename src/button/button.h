@@ -6,6 +6,7 @@
 
 #include "area.h"
 #include "common.h"
+#include "icon_cache.h"
 #include "timer.h"
 
 // Architecture:
@@ -36,12 +37,19 @@ typedef struct ButtonBackend {
     int paddingxlr, paddingx, paddingy;
     Background *bg;
 
+    // Backend state:
+    // The configured text and tooltip, if they contain sampler tokens; text and tooltip hold their expansion
+    char *text_template;
+    char *tooltip_template;
+
     // List of Button which are frontends for this backend, one for each panel
     GList *instances;
 } ButtonBackend;
 
 typedef struct ButtonFrontend {
     // Frontend state:
+    // Shared with the other panels; the icons below belong to it
+    CachedIcon *cached_icon;
     Imlib_Image icon;
     Imlib_Image icon_hover;
     Imlib_Image icon_pressed;
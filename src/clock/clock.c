@@ -30,6 +30,7 @@
 #include "clock.h"
 #include "timer.h"
 #include "common.h"
+#include "tz_cache.h"
 
 char *time1_format;
 char *time1_timezone;
@@ -111,33 +112,101 @@ void cleanup_clock()
     free(clock_dwheel_command);
     clock_dwheel_command = NULL;
     destroy_timer(&clock_timer);
+    cleanup_tz_cache();
 }
 
 struct tm *clock_gettime_for_tz(const char *timezone)
 {
-    if (timezone) {
-        const char *old_tz = getenv("TZ");
-        setenv("TZ", timezone, 1);
-        struct tm *result = localtime(&time_clock.tv_sec);
-        if (old_tz)
-            setenv("TZ", old_tz, 1);
-        else
-            unsetenv("TZ");
-        return result;
-    } else {
-        return localtime(&time_clock.tv_sec);
+    static struct tm result;
+    tz_cache_localtime(timezone, time_clock.tv_sec, &result);
+    return &result;
+}
+
+static gboolean font_has_tabular_digits(PangoFontDescription *font_desc, double scale)
+{
+    int digit_width = -1;
+    for (char digit = '0'; digit <= '9'; digit++) {
+        int width, height;
+        get_text_size2(font_desc,
+                       &height,
+                       &width,
+                       1000,
+                       1000,
+                       &digit,
+                       1,
+                       PANGO_WRAP_WORD_CHAR,
+                       PANGO_ELLIPSIZE_NONE,
+                       PANGO_ALIGN_CENTER,
+                       FALSE,
+                       scale);
+        if (digit_width >= 0 && width != digit_width)
+            return FALSE;
+        digit_width = width;
+    }
+    return TRUE;
+}
+
+static gboolean clock_texts_differ_only_in_digits(const char *old_text, const char *new_text)
+{
+    for (; *old_text && *new_text; old_text++, new_text++) {
+        if (*old_text == *new_text)
+            continue;
+        if (!g_ascii_isdigit(*old_text) || !g_ascii_isdigit(*new_text))
+            return FALSE;
     }
+    return !*old_text && !*new_text;
+}
+
+// Formats the time into buffer. Returns TRUE if the text changed, and clears *only_digits if it changed in more than
+// its digits.
+static gboolean clock_format_text(char *buffer,
+                                  size_t buffer_size,
+                                  const char *format,
+                                  const char *timezone,
+                                  gboolean *only_digits)
+{
+    char text[256];
+    if (!strftime(text, sizeof(text), format, clock_gettime_for_tz(timezone)))
+        text[0] = '\0';
+    if (strcmp(text, buffer) == 0)
+        return FALSE;
+    if (!clock_texts_differ_only_in_digits(buffer, text))
+        *only_digits = FALSE;
+    snprintf(buffer, buffer_size, "%s", text);
+    return TRUE;
+}
+
+// Returns TRUE if a text that changed only in its digits keeps its size on the panel,
+// i.e. the digits of the font all have the same width at the scale of the panel.
+static gboolean clock_text_keeps_size(PangoFontDescription *font_desc, double scale, int *tabular_digits)
+{
+    if (*tabular_digits < 0)
+        *tabular_digits = font_has_tabular_digits(font_desc, scale);
+    return *tabular_digits;
 }
 
 void update_clocks()
 {
+    gboolean time1_changed = FALSE;
+    gboolean time2_changed = FALSE;
+    gboolean only_digits = TRUE;
     if (time1_format)
-        strftime(buf_time, sizeof(buf_time), time1_format, clock_gettime_for_tz(time1_timezone));
+        time1_changed = clock_format_text(buf_time, sizeof(buf_time), time1_format, time1_timezone, &only_digits);
     if (time2_format)
-        strftime(buf_date, sizeof(buf_date), time2_format, clock_gettime_for_tz(time2_timezone));
-    if (time1_format || time2_format) {
-        for (int i = 0; i < num_panels; i++)
-            panels[i].clock.area.resize_needed = 1;
+        time2_changed = clock_format_text(buf_date, sizeof(buf_date), time2_format, time2_timezone, &only_digits);
+    if (!time1_changed && !time2_changed)
+        return;
+    for (int i = 0; i < num_panels; i++) {
+        Clock *clock = &panels[i].clock;
+        gboolean resize = !only_digits;
+        if (!resize && time1_changed)
+            resize = !clock_text_keeps_size(time1_font_desc, panels[i].scale, &clock->time1_tabular_digits);
+        if (!resize && time2_changed)
+            resize = !clock_text_keeps_size(time2_font_desc, panels[i].scale, &clock->time2_tabular_digits);
+        if (resize)
+            clock->area.resize_needed = 1;
+        else
+            schedule_redraw(&clock->area);
     }
     schedule_panel_redraw();
 }
@@ -208,6 +277,8 @@ void init_clock_panel(void *p)
     clock->area._resize = resize_clock;
     clock->area._compute_desired_size = clock_compute_desired_size;
     clock->area._dump_geometry = clock_dump_geometry;
+    clock->time1_tabular_digits = -1;
+    clock->time2_tabular_digits = -1;
     // check consistency
     if (!time1_format)
         return;
@@ -244,6 +315,14 @@ void clock_init_fonts()
     }
 }
 
+void clock_fonts_changed()
+{
+    for (int i = 0; i < num_panels; i++) {
+        panels[i].clock.time1_tabular_digits = -1;
+        panels[i].clock.time2_tabular_digits = -1;
+    }
+}
+
 void clock_default_font_changed()
 {
     if (!clock_enabled)
@@ -260,6 +339,10 @@ void clock_default_font_changed()
     }
     clock_init_fonts();
     for (int i = 0; i < num_panels; i++) {
+        if (!time1_has_font)
+            panels[i].clock.time1_tabular_digits = -1;
+        if (!time2_has_font)
+            panels[i].clock.time2_tabular_digits = -1;
         panels[i].clock.area.resize_needed = TRUE;
         schedule_redraw(&panels[i].clock.area);
     }
@@ -20,6 +20,9 @@ typedef struct Clock {
     Color font;
     int time1_posy;
     int time2_posy;
+    // Whether all digits have the same width in the fonts, at the scale of the panel: -1 if not measured yet
+    int time1_tabular_digits;
+    int time2_tabular_digits;
 } Clock;
 
 extern char *time1_format;
@@ -49,6 +52,8 @@ void cleanup_clock();
 void init_clock();
 void init_clock_panel(void *panel);
 void clock_default_font_changed();
+// Forgets what was measured with the previous fonts, after the config changed them
+void clock_fonts_changed();
 
 void draw_clock(void *obj, cairo_t *c);
 
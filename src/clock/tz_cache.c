@@ -0,0 +1,294 @@
+/**************************************************************************
+*
+* Tint2 : timezone cache
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "tz_cache.h"
+
+// Timezone transitions happen on quarter hour boundaries (in UTC as well as in local time)
+#define TZ_GRANULARITY 900
+#define TZ_MAX_ABBREVIATION_LEN 16
+
+typedef struct TzType {
+    gint32 utc_offset;
+    gboolean is_dst;
+    int abbreviation;
+} TzType;
+
+typedef struct TzZone {
+    char *name;
+    // TZif data; num_transitions is 0 if the file could not be loaded
+    gint64 *transitions;
+    guint8 *transition_types;
+    int num_transitions;
+    TzType *types;
+    int num_types;
+    char *abbreviations;
+    // Offset computed by the C library, valid in [fallback_start, fallback_end)
+    time_t fallback_start;
+    time_t fallback_end;
+    long fallback_utc_offset;
+    int fallback_is_dst;
+    char fallback_abbreviation[TZ_MAX_ABBREVIATION_LEN];
+} TzZone;
+
+static GSList *zones = NULL;
+
+static guint32 read_be32(const guint8 *p)
+{
+    return ((guint32)p[0] << 24) | ((guint32)p[1] << 16) | ((guint32)p[2] << 8) | (guint32)p[3];
+}
+
+static gint64 read_be64(const guint8 *p)
+{
+    return (gint64)(((guint64)read_be32(p) << 32) | read_be32(p + 4));
+}
+
+static char *tz_file_path(const char *name)
+{
+    if (name[0] == ':')
+        name++;
+    if (!name[0])
+        return NULL;
+    if (name[0] == '/')
+        return g_strdup(name);
+    const char *dir = getenv("TZDIR");
+    return g_build_filename(dir && dir[0] ? dir : "/usr/share/zoneinfo", name, NULL);
+}
+
+// Parses TZif data (RFC 8536) into the zone. Returns FALSE if the data is invalid or not usable.
+static gboolean tz_parse(TzZone *zone, const guint8 *data, size_t size)
+{
+    const size_t header_size = 44;
+    if (size < header_size || memcmp(data, "TZif", 4) != 0)
+        return FALSE;
+    int time_size = 4;
+    if (data[4] >= '2') {
+        // Skip the 32-bit data block, the 64-bit one follows
+        guint32 isutcnt = read_be32(data + 20);
+        guint32 isstdcnt = read_be32(data + 24);
+        guint32 leapcnt = read_be32(data + 28);
+        guint32 timecnt = read_be32(data + 32);
+        guint32 typecnt = read_be32(data + 36);
+        guint32 charcnt = read_be32(data + 40);
+        size_t v1_size = (size_t)timecnt * 5 + (size_t)typecnt * 6 + charcnt + (size_t)leapcnt * 8 + isstdcnt +
+                         isutcnt;
+        if (size < header_size + v1_size + header_size)
+            return FALSE;
+        data += header_size + v1_size;
+        size -= header_size + v1_size;
+        if (memcmp(data, "TZif", 4) != 0)
+            return FALSE;
+        time_size = 8;
+    }
+    guint32 leapcnt = read_be32(data + 28);
+    guint32 timecnt = read_be32(data + 32);
+    guint32 typecnt = read_be32(data + 36);
+    guint32 charcnt = read_be32(data + 40);
+    // With leap seconds time_t does not count POSIX seconds, leave these zones to the C library
+    if (leapcnt || !timecnt || !typecnt || !charcnt || timecnt > 100000 || typecnt > 256 || charcnt > 65536)
+        return FALSE;
+    if (size < header_size + (size_t)timecnt * (time_size + 1) + (size_t)typecnt * 6 + charcnt)
+        return FALSE;
+    const guint8 *p = data + header_size;
+
+    zone->transitions = calloc(timecnt, sizeof(gint64));
+    zone->transition_types = calloc(timecnt, 1);
+    zone->types = calloc(typecnt, sizeof(TzType));
+    zone->abbreviations = calloc(charcnt + 1, 1);
+    for (guint32 i = 0; i < timecnt; i++, p += time_size)
+        zone->transitions[i] = time_size == 8 ? read_be64(p) : (gint32)read_be32(p);
+    for (guint32 i = 0; i < timecnt; i++, p++) {
+        if (*p >= typecnt)
+            return FALSE;
+        zone->transition_types[i] = *p;
+    }
+    for (guint32 i = 0; i < typecnt; i++, p += 6) {
+        zone->types[i].utc_offset = (gint32)read_be32(p);
+        zone->types[i].is_dst = p[4] != 0;
+        zone->types[i].abbreviation = p[5];
+        if (p[5] >= charcnt)
+            return FALSE;
+    }
+    memcpy(zone->abbreviations, p, charcnt);
+    zone->num_types = (int)typecnt;
+    zone->num_transitions = (int)timecnt;
+    return TRUE;
+}
+
+static void tz_free_table(TzZone *zone)
+{
+    free(zone->transitions);
+    zone->transitions = NULL;
+    free(zone->transition_types);
+    zone->transition_types = NULL;
+    free(zone->types);
+    zone->types = NULL;
+    free(zone->abbreviations);
+    zone->abbreviations = NULL;
+    zone->num_transitions = 0;
+    zone->num_types = 0;
+}
+
+static TzZone *tz_load(const char *name)
+{
+    TzZone *zone = calloc(1, sizeof(TzZone));
+    zone->name = strdup(name);
+
+    char *path = tz_file_path(name);
+    gchar *contents = NULL;
+    gsize size = 0;
+    if (path && g_file_get_contents(path, &contents, &size, NULL)) {
+        if (!tz_parse(zone, (const guint8 *)contents, size))
+            tz_free_table(zone);
+    }
+    g_free(contents);
+    g_free(path);
+    return zone;
+}
+
+static TzZone *tz_get(const char *name)
+{
+    for (GSList *l = zones; l; l = l->next) {
+        TzZone *zone = (TzZone *)l->data;
+        if (strcmp(zone->name, name) == 0)
+            return zone;
+    }
+    TzZone *zone = tz_load(name);
+    zones = g_slist_prepend(zones, zone);
+    return zone;
+}
+
+static void tz_fallback_update(TzZone *zone, time_t t)
+{
+    const char *old_tz = getenv("TZ");
+    char *saved_tz = old_tz ? strdup(old_tz) : NULL;
+    setenv("TZ", zone->name, 1);
+    tzset();
+    struct tm local;
+    localtime_r(&t, &local);
+    if (saved_tz)
+        setenv("TZ", saved_tz, 1);
+    else
+        unsetenv("TZ");
+    tzset();
+    free(saved_tz);
+
+    zone->fallback_utc_offset = local.tm_gmtoff;
+    zone->fallback_is_dst = local.tm_isdst;
+    snprintf(zone->fallback_abbreviation,
+             sizeof(zone->fallback_abbreviation),
+             "%s",
+             local.tm_zone ? local.tm_zone : "");
+    zone->fallback_start = t - (t % TZ_GRANULARITY + TZ_GRANULARITY) % TZ_GRANULARITY;
+    zone->fallback_end = zone->fallback_start + TZ_GRANULARITY;
+}
+
+void tz_cache_localtime(const char *timezone, time_t t, struct tm *result)
+{
+    if (!timezone) {
+        localtime_r(&t, result);
+        return;
+    }
+
+    TzZone *zone = tz_get(timezone);
+    long utc_offset;
+    int is_dst;
+    const char *abbreviation;
+    if (zone->num_transitions && t >= zone->transitions[0] && t < zone->transitions[zone->num_transitions - 1]) {
+        // Find the last transition not after t
+        int low = 0, high = zone->num_transitions - 1;
+        while (high - low > 1) {
+            int middle = low + (high - low) / 2;
+            if (zone->transitions[middle] <= t)
+                low = middle;
+            else
+                high = middle;
+        }
+        TzType *type = &zone->types[zone->transition_types[low]];
+        utc_offset = type->utc_offset;
+        is_dst = type->is_dst;
+        abbreviation = zone->abbreviations + type->abbreviation;
+    } else {
+        if (t < zone->fallback_start || t >= zone->fallback_end)
+            tz_fallback_update(zone, t);
+        utc_offset = zone->fallback_utc_offset;
+        is_dst = zone->fallback_is_dst;
+        abbreviation = zone->fallback_abbreviation;
+    }
+
+    time_t local_time = t + utc_offset;
+    gmtime_r(&local_time, result);
+    result->tm_isdst = is_dst;
+    result->tm_gmtoff = utc_offset;
+    result->tm_zone = abbreviation;
+}
+
+void cleanup_tz_cache()
+{
+    for (GSList *l = zones; l; l = l->next) {
+        TzZone *zone = (TzZone *)l->data;
+        tz_free_table(zone);
+        free(zone->name);
+        free(zone);
+    }
+    g_slist_free(zones);
+    zones = NULL;
+}
+
+TEST(tz_cache_matches_libc)
+{
+    const char *names[] = {"UTC", "Europe/Paris", "America/New_York", "Australia/Lord_Howe", "Asia/Kathmandu",
+                           "EST5EDT", "CET-1CEST,M3.5.0,M10.5.0/3"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        // From 1990 to 2040 in steps of about 5 days, to cross DST transitions both within and after the table.
+        // A 32-bit time_t stops in 2038.
+        gint64 end = sizeof(time_t) == 4 ? G_MAXINT32 : G_GINT64_CONSTANT(2208988800);
+        for (gint64 when = G_GINT64_CONSTANT(631152000); when < end; when += 5 * 24 * 3600 + 1234) {
+            time_t t = (time_t)when;
+            struct tm expected, actual;
+            const char *old_tz = getenv("TZ");
+            char *saved_tz = old_tz ? strdup(old_tz) : NULL;
+            setenv("TZ", names[i], 1);
+            tzset();
+            localtime_r(&t, &expected);
+            if (saved_tz)
+                setenv("TZ", saved_tz, 1);
+            else
+                unsetenv("TZ");
+            tzset();
+            free(saved_tz);
+
+            tz_cache_localtime(names[i], t, &actual);
+            ASSERT_EQUAL(actual.tm_year, expected.tm_year);
+            ASSERT_EQUAL(actual.tm_yday, expected.tm_yday);
+            ASSERT_EQUAL(actual.tm_hour, expected.tm_hour);
+            ASSERT_EQUAL(actual.tm_min, expected.tm_min);
+            ASSERT_EQUAL(actual.tm_sec, expected.tm_sec);
+            ASSERT_EQUAL(actual.tm_isdst, expected.tm_isdst);
+            ASSERT_EQUAL(actual.tm_gmtoff, expected.tm_gmtoff);
+            ASSERT_STR_EQUAL(actual.tm_zone, expected.tm_zone);
+        }
+    }
+    cleanup_tz_cache();
+}
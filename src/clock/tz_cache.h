@@ -0,0 +1,19 @@
+#ifndef TZ_CACHE_H
+#define TZ_CACHE_H
+
+#include <time.h>
+
+// Converts times to broken-down local time in a named timezone (TZ syntax, e.g. "Europe/Paris" or ":UTC").
+// Each timezone is loaded once: its TZif file is parsed into a table of UTC offsets, so that conversions do not
+// have to change TZ and make the C library reload the zoneinfo file.
+// Times the table does not cover (e.g. after the last transition, or zones without a TZif file such as POSIX TZ
+// rules) are converted by the C library, and the offset it returns is reused until the next quarter hour, the
+// finest granularity of timezone transitions.
+
+// Fills result with the broken-down time of t in the timezone, or in the system timezone if timezone is NULL.
+// The tm_zone field of the result remains valid until cleanup_tz_cache() is called.
+void tz_cache_localtime(const char *timezone, time_t t, struct tm *result);
+
+void cleanup_tz_cache();
+
+#endif
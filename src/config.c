@@ -42,6 +42,7 @@
 #include "common.h"
 #include "server.h"
 #include "strnatcmp.h"
+#include "test.h"
 #include "panel.h"
 #include "task.h"
 #include "taskbar.h"
@@ -239,28 +240,239 @@ Button *get_or_create_last_button()
     return (Button *)g_list_last(panel_config.button_list)->data;
 }
 
-void add_entry(char *key, char *value)
+// One value per config key, so that the handlers do not compare the key again
+typedef enum ConfigKeyId {
+    CONFIG_KEY_AC_CONNECTED_CMD,
+    CONFIG_KEY_AC_DISCONNECTED_CMD,
+    CONFIG_KEY_AUTOHIDE,
+    CONFIG_KEY_AUTOHIDE_HEIGHT,
+    CONFIG_KEY_AUTOHIDE_HIDE_TIMEOUT,
+    CONFIG_KEY_AUTOHIDE_SHOW_TIMEOUT,
+    CONFIG_KEY_BACKGROUND_COLOR,
+    CONFIG_KEY_BACKGROUND_COLOR_HOVER,
+    CONFIG_KEY_BACKGROUND_COLOR_PRESSED,
+    CONFIG_KEY_BACKGROUND_CONTENT_TINT_WEIGHT,
+    CONFIG_KEY_BAT1_FONT,
+    CONFIG_KEY_BAT1_FORMAT,
+    CONFIG_KEY_BAT2_FONT,
+    CONFIG_KEY_BAT2_FORMAT,
+    CONFIG_KEY_BATTERY,
+    CONFIG_KEY_BATTERY_BACKGROUND_ID,
+    CONFIG_KEY_BATTERY_DWHEEL_COMMAND,
+    CONFIG_KEY_BATTERY_FONT_COLOR,
+    CONFIG_KEY_BATTERY_FULL_CMD,
+    CONFIG_KEY_BATTERY_HIDE,
+    CONFIG_KEY_BATTERY_LCLICK_COMMAND,
+    CONFIG_KEY_BATTERY_LOW_CMD,
+    CONFIG_KEY_BATTERY_LOW_STATUS,
+    CONFIG_KEY_BATTERY_MCLICK_COMMAND,
+    CONFIG_KEY_BATTERY_PADDING,
+    CONFIG_KEY_BATTERY_RCLICK_COMMAND,
+    CONFIG_KEY_BATTERY_TOOLTIP,
+    CONFIG_KEY_BATTERY_UWHEEL_COMMAND,
+    CONFIG_KEY_BORDER_COLOR,
+    CONFIG_KEY_BORDER_COLOR_HOVER,
+    CONFIG_KEY_BORDER_COLOR_PRESSED,
+    CONFIG_KEY_BORDER_CONTENT_TINT_WEIGHT,
+    CONFIG_KEY_BORDER_SIDES,
+    CONFIG_KEY_BORDER_WIDTH,
+    CONFIG_KEY_BUTTON,
+    CONFIG_KEY_BUTTON_BACKGROUND_ID,
+    CONFIG_KEY_BUTTON_CENTERED,
+    CONFIG_KEY_BUTTON_DWHEEL_COMMAND,
+    CONFIG_KEY_BUTTON_FONT,
+    CONFIG_KEY_BUTTON_FONT_COLOR,
+    CONFIG_KEY_BUTTON_ICON,
+    CONFIG_KEY_BUTTON_LCLICK_COMMAND,
+    CONFIG_KEY_BUTTON_MAX_ICON_SIZE,
+    CONFIG_KEY_BUTTON_MCLICK_COMMAND,
+    CONFIG_KEY_BUTTON_PADDING,
+    CONFIG_KEY_BUTTON_RCLICK_COMMAND,
+    CONFIG_KEY_BUTTON_TEXT,
+    CONFIG_KEY_BUTTON_TOOLTIP,
+    CONFIG_KEY_BUTTON_UWHEEL_COMMAND,
+    CONFIG_KEY_CLOCK_BACKGROUND_ID,
+    CONFIG_KEY_CLOCK_DWHEEL_COMMAND,
+    CONFIG_KEY_CLOCK_FONT_COLOR,
+    CONFIG_KEY_CLOCK_LCLICK_COMMAND,
+    CONFIG_KEY_CLOCK_MCLICK_COMMAND,
+    CONFIG_KEY_CLOCK_PADDING,
+    CONFIG_KEY_CLOCK_RCLICK_COMMAND,
+    CONFIG_KEY_CLOCK_TOOLTIP,
+    CONFIG_KEY_CLOCK_TOOLTIP_TIMEZONE,
+    CONFIG_KEY_CLOCK_UWHEEL_COMMAND,
+    CONFIG_KEY_COLOR_STOP,
+    CONFIG_KEY_DISABLE_TRANSPARENCY,
+    CONFIG_KEY_END_COLOR,
+    CONFIG_KEY_EXECP,
+    CONFIG_KEY_EXECP_BACKGROUND_ID,
+    CONFIG_KEY_EXECP_CACHE_ICON,
+    CONFIG_KEY_EXECP_CENTERED,
+    CONFIG_KEY_EXECP_COMMAND,
+    CONFIG_KEY_EXECP_CONTINUOUS,
+    CONFIG_KEY_EXECP_COPROCESS,
+    CONFIG_KEY_EXECP_DWHEEL_COMMAND,
+    CONFIG_KEY_EXECP_FONT,
+    CONFIG_KEY_EXECP_FONT_COLOR,
+    CONFIG_KEY_EXECP_HAS_ICON,
+    CONFIG_KEY_EXECP_ICON_H,
+    CONFIG_KEY_EXECP_ICON_W,
+    CONFIG_KEY_EXECP_INTERVAL,
+    CONFIG_KEY_EXECP_LCLICK_COMMAND,
+    CONFIG_KEY_EXECP_MARKUP,
+    CONFIG_KEY_EXECP_MCLICK_COMMAND,
+    CONFIG_KEY_EXECP_PADDING,
+    CONFIG_KEY_EXECP_RCLICK_COMMAND,
+    CONFIG_KEY_EXECP_TOOLTIP,
+    CONFIG_KEY_EXECP_UWHEEL_COMMAND,
+    CONFIG_KEY_FONT_SHADOW,
+    CONFIG_KEY_GRADIENT,
+    CONFIG_KEY_GRADIENT_ID,
+    CONFIG_KEY_GRADIENT_ID_HOVER,
+    CONFIG_KEY_GRADIENT_ID_PRESSED,
+    CONFIG_KEY_HOVER_GRADIENT_ID,
+    CONFIG_KEY_LAUNCHER_APPS_DIR,
+    CONFIG_KEY_LAUNCHER_BACKGROUND_ID,
+    CONFIG_KEY_LAUNCHER_ICON_ASB,
+    CONFIG_KEY_LAUNCHER_ICON_BACKGROUND_ID,
+    CONFIG_KEY_LAUNCHER_ICON_SIZE,
+    CONFIG_KEY_LAUNCHER_ICON_THEME,
+    CONFIG_KEY_LAUNCHER_ICON_THEME_OVERRIDE,
+    CONFIG_KEY_LAUNCHER_ITEM_APP,
+    CONFIG_KEY_LAUNCHER_PADDING,
+    CONFIG_KEY_LAUNCHER_TOOLTIP,
+    CONFIG_KEY_MOUSE_EFFECTS,
+    CONFIG_KEY_MOUSE_HOVER_ICON_ASB,
+    CONFIG_KEY_MOUSE_LEFT,
+    CONFIG_KEY_MOUSE_MIDDLE,
+    CONFIG_KEY_MOUSE_PRESSED_ICON_ASB,
+    CONFIG_KEY_MOUSE_RIGHT,
+    CONFIG_KEY_MOUSE_SCROLL_DOWN,
+    CONFIG_KEY_MOUSE_SCROLL_UP,
+    CONFIG_KEY_PANEL_BACKGROUND_ID,
+    CONFIG_KEY_PANEL_DOCK,
+    CONFIG_KEY_PANEL_ITEMS,
+    CONFIG_KEY_PANEL_LAYER,
+    CONFIG_KEY_PANEL_MARGIN,
+    CONFIG_KEY_PANEL_MONITOR,
+    CONFIG_KEY_PANEL_PADDING,
+    CONFIG_KEY_PANEL_PIVOT_STRUTS,
+    CONFIG_KEY_PANEL_POSITION,
+    CONFIG_KEY_PANEL_SHRINK,
+    CONFIG_KEY_PANEL_SIZE,
+    CONFIG_KEY_PANEL_WINDOW_NAME,
+    CONFIG_KEY_PRESSED_GRADIENT_ID,
+    CONFIG_KEY_PRIMARY_MONITOR_FIRST,
+    CONFIG_KEY_ROUNDED,
+    CONFIG_KEY_SCALE_RELATIVE_TO_DPI,
+    CONFIG_KEY_SCALE_RELATIVE_TO_SCREEN_HEIGHT,
+    CONFIG_KEY_SEPARATOR,
+    CONFIG_KEY_SEPARATOR_BACKGROUND_ID,
+    CONFIG_KEY_SEPARATOR_COLOR,
+    CONFIG_KEY_SEPARATOR_PADDING,
+    CONFIG_KEY_SEPARATOR_SIZE,
+    CONFIG_KEY_SEPARATOR_STYLE,
+    CONFIG_KEY_START_COLOR,
+    CONFIG_KEY_STARTUP_NOTIFICATIONS,
+    CONFIG_KEY_STRUT_POLICY,
+    CONFIG_KEY_SYSTRAY,
+    CONFIG_KEY_SYSTRAY_BACKGROUND_ID,
+    CONFIG_KEY_SYSTRAY_ICON_ASB,
+    CONFIG_KEY_SYSTRAY_ICON_SIZE,
+    CONFIG_KEY_SYSTRAY_MONITOR,
+    CONFIG_KEY_SYSTRAY_NAME_FILTER,
+    CONFIG_KEY_SYSTRAY_PADDING,
+    CONFIG_KEY_SYSTRAY_SORT,
+    CONFIG_KEY_TASK_ACTIVE_BACKGROUND_ID,
+    CONFIG_KEY_TASK_ACTIVE_FONT_COLOR,
+    CONFIG_KEY_TASK_ACTIVE_ICON_ASB,
+    CONFIG_KEY_TASK_ALIGN,
+    CONFIG_KEY_TASK_BACKGROUND_ID,
+    CONFIG_KEY_TASK_CENTERED,
+    CONFIG_KEY_TASK_FONT,
+    CONFIG_KEY_TASK_FONT_COLOR,
+    CONFIG_KEY_TASK_ICON,
+    CONFIG_KEY_TASK_ICON_ASB,
+    CONFIG_KEY_TASK_ICONIFIED_BACKGROUND_ID,
+    CONFIG_KEY_TASK_ICONIFIED_FONT_COLOR,
+    CONFIG_KEY_TASK_ICONIFIED_ICON_ASB,
+    CONFIG_KEY_TASK_MAXIMUM_SIZE,
+    CONFIG_KEY_TASK_PADDING,
+    CONFIG_KEY_TASK_TEXT,
+    CONFIG_KEY_TASK_THUMBNAIL,
+    CONFIG_KEY_TASK_THUMBNAIL_SIZE,
+    CONFIG_KEY_TASK_TOOLTIP,
+    CONFIG_KEY_TASK_URGENT_BACKGROUND_ID,
+    CONFIG_KEY_TASK_URGENT_FONT_COLOR,
+    CONFIG_KEY_TASK_URGENT_ICON_ASB,
+    CONFIG_KEY_TASK_WIDTH,
+    CONFIG_KEY_TASKBAR_ACTIVE_BACKGROUND_ID,
+    CONFIG_KEY_TASKBAR_ALWAYS_SHOW_ALL_DESKTOP_TASKS,
+    CONFIG_KEY_TASKBAR_BACKGROUND_ID,
+    CONFIG_KEY_TASKBAR_DISTRIBUTE_SIZE,
+    CONFIG_KEY_TASKBAR_HIDE_DIFFERENT_DESKTOP,
+    CONFIG_KEY_TASKBAR_HIDE_DIFFERENT_MONITOR,
+    CONFIG_KEY_TASKBAR_HIDE_IF_EMPTY,
+    CONFIG_KEY_TASKBAR_HIDE_INACTIVE_TASKS,
+    CONFIG_KEY_TASKBAR_MODE,
+    CONFIG_KEY_TASKBAR_NAME,
+    CONFIG_KEY_TASKBAR_NAME_ACTIVE_BACKGROUND_ID,
+    CONFIG_KEY_TASKBAR_NAME_ACTIVE_FONT_COLOR,
+    CONFIG_KEY_TASKBAR_NAME_BACKGROUND_ID,
+    CONFIG_KEY_TASKBAR_NAME_FONT,
+    CONFIG_KEY_TASKBAR_NAME_FONT_COLOR,
+    CONFIG_KEY_TASKBAR_NAME_PADDING,
+    CONFIG_KEY_TASKBAR_PADDING,
+    CONFIG_KEY_TASKBAR_SORT_ORDER,
+    CONFIG_KEY_TIME1_FONT,
+    CONFIG_KEY_TIME1_FORMAT,
+    CONFIG_KEY_TIME1_TIMEZONE,
+    CONFIG_KEY_TIME2_FONT,
+    CONFIG_KEY_TIME2_FORMAT,
+    CONFIG_KEY_TIME2_TIMEZONE,
+    CONFIG_KEY_TOOLTIP,
+    CONFIG_KEY_TOOLTIP_BACKGROUND_ID,
+    CONFIG_KEY_TOOLTIP_FONT,
+    CONFIG_KEY_TOOLTIP_FONT_COLOR,
+    CONFIG_KEY_TOOLTIP_HIDE_TIMEOUT,
+    CONFIG_KEY_TOOLTIP_PADDING,
+    CONFIG_KEY_TOOLTIP_SHOW_TIMEOUT,
+    CONFIG_KEY_URGENT_NB_OF_BLINK,
+    CONFIG_KEY_WM_MENU,
+} ConfigKeyId;
+
+// Background and border
+
+// The hover and pressed colors default to the normal ones when the last background does not set them
+static void finish_background()
+{
+    if (backgrounds->len == 0)
+        return;
+    Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
+    if (!read_bg_color_hover)
+        memcpy(&bg->fill_color_hover, &bg->fill_color, sizeof(Color));
+    if (!read_border_color_hover)
+        memcpy(&bg->border_color_hover, &bg->border, sizeof(Color));
+    if (!read_bg_color_press)
+        memcpy(&bg->fill_color_pressed, &bg->fill_color_hover, sizeof(Color));
+    if (!read_border_color_press)
+        memcpy(&bg->border_color_pressed, &bg->border_color_hover, sizeof(Color));
+}
+
+static void add_background_entry(ConfigKeyId key_id, char *key, char *value)
 {
     char *value1 = 0, *value2 = 0, *value3 = 0;
 
-    /* Background and border */
-    if (strcmp(key, "scale_relative_to_dpi") == 0) {
+    switch (key_id) {
+    case CONFIG_KEY_SCALE_RELATIVE_TO_DPI:
         ui_scale_dpi_ref = atof(value);
-    } else if (strcmp(key, "scale_relative_to_screen_height") == 0) {
+        break;
+    case CONFIG_KEY_SCALE_RELATIVE_TO_SCREEN_HEIGHT:
         ui_scale_monitor_size_ref = atof(value);
-    } else if (strcmp(key, "rounded") == 0) {
+        break;
+    case CONFIG_KEY_ROUNDED: {
         // 'rounded' is the first parameter => alloc a new background
-        if (backgrounds->len > 0) {
-            Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
-            if (!read_bg_color_hover)
-                memcpy(&bg->fill_color_hover, &bg->fill_color, sizeof(Color));
-            if (!read_border_color_hover)
-                memcpy(&bg->border_color_hover, &bg->border, sizeof(Color));
-            if (!read_bg_color_press)
-                memcpy(&bg->fill_color_pressed, &bg->fill_color_hover, sizeof(Color));
-            if (!read_border_color_press)
-                memcpy(&bg->border_color_pressed, &bg->border_color_hover, sizeof(Color));
-        }
+        finish_background();
         Background bg;
         init_background(&bg);
         bg.border.radius = atoi(value);
@@ -269,9 +481,12 @@ void add_entry(char *key, char *value)
         read_border_color_hover = FALSE;
         read_bg_color_press = FALSE;
         read_border_color_press = FALSE;
-    } else if (strcmp(key, "border_width") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BORDER_WIDTH:
         g_array_index(backgrounds, Background, backgrounds->len - 1).border.width = atoi(value);
-    } else if (strcmp(key, "border_sides") == 0) {
+        break;
+    case CONFIG_KEY_BORDER_SIDES: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         bg->border.mask = 0;
         if (strchr(value, 'l') || strchr(value, 'L'))
@@ -284,7 +499,9 @@ void add_entry(char *key, char *value)
             bg->border.mask |= BORDER_BOTTOM;
         if (!bg->border.mask)
             bg->border.width = 0;
-    } else if (strcmp(key, "background_color") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BACKGROUND_COLOR: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, bg->fill_color.rgb);
@@ -292,7 +509,9 @@ void add_entry(char *key, char *value)
             bg->fill_color.alpha = (atoi(value2) / 100.0);
         else
             bg->fill_color.alpha = 0.5;
-    } else if (strcmp(key, "border_color") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BORDER_COLOR: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, bg->border.color.rgb);
@@ -300,7 +519,9 @@ void add_entry(char *key, char *value)
             bg->border.color.alpha = (atoi(value2) / 100.0);
         else
             bg->border.color.alpha = 0.5;
-    } else if (strcmp(key, "background_color_hover") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BACKGROUND_COLOR_HOVER: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, bg->fill_color_hover.rgb);
@@ -309,7 +530,9 @@ void add_entry(char *key, char *value)
         else
             bg->fill_color_hover.alpha = 0.5;
         read_bg_color_hover = 1;
-    } else if (strcmp(key, "border_color_hover") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BORDER_COLOR_HOVER: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, bg->border_color_hover.rgb);
@@ -318,7 +541,9 @@ void add_entry(char *key, char *value)
         else
             bg->border_color_hover.alpha = 0.5;
         read_border_color_hover = 1;
-    } else if (strcmp(key, "background_color_pressed") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BACKGROUND_COLOR_PRESSED: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, bg->fill_color_pressed.rgb);
@@ -327,7 +552,9 @@ void add_entry(char *key, char *value)
         else
             bg->fill_color_pressed.alpha = 0.5;
         read_bg_color_press = 1;
-    } else if (strcmp(key, "border_color_pressed") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BORDER_COLOR_PRESSED: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, bg->border_color_pressed.rgb);
@@ -336,39 +563,67 @@ void add_entry(char *key, char *value)
         else
             bg->border_color_pressed.alpha = 0.5;
         read_border_color_press = 1;
-    } else if (strcmp(key, "gradient_id") == 0) {
+        break;
+    }
+    case CONFIG_KEY_GRADIENT_ID: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         int id = atoi(value);
         id = (id < gradients->len && id >= 0) ? id : -1;
         if (id >= 0)
             bg->gradients[MOUSE_NORMAL] = &g_array_index(gradients, GradientClass, id);
-    } else if (strcmp(key, "gradient_id_hover") == 0 || strcmp(key, "hover_gradient_id") == 0) {
+        break;
+    }
+    case CONFIG_KEY_GRADIENT_ID_HOVER:
+    case CONFIG_KEY_HOVER_GRADIENT_ID: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         int id = atoi(value);
         id = (id < gradients->len && id >= 0) ? id : -1;
         if (id >= 0)
             bg->gradients[MOUSE_OVER] = &g_array_index(gradients, GradientClass, id);
-    } else if (strcmp(key, "gradient_id_pressed") == 0 || strcmp(key, "pressed_gradient_id") == 0) {
+        break;
+    }
+    case CONFIG_KEY_GRADIENT_ID_PRESSED:
+    case CONFIG_KEY_PRESSED_GRADIENT_ID: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         int id = atoi(value);
         id = (id < gradients->len && id >= 0) ? id : -1;
         if (id >= 0)
             bg->gradients[MOUSE_DOWN] = &g_array_index(gradients, GradientClass, id);
-    } else if (strcmp(key, "border_content_tint_weight") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BORDER_CONTENT_TINT_WEIGHT: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         bg->border_content_tint_weight = MAX(0.0, MIN(1.0, atoi(value) / 100.));
-    } else if (strcmp(key, "background_content_tint_weight") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BACKGROUND_CONTENT_TINT_WEIGHT: {
         Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
         bg->fill_content_tint_weight = MAX(0.0, MIN(1.0, atoi(value) / 100.));
+        break;
+    }
+    default:
+        break;
     }
 
-    /* Gradients */
-    else if (strcmp(key, "gradient") == 0) {
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Gradients
+static void add_gradient_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_GRADIENT: {
         // Create a new gradient
         GradientClass g;
         init_gradient(&g, gradient_type_from_string(value));
         g_array_append_val(gradients, g);
-    } else if (strcmp(key, "start_color") == 0) {
+        break;
+    }
+    case CONFIG_KEY_START_COLOR: {
         GradientClass *g = &g_array_index(gradients, GradientClass, gradients->len - 1);
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, g->start_color.rgb);
@@ -376,7 +631,9 @@ void add_entry(char *key, char *value)
             g->start_color.alpha = (atoi(value2) / 100.0);
         else
             g->start_color.alpha = 0.5;
-    } else if (strcmp(key, "end_color") == 0) {
+        break;
+    }
+    case CONFIG_KEY_END_COLOR: {
         GradientClass *g = &g_array_index(gradients, GradientClass, gradients->len - 1);
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, g->end_color.rgb);
@@ -384,7 +641,9 @@ void add_entry(char *key, char *value)
             g->end_color.alpha = (atoi(value2) / 100.0);
         else
             g->end_color.alpha = 0.5;
-    } else if (strcmp(key, "color_stop") == 0) {
+        break;
+    }
+    case CONFIG_KEY_COLOR_STOP: {
         GradientClass *g = &g_array_index(gradients, GradientClass, gradients->len - 1);
         extract_values(value, &value1, &value2, &value3);
         ColorStop *color_stop = (ColorStop *)calloc(1, sizeof(ColorStop));
@@ -395,14 +654,30 @@ void add_entry(char *key, char *value)
         else
             color_stop->color.alpha = 0.5;
         g->extra_color_stops = g_list_append(g->extra_color_stops, color_stop);
+        break;
     }
+    default:
+        break;
+    }
+
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Panel
+static void add_panel_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
 
-    /* Panel */
-    else if (strcmp(key, "panel_monitor") == 0) {
+    switch (key_id) {
+    case CONFIG_KEY_PANEL_MONITOR:
         panel_config.monitor = config_get_monitor(value);
-    } else if (strcmp(key, "panel_shrink") == 0) {
+        break;
+    case CONFIG_KEY_PANEL_SHRINK:
         panel_shrink = atoi(value);
-    } else if (strcmp(key, "panel_size") == 0) {
+        break;
+    case CONFIG_KEY_PANEL_SIZE: {
         extract_values(value, &value1, &value2, &value3);
 
         char *b;
@@ -423,7 +698,9 @@ void add_entry(char *key, char *value)
             }
             panel_config.area.height = atoi(value2);
         }
-    } else if (strcmp(key, "panel_items") == 0) {
+        break;
+    }
+    case CONFIG_KEY_PANEL_ITEMS:
         new_config_file = TRUE;
         free_and_null(panel_items_order);
         panel_items_order = strdup(value);
@@ -454,19 +731,22 @@ void add_entry(char *key, char *value)
             if (panel_items_order[j] == 'C')
                 clock_enabled = 1;
         }
-    } else if (strcmp(key, "panel_margin") == 0) {
+        break;
+    case CONFIG_KEY_PANEL_MARGIN:
         extract_values(value, &value1, &value2, &value3);
         panel_config.marginx = atoi(value1);
         if (value2)
             panel_config.marginy = atoi(value2);
-    } else if (strcmp(key, "panel_padding") == 0) {
+        break;
+    case CONFIG_KEY_PANEL_PADDING:
         extract_values(value, &value1, &value2, &value3);
         panel_config.area.paddingxlr = panel_config.area.paddingx = atoi(value1);
         if (value2)
             panel_config.area.paddingy = atoi(value2);
         if (value3)
             panel_config.area.paddingx = atoi(value3);
-    } else if (strcmp(key, "panel_position") == 0) {
+        break;
+    case CONFIG_KEY_PANEL_POSITION:
         read_panel_position = TRUE;
         extract_values(value, &value1, &value2, &value3);
         if (strcmp(value1, "top") == 0)
@@ -498,99 +778,134 @@ void add_entry(char *key, char *value)
             else
                 panel_horizontal = 1;
         }
-    } else if (strcmp(key, "font_shadow") == 0)
+        break;
+    case CONFIG_KEY_FONT_SHADOW:
         panel_config.font_shadow = atoi(value);
-    else if (strcmp(key, "panel_background_id") == 0) {
+        break;
+    case CONFIG_KEY_PANEL_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         panel_config.area.bg = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "wm_menu") == 0)
+        break;
+    }
+    case CONFIG_KEY_WM_MENU:
         wm_menu = atoi(value);
-    else if (strcmp(key, "panel_dock") == 0)
+        break;
+    case CONFIG_KEY_PANEL_DOCK:
         panel_dock = atoi(value);
-    else if (strcmp(key, "panel_pivot_struts") == 0)
+        break;
+    case CONFIG_KEY_PANEL_PIVOT_STRUTS:
         panel_pivot_struts = atoi(value);
-    else if (strcmp(key, "urgent_nb_of_blink") == 0)
+        break;
+    case CONFIG_KEY_URGENT_NB_OF_BLINK:
         max_tick_urgent = atoi(value);
-    else if (strcmp(key, "panel_layer") == 0) {
+        break;
+    case CONFIG_KEY_PANEL_LAYER:
         if (strcmp(value, "bottom") == 0)
             panel_layer = BOTTOM_LAYER;
         else if (strcmp(value, "top") == 0)
             panel_layer = TOP_LAYER;
         else
             panel_layer = NORMAL_LAYER;
-    } else if (strcmp(key, "disable_transparency") == 0) {
+        break;
+    case CONFIG_KEY_DISABLE_TRANSPARENCY:
         server.disable_transparency = atoi(value);
-    } else if (strcmp(key, "panel_window_name") == 0) {
+        break;
+    case CONFIG_KEY_PANEL_WINDOW_NAME:
         if (strlen(value) > 0) {
             free(panel_window_name);
             panel_window_name = strdup(value);
         }
+        break;
+    default:
+        break;
     }
 
-    /* Battery */
-    else if (strcmp(key, "battery_low_status") == 0) {
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Battery
+static void add_battery_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_BATTERY_LOW_STATUS:
 #ifdef ENABLE_BATTERY
         battery_low_status = atoi(value);
         if (battery_low_status < 0 || battery_low_status > 100)
             battery_low_status = 0;
 #endif
-    } else if (strcmp(key, "battery_lclick_command") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_LCLICK_COMMAND:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0)
             battery_lclick_command = strdup(value);
 #endif
-    } else if (strcmp(key, "battery_mclick_command") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_MCLICK_COMMAND:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0)
             battery_mclick_command = strdup(value);
 #endif
-    } else if (strcmp(key, "battery_rclick_command") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_RCLICK_COMMAND:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0)
             battery_rclick_command = strdup(value);
 #endif
-    } else if (strcmp(key, "battery_uwheel_command") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_UWHEEL_COMMAND:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0)
             battery_uwheel_command = strdup(value);
 #endif
-    } else if (strcmp(key, "battery_dwheel_command") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_DWHEEL_COMMAND:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0)
             battery_dwheel_command = strdup(value);
 #endif
-    } else if (strcmp(key, "battery_low_cmd") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_LOW_CMD:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0)
             battery_low_cmd = strdup(value);
 #endif
-    } else if (strcmp(key, "battery_full_cmd") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_FULL_CMD:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0)
             battery_full_cmd = strdup(value);
 #endif
-    } else if (strcmp(key, "ac_connected_cmd") == 0) {
+        break;
+    case CONFIG_KEY_AC_CONNECTED_CMD:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0)
             ac_connected_cmd = strdup(value);
 #endif
-    } else if (strcmp(key, "ac_disconnected_cmd") == 0) {
+        break;
+    case CONFIG_KEY_AC_DISCONNECTED_CMD:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0)
             ac_disconnected_cmd = strdup(value);
 #endif
-    } else if (strcmp(key, "bat1_font") == 0) {
+        break;
+    case CONFIG_KEY_BAT1_FONT:
 #ifdef ENABLE_BATTERY
         bat1_font_desc = pango_font_description_from_string(value);
         bat1_has_font = TRUE;
 #endif
-    } else if (strcmp(key, "bat2_font") == 0) {
+        break;
+    case CONFIG_KEY_BAT2_FONT:
 #ifdef ENABLE_BATTERY
         bat2_font_desc = pango_font_description_from_string(value);
         bat2_has_font = TRUE;
 #endif
-    } else if (strcmp(key, "bat1_format") == 0) {
+        break;
+    case CONFIG_KEY_BAT1_FORMAT:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0) {
             free(bat1_format);
@@ -598,14 +913,16 @@ void add_entry(char *key, char *value)
             battery_enabled = 1;
         }
 #endif
-    } else if (strcmp(key, "bat2_format") == 0) {
+        break;
+    case CONFIG_KEY_BAT2_FORMAT:
 #ifdef ENABLE_BATTERY
         if (strlen(value) > 0) {
             free(bat2_format);
             bat2_format = strdup(value);
         }
 #endif
-    } else if (strcmp(key, "battery_font_color") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_FONT_COLOR:
 #ifdef ENABLE_BATTERY
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, panel_config.battery.font_color.rgb);
@@ -614,7 +931,8 @@ void add_entry(char *key, char *value)
         else
             panel_config.battery.font_color.alpha = 0.5;
 #endif
-    } else if (strcmp(key, "battery_padding") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_PADDING:
 #ifdef ENABLE_BATTERY
         extract_values(value, &value1, &value2, &value3);
         panel_config.battery.area.paddingxlr = panel_config.battery.area.paddingx = atoi(value1);
@@ -623,33 +941,53 @@ void add_entry(char *key, char *value)
         if (value3)
             panel_config.battery.area.paddingx = atoi(value3);
 #endif
-    } else if (strcmp(key, "battery_background_id") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_BACKGROUND_ID: {
 #ifdef ENABLE_BATTERY
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         panel_config.battery.area.bg = &g_array_index(backgrounds, Background, id);
 #endif
-    } else if (strcmp(key, "battery_hide") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BATTERY_HIDE:
 #ifdef ENABLE_BATTERY
         percentage_hide = atoi(value);
         if (percentage_hide == 0)
             percentage_hide = 101;
 #endif
-    } else if (strcmp(key, "battery_tooltip") == 0) {
+        break;
+    case CONFIG_KEY_BATTERY_TOOLTIP:
 #ifdef ENABLE_BATTERY
         battery_tooltip_enabled = atoi(value);
 #endif
+        break;
+    default:
+        break;
     }
 
-    /* Separator */
-    else if (strcmp(key, "separator") == 0) {
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Separator
+static void add_separator_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_SEPARATOR:
         panel_config.separator_list = g_list_append(panel_config.separator_list, create_separator());
-    } else if (strcmp(key, "separator_background_id") == 0) {
+        break;
+    case CONFIG_KEY_SEPARATOR_BACKGROUND_ID: {
         Separator *separator = get_or_create_last_separator();
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         separator->area.bg = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "separator_color") == 0) {
+        break;
+    }
+    case CONFIG_KEY_SEPARATOR_COLOR: {
         Separator *separator = get_or_create_last_separator();
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, separator->color.rgb);
@@ -657,7 +995,9 @@ void add_entry(char *key, char *value)
             separator->color.alpha = (atoi(value2) / 100.0);
         else
             separator->color.alpha = 0.5;
-    } else if (strcmp(key, "separator_style") == 0) {
+        break;
+    }
+    case CONFIG_KEY_SEPARATOR_STYLE: {
         Separator *separator = get_or_create_last_separator();
         if (g_str_equal(value, "empty"))
             separator->style = SEPARATOR_EMPTY;
@@ -667,10 +1007,14 @@ void add_entry(char *key, char *value)
             separator->style = SEPARATOR_DOTS;
         else
             fprintf(stderr, RED "tint2: Invalid separator_style value: %s" RESET "\n", value);
-    } else if (strcmp(key, "separator_size") == 0) {
+        break;
+    }
+    case CONFIG_KEY_SEPARATOR_SIZE: {
         Separator *separator = get_or_create_last_separator();
         separator->thickness = atoi(value);
-    } else if (strcmp(key, "separator_padding") == 0) {
+        break;
+    }
+    case CONFIG_KEY_SEPARATOR_PADDING: {
         Separator *separator = get_or_create_last_separator();
         extract_values(value, &value1, &value2, &value3);
         separator->area.paddingxlr = separator->area.paddingx = atoi(value1);
@@ -678,17 +1022,34 @@ void add_entry(char *key, char *value)
             separator->area.paddingy = atoi(value2);
         if (value3)
             separator->area.paddingx = atoi(value3);
+        break;
+    }
+    default:
+        break;
     }
 
-    /* Execp */
-    else if (strcmp(key, "execp") == 0) {
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Execp
+static void add_execp_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_EXECP:
         panel_config.execp_list = g_list_append(panel_config.execp_list, create_execp());
-    } else if (strcmp(key, "execp_command") == 0) {
+        break;
+    case CONFIG_KEY_EXECP_COMMAND: {
         Execp *execp = get_or_create_last_execp();
         free_and_null(execp->backend->command);
         if (strlen(value) > 0)
             execp->backend->command = strdup(value);
-    } else if (strcmp(key, "execp_interval") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_INTERVAL: {
         Execp *execp = get_or_create_last_execp();
         execp->backend->interval = 0;
         int v = atoi(value);
@@ -697,29 +1058,48 @@ void add_entry(char *key, char *value)
         } else {
             execp->backend->interval = v;
         }
-    } else if (strcmp(key, "execp_has_icon") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_HAS_ICON: {
         Execp *execp = get_or_create_last_execp();
         execp->backend->has_icon = atoi(value);
-    } else if (strcmp(key, "execp_continuous") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_CONTINUOUS: {
         Execp *execp = get_or_create_last_execp();
         execp->backend->continuous = atoi(value);
-    } else if (strcmp(key, "execp_markup") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_COPROCESS: {
+        Execp *execp = get_or_create_last_execp();
+        execp->backend->coprocess = atoi(value);
+        break;
+    }
+    case CONFIG_KEY_EXECP_MARKUP: {
         Execp *execp = get_or_create_last_execp();
         execp->backend->has_markup = atoi(value);
-    } else if (strcmp(key, "execp_cache_icon") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_CACHE_ICON: {
         Execp *execp = get_or_create_last_execp();
         execp->backend->cache_icon = atoi(value);
-    } else if (strcmp(key, "execp_tooltip") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_TOOLTIP: {
         Execp *execp = get_or_create_last_execp();
         free_and_null(execp->backend->tooltip);
         execp->backend->tooltip = strdup(value);
         execp->backend->has_user_tooltip = TRUE;
-    } else if (strcmp(key, "execp_font") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_FONT: {
         Execp *execp = get_or_create_last_execp();
         pango_font_description_free(execp->backend->font_desc);
         execp->backend->font_desc = pango_font_description_from_string(value);
         execp->backend->has_font = TRUE;
-    } else if (strcmp(key, "execp_font_color") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_FONT_COLOR: {
         Execp *execp = get_or_create_last_execp();
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, execp->backend->font_color.rgb);
@@ -727,7 +1107,9 @@ void add_entry(char *key, char *value)
             execp->backend->font_color.alpha = atoi(value2) / 100.0;
         else
             execp->backend->font_color.alpha = 0.5;
-    } else if (strcmp(key, "execp_padding") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_PADDING: {
         Execp *execp = get_or_create_last_execp();
         extract_values(value, &value1, &value2, &value3);
         execp->backend->paddingxlr = execp->backend->paddingx = atoi(value1);
@@ -737,15 +1119,21 @@ void add_entry(char *key, char *value)
             execp->backend->paddingy = 0;
         if (value3)
             execp->backend->paddingx = atoi(value3);
-    } else if (strcmp(key, "execp_background_id") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_BACKGROUND_ID: {
         Execp *execp = get_or_create_last_execp();
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         execp->backend->bg = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "execp_centered") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_CENTERED: {
         Execp *execp = get_or_create_last_execp();
         execp->backend->centered = atoi(value);
-    } else if (strcmp(key, "execp_icon_w") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_ICON_W: {
         Execp *execp = get_or_create_last_execp();
         int v = atoi(value);
         if (v < 0) {
@@ -753,7 +1141,9 @@ void add_entry(char *key, char *value)
         } else {
             execp->backend->icon_w = v;
         }
-    } else if (strcmp(key, "execp_icon_h") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_ICON_H: {
         Execp *execp = get_or_create_last_execp();
         int v = atoi(value);
         if (v < 0) {
@@ -761,59 +1151,89 @@ void add_entry(char *key, char *value)
         } else {
             execp->backend->icon_h = v;
         }
-    } else if (strcmp(key, "execp_lclick_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_LCLICK_COMMAND: {
         Execp *execp = get_or_create_last_execp();
         free_and_null(execp->backend->lclick_command);
         if (strlen(value) > 0)
             execp->backend->lclick_command = strdup(value);
-    } else if (strcmp(key, "execp_mclick_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_MCLICK_COMMAND: {
         Execp *execp = get_or_create_last_execp();
         free_and_null(execp->backend->mclick_command);
         if (strlen(value) > 0)
             execp->backend->mclick_command = strdup(value);
-    } else if (strcmp(key, "execp_rclick_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_RCLICK_COMMAND: {
         Execp *execp = get_or_create_last_execp();
         free_and_null(execp->backend->rclick_command);
         if (strlen(value) > 0)
             execp->backend->rclick_command = strdup(value);
-    } else if (strcmp(key, "execp_uwheel_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_UWHEEL_COMMAND: {
         Execp *execp = get_or_create_last_execp();
         free_and_null(execp->backend->uwheel_command);
         if (strlen(value) > 0)
             execp->backend->uwheel_command = strdup(value);
-    } else if (strcmp(key, "execp_dwheel_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_EXECP_DWHEEL_COMMAND: {
         Execp *execp = get_or_create_last_execp();
         free_and_null(execp->backend->dwheel_command);
         if (strlen(value) > 0)
             execp->backend->dwheel_command = strdup(value);
+        break;
+    }
+    default:
+        break;
     }
 
-    /* Button */
-    else if (strcmp(key, "button") == 0) {
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Button
+static void add_button_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_BUTTON:
         panel_config.button_list = g_list_append(panel_config.button_list, create_button());
-    } else if (strcmp(key, "button_icon") == 0) {
+        break;
+    case CONFIG_KEY_BUTTON_ICON:
         if (strlen(value)) {
             Button *button = get_or_create_last_button();
             button->backend->icon_name = expand_tilde(value);
         }
-    } else if (strcmp(key, "button_text") == 0) {
+        break;
+    case CONFIG_KEY_BUTTON_TEXT:
         if (strlen(value)) {
             Button *button = get_or_create_last_button();
             free_and_null(button->backend->text);
             button->backend->text = strdup(value);
         }
-    } else if (strcmp(key, "button_tooltip") == 0) {
+        break;
+    case CONFIG_KEY_BUTTON_TOOLTIP:
         if (strlen(value)) {
             Button *button = get_or_create_last_button();
             free_and_null(button->backend->tooltip);
             button->backend->tooltip = strdup(value);
         }
-    } else if (strcmp(key, "button_font") == 0) {
+        break;
+    case CONFIG_KEY_BUTTON_FONT: {
         Button *button = get_or_create_last_button();
         pango_font_description_free(button->backend->font_desc);
         button->backend->font_desc = pango_font_description_from_string(value);
         button->backend->has_font = TRUE;
-    } else if (strcmp(key, "button_font_color") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_FONT_COLOR: {
         Button *button = get_or_create_last_button();
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, button->backend->font_color.rgb);
@@ -821,7 +1241,9 @@ void add_entry(char *key, char *value)
             button->backend->font_color.alpha = atoi(value2) / 100.0;
         else
             button->backend->font_color.alpha = 0.5;
-    } else if (strcmp(key, "button_padding") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_PADDING: {
         Button *button = get_or_create_last_button();
         extract_values(value, &value1, &value2, &value3);
         button->backend->paddingxlr = button->backend->paddingx = atoi(value1);
@@ -831,47 +1253,77 @@ void add_entry(char *key, char *value)
             button->backend->paddingy = 0;
         if (value3)
             button->backend->paddingx = atoi(value3);
-    } else if (strcmp(key, "button_max_icon_size") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_MAX_ICON_SIZE: {
         Button *button = get_or_create_last_button();
         extract_values(value, &value1, &value2, &value3);
         button->backend->max_icon_size = MAX(0, atoi(value));
-    } else if (strcmp(key, "button_background_id") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_BACKGROUND_ID: {
         Button *button = get_or_create_last_button();
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         button->backend->bg = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "button_centered") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_CENTERED: {
         Button *button = get_or_create_last_button();
         button->backend->centered = atoi(value);
-    } else if (strcmp(key, "button_lclick_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_LCLICK_COMMAND: {
         Button *button = get_or_create_last_button();
         free_and_null(button->backend->lclick_command);
         if (strlen(value) > 0)
             button->backend->lclick_command = strdup(value);
-    } else if (strcmp(key, "button_mclick_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_MCLICK_COMMAND: {
         Button *button = get_or_create_last_button();
         free_and_null(button->backend->mclick_command);
         if (strlen(value) > 0)
             button->backend->mclick_command = strdup(value);
-    } else if (strcmp(key, "button_rclick_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_RCLICK_COMMAND: {
         Button *button = get_or_create_last_button();
         free_and_null(button->backend->rclick_command);
         if (strlen(value) > 0)
             button->backend->rclick_command = strdup(value);
-    } else if (strcmp(key, "button_uwheel_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_UWHEEL_COMMAND: {
         Button *button = get_or_create_last_button();
         free_and_null(button->backend->uwheel_command);
         if (strlen(value) > 0)
             button->backend->uwheel_command = strdup(value);
-    } else if (strcmp(key, "button_dwheel_command") == 0) {
+        break;
+    }
+    case CONFIG_KEY_BUTTON_DWHEEL_COMMAND: {
         Button *button = get_or_create_last_button();
         free_and_null(button->backend->dwheel_command);
         if (strlen(value) > 0)
             button->backend->dwheel_command = strdup(value);
+        break;
+    }
+    default:
+        break;
     }
 
-    /* Clock */
-    else if (strcmp(key, "time1_format") == 0) {
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Clock
+static void add_clock_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_TIME1_FORMAT:
         if (!new_config_file) {
             clock_enabled = TRUE;
             if (panel_items_order) {
@@ -887,133 +1339,183 @@ void add_entry(char *key, char *value)
             time1_format = strdup(value);
             clock_enabled = TRUE;
         }
-    } else if (strcmp(key, "time2_format") == 0) {
+        break;
+    case CONFIG_KEY_TIME2_FORMAT:
         if (strlen(value) > 0)
             time2_format = strdup(value);
-    } else if (strcmp(key, "time1_font") == 0) {
+        break;
+    case CONFIG_KEY_TIME1_FONT:
         time1_font_desc = pango_font_description_from_string(value);
         time1_has_font = TRUE;
-    } else if (strcmp(key, "time1_timezone") == 0) {
+        break;
+    case CONFIG_KEY_TIME1_TIMEZONE:
         if (strlen(value) > 0)
             time1_timezone = strdup(value);
-    } else if (strcmp(key, "time2_timezone") == 0) {
+        break;
+    case CONFIG_KEY_TIME2_TIMEZONE:
         if (strlen(value) > 0)
             time2_timezone = strdup(value);
-    } else if (strcmp(key, "time2_font") == 0) {
+        break;
+    case CONFIG_KEY_TIME2_FONT:
         time2_font_desc = pango_font_description_from_string(value);
         time2_has_font = TRUE;
-    } else if (strcmp(key, "clock_font_color") == 0) {
+        break;
+    case CONFIG_KEY_CLOCK_FONT_COLOR:
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, panel_config.clock.font.rgb);
         if (value2)
             panel_config.clock.font.alpha = (atoi(value2) / 100.0);
         else
             panel_config.clock.font.alpha = 0.5;
-    } else if (strcmp(key, "clock_padding") == 0) {
+        break;
+    case CONFIG_KEY_CLOCK_PADDING:
         extract_values(value, &value1, &value2, &value3);
         panel_config.clock.area.paddingxlr = panel_config.clock.area.paddingx = atoi(value1);
         if (value2)
             panel_config.clock.area.paddingy = atoi(value2);
         if (value3)
             panel_config.clock.area.paddingx = atoi(value3);
-    } else if (strcmp(key, "clock_background_id") == 0) {
+        break;
+    case CONFIG_KEY_CLOCK_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         panel_config.clock.area.bg = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "clock_tooltip") == 0) {
+        break;
+    }
+    case CONFIG_KEY_CLOCK_TOOLTIP:
         if (strlen(value) > 0)
             time_tooltip_format = strdup(value);
-    } else if (strcmp(key, "clock_tooltip_timezone") == 0) {
+        break;
+    case CONFIG_KEY_CLOCK_TOOLTIP_TIMEZONE:
         if (strlen(value) > 0)
             time_tooltip_timezone = strdup(value);
-    } else if (strcmp(key, "clock_lclick_command") == 0) {
+        break;
+    case CONFIG_KEY_CLOCK_LCLICK_COMMAND:
         if (strlen(value) > 0)
             clock_lclick_command = strdup(value);
-    } else if (strcmp(key, "clock_mclick_command") == 0) {
+        break;
+    case CONFIG_KEY_CLOCK_MCLICK_COMMAND:
         if (strlen(value) > 0)
             clock_mclick_command = strdup(value);
-    } else if (strcmp(key, "clock_rclick_command") == 0) {
+        break;
+    case CONFIG_KEY_CLOCK_RCLICK_COMMAND:
         if (strlen(value) > 0)
             clock_rclick_command = strdup(value);
-    } else if (strcmp(key, "clock_uwheel_command") == 0) {
+        break;
+    case CONFIG_KEY_CLOCK_UWHEEL_COMMAND:
         if (strlen(value) > 0)
             clock_uwheel_command = strdup(value);
-    } else if (strcmp(key, "clock_dwheel_command") == 0) {
+        break;
+    case CONFIG_KEY_CLOCK_DWHEEL_COMMAND:
         if (strlen(value) > 0)
             clock_dwheel_command = strdup(value);
+        break;
+    default:
+        break;
     }
 
-    /* Taskbar */
-    else if (strcmp(key, "taskbar_mode") == 0) {
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Taskbar
+static void add_taskbar_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_TASKBAR_MODE:
         if (strcmp(value, "multi_desktop") == 0)
             taskbar_mode = MULTI_DESKTOP;
         else
             taskbar_mode = SINGLE_DESKTOP;
-    } else if (strcmp(key, "taskbar_distribute_size") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_DISTRIBUTE_SIZE:
         taskbar_distribute_size = atoi(value);
-    } else if (strcmp(key, "taskbar_padding") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_PADDING:
         extract_values(value, &value1, &value2, &value3);
         panel_config.g_taskbar.area.paddingxlr = panel_config.g_taskbar.area.paddingx = atoi(value1);
         if (value2)
             panel_config.g_taskbar.area.paddingy = atoi(value2);
         if (value3)
             panel_config.g_taskbar.area.paddingx = atoi(value3);
-    } else if (strcmp(key, "taskbar_background_id") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         panel_config.g_taskbar.background[TASKBAR_NORMAL] = &g_array_index(backgrounds, Background, id);
         if (panel_config.g_taskbar.background[TASKBAR_ACTIVE] == 0)
             panel_config.g_taskbar.background[TASKBAR_ACTIVE] = panel_config.g_taskbar.background[TASKBAR_NORMAL];
-    } else if (strcmp(key, "taskbar_active_background_id") == 0) {
+        break;
+    }
+    case CONFIG_KEY_TASKBAR_ACTIVE_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         panel_config.g_taskbar.background[TASKBAR_ACTIVE] = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "taskbar_name") == 0) {
+        break;
+    }
+    case CONFIG_KEY_TASKBAR_NAME:
         taskbarname_enabled = atoi(value);
-    } else if (strcmp(key, "taskbar_name_padding") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_NAME_PADDING:
         extract_values(value, &value1, &value2, &value3);
         panel_config.g_taskbar.area_name.paddingxlr = panel_config.g_taskbar.area_name.paddingx = atoi(value1);
         if (value2)
             panel_config.g_taskbar.area_name.paddingy = atoi(value2);
-    } else if (strcmp(key, "taskbar_name_background_id") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_NAME_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         panel_config.g_taskbar.background_name[TASKBAR_NORMAL] = &g_array_index(backgrounds, Background, id);
         if (panel_config.g_taskbar.background_name[TASKBAR_ACTIVE] == 0)
             panel_config.g_taskbar.background_name[TASKBAR_ACTIVE] =
                 panel_config.g_taskbar.background_name[TASKBAR_NORMAL];
-    } else if (strcmp(key, "taskbar_name_active_background_id") == 0) {
+        break;
+    }
+    case CONFIG_KEY_TASKBAR_NAME_ACTIVE_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         panel_config.g_taskbar.background_name[TASKBAR_ACTIVE] = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "taskbar_name_font") == 0) {
+        break;
+    }
+    case CONFIG_KEY_TASKBAR_NAME_FONT:
         panel_config.taskbarname_font_desc = pango_font_description_from_string(value);
         panel_config.taskbarname_has_font = TRUE;
-    } else if (strcmp(key, "taskbar_name_font_color") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_NAME_FONT_COLOR:
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, taskbarname_font.rgb);
         if (value2)
             taskbarname_font.alpha = (atoi(value2) / 100.0);
         else
             taskbarname_font.alpha = 0.5;
-    } else if (strcmp(key, "taskbar_name_active_font_color") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_NAME_ACTIVE_FONT_COLOR:
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, taskbarname_active_font.rgb);
         if (value2)
             taskbarname_active_font.alpha = (atoi(value2) / 100.0);
         else
             taskbarname_active_font.alpha = 0.5;
-    } else if (strcmp(key, "taskbar_hide_inactive_tasks") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_HIDE_INACTIVE_TASKS:
         hide_inactive_tasks = atoi(value);
-    } else if (strcmp(key, "taskbar_hide_different_monitor") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_HIDE_DIFFERENT_MONITOR:
         hide_task_diff_monitor = atoi(value);
-    } else if (strcmp(key, "taskbar_hide_different_desktop") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_HIDE_DIFFERENT_DESKTOP:
         hide_task_diff_desktop = atoi(value);
-    } else if (strcmp(key, "taskbar_hide_if_empty") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_HIDE_IF_EMPTY:
         hide_taskbar_if_empty = atoi(value);
-    } else if (strcmp(key, "taskbar_always_show_all_desktop_tasks") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_ALWAYS_SHOW_ALL_DESKTOP_TASKS:
         always_show_all_desktop_tasks = atoi(value);
-    } else if (strcmp(key, "taskbar_sort_order") == 0) {
+        break;
+    case CONFIG_KEY_TASKBAR_SORT_ORDER:
         if (strcmp(value, "center") == 0) {
             taskbar_sort_method = TASKBAR_SORT_CENTER;
         } else if (strcmp(value, "title") == 0) {
@@ -1027,7 +1529,8 @@ void add_entry(char *key, char *value)
         } else {
             taskbar_sort_method = TASKBAR_NOSORT;
         }
-    } else if (strcmp(key, "task_align") == 0) {
+        break;
+    case CONFIG_KEY_TASK_ALIGN:
         if (strcmp(value, "center") == 0) {
             taskbar_alignment = ALIGN_CENTER;
         } else if (strcmp(value, "right") == 0) {
@@ -1035,38 +1538,61 @@ void add_entry(char *key, char *value)
         } else {
             taskbar_alignment = ALIGN_LEFT;
         }
+        break;
+    default:
+        break;
     }
 
-    /* Task */
-    else if (strcmp(key, "task_text") == 0)
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Task
+static void add_task_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_TASK_TEXT:
         panel_config.g_task.has_text = atoi(value);
-    else if (strcmp(key, "task_icon") == 0)
+        break;
+    case CONFIG_KEY_TASK_ICON:
         panel_config.g_task.has_icon = atoi(value);
-    else if (strcmp(key, "task_centered") == 0)
+        break;
+    case CONFIG_KEY_TASK_CENTERED:
         panel_config.g_task.centered = atoi(value);
-    else if (strcmp(key, "task_width") == 0) {
+        break;
+    case CONFIG_KEY_TASK_WIDTH:
         // old parameter : just for backward compatibility
         panel_config.g_task.maximum_width = atoi(value);
         panel_config.g_task.maximum_height = 30;
-    } else if (strcmp(key, "task_maximum_size") == 0) {
+        break;
+    case CONFIG_KEY_TASK_MAXIMUM_SIZE:
         extract_values(value, &value1, &value2, &value3);
         panel_config.g_task.maximum_width = atoi(value1);
         if (value2)
             panel_config.g_task.maximum_height = atoi(value2);
         else
             panel_config.g_task.maximum_height = panel_config.g_task.maximum_width;
-    } else if (strcmp(key, "task_padding") == 0) {
+        break;
+    case CONFIG_KEY_TASK_PADDING:
         extract_values(value, &value1, &value2, &value3);
         panel_config.g_task.area.paddingxlr = panel_config.g_task.area.paddingx = atoi(value1);
         if (value2)
             panel_config.g_task.area.paddingy = atoi(value2);
         if (value3)
             panel_config.g_task.area.paddingx = atoi(value3);
-    } else if (strcmp(key, "task_font") == 0) {
+        break;
+    case CONFIG_KEY_TASK_FONT:
         panel_config.g_task.font_desc = pango_font_description_from_string(value);
         panel_config.g_task.has_font = TRUE;
-    } else if (g_regex_match_simple("task.*_font_color", key, 0, 0)) {
-        gchar **split = g_regex_split_simple("_", key, 0, 0);
+        break;
+    case CONFIG_KEY_TASK_FONT_COLOR:
+    case CONFIG_KEY_TASK_ACTIVE_FONT_COLOR:
+    case CONFIG_KEY_TASK_ICONIFIED_FONT_COLOR:
+    case CONFIG_KEY_TASK_URGENT_FONT_COLOR: {
+        gchar **split = g_strsplit(key, "_", 0);
         int status = g_strv_length(split) == 3 ? TASK_NORMAL : get_task_status(split[1]);
         g_strfreev(split);
         if (status >= 0) {
@@ -1078,8 +1604,13 @@ void add_entry(char *key, char *value)
             panel_config.g_task.font[status].alpha = alpha;
             panel_config.g_task.config_font_mask |= (1 << status);
         }
-    } else if (g_regex_match_simple("task.*_icon_asb", key, 0, 0)) {
-        gchar **split = g_regex_split_simple("_", key, 0, 0);
+        break;
+    }
+    case CONFIG_KEY_TASK_ICON_ASB:
+    case CONFIG_KEY_TASK_ACTIVE_ICON_ASB:
+    case CONFIG_KEY_TASK_ICONIFIED_ICON_ASB:
+    case CONFIG_KEY_TASK_URGENT_ICON_ASB: {
+        gchar **split = g_strsplit(key, "_", 0);
         int status = g_strv_length(split) == 3 ? TASK_NORMAL : get_task_status(split[1]);
         g_strfreev(split);
         if (status >= 0) {
@@ -1089,8 +1620,13 @@ void add_entry(char *key, char *value)
             panel_config.g_task.brightness[status] = atoi(value3);
             panel_config.g_task.config_asb_mask |= (1 << status);
         }
-    } else if (g_regex_match_simple("task.*_background_id", key, 0, 0)) {
-        gchar **split = g_regex_split_simple("_", key, 0, 0);
+        break;
+    }
+    case CONFIG_KEY_TASK_BACKGROUND_ID:
+    case CONFIG_KEY_TASK_ACTIVE_BACKGROUND_ID:
+    case CONFIG_KEY_TASK_ICONIFIED_BACKGROUND_ID:
+    case CONFIG_KEY_TASK_URGENT_BACKGROUND_ID: {
+        gchar **split = g_strsplit(key, "_", 0);
         int status = g_strv_length(split) == 3 ? TASK_NORMAL : get_task_status(split[1]);
         g_strfreev(split);
         if (status >= 0) {
@@ -1104,17 +1640,35 @@ void add_entry(char *key, char *value)
                 panel_config.g_task.background[status]->fill_content_tint_weight > 0)
                 panel_config.g_task.has_content_tint = TRUE;
         }
+        break;
     }
     // "tooltip" is deprecated but here for backwards compatibility
-    else if (strcmp(key, "task_tooltip") == 0 || strcmp(key, "tooltip") == 0)
+    case CONFIG_KEY_TASK_TOOLTIP:
+    case CONFIG_KEY_TOOLTIP:
         panel_config.g_task.tooltip_enabled = atoi(value);
-    else if (strcmp(key, "task_thumbnail") == 0)
+        break;
+    case CONFIG_KEY_TASK_THUMBNAIL:
         panel_config.g_task.thumbnail_enabled = atoi(value);
-    else if (strcmp(key, "task_thumbnail_size") == 0)
+        break;
+    case CONFIG_KEY_TASK_THUMBNAIL_SIZE:
         panel_config.g_task.thumbnail_width = MAX(8, atoi(value));
+        break;
+    default:
+        break;
+    }
+
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Systray
+static void add_systray_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
 
-    /* Systray */
-    else if (strcmp(key, "systray_padding") == 0) {
+    switch (key_id) {
+    case CONFIG_KEY_SYSTRAY_PADDING:
         if (!new_config_file && systray_enabled == 0) {
             systray_enabled = TRUE;
             if (panel_items_order) {
@@ -1131,11 +1685,14 @@ void add_entry(char *key, char *value)
             systray.area.paddingy = atoi(value2);
         if (value3)
             systray.area.paddingx = atoi(value3);
-    } else if (strcmp(key, "systray_background_id") == 0) {
+        break;
+    case CONFIG_KEY_SYSTRAY_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         systray.area.bg = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "systray_sort") == 0) {
+        break;
+    }
+    case CONFIG_KEY_SYSTRAY_SORT:
         if (strcmp(value, "descending") == 0)
             systray.sort = SYSTRAY_SORT_DESCENDING;
         else if (strcmp(value, "ascending") == 0)
@@ -1144,144 +1701,239 @@ void add_entry(char *key, char *value)
             systray.sort = SYSTRAY_SORT_LEFT2RIGHT;
         else if (strcmp(value, "right2left") == 0)
             systray.sort = SYSTRAY_SORT_RIGHT2LEFT;
-    } else if (strcmp(key, "systray_icon_size") == 0) {
+        break;
+    case CONFIG_KEY_SYSTRAY_ICON_SIZE:
         systray_max_icon_size = atoi(value);
-    } else if (strcmp(key, "systray_icon_asb") == 0) {
+        break;
+    case CONFIG_KEY_SYSTRAY_ICON_ASB:
         extract_values(value, &value1, &value2, &value3);
         systray.alpha = atoi(value1);
         systray.saturation = atoi(value2);
         systray.brightness = atoi(value3);
-    } else if (strcmp(key, "systray_monitor") == 0) {
+        break;
+    case CONFIG_KEY_SYSTRAY_MONITOR:
         systray_monitor = MAX(0, config_get_monitor(value));
-    } else if (strcmp(key, "systray_name_filter") == 0) {
+        break;
+    case CONFIG_KEY_SYSTRAY_NAME_FILTER:
         if (systray_hide_name_filter) {
             fprintf(stderr, "tint2: Error: duplicate option 'systray_name_filter'. Please use it only once. See "
                             "https://gitlab.com/o9000/tint2/issues/652\n");
             free(systray_hide_name_filter);
         }
         systray_hide_name_filter = strdup(value);
+        break;
+    default:
+        break;
     }
 
-    /* Launcher */
-    else if (strcmp(key, "launcher_padding") == 0) {
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Launcher
+static void add_launcher_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_LAUNCHER_PADDING:
         extract_values(value, &value1, &value2, &value3);
         panel_config.launcher.area.paddingxlr = panel_config.launcher.area.paddingx = atoi(value1);
         if (value2)
             panel_config.launcher.area.paddingy = atoi(value2);
         if (value3)
             panel_config.launcher.area.paddingx = atoi(value3);
-    } else if (strcmp(key, "launcher_background_id") == 0) {
+        break;
+    case CONFIG_KEY_LAUNCHER_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         panel_config.launcher.area.bg = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "launcher_icon_background_id") == 0) {
+        break;
+    }
+    case CONFIG_KEY_LAUNCHER_ICON_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         launcher_icon_bg = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "launcher_icon_size") == 0) {
+        break;
+    }
+    case CONFIG_KEY_LAUNCHER_ICON_SIZE:
         launcher_max_icon_size = atoi(value);
-    } else if (strcmp(key, "launcher_item_app") == 0) {
+        break;
+    case CONFIG_KEY_LAUNCHER_ITEM_APP: {
         char *app = expand_tilde(value);
         panel_config.launcher.list_apps = g_slist_append(panel_config.launcher.list_apps, app);
-    } else if (strcmp(key, "launcher_apps_dir") == 0) {
+        break;
+    }
+    case CONFIG_KEY_LAUNCHER_APPS_DIR: {
         char *path = expand_tilde(value);
         load_launcher_app_dir(path);
         free(path);
-    } else if (strcmp(key, "launcher_icon_theme") == 0) {
+        break;
+    }
+    case CONFIG_KEY_LAUNCHER_ICON_THEME:
         // if XSETTINGS manager running, tint2 use it.
         if (icon_theme_name_config)
             free(icon_theme_name_config);
         icon_theme_name_config = strdup(value);
-    } else if (strcmp(key, "launcher_icon_theme_override") == 0) {
+        break;
+    case CONFIG_KEY_LAUNCHER_ICON_THEME_OVERRIDE:
         launcher_icon_theme_override = atoi(value);
-    } else if (strcmp(key, "launcher_icon_asb") == 0) {
+        break;
+    case CONFIG_KEY_LAUNCHER_ICON_ASB:
         extract_values(value, &value1, &value2, &value3);
         launcher_alpha = atoi(value1);
         launcher_saturation = atoi(value2);
         launcher_brightness = atoi(value3);
-    } else if (strcmp(key, "launcher_tooltip") == 0) {
+        break;
+    case CONFIG_KEY_LAUNCHER_TOOLTIP:
         launcher_tooltip_enabled = atoi(value);
-    } else if (strcmp(key, "startup_notifications") == 0) {
+        break;
+    case CONFIG_KEY_STARTUP_NOTIFICATIONS:
         startup_notifications = atoi(value);
+        break;
+    default:
+        break;
     }
 
-    /* Tooltip */
-    else if (strcmp(key, "tooltip_show_timeout") == 0) {
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Tooltip
+static void add_tooltip_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_TOOLTIP_SHOW_TIMEOUT: {
         int timeout_msec = 1000 * atof(value);
         g_tooltip.show_timeout_msec = timeout_msec;
-    } else if (strcmp(key, "tooltip_hide_timeout") == 0) {
+        break;
+    }
+    case CONFIG_KEY_TOOLTIP_HIDE_TIMEOUT: {
         int timeout_msec = 1000 * atof(value);
         g_tooltip.hide_timeout_msec = timeout_msec;
-    } else if (strcmp(key, "tooltip_padding") == 0) {
+        break;
+    }
+    case CONFIG_KEY_TOOLTIP_PADDING:
         extract_values(value, &value1, &value2, &value3);
         if (value1)
             g_tooltip.paddingx = atoi(value1);
         if (value2)
             g_tooltip.paddingy = atoi(value2);
-    } else if (strcmp(key, "tooltip_background_id") == 0) {
+        break;
+    case CONFIG_KEY_TOOLTIP_BACKGROUND_ID: {
         int id = atoi(value);
         id = (id < backgrounds->len && id >= 0) ? id : 0;
         g_tooltip.bg = &g_array_index(backgrounds, Background, id);
-    } else if (strcmp(key, "tooltip_font_color") == 0) {
+        break;
+    }
+    case CONFIG_KEY_TOOLTIP_FONT_COLOR:
         extract_values(value, &value1, &value2, &value3);
         get_color(value1, g_tooltip.font_color.rgb);
         if (value2)
             g_tooltip.font_color.alpha = (atoi(value2) / 100.0);
         else
             g_tooltip.font_color.alpha = 0.1;
-    } else if (strcmp(key, "tooltip_font") == 0) {
+        break;
+    case CONFIG_KEY_TOOLTIP_FONT:
         g_tooltip.font_desc = pango_font_description_from_string(value);
+        g_tooltip.has_font = TRUE;
+        break;
+    default:
+        break;
     }
 
-    /* Mouse actions */
-    else if (strcmp(key, "mouse_left") == 0)
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Mouse actions
+static void add_mouse_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    char *value1 = 0, *value2 = 0, *value3 = 0;
+
+    switch (key_id) {
+    case CONFIG_KEY_MOUSE_LEFT:
         get_action(value, &mouse_left);
-    else if (strcmp(key, "mouse_middle") == 0)
+        break;
+    case CONFIG_KEY_MOUSE_MIDDLE:
         get_action(value, &mouse_middle);
-    else if (strcmp(key, "mouse_right") == 0)
+        break;
+    case CONFIG_KEY_MOUSE_RIGHT:
         get_action(value, &mouse_right);
-    else if (strcmp(key, "mouse_scroll_up") == 0)
+        break;
+    case CONFIG_KEY_MOUSE_SCROLL_UP:
         get_action(value, &mouse_scroll_up);
-    else if (strcmp(key, "mouse_scroll_down") == 0)
+        break;
+    case CONFIG_KEY_MOUSE_SCROLL_DOWN:
         get_action(value, &mouse_scroll_down);
-    else if (strcmp(key, "mouse_effects") == 0)
+        break;
+    case CONFIG_KEY_MOUSE_EFFECTS:
         panel_config.mouse_effects = atoi(value);
-    else if (strcmp(key, "mouse_hover_icon_asb") == 0) {
+        break;
+    case CONFIG_KEY_MOUSE_HOVER_ICON_ASB:
         extract_values(value, &value1, &value2, &value3);
         panel_config.mouse_over_alpha = atoi(value1);
         panel_config.mouse_over_saturation = atoi(value2);
         panel_config.mouse_over_brightness = atoi(value3);
-    } else if (strcmp(key, "mouse_pressed_icon_asb") == 0) {
+        break;
+    case CONFIG_KEY_MOUSE_PRESSED_ICON_ASB:
         extract_values(value, &value1, &value2, &value3);
         panel_config.mouse_pressed_alpha = atoi(value1);
         panel_config.mouse_pressed_saturation = atoi(value2);
         panel_config.mouse_pressed_brightness = atoi(value3);
+        break;
+    default:
+        break;
     }
 
-    /* autohide options */
-    else if (strcmp(key, "autohide") == 0)
+    free(value1);
+    free(value2);
+    free(value3);
+}
+
+// Autohide options
+static void add_autohide_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    switch (key_id) {
+    case CONFIG_KEY_AUTOHIDE:
         panel_autohide = atoi(value);
-    else if (strcmp(key, "autohide_show_timeout") == 0)
+        break;
+    case CONFIG_KEY_AUTOHIDE_SHOW_TIMEOUT:
         panel_autohide_show_timeout = 1000 * atof(value);
-    else if (strcmp(key, "autohide_hide_timeout") == 0)
+        break;
+    case CONFIG_KEY_AUTOHIDE_HIDE_TIMEOUT:
         panel_autohide_hide_timeout = 1000 * atof(value);
-    else if (strcmp(key, "strut_policy") == 0) {
+        break;
+    case CONFIG_KEY_STRUT_POLICY:
         if (strcmp(value, "follow_size") == 0)
             panel_strut_policy = STRUT_FOLLOW_SIZE;
         else if (strcmp(value, "none") == 0)
             panel_strut_policy = STRUT_NONE;
         else
             panel_strut_policy = STRUT_MINIMUM;
-    } else if (strcmp(key, "autohide_height") == 0) {
+        break;
+    case CONFIG_KEY_AUTOHIDE_HEIGHT:
         panel_autohide_height = atoi(value);
         if (panel_autohide_height == 0) {
             // autohide need height > 0
             panel_autohide_height = 1;
         }
+        break;
+    default:
+        break;
     }
+}
 
-    // old config option
-    else if (strcmp(key, "systray") == 0) {
+// Old config options
+static void add_deprecated_entry(ConfigKeyId key_id, char *key, char *value)
+{
+    switch (key_id) {
+    case CONFIG_KEY_SYSTRAY:
         if (!new_config_file) {
             systray_enabled = atoi(value);
             if (systray_enabled) {
@@ -1294,9 +1946,9 @@ void add_entry(char *key, char *value)
                     panel_items_order = strdup("S");
             }
         }
-    }
+        break;
 #ifdef ENABLE_BATTERY
-    else if (strcmp(key, "battery") == 0) {
+    case CONFIG_KEY_BATTERY:
         if (!new_config_file) {
             battery_enabled = atoi(value);
             if (battery_enabled) {
@@ -1309,44 +1961,372 @@ void add_entry(char *key, char *value)
                     panel_items_order = strdup("B");
             }
         }
-    }
+        break;
 #endif
-    else if (strcmp(key, "primary_monitor_first") == 0) {
+    case CONFIG_KEY_PRIMARY_MONITOR_FIRST:
         fprintf(stderr,
                 "tint2: deprecated config option \"%s\"\n"
                 "       Please see the documentation regarding the alternatives.\n",
                 key);
-    } else
+        break;
+    default:
+        break;
+    }
+}
+
+typedef void ConfigEntryHandler(ConfigKeyId key_id, char *key, char *value);
+
+typedef struct ConfigKey {
+    const char *key;
+    ConfigKeyId id;
+    ConfigEntryHandler *handler;
+} ConfigKey;
+
+// Sorted by key, for binary search
+static const ConfigKey config_keys[] = {
+    {"ac_connected_cmd", CONFIG_KEY_AC_CONNECTED_CMD, add_battery_entry},
+    {"ac_disconnected_cmd", CONFIG_KEY_AC_DISCONNECTED_CMD, add_battery_entry},
+    {"autohide", CONFIG_KEY_AUTOHIDE, add_autohide_entry},
+    {"autohide_height", CONFIG_KEY_AUTOHIDE_HEIGHT, add_autohide_entry},
+    {"autohide_hide_timeout", CONFIG_KEY_AUTOHIDE_HIDE_TIMEOUT, add_autohide_entry},
+    {"autohide_show_timeout", CONFIG_KEY_AUTOHIDE_SHOW_TIMEOUT, add_autohide_entry},
+    {"background_color", CONFIG_KEY_BACKGROUND_COLOR, add_background_entry},
+    {"background_color_hover", CONFIG_KEY_BACKGROUND_COLOR_HOVER, add_background_entry},
+    {"background_color_pressed", CONFIG_KEY_BACKGROUND_COLOR_PRESSED, add_background_entry},
+    {"background_content_tint_weight", CONFIG_KEY_BACKGROUND_CONTENT_TINT_WEIGHT, add_background_entry},
+    {"bat1_font", CONFIG_KEY_BAT1_FONT, add_battery_entry},
+    {"bat1_format", CONFIG_KEY_BAT1_FORMAT, add_battery_entry},
+    {"bat2_font", CONFIG_KEY_BAT2_FONT, add_battery_entry},
+    {"bat2_format", CONFIG_KEY_BAT2_FORMAT, add_battery_entry},
+#ifdef ENABLE_BATTERY
+    {"battery", CONFIG_KEY_BATTERY, add_deprecated_entry},
+#endif
+    {"battery_background_id", CONFIG_KEY_BATTERY_BACKGROUND_ID, add_battery_entry},
+    {"battery_dwheel_command", CONFIG_KEY_BATTERY_DWHEEL_COMMAND, add_battery_entry},
+    {"battery_font_color", CONFIG_KEY_BATTERY_FONT_COLOR, add_battery_entry},
+    {"battery_full_cmd", CONFIG_KEY_BATTERY_FULL_CMD, add_battery_entry},
+    {"battery_hide", CONFIG_KEY_BATTERY_HIDE, add_battery_entry},
+    {"battery_lclick_command", CONFIG_KEY_BATTERY_LCLICK_COMMAND, add_battery_entry},
+    {"battery_low_cmd", CONFIG_KEY_BATTERY_LOW_CMD, add_battery_entry},
+    {"battery_low_status", CONFIG_KEY_BATTERY_LOW_STATUS, add_battery_entry},
+    {"battery_mclick_command", CONFIG_KEY_BATTERY_MCLICK_COMMAND, add_battery_entry},
+    {"battery_padding", CONFIG_KEY_BATTERY_PADDING, add_battery_entry},
+    {"battery_rclick_command", CONFIG_KEY_BATTERY_RCLICK_COMMAND, add_battery_entry},
+    {"battery_tooltip", CONFIG_KEY_BATTERY_TOOLTIP, add_battery_entry},
+    {"battery_uwheel_command", CONFIG_KEY_BATTERY_UWHEEL_COMMAND, add_battery_entry},
+    {"border_color", CONFIG_KEY_BORDER_COLOR, add_background_entry},
+    {"border_color_hover", CONFIG_KEY_BORDER_COLOR_HOVER, add_background_entry},
+    {"border_color_pressed", CONFIG_KEY_BORDER_COLOR_PRESSED, add_background_entry},
+    {"border_content_tint_weight", CONFIG_KEY_BORDER_CONTENT_TINT_WEIGHT, add_background_entry},
+    {"border_sides", CONFIG_KEY_BORDER_SIDES, add_background_entry},
+    {"border_width", CONFIG_KEY_BORDER_WIDTH, add_background_entry},
+    {"button", CONFIG_KEY_BUTTON, add_button_entry},
+    {"button_background_id", CONFIG_KEY_BUTTON_BACKGROUND_ID, add_button_entry},
+    {"button_centered", CONFIG_KEY_BUTTON_CENTERED, add_button_entry},
+    {"button_dwheel_command", CONFIG_KEY_BUTTON_DWHEEL_COMMAND, add_button_entry},
+    {"button_font", CONFIG_KEY_BUTTON_FONT, add_button_entry},
+    {"button_font_color", CONFIG_KEY_BUTTON_FONT_COLOR, add_button_entry},
+    {"button_icon", CONFIG_KEY_BUTTON_ICON, add_button_entry},
+    {"button_lclick_command", CONFIG_KEY_BUTTON_LCLICK_COMMAND, add_button_entry},
+    {"button_max_icon_size", CONFIG_KEY_BUTTON_MAX_ICON_SIZE, add_button_entry},
+    {"button_mclick_command", CONFIG_KEY_BUTTON_MCLICK_COMMAND, add_button_entry},
+    {"button_padding", CONFIG_KEY_BUTTON_PADDING, add_button_entry},
+    {"button_rclick_command", CONFIG_KEY_BUTTON_RCLICK_COMMAND, add_button_entry},
+    {"button_text", CONFIG_KEY_BUTTON_TEXT, add_button_entry},
+    {"button_tooltip", CONFIG_KEY_BUTTON_TOOLTIP, add_button_entry},
+    {"button_uwheel_command", CONFIG_KEY_BUTTON_UWHEEL_COMMAND, add_button_entry},
+    {"clock_background_id", CONFIG_KEY_CLOCK_BACKGROUND_ID, add_clock_entry},
+    {"clock_dwheel_command", CONFIG_KEY_CLOCK_DWHEEL_COMMAND, add_clock_entry},
+    {"clock_font_color", CONFIG_KEY_CLOCK_FONT_COLOR, add_clock_entry},
+    {"clock_lclick_command", CONFIG_KEY_CLOCK_LCLICK_COMMAND, add_clock_entry},
+    {"clock_mclick_command", CONFIG_KEY_CLOCK_MCLICK_COMMAND, add_clock_entry},
+    {"clock_padding", CONFIG_KEY_CLOCK_PADDING, add_clock_entry},
+    {"clock_rclick_command", CONFIG_KEY_CLOCK_RCLICK_COMMAND, add_clock_entry},
+    {"clock_tooltip", CONFIG_KEY_CLOCK_TOOLTIP, add_clock_entry},
+    {"clock_tooltip_timezone", CONFIG_KEY_CLOCK_TOOLTIP_TIMEZONE, add_clock_entry},
+    {"clock_uwheel_command", CONFIG_KEY_CLOCK_UWHEEL_COMMAND, add_clock_entry},
+    {"color_stop", CONFIG_KEY_COLOR_STOP, add_gradient_entry},
+    {"disable_transparency", CONFIG_KEY_DISABLE_TRANSPARENCY, add_panel_entry},
+    {"end_color", CONFIG_KEY_END_COLOR, add_gradient_entry},
+    {"execp", CONFIG_KEY_EXECP, add_execp_entry},
+    {"execp_background_id", CONFIG_KEY_EXECP_BACKGROUND_ID, add_execp_entry},
+    {"execp_cache_icon", CONFIG_KEY_EXECP_CACHE_ICON, add_execp_entry},
+    {"execp_centered", CONFIG_KEY_EXECP_CENTERED, add_execp_entry},
+    {"execp_command", CONFIG_KEY_EXECP_COMMAND, add_execp_entry},
+    {"execp_continuous", CONFIG_KEY_EXECP_CONTINUOUS, add_execp_entry},
+    {"execp_coprocess", CONFIG_KEY_EXECP_COPROCESS, add_execp_entry},
+    {"execp_dwheel_command", CONFIG_KEY_EXECP_DWHEEL_COMMAND, add_execp_entry},
+    {"execp_font", CONFIG_KEY_EXECP_FONT, add_execp_entry},
+    {"execp_font_color", CONFIG_KEY_EXECP_FONT_COLOR, add_execp_entry},
+    {"execp_has_icon", CONFIG_KEY_EXECP_HAS_ICON, add_execp_entry},
+    {"execp_icon_h", CONFIG_KEY_EXECP_ICON_H, add_execp_entry},
+    {"execp_icon_w", CONFIG_KEY_EXECP_ICON_W, add_execp_entry},
+    {"execp_interval", CONFIG_KEY_EXECP_INTERVAL, add_execp_entry},
+    {"execp_lclick_command", CONFIG_KEY_EXECP_LCLICK_COMMAND, add_execp_entry},
+    {"execp_markup", CONFIG_KEY_EXECP_MARKUP, add_execp_entry},
+    {"execp_mclick_command", CONFIG_KEY_EXECP_MCLICK_COMMAND, add_execp_entry},
+    {"execp_padding", CONFIG_KEY_EXECP_PADDING, add_execp_entry},
+    {"execp_rclick_command", CONFIG_KEY_EXECP_RCLICK_COMMAND, add_execp_entry},
+    {"execp_tooltip", CONFIG_KEY_EXECP_TOOLTIP, add_execp_entry},
+    {"execp_uwheel_command", CONFIG_KEY_EXECP_UWHEEL_COMMAND, add_execp_entry},
+    {"font_shadow", CONFIG_KEY_FONT_SHADOW, add_panel_entry},
+    {"gradient", CONFIG_KEY_GRADIENT, add_gradient_entry},
+    {"gradient_id", CONFIG_KEY_GRADIENT_ID, add_background_entry},
+    {"gradient_id_hover", CONFIG_KEY_GRADIENT_ID_HOVER, add_background_entry},
+    {"gradient_id_pressed", CONFIG_KEY_GRADIENT_ID_PRESSED, add_background_entry},
+    {"hover_gradient_id", CONFIG_KEY_HOVER_GRADIENT_ID, add_background_entry},
+    {"launcher_apps_dir", CONFIG_KEY_LAUNCHER_APPS_DIR, add_launcher_entry},
+    {"launcher_background_id", CONFIG_KEY_LAUNCHER_BACKGROUND_ID, add_launcher_entry},
+    {"launcher_icon_asb", CONFIG_KEY_LAUNCHER_ICON_ASB, add_launcher_entry},
+    {"launcher_icon_background_id", CONFIG_KEY_LAUNCHER_ICON_BACKGROUND_ID, add_launcher_entry},
+    {"launcher_icon_size", CONFIG_KEY_LAUNCHER_ICON_SIZE, add_launcher_entry},
+    {"launcher_icon_theme", CONFIG_KEY_LAUNCHER_ICON_THEME, add_launcher_entry},
+    {"launcher_icon_theme_override", CONFIG_KEY_LAUNCHER_ICON_THEME_OVERRIDE, add_launcher_entry},
+    {"launcher_item_app", CONFIG_KEY_LAUNCHER_ITEM_APP, add_launcher_entry},
+    {"launcher_padding", CONFIG_KEY_LAUNCHER_PADDING, add_launcher_entry},
+    {"launcher_tooltip", CONFIG_KEY_LAUNCHER_TOOLTIP, add_launcher_entry},
+    {"mouse_effects", CONFIG_KEY_MOUSE_EFFECTS, add_mouse_entry},
+    {"mouse_hover_icon_asb", CONFIG_KEY_MOUSE_HOVER_ICON_ASB, add_mouse_entry},
+    {"mouse_left", CONFIG_KEY_MOUSE_LEFT, add_mouse_entry},
+    {"mouse_middle", CONFIG_KEY_MOUSE_MIDDLE, add_mouse_entry},
+    {"mouse_pressed_icon_asb", CONFIG_KEY_MOUSE_PRESSED_ICON_ASB, add_mouse_entry},
+    {"mouse_right", CONFIG_KEY_MOUSE_RIGHT, add_mouse_entry},
+    {"mouse_scroll_down", CONFIG_KEY_MOUSE_SCROLL_DOWN, add_mouse_entry},
+    {"mouse_scroll_up", CONFIG_KEY_MOUSE_SCROLL_UP, add_mouse_entry},
+    {"panel_background_id", CONFIG_KEY_PANEL_BACKGROUND_ID, add_panel_entry},
+    {"panel_dock", CONFIG_KEY_PANEL_DOCK, add_panel_entry},
+    {"panel_items", CONFIG_KEY_PANEL_ITEMS, add_panel_entry},
+    {"panel_layer", CONFIG_KEY_PANEL_LAYER, add_panel_entry},
+    {"panel_margin", CONFIG_KEY_PANEL_MARGIN, add_panel_entry},
+    {"panel_monitor", CONFIG_KEY_PANEL_MONITOR, add_panel_entry},
+    {"panel_padding", CONFIG_KEY_PANEL_PADDING, add_panel_entry},
+    {"panel_pivot_struts", CONFIG_KEY_PANEL_PIVOT_STRUTS, add_panel_entry},
+    {"panel_position", CONFIG_KEY_PANEL_POSITION, add_panel_entry},
+    {"panel_shrink", CONFIG_KEY_PANEL_SHRINK, add_panel_entry},
+    {"panel_size", CONFIG_KEY_PANEL_SIZE, add_panel_entry},
+    {"panel_window_name", CONFIG_KEY_PANEL_WINDOW_NAME, add_panel_entry},
+    {"pressed_gradient_id", CONFIG_KEY_PRESSED_GRADIENT_ID, add_background_entry},
+    {"primary_monitor_first", CONFIG_KEY_PRIMARY_MONITOR_FIRST, add_deprecated_entry},
+    {"rounded", CONFIG_KEY_ROUNDED, add_background_entry},
+    {"scale_relative_to_dpi", CONFIG_KEY_SCALE_RELATIVE_TO_DPI, add_background_entry},
+    {"scale_relative_to_screen_height", CONFIG_KEY_SCALE_RELATIVE_TO_SCREEN_HEIGHT, add_background_entry},
+    {"separator", CONFIG_KEY_SEPARATOR, add_separator_entry},
+    {"separator_background_id", CONFIG_KEY_SEPARATOR_BACKGROUND_ID, add_separator_entry},
+    {"separator_color", CONFIG_KEY_SEPARATOR_COLOR, add_separator_entry},
+    {"separator_padding", CONFIG_KEY_SEPARATOR_PADDING, add_separator_entry},
+    {"separator_size", CONFIG_KEY_SEPARATOR_SIZE, add_separator_entry},
+    {"separator_style", CONFIG_KEY_SEPARATOR_STYLE, add_separator_entry},
+    {"start_color", CONFIG_KEY_START_COLOR, add_gradient_entry},
+    {"startup_notifications", CONFIG_KEY_STARTUP_NOTIFICATIONS, add_launcher_entry},
+    {"strut_policy", CONFIG_KEY_STRUT_POLICY, add_autohide_entry},
+    {"systray", CONFIG_KEY_SYSTRAY, add_deprecated_entry},
+    {"systray_background_id", CONFIG_KEY_SYSTRAY_BACKGROUND_ID, add_systray_entry},
+    {"systray_icon_asb", CONFIG_KEY_SYSTRAY_ICON_ASB, add_systray_entry},
+    {"systray_icon_size", CONFIG_KEY_SYSTRAY_ICON_SIZE, add_systray_entry},
+    {"systray_monitor", CONFIG_KEY_SYSTRAY_MONITOR, add_systray_entry},
+    {"systray_name_filter", CONFIG_KEY_SYSTRAY_NAME_FILTER, add_systray_entry},
+    {"systray_padding", CONFIG_KEY_SYSTRAY_PADDING, add_systray_entry},
+    {"systray_sort", CONFIG_KEY_SYSTRAY_SORT, add_systray_entry},
+    {"task_active_background_id", CONFIG_KEY_TASK_ACTIVE_BACKGROUND_ID, add_task_entry},
+    {"task_active_font_color", CONFIG_KEY_TASK_ACTIVE_FONT_COLOR, add_task_entry},
+    {"task_active_icon_asb", CONFIG_KEY_TASK_ACTIVE_ICON_ASB, add_task_entry},
+    {"task_align", CONFIG_KEY_TASK_ALIGN, add_taskbar_entry},
+    {"task_background_id", CONFIG_KEY_TASK_BACKGROUND_ID, add_task_entry},
+    {"task_centered", CONFIG_KEY_TASK_CENTERED, add_task_entry},
+    {"task_font", CONFIG_KEY_TASK_FONT, add_task_entry},
+    {"task_font_color", CONFIG_KEY_TASK_FONT_COLOR, add_task_entry},
+    {"task_icon", CONFIG_KEY_TASK_ICON, add_task_entry},
+    {"task_icon_asb", CONFIG_KEY_TASK_ICON_ASB, add_task_entry},
+    {"task_iconified_background_id", CONFIG_KEY_TASK_ICONIFIED_BACKGROUND_ID, add_task_entry},
+    {"task_iconified_font_color", CONFIG_KEY_TASK_ICONIFIED_FONT_COLOR, add_task_entry},
+    {"task_iconified_icon_asb", CONFIG_KEY_TASK_ICONIFIED_ICON_ASB, add_task_entry},
+    {"task_maximum_size", CONFIG_KEY_TASK_MAXIMUM_SIZE, add_task_entry},
+    {"task_padding", CONFIG_KEY_TASK_PADDING, add_task_entry},
+    {"task_text", CONFIG_KEY_TASK_TEXT, add_task_entry},
+    {"task_thumbnail", CONFIG_KEY_TASK_THUMBNAIL, add_task_entry},
+    {"task_thumbnail_size", CONFIG_KEY_TASK_THUMBNAIL_SIZE, add_task_entry},
+    {"task_tooltip", CONFIG_KEY_TASK_TOOLTIP, add_task_entry},
+    {"task_urgent_background_id", CONFIG_KEY_TASK_URGENT_BACKGROUND_ID, add_task_entry},
+    {"task_urgent_font_color", CONFIG_KEY_TASK_URGENT_FONT_COLOR, add_task_entry},
+    {"task_urgent_icon_asb", CONFIG_KEY_TASK_URGENT_ICON_ASB, add_task_entry},
+    {"task_width", CONFIG_KEY_TASK_WIDTH, add_task_entry},
+    {"taskbar_active_background_id", CONFIG_KEY_TASKBAR_ACTIVE_BACKGROUND_ID, add_taskbar_entry},
+    {"taskbar_always_show_all_desktop_tasks", CONFIG_KEY_TASKBAR_ALWAYS_SHOW_ALL_DESKTOP_TASKS, add_taskbar_entry},
+    {"taskbar_background_id", CONFIG_KEY_TASKBAR_BACKGROUND_ID, add_taskbar_entry},
+    {"taskbar_distribute_size", CONFIG_KEY_TASKBAR_DISTRIBUTE_SIZE, add_taskbar_entry},
+    {"taskbar_hide_different_desktop", CONFIG_KEY_TASKBAR_HIDE_DIFFERENT_DESKTOP, add_taskbar_entry},
+    {"taskbar_hide_different_monitor", CONFIG_KEY_TASKBAR_HIDE_DIFFERENT_MONITOR, add_taskbar_entry},
+    {"taskbar_hide_if_empty", CONFIG_KEY_TASKBAR_HIDE_IF_EMPTY, add_taskbar_entry},
+    {"taskbar_hide_inactive_tasks", CONFIG_KEY_TASKBAR_HIDE_INACTIVE_TASKS, add_taskbar_entry},
+    {"taskbar_mode", CONFIG_KEY_TASKBAR_MODE, add_taskbar_entry},
+    {"taskbar_name", CONFIG_KEY_TASKBAR_NAME, add_taskbar_entry},
+    {"taskbar_name_active_background_id", CONFIG_KEY_TASKBAR_NAME_ACTIVE_BACKGROUND_ID, add_taskbar_entry},
+    {"taskbar_name_active_font_color", CONFIG_KEY_TASKBAR_NAME_ACTIVE_FONT_COLOR, add_taskbar_entry},
+    {"taskbar_name_background_id", CONFIG_KEY_TASKBAR_NAME_BACKGROUND_ID, add_taskbar_entry},
+    {"taskbar_name_font", CONFIG_KEY_TASKBAR_NAME_FONT, add_taskbar_entry},
+    {"taskbar_name_font_color", CONFIG_KEY_TASKBAR_NAME_FONT_COLOR, add_taskbar_entry},
+    {"taskbar_name_padding", CONFIG_KEY_TASKBAR_NAME_PADDING, add_taskbar_entry},
+    {"taskbar_padding", CONFIG_KEY_TASKBAR_PADDING, add_taskbar_entry},
+    {"taskbar_sort_order", CONFIG_KEY_TASKBAR_SORT_ORDER, add_taskbar_entry},
+    {"time1_font", CONFIG_KEY_TIME1_FONT, add_clock_entry},
+    {"time1_format", CONFIG_KEY_TIME1_FORMAT, add_clock_entry},
+    {"time1_timezone", CONFIG_KEY_TIME1_TIMEZONE, add_clock_entry},
+    {"time2_font", CONFIG_KEY_TIME2_FONT, add_clock_entry},
+    {"time2_format", CONFIG_KEY_TIME2_FORMAT, add_clock_entry},
+    {"time2_timezone", CONFIG_KEY_TIME2_TIMEZONE, add_clock_entry},
+    {"tooltip", CONFIG_KEY_TOOLTIP, add_task_entry},
+    {"tooltip_background_id", CONFIG_KEY_TOOLTIP_BACKGROUND_ID, add_tooltip_entry},
+    {"tooltip_font", CONFIG_KEY_TOOLTIP_FONT, add_tooltip_entry},
+    {"tooltip_font_color", CONFIG_KEY_TOOLTIP_FONT_COLOR, add_tooltip_entry},
+    {"tooltip_hide_timeout", CONFIG_KEY_TOOLTIP_HIDE_TIMEOUT, add_tooltip_entry},
+    {"tooltip_padding", CONFIG_KEY_TOOLTIP_PADDING, add_tooltip_entry},
+    {"tooltip_show_timeout", CONFIG_KEY_TOOLTIP_SHOW_TIMEOUT, add_tooltip_entry},
+    {"urgent_nb_of_blink", CONFIG_KEY_URGENT_NB_OF_BLINK, add_panel_entry},
+    {"wm_menu", CONFIG_KEY_WM_MENU, add_panel_entry},
+};
+
+static int compare_config_keys(const void *a, const void *b)
+{
+    return strcmp(((const ConfigKey *)a)->key, ((const ConfigKey *)b)->key);
+}
+
+static const ConfigKey *find_config_key(const char *key)
+{
+    ConfigKey needle = {key, 0, NULL};
+    const ConfigKey *found = (const ConfigKey *)bsearch(&needle,
+                                                        config_keys,
+                                                        sizeof(config_keys) / sizeof(config_keys[0]),
+                                                        sizeof(config_keys[0]),
+                                                        compare_config_keys);
+    return found;
+}
+
+TEST(config_keys_sorted)
+{
+    for (size_t i = 1; i < sizeof(config_keys) / sizeof(config_keys[0]); i++)
+        ASSERT(strcmp(config_keys[i - 1].key, config_keys[i].key) < 0);
+}
+
+static void apply_config_entry(const ConfigKey *config_key, char *key, char *value)
+{
+    if (config_key)
+        config_key->handler(config_key->id, key, value);
+    else
         fprintf(stderr, "tint2: invalid option \"%s\",\n  upgrade tint2 or correct your config file\n", key);
+}
+
+void add_entry(char *key, char *value)
+{
+    apply_config_entry(find_config_key(key), key, value);
+}
 
-    if (value1)
-        free(value1);
-    if (value2)
-        free(value2);
-    if (value3)
-        free(value3);
+typedef struct ConfigEntry {
+    // NULL if the key is unknown
+    const ConfigKey *config_key;
+    char *key;
+    char *value;
+} ConfigEntry;
+
+// The entries of the last config file read, with their handlers already looked up.
+// They are replayed when tint2 restarts (SIGUSR1) and the file has not changed meanwhile.
+// Only the reading and splitting of the file is skipped: the handlers run again, so colors are parsed and
+// gradients are built again. A changed file is always read again.
+typedef struct ConfigCache {
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    // Each element is a ConfigEntry
+    GArray *entries;
+} ConfigCache;
+
+static ConfigCache config_cache;
+
+static void free_config_entries(GArray *entries)
+{
+    for (guint i = 0; i < entries->len; i++) {
+        ConfigEntry *entry = &g_array_index(entries, ConfigEntry, i);
+        free(entry->key);
+        free(entry->value);
+    }
+    g_array_free(entries, TRUE);
 }
 
-gboolean config_read_file(const char *path)
+void free_config_cache()
 {
-    fprintf(stderr, "tint2: Loading config file: %s\n", path);
+    if (config_cache.entries)
+        free_config_entries(config_cache.entries);
+    free(config_cache.path);
+    memset(&config_cache, 0, sizeof(config_cache));
+}
 
+static void set_config_cache(const char *path, const struct stat *st, GArray *entries)
+{
+    free_config_cache();
+    config_cache.entries = entries;
+    config_cache.path = strdup(path);
+    config_cache.dev = st->st_dev;
+    config_cache.ino = st->st_ino;
+    config_cache.size = st->st_size;
+    config_cache.mtime = st->st_mtim;
+}
+
+static gboolean config_cache_matches(const char *path, const struct stat *st)
+{
+    return config_cache.path && strcmp(config_cache.path, path) == 0 && config_cache.dev == st->st_dev &&
+           config_cache.ino == st->st_ino && config_cache.size == st->st_size &&
+           config_cache.mtime.tv_sec == st->st_mtim.tv_sec && config_cache.mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+// Returns the entries of the file, with their handlers looked up but not applied, or NULL
+static GArray *config_parse_entries(const char *path)
+{
     FILE *fp = fopen(path, "r");
     if (!fp)
-        return FALSE;
+        return NULL;
 
+    GArray *entries = g_array_new(FALSE, FALSE, sizeof(ConfigEntry));
     char *line = NULL;
     size_t line_size = 0;
     while (getline(&line, &line_size, fp) >= 0) {
-        char *key, *value;
-        if (parse_line(line, &key, &value)) {
-            add_entry(key, value);
-            free(key);
-            free(value);
+        ConfigEntry entry;
+        if (parse_line(line, &entry.key, &entry.value)) {
+            entry.config_key = find_config_key(entry.key);
+            g_array_append_val(entries, entry);
         }
     }
     free(line);
     fclose(fp);
+    return entries;
+}
+
+static void apply_config_entries(GArray *entries)
+{
+    for (guint i = 0; i < entries->len; i++) {
+        ConfigEntry *entry = &g_array_index(entries, ConfigEntry, i);
+        apply_config_entry(entry->config_key, entry->key, entry->value);
+    }
+}
+
+gboolean config_read_file(const char *path)
+{
+    fprintf(stderr, "tint2: Loading config file: %s\n", path);
+
+    struct stat st;
+    gboolean have_stat = stat(path, &st) == 0;
+    if (have_stat && config_cache_matches(path, &st)) {
+        apply_config_entries(config_cache.entries);
+    } else {
+        GArray *entries = config_parse_entries(path);
+        if (!entries)
+            return FALSE;
+        apply_config_entries(entries);
+        if (have_stat)
+            set_config_cache(path, &st, entries);
+        else
+            free_config_entries(entries);
+    }
 
     if (!read_panel_position) {
         panel_horizontal = TRUE;
@@ -1366,17 +2346,7 @@ gboolean config_read_file(const char *path)
         }
     }
 
-    if (backgrounds->len > 0) {
-        Background *bg = &g_array_index(backgrounds, Background, backgrounds->len - 1);
-        if (!read_bg_color_hover)
-            memcpy(&bg->fill_color_hover, &bg->fill_color, sizeof(Color));
-        if (!read_border_color_hover)
-            memcpy(&bg->border_color_hover, &bg->border, sizeof(Color));
-        if (!read_bg_color_press)
-            memcpy(&bg->fill_color_pressed, &bg->fill_color_hover, sizeof(Color));
-        if (!read_border_color_press)
-            memcpy(&bg->border_color_pressed, &bg->border_color_hover, sizeof(Color));
-    }
+    finish_background();
 
     return TRUE;
 }
@@ -1460,4 +2430,209 @@ gboolean config_read()
     return config_read_default_path();
 }
 
+// Entries that only change how existing areas are painted (and their border widths).
+// The rounded radius is not one of them: it is clamped to the size of the areas when the panels are initialized.
+static gboolean config_entry_is_background(const ConfigEntry *entry)
+{
+    if (!entry->config_key)
+        return FALSE;
+    if (entry->config_key->handler == add_gradient_entry)
+        return TRUE;
+    return entry->config_key->handler == add_background_entry && entry->config_key->id != CONFIG_KEY_ROUNDED &&
+           entry->config_key->id != CONFIG_KEY_SCALE_RELATIVE_TO_DPI &&
+           entry->config_key->id != CONFIG_KEY_SCALE_RELATIVE_TO_SCREEN_HEIGHT;
+}
+
+static gboolean config_entry_is_font(const ConfigEntry *entry)
+{
+    return g_str_has_suffix(entry->key, "_font");
+}
+
+// Returns TRUE if both panel_items values have the same items, possibly in a different order
+static gboolean panel_items_are_reordered(const char *old_items, const char *new_items)
+{
+    if (strlen(old_items) != strlen(new_items))
+        return FALSE;
+    int counts[256] = {0};
+    for (const char *c = old_items; *c; c++)
+        counts[(unsigned char)*c]++;
+    for (const char *c = new_items; *c; c++) {
+        if (--counts[(unsigned char)*c] < 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// Applies a *_font entry whose value changed, freeing the font it replaces
+static void reload_font_entry(GArray *entries, guint index)
+{
+    ConfigEntry *entry = &g_array_index(entries, ConfigEntry, index);
+    gboolean is_execp = strcmp(entry->key, "execp_font") == 0;
+    gboolean is_button = strcmp(entry->key, "button_font") == 0;
+
+    // A later entry for the same font overrides this one
+    for (guint i = index + 1; i < entries->len; i++) {
+        const char *key = g_array_index(entries, ConfigEntry, i).key;
+        if ((is_execp && strcmp(key, "execp") == 0) || (is_button && strcmp(key, "button") == 0))
+            break;
+        if (strcmp(key, entry->key) == 0)
+            return;
+    }
+
+    if (is_execp || is_button) {
+        // The handlers apply to the last execp or button, so find the one declared before this entry
+        int n = 0;
+        for (guint i = 0; i < index; i++) {
+            if (strcmp(g_array_index(entries, ConfigEntry, i).key, is_execp ? "execp" : "button") == 0)
+                n++;
+        }
+        GList *item = g_list_nth(is_execp ? panel_config.execp_list : panel_config.button_list, MAX(n - 1, 0));
+        if (!item)
+            return;
+        if (is_execp) {
+            Execp *execp = (Execp *)item->data;
+            pango_font_description_free(execp->backend->font_desc);
+            execp->backend->font_desc = pango_font_description_from_string(entry->value);
+            execp->backend->has_font = TRUE;
+        } else {
+            Button *button = (Button *)item->data;
+            pango_font_description_free(button->backend->font_desc);
+            button->backend->font_desc = pango_font_description_from_string(entry->value);
+            button->backend->has_font = TRUE;
+        }
+        return;
+    }
+
+    // The entry was already in the file, so the fonts replaced here are the configured ones, not the defaults
+    if (strcmp(entry->key, "task_font") == 0) {
+        pango_font_description_free(panel_config.g_task.font_desc);
+        panel_config.g_task.font_desc = NULL;
+    } else if (strcmp(entry->key, "taskbar_name_font") == 0) {
+        pango_font_description_free(panel_config.taskbarname_font_desc);
+        panel_config.taskbarname_font_desc = NULL;
+    } else if (strcmp(entry->key, "time1_font") == 0) {
+        pango_font_description_free(time1_font_desc);
+        time1_font_desc = NULL;
+    } else if (strcmp(entry->key, "time2_font") == 0) {
+        pango_font_description_free(time2_font_desc);
+        time2_font_desc = NULL;
+#ifdef ENABLE_BATTERY
+    } else if (strcmp(entry->key, "bat1_font") == 0) {
+        pango_font_description_free(bat1_font_desc);
+        bat1_font_desc = NULL;
+    } else if (strcmp(entry->key, "bat2_font") == 0) {
+        pango_font_description_free(bat2_font_desc);
+        bat2_font_desc = NULL;
+#endif
+    } else if (strcmp(entry->key, "tooltip_font") == 0) {
+        pango_font_description_free(g_tooltip.font_desc);
+        g_tooltip.font_desc = NULL;
+    }
+    apply_config_entry(entry->config_key, entry->key, entry->value);
+
+    if (strcmp(entry->key, "task_font") == 0) {
+        // The panels share the configured task font
+        for (int i = 0; i < num_panels; i++)
+            panels[i].g_task.font_desc = panel_config.g_task.font_desc;
+    }
+}
+
+gboolean config_reload()
+{
+    if (!config_path || !config_cache.entries)
+        return FALSE;
+
+    struct stat st;
+    if (stat(config_path, &st) != 0 || config_cache_matches(config_path, &st))
+        return FALSE;
+
+    GArray *entries = config_parse_entries(config_path);
+    if (!entries)
+        return FALSE;
+
+    // The new file must have the same entries in the same order, with only backgrounds, fonts or the order of the
+    // panel items changed
+    gboolean compatible = entries->len == config_cache.entries->len;
+    if (!compatible)
+        fprintf(stderr, "tint2: config entries were added or removed, restarting\n");
+    gboolean backgrounds_changed = FALSE;
+    gboolean fonts_changed = FALSE;
+    gboolean items_changed = FALSE;
+    for (guint i = 0; compatible && i < entries->len; i++) {
+        ConfigEntry *old_entry = &g_array_index(config_cache.entries, ConfigEntry, i);
+        ConfigEntry *new_entry = &g_array_index(entries, ConfigEntry, i);
+        if (strcmp(old_entry->key, new_entry->key) != 0) {
+            compatible = FALSE;
+            fprintf(stderr,
+                    "tint2: config entry '%s' was replaced by '%s', restarting\n",
+                    old_entry->key,
+                    new_entry->key);
+        } else if (strcmp(old_entry->value, new_entry->value) != 0) {
+            if (config_entry_is_background(new_entry))
+                backgrounds_changed = TRUE;
+            else if (config_entry_is_font(new_entry))
+                fonts_changed = TRUE;
+            else if (strcmp(new_entry->key, "panel_items") == 0 &&
+                     panel_items_are_reordered(old_entry->value, new_entry->value))
+                items_changed = TRUE;
+            else
+                compatible = FALSE;
+            if (!compatible)
+                fprintf(stderr, "tint2: config entry '%s' cannot be changed without restarting\n", new_entry->key);
+        }
+    }
+    if (!compatible) {
+        free_config_entries(entries);
+        return FALSE;
+    }
+
+    if (backgrounds_changed) {
+        // Rebuild the backgrounds and gradients into new arrays, then copy them over the ones in use
+        GArray *old_backgrounds = backgrounds;
+        GArray *old_gradients = gradients;
+        init_backgrounds();
+        read_bg_color_hover = FALSE;
+        read_border_color_hover = FALSE;
+        read_bg_color_press = FALSE;
+        read_border_color_press = FALSE;
+        for (guint i = 0; i < entries->len; i++) {
+            ConfigEntry *entry = &g_array_index(entries, ConfigEntry, i);
+            if (entry->config_key && (entry->config_key->handler == add_background_entry ||
+                                      entry->config_key->handler == add_gradient_entry))
+                apply_config_entry(entry->config_key, entry->key, entry->value);
+        }
+        finish_background();
+        GArray *new_backgrounds = backgrounds;
+        GArray *new_gradients = gradients;
+        backgrounds = old_backgrounds;
+        gradients = old_gradients;
+        if (!update_backgrounds(new_backgrounds, new_gradients)) {
+            free_config_entries(entries);
+            return FALSE;
+        }
+    }
+
+    // Nothing below can fail
+    for (guint i = 0; i < entries->len; i++) {
+        ConfigEntry *old_entry = &g_array_index(config_cache.entries, ConfigEntry, i);
+        ConfigEntry *new_entry = &g_array_index(entries, ConfigEntry, i);
+        if (items_changed && strcmp(new_entry->key, "panel_items") == 0)
+            apply_config_entry(new_entry->config_key, new_entry->key, new_entry->value);
+        else if (config_entry_is_font(new_entry) && strcmp(old_entry->value, new_entry->value) != 0)
+            reload_font_entry(entries, i);
+    }
+    if (fonts_changed)
+        update_fonts();
+    if (items_changed) {
+        for (int i = 0; i < num_panels; i++) {
+            set_panel_items_order(&panels[i]);
+            panels[i].area.resize_needed = 1;
+        }
+        schedule_panel_redraw();
+    }
+
+    set_config_cache(config_path, &st, entries);
+    return TRUE;
+}
+
 #endif
@@ -22,4 +22,13 @@ void cleanup_config();
 
 gboolean config_read();
 
+// Applies the changes made to the config file since it was read, without restarting.
+// Only changes to backgrounds, gradients (except the rounded radius), fonts and the order of panel_items
+// are applied in place; any other change, or an added or removed entry, needs a full restart.
+// Returns FALSE if the changes need a full restart; nothing has been modified in that case.
+gboolean config_reload();
+
+// Frees the entries kept to speed up restarts. Called before exiting.
+void free_config_cache();
+
 #endif
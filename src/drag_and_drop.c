@@ -18,6 +18,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <X11/Xatom.h>
+
 #include "drag_and_drop.h"
 #include "panel.h"
 #include "server.h"
@@ -153,7 +155,7 @@ void dnd_init()
     dnd_source_window = 0;
     dnd_target_window = 0;
     dnd_version = 0;
-    dnd_selection = XInternAtom(server.display, "PRIMARY", 0);
+    dnd_selection = XA_PRIMARY;
     dnd_atom = None;
     dnd_sent_request = 0;
     dnd_launcher_icon = NULL;
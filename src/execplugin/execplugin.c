@@ -11,14 +11,23 @@
 #include <errno.h>
 #include <time.h>
 #include <fcntl.h>
+#include <sys/socket.h>
 
+#include "event_loop.h"
 #include "window.h"
 #include "server.h"
 #include "panel.h"
 #include "timer.h"
 #include "common.h"
+#include "sampler.h"
+#include "tooltip.h"
 
 #define MAX_TOOLTIP_LEN 4096
+#define MAX_COPROCESS_RESTART_DELAY 60
+// Minimum time in seconds a coprocess has to reply to an update request before it is restarted
+#define MIN_COPROCESS_REPLY_TIMEOUT 30
+// Output kept in continuous mode while waiting for the end of a frame
+#define MAX_CONTINUOUS_BUFFER_LEN (1024 * 1024)
 
 bool debug_executors = false;
 
@@ -27,6 +36,8 @@ char *execp_get_tooltip(void *obj);
 void execp_init_fonts();
 int execp_compute_desired_size(void *obj);
 void execp_dump_geometry(void *obj, int indent);
+static void execp_close_pipes(Execp *execp);
+static void execp_update_sampler_subscription(Execp *execp);
 
 void default_execp()
 {
@@ -38,6 +49,8 @@ Execp *create_execp()
     execp->backend = (ExecpBackend *)calloc(1, sizeof(ExecpBackend));
     execp->backend->child_pipe_stdout = -1;
     execp->backend->child_pipe_stderr = -1;
+    execp->backend->child_pipe_stdin = -1;
+    execp->backend->last_update_cpu_time = -1;
     execp->backend->cmd_pids = g_tree_new(cmp_ptr);
     execp->backend->interval = 30;
     execp->backend->cache_icon = TRUE;
@@ -71,6 +84,9 @@ void destroy_execp(void *obj)
     } else {
         // This is a backend element
         destroy_timer(&execp->backend->timer);
+        free_and_null(execp->backend->text_template);
+        free_and_null(execp->backend->tooltip_template);
+        execp_update_sampler_subscription(execp);
 
         free_icon(execp->backend->icon);
         free_and_null(execp->backend->buf_stdout);
@@ -81,14 +97,7 @@ void destroy_execp(void *obj)
             kill(-execp->backend->child, SIGHUP);
             execp->backend->child = 0;
         }
-        if (execp->backend->child_pipe_stdout >= 0) {
-            close(execp->backend->child_pipe_stdout);
-            execp->backend->child_pipe_stdout = -1;
-        }
-        if (execp->backend->child_pipe_stderr >= 0) {
-            close(execp->backend->child_pipe_stderr);
-            execp->backend->child_pipe_stderr = -1;
-        }
+        execp_close_pipes(execp);
         if (execp->backend->cmd_pids) {
             g_tree_destroy(execp->backend->cmd_pids);
             execp->backend->cmd_pids = NULL;
@@ -150,6 +159,11 @@ void init_execp()
         execp->backend->buf_stderr = calloc(execp->backend->buf_stderr_capacity, 1);
         execp->backend->text = strdup("");
         execp->backend->icon_path = NULL;
+        if (execp->backend->has_user_tooltip && sampler_has_tokens(execp->backend->tooltip)) {
+            execp->backend->tooltip_template = execp->backend->tooltip;
+            execp->backend->tooltip = NULL;
+        }
+        execp_update_sampler_subscription(execp);
     }
 }
 
@@ -575,9 +589,16 @@ void execp_dump_geometry(void *obj, int indent)
             execp->backend->text);
 }
 
+static gboolean execp_update_in_progress(Execp *execp)
+{
+    if (execp->backend->coprocess)
+        return execp->backend->update_requested;
+    return execp->backend->child_pipe_stdout >= 0;
+}
+
 void execp_force_update(Execp *execp)
 {
-    if (execp->backend->child_pipe_stdout > 0) {
+    if (execp_update_in_progress(execp)) {
         // Command currently running, nothing to do
     } else {
         // Run command right away
@@ -629,22 +650,165 @@ void execp_cmd_completed(Execp *execp, pid_t pid)
     execp_force_update(execp);
 }
 
-void execp_timer_callback(void *arg)
+void execp_command_reaped(Execp *execp, const struct rusage *usage)
 {
-    Execp *execp = (Execp *)arg;
+    execp->backend->command_pid = 0;
+    // Coprocesses are measured for each update instead
+    if (!execp->backend->coprocess)
+        execp->backend->last_update_cpu_time = usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1.0e6 +
+                                               usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1.0e6;
+}
 
-    if (!execp->backend->command)
-        return;
+// Returns the CPU time used by a process and the children it has reaped, in seconds, or -1 if unknown.
+static double process_cpu_time(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+    char buffer[1024];
+    size_t length = fread(buffer, 1, sizeof(buffer) - 1, f);
+    fclose(f);
+    buffer[length] = '\0';
+
+    // The command name may contain spaces and parentheses, so the fields are counted from the last ')'
+    char *fields = strrchr(buffer, ')');
+    unsigned long long utime, stime, cutime, cstime;
+    if (!fields ||
+        sscanf(fields + 1,
+               " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %llu %llu",
+               &utime,
+               &stime,
+               &cutime,
+               &cstime) != 4)
+        return -1;
+    return (utime + stime + cutime + cstime) / (double)sysconf(_SC_CLK_TCK);
+}
 
-    // Still running!
-    if (execp->backend->child_pipe_stdout > 0)
-        return;
+static void execp_close_pipes(Execp *execp)
+{
+    if (execp->backend->child_pipe_stdout >= 0) {
+        unwatch_fd(execp->backend->child_pipe_stdout);
+        close(execp->backend->child_pipe_stdout);
+        execp->backend->child_pipe_stdout = -1;
+    }
+    if (execp->backend->child_pipe_stderr >= 0) {
+        unwatch_fd(execp->backend->child_pipe_stderr);
+        close(execp->backend->child_pipe_stderr);
+        execp->backend->child_pipe_stderr = -1;
+    }
+    if (execp->backend->child_pipe_stdin >= 0) {
+        close(execp->backend->child_pipe_stdin);
+        execp->backend->child_pipe_stdin = -1;
+    }
+}
 
+// Returns TRUE if the text has changed.
+static gboolean execp_expand_sampler_tokens(Execp *execp)
+{
+    char buffer[MAX_TOOLTIP_LEN + 1];
+    gboolean text_changed = FALSE;
+    if (execp->backend->text_template) {
+        sampler_expand(execp->backend->text_template, buffer, sizeof(buffer));
+        if (!execp->backend->text || strcmp(buffer, execp->backend->text) != 0) {
+            free(execp->backend->text);
+            execp->backend->text = strdup(buffer);
+            text_changed = TRUE;
+        }
+    }
+    if (execp->backend->tooltip_template) {
+        sampler_expand(execp->backend->tooltip_template, buffer, sizeof(buffer));
+        free(execp->backend->tooltip);
+        execp->backend->tooltip = strdup(buffer);
+    }
+    return text_changed;
+}
+
+// Called for backend elements after each sample
+static void execp_sampler_update(void *obj)
+{
+    Execp *execp = (Execp *)obj;
+    gboolean text_changed = execp_expand_sampler_tokens(execp);
+    gboolean has_icon = execp->backend->has_icon && execp->backend->icon_path && execp->backend->icon;
+    for (GList *l = execp->backend->instances; l; l = l->next) {
+        Execp *instance = (Execp *)l->data;
+        if (text_changed) {
+            // Same as execp_update_post_read(), but the icon has not changed and is not reloaded
+            if (!has_icon && !execp->backend->text[0]) {
+                if (instance->area.on_screen)
+                    hide(&instance->area);
+            } else {
+                if (!instance->area.on_screen)
+                    show(&instance->area);
+                instance->area.resize_needed = TRUE;
+                schedule_redraw(&instance->area);
+                schedule_panel_redraw();
+            }
+        }
+        if (execp->backend->tooltip_template && g_tooltip.mapped && g_tooltip.area == &instance->area) {
+            tooltip_update_contents_for(&instance->area);
+            tooltip_update();
+        }
+    }
+}
+
+static void execp_update_sampler_subscription(Execp *execp)
+{
+    gboolean needed = execp->backend->text_template || execp->backend->tooltip_template;
+    if (needed && !execp->backend->sampler_subscribed) {
+        execp->backend->sampler_subscribed = TRUE;
+        sampler_subscribe(execp_sampler_update, execp);
+    } else if (!needed && execp->backend->sampler_subscribed) {
+        execp->backend->sampler_subscribed = FALSE;
+        sampler_unsubscribe(execp_sampler_update, execp);
+    }
+}
+
+// Output with sampler tokens is kept as a template, expanded again after each sample without running the command
+static void execp_update_text_template(Execp *execp)
+{
+    free_and_null(execp->backend->text_template);
+    if (sampler_has_tokens(execp->backend->text)) {
+        execp->backend->text_template = execp->backend->text;
+        execp->backend->text = NULL;
+        execp_expand_sampler_tokens(execp);
+    }
+    execp_update_sampler_subscription(execp);
+}
+
+static void execp_pipe_ready(int fd, void *arg)
+{
+    Execp *execp = (Execp *)arg;
+    if (read_execp(execp)) {
+        execp_update_text_template(execp);
+        for (GList *l = execp->backend->instances; l; l = l->next) {
+            Execp *instance = (Execp *)l->data;
+            execp_update_post_read(instance);
+        }
+    }
+}
+
+static void execp_reset_stdout_buffer(Execp *execp)
+{
+    if (execp->backend->buf_stdout_capacity > MAX_CONTINUOUS_BUFFER_LEN) {
+        execp->backend->buf_stdout_capacity = 1024;
+        execp->backend->buf_stdout = realloc(execp->backend->buf_stdout, execp->backend->buf_stdout_capacity);
+    }
+    execp->backend->buf_stdout_length = 0;
+    execp->backend->buf_stdout[execp->backend->buf_stdout_length] = '\0';
+    execp->backend->buf_stdout_scanned = 0;
+    execp->backend->buf_stdout_lines = 0;
+}
+
+// Starts the command with its output connected to pipes, and for coprocesses its input too.
+static gboolean execp_start_command(Execp *execp)
+{
     int pipe_fd_stdout[2];
     if (pipe(pipe_fd_stdout)) {
         // TODO maybe write this in tooltip, but if this happens we're screwed anyways
         fprintf(stderr, "tint2: Execp: Creating pipe failed!\n");
-        return;
+        return FALSE;
     }
 
     fcntl(pipe_fd_stdout[0], F_SETFL, O_NONBLOCK | fcntl(pipe_fd_stdout[0], F_GETFL));
@@ -655,11 +819,25 @@ void execp_timer_callback(void *arg)
         close(pipe_fd_stdout[0]);
         // TODO maybe write this in tooltip, but if this happens we're screwed anyways
         fprintf(stderr, "tint2: Execp: Creating pipe failed!\n");
-        return;
+        return FALSE;
     }
 
     fcntl(pipe_fd_stderr[0], F_SETFL, O_NONBLOCK | fcntl(pipe_fd_stderr[0], F_GETFL));
 
+    // A socket rather than a pipe: writing to a coprocess that has exited fails with EPIPE instead of raising SIGPIPE
+    int fd_stdin[2] = {-1, -1};
+    if (execp->backend->coprocess) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd_stdin)) {
+            close(pipe_fd_stdout[1]);
+            close(pipe_fd_stdout[0]);
+            close(pipe_fd_stderr[1]);
+            close(pipe_fd_stderr[0]);
+            fprintf(stderr, "tint2: Execp: Creating socket failed!\n");
+            return FALSE;
+        }
+        fcntl(fd_stdin[0], F_SETFL, O_NONBLOCK | fcntl(fd_stdin[0], F_GETFL));
+    }
+
     // Fork and run command, capturing stdout in pipe
     pid_t child = fork();
     if (child == -1) {
@@ -669,7 +847,11 @@ void execp_timer_callback(void *arg)
         close(pipe_fd_stdout[0]);
         close(pipe_fd_stderr[1]);
         close(pipe_fd_stderr[0]);
-        return;
+        if (fd_stdin[0] >= 0) {
+            close(fd_stdin[1]);
+            close(fd_stdin[0]);
+        }
+        return FALSE;
     } else if (child == 0) {
         if (debug_executors)
             fprintf(stderr, "tint2: Executing: %s\n", execp->backend->command);
@@ -680,6 +862,11 @@ void execp_timer_callback(void *arg)
         close(pipe_fd_stderr[0]);
         dup2(pipe_fd_stderr[1], 2); // 2 is stderr
         close(pipe_fd_stderr[1]);
+        if (fd_stdin[0] >= 0) {
+            close(fd_stdin[0]);
+            dup2(fd_stdin[1], 0); // 0 is stdin
+            close(fd_stdin[1]);
+        }
         close_all_fds();
         setpgid(0, 0);
         execl("/bin/sh", "/bin/sh", "-c", execp->backend->command, NULL);
@@ -689,28 +876,129 @@ void execp_timer_callback(void *arg)
     }
     close(pipe_fd_stdout[1]);
     close(pipe_fd_stderr[1]);
+    if (fd_stdin[1] >= 0)
+        close(fd_stdin[1]);
     execp->backend->child = child;
+    execp->backend->command_pid = child;
     execp->backend->child_pipe_stdout = pipe_fd_stdout[0];
     execp->backend->child_pipe_stderr = pipe_fd_stderr[0];
-    execp->backend->buf_stdout_length = 0;
-    execp->backend->buf_stdout[execp->backend->buf_stdout_length] = '\0';
+    execp->backend->child_pipe_stdin = fd_stdin[0];
+    watch_fd(execp->backend->child_pipe_stdout, execp_pipe_ready, execp);
+    watch_fd(execp->backend->child_pipe_stderr, execp_pipe_ready, execp);
+    execp_reset_stdout_buffer(execp);
     execp->backend->buf_stderr_length = 0;
     execp->backend->buf_stderr[execp->backend->buf_stderr_length] = '\0';
+    return TRUE;
+}
+
+static void execp_restart_coprocess_later(Execp *execp)
+{
+    if (execp->backend->restart_delay)
+        execp->backend->restart_delay = MIN(2 * execp->backend->restart_delay, MAX_COPROCESS_RESTART_DELAY);
+    else
+        execp->backend->restart_delay = 1;
+    fprintf(stderr,
+            YELLOW "tint2: Execp: coprocess '%s' is not running, restarting it in %ds" RESET "\n",
+            execp->backend->command,
+            execp->backend->restart_delay);
+    change_timer(&execp->backend->timer, true, execp->backend->restart_delay * 1000, 0, execp_timer_callback, execp);
+}
+
+// Kills a coprocess that does not answer. Its process group is killed, in case it is blocked in a child.
+static void execp_kill_coprocess(Execp *execp)
+{
+    if (execp->backend->child > 0)
+        kill(-execp->backend->child, SIGKILL);
+    execp_close_pipes(execp);
+    execp->backend->child = 0;
+    execp->backend->update_requested = FALSE;
+}
+
+static void execp_reply_timeout(void *arg)
+{
+    Execp *execp = (Execp *)arg;
+    fprintf(stderr,
+            YELLOW "tint2: Execp: coprocess '%s' did not reply to an update request, killing it" RESET "\n",
+            execp->backend->command);
+    execp_kill_coprocess(execp);
+    execp_restart_coprocess_later(execp);
+}
+
+static void execp_request_update(Execp *execp)
+{
+    if (execp->backend->update_requested)
+        return;
+
+    if (execp->backend->child_pipe_stdout < 0 && !execp_start_command(execp)) {
+        execp_restart_coprocess_later(execp);
+        return;
+    }
+
+    const char *request = "update\n";
+    if (send(execp->backend->child_pipe_stdin, request, strlen(request), MSG_NOSIGNAL) < 0) {
+        // The coprocess has exited or closed its input; either way it cannot be updated anymore
+        fprintf(stderr,
+                "tint2: Execp: could not request an update from '%s': %s\n",
+                execp->backend->command,
+                strerror(errno));
+        execp_kill_coprocess(execp);
+        execp_restart_coprocess_later(execp);
+        return;
+    }
+    execp->backend->update_requested = TRUE;
+    // The timer is idle until the reply is read, so it serves as the reply deadline
+    change_timer(&execp->backend->timer,
+                 true,
+                 MAX(execp->backend->interval, MIN_COPROCESS_REPLY_TIMEOUT) * 1000,
+                 0,
+                 execp_reply_timeout,
+                 execp);
     execp->backend->last_update_start_time = time(NULL);
+    execp->backend->request_cpu_time = process_cpu_time(execp->backend->child);
+}
+
+void execp_timer_callback(void *arg)
+{
+    Execp *execp = (Execp *)arg;
+
+    if (!execp->backend->command)
+        return;
+
+    if (execp->backend->coprocess) {
+        execp_request_update(execp);
+        return;
+    }
+
+    // Still running!
+    if (execp->backend->child_pipe_stdout > 0)
+        return;
+
+    if (execp_start_command(execp))
+        execp->backend->last_update_start_time = time(NULL);
 }
 
-void read_from_pipe(int fd, char **buffer, ssize_t *buffer_length, ssize_t *buffer_capacity, gboolean *eof)
+// Reads the data available on fd into the buffer, growing it as needed.
+// If max_length is not 0, stops once the buffer holds max_length bytes; the rest is read on the next call.
+void read_from_pipe(int fd,
+                    char **buffer,
+                    ssize_t *buffer_length,
+                    ssize_t *buffer_capacity,
+                    ssize_t max_length,
+                    gboolean *eof)
 {
     *eof = FALSE;
     while (1) {
+        if (max_length && *buffer_length >= max_length)
+            break;
         // Make sure there is free space in the buffer
         if (*buffer_capacity - *buffer_length < 1024) {
             *buffer_capacity *= 2;
             *buffer = (char *)realloc(*buffer, *buffer_capacity);
         }
-        ssize_t count = read(fd,
-                             *buffer + *buffer_length,
-                             *buffer_capacity - *buffer_length - 1);
+        ssize_t size = *buffer_capacity - *buffer_length - 1;
+        if (max_length)
+            size = MIN(size, max_length - *buffer_length);
+        ssize_t count = read(fd, *buffer + *buffer_length, size);
         if (count > 0) {
             // Successful read
             *buffer_length += count;
@@ -768,6 +1056,194 @@ void rstrip(char *s)
     }
 }
 
+// Used when the command keeps running: the tooltip shows its standard error since the last ANSI clear screen
+static void execp_update_tooltip_from_stderr(Execp *execp)
+{
+    char *ansi_clear_screen = (char*)"\x1b[2J";
+    if (!execp->backend->has_user_tooltip) {
+        free_and_null(execp->backend->tooltip);
+        char *start = last_substring(execp->backend->buf_stderr, ansi_clear_screen);
+        if (start) {
+            start += strlen(ansi_clear_screen);
+            memmove(execp->backend->buf_stderr, start, strlen(start) + 1);
+            execp->backend->buf_stderr_length = (ssize_t)strlen(execp->backend->buf_stderr);
+        }
+        if (execp->backend->buf_stderr_length > MAX_TOOLTIP_LEN) {
+            execp->backend->buf_stderr_length = MAX_TOOLTIP_LEN;
+            execp->backend->buf_stderr[execp->backend->buf_stderr_length] = '\0';
+        }
+        execp->backend->tooltip = strdup(execp->backend->buf_stderr);
+        rstrip(execp->backend->tooltip);
+    } else {
+        execp->backend->buf_stderr_length = 0;
+        execp->backend->buf_stderr[execp->backend->buf_stderr_length] = '\0';
+    }
+}
+
+// Used when the command keeps running: extracts the icon path and the text from one update
+static void execp_set_output(Execp *execp, char *output)
+{
+    free_and_null(execp->backend->text);
+    free_and_null(execp->backend->icon_path);
+    if (!execp->backend->has_icon) {
+        execp->backend->text = strdup(output);
+    } else {
+        char *text = strchr(output, '\n');
+        if (text) {
+            *text = '\0';
+            text++;
+            execp->backend->text = strdup(text);
+        } else {
+            execp->backend->text = strdup("");
+        }
+        execp->backend->icon_path = expand_tilde(output);
+    }
+    size_t len = strlen(execp->backend->text);
+    if (len > 0 && execp->backend->text[len - 1] == '\n')
+        execp->backend->text[len - 1] = '\0';
+}
+
+static gboolean read_coprocess(Execp *execp)
+{
+    gboolean stdout_eof, stderr_eof;
+    read_from_pipe(execp->backend->child_pipe_stdout,
+                   &execp->backend->buf_stdout,
+                   &execp->backend->buf_stdout_length,
+                   &execp->backend->buf_stdout_capacity,
+                   0,
+                   &stdout_eof);
+    if (execp->backend->child_pipe_stderr >= 0) {
+        read_from_pipe(execp->backend->child_pipe_stderr,
+                       &execp->backend->buf_stderr,
+                       &execp->backend->buf_stderr_length,
+                       &execp->backend->buf_stderr_capacity,
+                       0,
+                       &stderr_eof);
+        if (stderr_eof && !stdout_eof) {
+            // The coprocess closed its standard error but keeps running
+            unwatch_fd(execp->backend->child_pipe_stderr);
+            close(execp->backend->child_pipe_stderr);
+            execp->backend->child_pipe_stderr = -1;
+        }
+    }
+    execp_update_tooltip_from_stderr(execp);
+    if (!execp->backend->has_user_tooltip && execp->backend->tooltip && !*execp->backend->tooltip) {
+        // Nothing on stderr: show the update times instead
+        free_and_null(execp->backend->tooltip);
+    }
+
+    // Each reply ends with an empty line; only the last complete one is shown
+    char *reply = NULL;
+    char *next_reply = execp->backend->buf_stdout;
+    for (char *line = next_reply, *eol; (eol = strchr(line, '\n')); line = eol + 1) {
+        if (eol == line) {
+            *eol = '\0';
+            reply = next_reply;
+            next_reply = eol + 1;
+        }
+    }
+
+    if (reply) {
+        execp_set_output(execp, reply);
+        ssize_t remaining = execp->backend->buf_stdout_length - (next_reply - execp->backend->buf_stdout);
+        memmove(execp->backend->buf_stdout, next_reply, (size_t)remaining);
+        execp->backend->buf_stdout_length = remaining;
+        execp->backend->buf_stdout[execp->backend->buf_stdout_length] = '\0';
+
+        execp->backend->restart_delay = 0;
+        execp->backend->last_update_finish_time = time(NULL);
+        execp->backend->last_update_duration =
+            execp->backend->last_update_finish_time - execp->backend->last_update_start_time;
+        double cpu_time = process_cpu_time(execp->backend->child);
+        if (cpu_time >= 0 && execp->backend->request_cpu_time >= 0)
+            execp->backend->last_update_cpu_time = cpu_time - execp->backend->request_cpu_time;
+        else
+            execp->backend->last_update_cpu_time = -1;
+        if (execp->backend->update_requested) {
+            execp->backend->update_requested = FALSE;
+            if (execp->backend->interval)
+                change_timer(&execp->backend->timer,
+                             true,
+                             execp->backend->interval * 1000,
+                             0,
+                             execp_timer_callback,
+                             execp);
+            else
+                stop_timer(&execp->backend->timer);
+        }
+    }
+
+    if (stdout_eof) {
+        execp_close_pipes(execp);
+        execp->backend->child = 0;
+        execp->backend->update_requested = FALSE;
+        execp_restart_coprocess_later(execp);
+    }
+
+    return reply != NULL;
+}
+
+// Continuous mode: splits the output read since the last call in frames of `continuous` lines.
+// Only the newest complete frame is shown, the older ones are dropped.
+// Returns TRUE if a frame has been shown.
+static gboolean execp_read_newest_frame(Execp *execp)
+{
+    char *buffer = execp->backend->buf_stdout;
+    // The partial frame always starts at the beginning of the buffer
+    ssize_t frame_start = 0;
+    ssize_t newest_frame_start = -1;
+    ssize_t newest_frame_end = -1;
+    int num_frames = 0;
+    for (ssize_t i = execp->backend->buf_stdout_scanned; i < execp->backend->buf_stdout_length; i++) {
+        if (buffer[i] != '\n')
+            continue;
+        execp->backend->buf_stdout_lines++;
+        if (execp->backend->buf_stdout_lines == execp->backend->continuous) {
+            newest_frame_start = frame_start;
+            newest_frame_end = i;
+            frame_start = i + 1;
+            execp->backend->buf_stdout_lines = 0;
+            num_frames++;
+        }
+    }
+    execp->backend->buf_stdout_scanned = execp->backend->buf_stdout_length;
+
+    if (!num_frames) {
+        if (execp->backend->buf_stdout_length >= MAX_CONTINUOUS_BUFFER_LEN) {
+            // The command does not print line ends, do not let the buffer grow forever
+            fprintf(stderr,
+                    YELLOW "tint2: Execp: '%s' printed %zd bytes without completing a frame, discarding them" RESET
+                           "\n",
+                    execp->backend->command,
+                    execp->backend->buf_stdout_length);
+            execp->backend->frames_dropped++;
+            execp_reset_stdout_buffer(execp);
+        }
+        return FALSE;
+    }
+
+    buffer[newest_frame_end] = '\0';
+    execp_set_output(execp, buffer + newest_frame_start);
+    execp->backend->frames_shown++;
+    execp->backend->frames_dropped += num_frames - 1;
+    if (debug_executors && num_frames > 1)
+        fprintf(stderr,
+                "tint2: Execp: '%s': %d frames read at once, dropped %d (total: %lu shown, %lu dropped)\n",
+                execp->backend->command,
+                num_frames,
+                num_frames - 1,
+                execp->backend->frames_shown,
+                execp->backend->frames_dropped);
+
+    // Keep only the partial frame; it has already been scanned
+    ssize_t remaining = execp->backend->buf_stdout_length - frame_start;
+    memmove(buffer, buffer + frame_start, (size_t)remaining);
+    execp->backend->buf_stdout_length = remaining;
+    execp->backend->buf_stdout[execp->backend->buf_stdout_length] = '\0';
+    execp->backend->buf_stdout_scanned = remaining;
+    return TRUE;
+}
+
 gboolean read_execp(void *obj)
 {
     Execp *execp = (Execp *)obj;
@@ -775,26 +1251,30 @@ gboolean read_execp(void *obj)
     if (execp->backend->child_pipe_stdout < 0)
         return FALSE;
 
+    if (execp->backend->coprocess)
+        return read_coprocess(execp);
+
     gboolean stdout_eof, stderr_eof;
+    // In continuous mode the command may print faster than it is read: read at most the buffer limit at once,
+    // the rest is read after the complete frames have been consumed
     read_from_pipe(execp->backend->child_pipe_stdout,
                    &execp->backend->buf_stdout,
                    &execp->backend->buf_stdout_length,
                    &execp->backend->buf_stdout_capacity,
+                   execp->backend->continuous > 0 ? MAX_CONTINUOUS_BUFFER_LEN : 0,
                    &stdout_eof);
     read_from_pipe(execp->backend->child_pipe_stderr,
                    &execp->backend->buf_stderr,
                    &execp->backend->buf_stderr_length,
                    &execp->backend->buf_stderr_capacity,
+                   0,
                    &stderr_eof);
 
     gboolean command_finished = stdout_eof && stderr_eof;
 
     if (command_finished) {
         execp->backend->child = 0;
-        close(execp->backend->child_pipe_stdout);
-        execp->backend->child_pipe_stdout = -1;
-        close(execp->backend->child_pipe_stderr);
-        execp->backend->child_pipe_stderr = -1;
+        execp_close_pipes(execp);
         if (execp->backend->interval)
             change_timer(&execp->backend->timer, true, execp->backend->interval * 1000, 0, execp_timer_callback, execp);
     }
@@ -846,71 +1326,9 @@ gboolean read_execp(void *obj)
         return TRUE;
     } else if (execp->backend->continuous > 0) {
         // Handle stderr
-        if (!execp->backend->has_user_tooltip) {
-            free_and_null(execp->backend->tooltip);
-            char *start = last_substring(execp->backend->buf_stderr, ansi_clear_screen);
-            if (start) {
-                start += strlen(ansi_clear_screen);
-                memmove(execp->backend->buf_stderr, start, strlen(start) + 1);
-                execp->backend->buf_stderr_length = (ssize_t)strlen(execp->backend->buf_stderr);
-            }
-            if (execp->backend->buf_stderr_length > MAX_TOOLTIP_LEN) {
-                execp->backend->buf_stderr_length = MAX_TOOLTIP_LEN;
-                execp->backend->buf_stderr[execp->backend->buf_stderr_length] = '\0';
-            }
-            execp->backend->tooltip = strdup(execp->backend->buf_stderr);
-            rstrip(execp->backend->tooltip);
-        } else {
-            execp->backend->buf_stderr_length = 0;
-            execp->backend->buf_stderr[execp->backend->buf_stderr_length] = '\0';
-        }
+        execp_update_tooltip_from_stderr(execp);
         // Handle stdout
-        // Count lines in buffer
-        int num_lines = 0;
-        char *end = NULL;
-        for (char *c = execp->backend->buf_stdout; *c; c++) {
-            if (*c == '\n') {
-                num_lines++;
-                if (num_lines == execp->backend->continuous)
-                    end = c;
-            }
-        }
-        if (num_lines >= execp->backend->continuous) {
-            if (end)
-                *end = '\0';
-            free_and_null(execp->backend->text);
-            free_and_null(execp->backend->icon_path);
-            if (!execp->backend->has_icon) {
-                execp->backend->text = strdup(execp->backend->buf_stdout);
-            } else {
-                char *text = strchr(execp->backend->buf_stdout, '\n');
-                if (text) {
-                    *text = '\0';
-                    text++;
-                    execp->backend->text = strdup(text);
-                } else {
-                    execp->backend->text = strdup("");
-                }
-                execp->backend->icon_path = expand_tilde(execp->backend->buf_stdout);
-            }
-            size_t len = strlen(execp->backend->text);
-            if (len > 0 && execp->backend->text[len - 1] == '\n')
-                execp->backend->text[len - 1] = '\0';
-
-            if (end) {
-                char *next = end + 1;
-                ssize_t copied = next - execp->backend->buf_stdout;
-                ssize_t remaining = execp->backend->buf_stdout_length - copied;
-                if (remaining > 0) {
-                    memmove(execp->backend->buf_stdout, next, (size_t)remaining);
-                    execp->backend->buf_stdout_length = remaining;
-                    execp->backend->buf_stdout[execp->backend->buf_stdout_length] = '\0';
-                } else {
-                    execp->backend->buf_stdout_length = 0;
-                    execp->backend->buf_stdout[execp->backend->buf_stdout_length] = '\0';
-                }
-            }
-
+        if (execp_read_newest_frame(execp)) {
             execp->backend->last_update_finish_time = time(NULL);
             execp->backend->last_update_duration =
                 execp->backend->last_update_finish_time - execp->backend->last_update_start_time;
@@ -940,6 +1358,18 @@ const char *time_to_string(int seconds, char *buffer, size_t buffer_size)
     return buffer;
 }
 
+// Formats the time taken by the last update, with its CPU time when known
+static const char *execp_duration_to_string(Execp *execp, char *buffer, size_t buffer_size)
+{
+    char duration[256];
+    time_to_string((int)execp->backend->last_update_duration, duration, sizeof(duration));
+    if (execp->backend->last_update_cpu_time >= 0)
+        snprintf(buffer, buffer_size, "%s, %.2fs CPU", duration, execp->backend->last_update_cpu_time);
+    else
+        snprintf(buffer, buffer_size, "%s", duration);
+    return buffer;
+}
+
 char *execp_get_tooltip(void *obj)
 {
     Execp *execp = (Execp *)obj;
@@ -956,7 +1386,7 @@ char *execp_get_tooltip(void *obj)
     char tmp_buf1[256];
     char tmp_buf2[256];
     char tmp_buf3[256];
-    if (execp->backend->child_pipe_stdout < 0) {
+    if (!execp_update_in_progress(execp)) {
         // Not executing command
         if (execp->backend->last_update_finish_time) {
             // We updated at least once
@@ -965,7 +1395,7 @@ char *execp_get_tooltip(void *obj)
                          sizeof(execp->backend->tooltip_text),
                          "Last update finished %s ago (took %s). Next update starting in %s.",
                          time_to_string((int)(now - execp->backend->last_update_finish_time), tmp_buf1, sizeof(tmp_buf1)),
-                         time_to_string((int)execp->backend->last_update_duration, tmp_buf2, sizeof(tmp_buf2)),
+                         execp_duration_to_string(execp, tmp_buf2, sizeof(tmp_buf2)),
                          time_to_string((int)(execp->backend->interval - (now - execp->backend->last_update_finish_time)),
                                         tmp_buf3, sizeof(tmp_buf3)));
             } else {
@@ -973,7 +1403,7 @@ char *execp_get_tooltip(void *obj)
                          sizeof(execp->backend->tooltip_text),
                          "Last update finished %s ago (took %s).",
                          time_to_string((int)(now - execp->backend->last_update_finish_time), tmp_buf1, sizeof(tmp_buf1)),
-                         time_to_string((int)execp->backend->last_update_duration, tmp_buf2, sizeof(tmp_buf2)));
+                         execp_duration_to_string(execp, tmp_buf2, sizeof(tmp_buf2)));
             }
         } else {
             // we never requested an update
@@ -1025,17 +1455,3 @@ void execp_update_post_read(Execp *execp)
         schedule_panel_redraw();
     }
 }
-
-void handle_execp_events()
-{
-    for (GList *l = panel_config.execp_list; l; l = l->next) {
-        Execp *execp = (Execp *)l->data;
-        if (read_execp(execp)) {
-            GList *l_instance;
-            for (l_instance = execp->backend->instances; l_instance; l_instance = l_instance->next) {
-                Execp *instance = (Execp *)l_instance->data;
-                execp_update_post_read(instance);
-            }
-        }
-    }
-}
@@ -2,6 +2,7 @@
 #define EXECPLUGIN_H
 
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <pango/pangocairo.h>
 
 #include "area.h"
@@ -36,6 +37,9 @@ typedef struct ExecpBackend {
     PangoFontDescription *font_desc;
     Color font_color;
     int continuous;
+    // 1 if the command is started once, then asked for an update by writing a line on its standard input.
+    // Each reply ends with an empty line.
+    gboolean coprocess;
     gboolean has_markup;
     char *lclick_command;
     char *mclick_command;
@@ -51,18 +55,39 @@ typedef struct ExecpBackend {
     Timer timer;
     int child_pipe_stdout;
     int child_pipe_stderr;
+    // Coprocess standard input, -1 otherwise
+    int child_pipe_stdin;
     pid_t child;
+    // The last command started by the timer, until it is reaped
+    pid_t command_pid;
+    // Coprocess: an update has been requested and the reply has not been read yet
+    gboolean update_requested;
+    // Coprocess: the delay in seconds before restarting it after it exits, doubled at each failure
+    int restart_delay;
+    // Coprocess: its CPU time when the update was requested
+    double request_cpu_time;
 
     // Command output buffer
     char *buf_stdout;
     ssize_t buf_stdout_length;
     ssize_t buf_stdout_capacity;
+    // Continuous mode: the output before this offset has already been scanned for line ends
+    ssize_t buf_stdout_scanned;
+    // Continuous mode: the number of line ends in the partial frame scanned so far
+    int buf_stdout_lines;
+    // Continuous mode: frames shown, and frames skipped because a newer one had already been read
+    unsigned long frames_shown;
+    unsigned long frames_dropped;
     char *buf_stderr;
     ssize_t buf_stderr_length;
     ssize_t buf_stderr_capacity;
 
     // Text extracted from the output buffer
     char *text;
+    // The text and the user tooltip, if they contain sampler tokens; text and tooltip hold their expansion
+    char *text_template;
+    char *tooltip_template;
+    gboolean sampler_subscribed;
     // Icon path extracted from the output buffer
     char *icon_path;
     Imlib_Image icon;
@@ -74,6 +99,8 @@ typedef struct ExecpBackend {
     time_t last_update_finish_time;
     // The time it took to execute last command
     time_t last_update_duration;
+    // The CPU time used by the last command or coprocess update, in seconds, or -1 if unknown
+    double last_update_cpu_time;
 
     // List of Execp which are frontends for this backend, one for each panel
     GList *instances;
@@ -140,6 +167,9 @@ void execp_action(void *obj, int button, int x, int y, Time time);
 
 void execp_cmd_completed(Execp *obj, pid_t pid);
 
+// Called when the last command started by the timer (backend->command_pid) has been reaped.
+void execp_command_reaped(Execp *obj, const struct rusage *usage);
+
 // Called to check if new output from the command can be read.
 // No command might be running.
 // Returns 1 if the output has been updated and a redraw is needed.
@@ -150,6 +180,4 @@ void execp_update_post_read(Execp *execp);
 
 void execp_default_font_changed();
 
-void handle_execp_events();
-
 #endif // EXECPLUGIN_H
@@ -14,15 +14,23 @@
 #include "config.h"
 #include "default_icon.h"
 #include "drag_and_drop.h"
+#include "event_loop.h"
 #include "fps_distribution.h"
 #include "panel.h"
+#include "pixmap_pool.h"
+#include "sampler.h"
 #include "server.h"
 #include "signals.h"
+#include "startup_profile.h"
 #include "test.h"
+#include "svg_loader.h"
+#include "text_size_cache.h"
 #include "tooltip.h"
 #include "tracing.h"
 #include "uevent.h"
 #include "version.h"
+#include "window.h"
+#include "window_index.h"
 
 void print_usage()
 {
@@ -33,6 +41,8 @@ void print_usage()
             "  -c path_to_config_file   Loads the configuration file from a\n"
             "                           custom location.\n"
             "  -v, --version            Prints version information and exits.\n"
+            "  --profile-startup        Prints the duration and the number of X round-trips\n"
+            "                           of each startup phase.\n"
             "  -h, --help               Display this help and exits.\n"
             "\n"
             "For more information, run `man tint2` or visit the project page\n"
@@ -50,6 +60,8 @@ void handle_cli_arguments(int argc, char **argv)
         } else if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--version") == 0) {
             fprintf(stdout, "tint2 version %s\n", VERSION_STRING);
             exit(0);
+        } else if (strcmp(argv[i], "--profile-startup") == 0) {
+            profile_startup = TRUE;
         } else if (strcmp(argv[i], "--test") == 0) {
             run_all_tests(false);
             exit(0);
@@ -210,6 +222,7 @@ void init_X11_pre_config()
         fprintf(stderr, "tint2: could not open display!\n");
         exit(EXIT_FAILURE);
     }
+    startup_profile_watch_display(server.display);
     server.x11_fd = ConnectionNumber(server.display);
     XSetErrorHandler(server_catch_error);
     XSetIOErrorHandler(x11_io_error);
@@ -239,13 +252,16 @@ void init(int argc, char **argv)
 {
     setlinebuf(stdout);
     setlinebuf(stderr);
+    startup_profile_begin();
     default_config();
     handle_env_vars();
     handle_cli_arguments(argc, argv);
     create_default_elements();
     init_signals();
+    startup_profile_phase("init");
 
     init_X11_pre_config();
+    startup_profile_phase("init_X11_pre_config()");
     if (!config_read()) {
         fprintf(stderr, "tint2: Could not read config file.\n");
         print_usage();
@@ -254,9 +270,13 @@ void init(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
 
+    startup_profile_phase("config_read()");
+
     init_post_config();
     start_detect_compositor();
+    startup_profile_phase("init_post_config()");
     init_panel();
+    startup_profile_phase("init_panel()");
 }
 
 void cleanup()
@@ -270,6 +290,7 @@ void cleanup()
 
     cleanup_button();
     cleanup_execp();
+    cleanup_sampler();
     cleanup_systray();
     cleanup_tooltip();
     cleanup_clock();
@@ -292,20 +313,29 @@ void cleanup()
     xsettings_client_destroy(xsettings_client);
     xsettings_client = NULL;
 
+    cleanup_pixmap_pool();
+    cleanup_text_size_cache();
+    cleanup_svg_loader();
+    cleanup_thumbnails();
+    cleanup_window_index();
     cleanup_server();
     cleanup_timers();
 
-    if (server.display)
+    if (server.display) {
+        unwatch_fd(server.x11_fd);
         XCloseDisplay(server.display);
+    }
     server.display = NULL;
 
     if (sigchild_pipe_valid) {
         sigchild_pipe_valid = FALSE;
+        unwatch_fd(sigchild_pipe[0]);
         close(sigchild_pipe[1]);
         close(sigchild_pipe[0]);
     }
 
     uevent_cleanup();
+    cleanup_event_loop();
     cleanup_fps_distribution();
 
 #ifdef HAVE_TRACING
@@ -120,7 +120,7 @@ void expand_exec(DesktopEntry *entry, const char *path)
     }
 }
 
-gboolean read_desktop_file_full_path(const char *path, DesktopEntry *entry)
+gboolean read_desktop_file_full_path(const char *path, DesktopEntry *entry, const gchar *const *languages)
 {
     entry->name = entry->generic_name = entry->icon = entry->exec = entry->cwd = NULL;
     entry->hidden_from_menus = FALSE;
@@ -133,7 +133,6 @@ gboolean read_desktop_file_full_path(const char *path, DesktopEntry *entry)
         return FALSE;
     }
 
-    const gchar **languages = (const gchar **)g_get_language_names();
     // lang_index is the index of the language for the best Name key in the language vector
     // lang_index_default is a constant that encodes the Name key without a language
     int lang_index_default = 1;
@@ -222,10 +221,13 @@ gboolean read_desktop_file_full_path(const char *path, DesktopEntry *entry)
     return entry->exec != NULL;
 }
 
-gboolean read_desktop_file_from_dir(const char *path, const char *file_name, DesktopEntry *entry)
+gboolean read_desktop_file_from_dir(const char *path,
+                                    const char *file_name,
+                                    DesktopEntry *entry,
+                                    const gchar *const *languages)
 {
     gchar *full_path = g_build_filename(path, file_name, NULL);
-    if (read_desktop_file_full_path(full_path, entry)) {
+    if (read_desktop_file_full_path(full_path, entry, languages)) {
         g_free(full_path);
         return TRUE;
     }
@@ -254,7 +256,7 @@ gboolean read_desktop_file_from_dir(const char *path, const char *file_name, Des
     subdirs = g_list_sort(subdirs, compare_strings);
     gboolean found = FALSE;
     for (GList *l = subdirs; l; l = g_list_next(l)) {
-        if (read_desktop_file_from_dir(l->data, file_name, entry)) {
+        if (read_desktop_file_from_dir(l->data, file_name, entry, languages)) {
             found = TRUE;
             break;
         }
@@ -269,20 +271,25 @@ gboolean read_desktop_file_from_dir(const char *path, const char *file_name, Des
     return found;
 }
 
-gboolean read_desktop_file(const char *path, DesktopEntry *entry)
+gboolean read_desktop_file_with_languages(const char *path, DesktopEntry *entry, const gchar *const *languages)
 {
     entry->path = strdup(path);
     entry->name = entry->generic_name = entry->icon = entry->exec = entry->cwd = NULL;
 
     if (strchr(path, '/'))
-        return read_desktop_file_full_path(path, entry);
+        return read_desktop_file_full_path(path, entry, languages);
     for (const GSList *location = get_apps_locations(); location; location = g_slist_next(location)) {
-        if (read_desktop_file_from_dir(location->data, path, entry))
+        if (read_desktop_file_from_dir(location->data, path, entry, languages))
             return TRUE;
     }
     return FALSE;
 }
 
+gboolean read_desktop_file(const char *path, DesktopEntry *entry)
+{
+    return read_desktop_file_with_languages(path, entry, g_get_language_names());
+}
+
 void free_desktop_entry(DesktopEntry *entry)
 {
     free_and_null(entry->name);
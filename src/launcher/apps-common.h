@@ -31,6 +31,11 @@ int parse_dektop_line(char *line, char **key, char **value);
 // Returns 1 if successful.
 gboolean read_desktop_file(const char *path, DesktopEntry *entry);
 
+// Same as read_desktop_file(), with the preferred languages of the Name keys given instead of read from
+// the environment, so that it can run in a thread while the main thread changes the environment.
+// get_apps_locations() must have been called once before, for the same reason.
+gboolean read_desktop_file_with_languages(const char *path, DesktopEntry *entry, const gchar *const *languages);
+
 // Empties DesktopEntry: releases the memory of the *members* of entry.
 void free_desktop_entry(DesktopEntry *entry);
 
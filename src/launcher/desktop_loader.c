@@ -0,0 +1,241 @@
+/**************************************************************************
+*
+* Tint2 : asynchronous .desktop file loading
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "desktop_loader.h"
+#include "event_loop.h"
+
+// The work is I/O bound, so more threads than cores help on slow file systems
+#define DESKTOP_LOADER_THREADS 4
+
+typedef struct DesktopCallback {
+    DesktopEntryLoadedCallback *callback;
+    void *arg;
+} DesktopCallback;
+
+typedef struct DesktopRequest {
+    // Set before queuing, read-only afterwards
+    char *path;
+    // Written by the worker
+    DesktopEntry entry;
+    gboolean found;
+    // Main thread only: list of DesktopCallback*
+    GSList *callbacks;
+} DesktopRequest;
+
+// Main thread only. Key: path, value: DesktopRequest*; queued, in progress or finished but not handled yet
+static GHashTable *pending_requests = NULL;
+// Finished requests are written by the workers to result_pipe[1] as pointers
+static int result_pipe[2] = {-1, -1};
+// Copy of g_get_language_names(), which reads the environment and cannot be called from the workers.
+// Read-only while workers run.
+static gchar **languages = NULL;
+
+// Protected by mutex
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workers_stopped = PTHREAD_COND_INITIALIZER;
+static GQueue queue = G_QUEUE_INIT;
+static int num_workers = 0;
+static gboolean stopping = FALSE;
+
+static void free_request(DesktopRequest *request)
+{
+    free(request->path);
+    free_desktop_entry(&request->entry);
+    g_slist_free_full(request->callbacks, free);
+    free(request);
+}
+
+static void finish_request(DesktopRequest *request)
+{
+    // Callbacks may queue new requests, so the request must not be pending anymore
+    while (request->callbacks) {
+        DesktopCallback *cb = (DesktopCallback *)request->callbacks->data;
+        request->callbacks = g_slist_delete_link(request->callbacks, request->callbacks);
+        cb->callback(&request->entry, request->found, cb->arg);
+        free(cb);
+    }
+    free_request(request);
+}
+
+static void *desktop_loader_worker(void *arg)
+{
+    while (TRUE) {
+        pthread_mutex_lock(&mutex);
+        DesktopRequest *request = stopping ? NULL : (DesktopRequest *)g_queue_pop_head(&queue);
+        if (!request) {
+            // Workers exit as soon as the queue is empty, none stay around after startup
+            num_workers--;
+            pthread_cond_broadcast(&workers_stopped);
+            pthread_mutex_unlock(&mutex);
+            return NULL;
+        }
+        pthread_mutex_unlock(&mutex);
+
+        request->found =
+            read_desktop_file_with_languages(request->path, &request->entry, (const gchar *const *)languages);
+        while (write(result_pipe[1], &request, sizeof(request)) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+static void desktop_loader_fd_ready(int fd, void *arg)
+{
+    DesktopRequest *request;
+    // Pointers are written atomically (they are smaller than PIPE_BUF), so reads never return partial pointers
+    while (read(fd, &request, sizeof(request)) == sizeof(request)) {
+        g_hash_table_remove(pending_requests, request->path);
+        finish_request(request);
+    }
+}
+
+static gboolean start_desktop_loader()
+{
+    if (result_pipe[0] >= 0)
+        return TRUE;
+    if (pipe(result_pipe) != 0) {
+        fprintf(stderr, "tint2: Creating pipe failed.\n");
+        result_pipe[0] = result_pipe[1] = -1;
+        return FALSE;
+    }
+    fcntl(result_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(result_pipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(result_pipe[0], F_SETFL, O_NONBLOCK | fcntl(result_pipe[0], F_GETFL));
+    watch_fd(result_pipe[0], desktop_loader_fd_ready, NULL);
+    // Computed lazily and cached, so it must be initialized before the workers use it
+    get_apps_locations();
+    languages = g_strdupv((gchar **)g_get_language_names());
+    return TRUE;
+}
+
+// Must be called with the mutex held
+static gboolean start_worker()
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    int ret = pthread_create(&thread, &attr, desktop_loader_worker, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret != 0)
+        return FALSE;
+    num_workers++;
+    return TRUE;
+}
+
+void load_desktop_file_async(const char *path, DesktopEntryLoadedCallback *callback, void *arg)
+{
+    DesktopCallback *cb = (DesktopCallback *)calloc(1, sizeof(DesktopCallback));
+    cb->callback = callback;
+    cb->arg = arg;
+
+    DesktopRequest *request = pending_requests ? g_hash_table_lookup(pending_requests, path) : NULL;
+    if (request) {
+        request->callbacks = g_slist_append(request->callbacks, cb);
+        return;
+    }
+    request = (DesktopRequest *)calloc(1, sizeof(DesktopRequest));
+    request->path = strdup(path);
+    request->callbacks = g_slist_append(request->callbacks, cb);
+
+    gboolean queued = FALSE;
+    if (start_desktop_loader()) {
+        pthread_mutex_lock(&mutex);
+        g_queue_push_tail(&queue, request);
+        if (num_workers < DESKTOP_LOADER_THREADS && num_workers < (int)g_queue_get_length(&queue))
+            start_worker();
+        queued = num_workers > 0;
+        if (!queued)
+            g_queue_remove(&queue, request);
+        pthread_mutex_unlock(&mutex);
+    }
+    if (!queued) {
+        // No worker could be started, parse synchronously
+        request->found = read_desktop_file(request->path, &request->entry);
+        finish_request(request);
+        return;
+    }
+    if (!pending_requests)
+        pending_requests = g_hash_table_new(g_str_hash, g_str_equal);
+    g_hash_table_insert(pending_requests, request->path, request);
+}
+
+gboolean desktop_file_loads_pending()
+{
+    return pending_requests && g_hash_table_size(pending_requests) > 0;
+}
+
+void cancel_desktop_file_loads(void *arg)
+{
+    if (!pending_requests)
+        return;
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, pending_requests);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        DesktopRequest *request = (DesktopRequest *)value;
+        for (GSList *l = request->callbacks; l;) {
+            DesktopCallback *cb = (DesktopCallback *)l->data;
+            GSList *next = l->next;
+            if (cb->arg == arg) {
+                request->callbacks = g_slist_delete_link(request->callbacks, l);
+                free(cb);
+            }
+            l = next;
+        }
+    }
+}
+
+void cleanup_desktop_loader()
+{
+    pthread_mutex_lock(&mutex);
+    stopping = TRUE;
+    // Running workers finish the file they are reading, which is bounded by the slowest file system access
+    while (num_workers > 0)
+        pthread_cond_wait(&workers_stopped, &mutex);
+    // The queued requests are also in pending_requests
+    g_queue_clear(&queue);
+    stopping = FALSE;
+    pthread_mutex_unlock(&mutex);
+
+    if (result_pipe[0] >= 0) {
+        unwatch_fd(result_pipe[0]);
+        close(result_pipe[0]);
+        close(result_pipe[1]);
+        result_pipe[0] = result_pipe[1] = -1;
+    }
+    g_strfreev(languages);
+    languages = NULL;
+    if (pending_requests) {
+        GHashTableIter iter;
+        gpointer key, value;
+        g_hash_table_iter_init(&iter, pending_requests);
+        while (g_hash_table_iter_next(&iter, &key, &value))
+            free_request((DesktopRequest *)value);
+        g_hash_table_destroy(pending_requests);
+        pending_requests = NULL;
+    }
+}
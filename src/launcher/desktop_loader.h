@@ -0,0 +1,31 @@
+#ifndef DESKTOP_LOADER_H
+#define DESKTOP_LOADER_H
+
+#include <glib.h>
+
+#include "apps-common.h"
+
+// Asynchronous .desktop file loading.
+// Desktop files are parsed by a small pool of worker threads, so that slow file systems (e.g. home directories on
+// NFS) do not delay the first frame. Only the parsing runs in the workers: the entries are handed back to the event
+// loop through a pipe, and everything else (icon lookup, Imlib2, X) stays on the main thread.
+
+// Called from the event loop with the parsed entry; found is FALSE if the file could not be read or has no Exec key.
+// The entry is freed after the callback returns.
+typedef void DesktopEntryLoadedCallback(const DesktopEntry *entry, gboolean found, void *arg);
+
+// Queues the parsing of the desktop file at path (a full path or a file name searched in the applications
+// directories, as in read_desktop_file()). Requests for the same path are parsed once.
+void load_desktop_file_async(const char *path, DesktopEntryLoadedCallback *callback, void *arg);
+
+// Returns TRUE if some requests have not been handled yet. Called from a callback, the request being handled
+// does not count, so that the last callback of a batch can finish the work.
+gboolean desktop_file_loads_pending();
+
+// Drops the callbacks registered with arg, e.g. when the object waiting for an entry is destroyed.
+void cancel_desktop_file_loads(void *arg);
+
+// Stops the workers and drops the pending requests.
+void cleanup_desktop_loader();
+
+#endif
@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "apps-common.h"
 #include "common.h"
@@ -41,8 +42,32 @@ typedef struct IconThemeDir {
     int max_size;
     int min_size;
     int threshold;
+    // Position in IconTheme::list_directories, used to break ties between directories of the same size
+    int index;
 } IconThemeDir;
 
+// The icon files of a theme found in one icon location, e.g. /usr/share/icons/hicolor.
+typedef struct IconThemeLocation {
+    // Owned by get_icon_locations()
+    const char *base;
+    int base_rank;
+    // The GTK icon-theme.cache of the location, if it is up to date
+    GMappedFile *gtk_cache;
+    // Maps the directory indices of the GTK cache to IconThemeDir* (NULL if not in the theme)
+    IconThemeDir **gtk_cache_dirs;
+    guint32 gtk_cache_num_dirs;
+    guint32 gtk_cache_hash_offset;
+    // Used when there is no GTK cache. Key: file name, value: GSList of IconThemeDir* containing the file
+    GHashTable *files;
+} IconThemeLocation;
+
+typedef struct IconMatch {
+    IconThemeDir *dir;
+    const IconThemeLocation *location;
+    const char *extension;
+    int extension_rank;
+} IconMatch;
+
 int parse_theme_line(char *line, char **key, char **value)
 {
     return parse_dektop_line(line, key, value);
@@ -296,6 +321,300 @@ IconTheme *load_theme(const char *name)
     return load_theme_from_fs(name, theme);
 }
 
+// GTK icon-theme.cache format, see gtk/updateiconcache.c.
+// All integers are big endian; offsets are relative to the start of the file.
+#define GTK_CACHE_MAJOR_VERSION 1
+#define GTK_CACHE_HAS_SUFFIX_XPM (1 << 0)
+#define GTK_CACHE_HAS_SUFFIX_SVG (1 << 1)
+#define GTK_CACHE_HAS_SUFFIX_PNG (1 << 2)
+#define GTK_CACHE_NO_OFFSET 0xffffffff
+
+static gboolean gtk_cache_read_u16(const IconThemeLocation *location, guint32 offset, guint16 *result)
+{
+    gsize size = g_mapped_file_get_length(location->gtk_cache);
+    if (offset > size || size - offset < 2)
+        return FALSE;
+    const guchar *p = (const guchar *)g_mapped_file_get_contents(location->gtk_cache) + offset;
+    *result = (guint16)((p[0] << 8) | p[1]);
+    return TRUE;
+}
+
+static gboolean gtk_cache_read_u32(const IconThemeLocation *location, guint32 offset, guint32 *result)
+{
+    gsize size = g_mapped_file_get_length(location->gtk_cache);
+    if (offset > size || size - offset < 4)
+        return FALSE;
+    const guchar *p = (const guchar *)g_mapped_file_get_contents(location->gtk_cache) + offset;
+    *result = ((guint32)p[0] << 24) | ((guint32)p[1] << 16) | ((guint32)p[2] << 8) | (guint32)p[3];
+    return TRUE;
+}
+
+// Returns the NUL-terminated string at offset, or NULL if it does not fit in the file.
+static const char *gtk_cache_read_string(const IconThemeLocation *location, guint32 offset)
+{
+    gsize size = g_mapped_file_get_length(location->gtk_cache);
+    if (offset >= size)
+        return NULL;
+    const char *s = g_mapped_file_get_contents(location->gtk_cache) + offset;
+    return memchr(s, '\0', size - offset) ? s : NULL;
+}
+
+static guint32 gtk_cache_icon_name_hash(const char *name)
+{
+    const signed char *p = (const signed char *)name;
+    guint32 h = (guint32)*p;
+    if (h) {
+        for (p += 1; *p; p++)
+            h = (h << 5) - h + (guint32)*p;
+    }
+    return h;
+}
+
+static guint16 gtk_cache_suffix_flag(const char *extension)
+{
+    if (strcmp(extension, ".png") == 0)
+        return GTK_CACHE_HAS_SUFFIX_PNG;
+    if (strcmp(extension, ".xpm") == 0)
+        return GTK_CACHE_HAS_SUFFIX_XPM;
+    if (strcmp(extension, ".svg") == 0)
+        return GTK_CACHE_HAS_SUFFIX_SVG;
+    return 0;
+}
+
+// Maps the GTK cache of the location if it exists and is not older than the theme directory
+// (the same validity rule GTK uses). Returns TRUE if the cache can be used.
+static gboolean load_gtk_icon_cache(IconThemeLocation *location, IconTheme *theme, const char *theme_dir)
+{
+    gchar *cache_path = g_build_filename(theme_dir, "icon-theme.cache", NULL);
+    struct stat cache_st, dir_st;
+    if (stat(cache_path, &cache_st) != 0 || stat(theme_dir, &dir_st) != 0 || cache_st.st_mtime < dir_st.st_mtime) {
+        g_free(cache_path);
+        return FALSE;
+    }
+
+    location->gtk_cache = g_mapped_file_new(cache_path, FALSE, NULL);
+    g_free(cache_path);
+    if (!location->gtk_cache)
+        return FALSE;
+
+    guint16 major_version;
+    guint32 dir_list_offset, num_dirs;
+    if (!gtk_cache_read_u16(location, 0, &major_version) || major_version != GTK_CACHE_MAJOR_VERSION ||
+        !gtk_cache_read_u32(location, 4, &location->gtk_cache_hash_offset) ||
+        !gtk_cache_read_u32(location, 8, &dir_list_offset) || !gtk_cache_read_u32(location, dir_list_offset, &num_dirs) ||
+        num_dirs > g_mapped_file_get_length(location->gtk_cache) / 4)
+        goto invalid;
+
+    GHashTable *dirs_by_name = g_hash_table_new(g_str_hash, g_str_equal);
+    for (GSList *l = theme->list_directories; l; l = l->next) {
+        IconThemeDir *dir = (IconThemeDir *)l->data;
+        g_hash_table_insert(dirs_by_name, dir->name, dir);
+    }
+    location->gtk_cache_num_dirs = num_dirs;
+    location->gtk_cache_dirs = calloc(num_dirs ? num_dirs : 1, sizeof(IconThemeDir *));
+    gboolean ok = TRUE;
+    for (guint32 i = 0; i < num_dirs && ok; i++) {
+        guint32 name_offset;
+        const char *name = NULL;
+        ok = gtk_cache_read_u32(location, dir_list_offset + 4 + 4 * i, &name_offset) &&
+             (name = gtk_cache_read_string(location, name_offset)) != NULL;
+        if (ok)
+            location->gtk_cache_dirs[i] = g_hash_table_lookup(dirs_by_name, name);
+    }
+    g_hash_table_destroy(dirs_by_name);
+    if (ok)
+        return TRUE;
+
+invalid:
+    fprintf(stderr, YELLOW "tint2: Ignoring invalid icon cache in %s" RESET "\n", theme_dir);
+    free(location->gtk_cache_dirs);
+    location->gtk_cache_dirs = NULL;
+    location->gtk_cache_num_dirs = 0;
+    g_mapped_file_unref(location->gtk_cache);
+    location->gtk_cache = NULL;
+    return FALSE;
+}
+
+// Lists every theme directory once, instead of testing each candidate file name separately.
+static void scan_icon_theme_location(IconThemeLocation *location, IconTheme *theme, const char *theme_dir)
+{
+    location->files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_slist_free);
+    for (GSList *l = theme->list_directories; l; l = l->next) {
+        IconThemeDir *dir = (IconThemeDir *)l->data;
+        gchar *dir_path = g_build_filename(theme_dir, dir->name, NULL);
+        GDir *d = g_dir_open(dir_path, 0, NULL);
+        if (d) {
+            const gchar *file_name;
+            while ((file_name = g_dir_read_name(d))) {
+                GSList *dirs = g_hash_table_lookup(location->files, file_name);
+                if (dirs)
+                    dirs = g_slist_append(dirs, dir);
+                else
+                    g_hash_table_insert(location->files, g_strdup(file_name), g_slist_append(NULL, dir));
+            }
+            g_dir_close(d);
+        }
+        g_free(dir_path);
+    }
+}
+
+static void free_icon_theme_location(gpointer data)
+{
+    IconThemeLocation *location = (IconThemeLocation *)data;
+    if (location->gtk_cache)
+        g_mapped_file_unref(location->gtk_cache);
+    free(location->gtk_cache_dirs);
+    if (location->files)
+        g_hash_table_destroy(location->files);
+    free(location);
+}
+
+static void index_icon_theme(IconTheme *theme)
+{
+    if (theme->_indexed)
+        return;
+    theme->_indexed = TRUE;
+
+    int index = 0;
+    for (GSList *l = theme->list_directories; l; l = l->next)
+        ((IconThemeDir *)l->data)->index = index++;
+
+    int base_rank = 0;
+    for (const GSList *base = get_icon_locations(); base; base = g_slist_next(base), base_rank++) {
+        gchar *theme_dir = g_build_filename((const char *)base->data, theme->name, NULL);
+        if (g_file_test(theme_dir, G_FILE_TEST_IS_DIR)) {
+            IconThemeLocation *location = calloc(1, sizeof(IconThemeLocation));
+            location->base = (const char *)base->data;
+            location->base_rank = base_rank;
+            if (load_gtk_icon_cache(location, theme, theme_dir)) {
+                if (debug_icons)
+                    fprintf(stderr, "tint2: Using GTK icon cache of %s\n", theme_dir);
+            } else {
+                scan_icon_theme_location(location, theme, theme_dir);
+                if (debug_icons)
+                    fprintf(stderr,
+                            "tint2: Indexed %s: %u file names\n",
+                            theme_dir,
+                            g_hash_table_size(location->files));
+            }
+            theme->_locations = g_slist_append(theme->_locations, location);
+        }
+        g_free(theme_dir);
+    }
+}
+
+static void add_icon_match(GSList **matches,
+                           IconThemeDir *dir,
+                           const IconThemeLocation *location,
+                           const char *extension,
+                           int extension_rank)
+{
+    IconMatch *match = calloc(1, sizeof(IconMatch));
+    match->dir = dir;
+    match->location = location;
+    match->extension = extension;
+    match->extension_rank = extension_rank;
+    *matches = g_slist_prepend(*matches, match);
+}
+
+static void gtk_cache_find_icon(const IconThemeLocation *location,
+                                const char *name,
+                                guint16 suffix_flag,
+                                const char *extension,
+                                int extension_rank,
+                                GSList **matches)
+{
+    guint32 num_buckets, chain_offset;
+    if (!gtk_cache_read_u32(location, location->gtk_cache_hash_offset, &num_buckets) || num_buckets == 0)
+        return;
+    guint32 bucket = gtk_cache_icon_name_hash(name) % num_buckets;
+    if (!gtk_cache_read_u32(location, location->gtk_cache_hash_offset + 4 + 4 * bucket, &chain_offset))
+        return;
+    // Bound the walk in case the chain is corrupt and loops
+    for (int hops = 0; chain_offset != GTK_CACHE_NO_OFFSET && hops < 4096; hops++) {
+        guint32 name_offset, image_list_offset, num_images;
+        const char *icon_name;
+        if (!gtk_cache_read_u32(location, chain_offset + 4, &name_offset) ||
+            !(icon_name = gtk_cache_read_string(location, name_offset)))
+            return;
+        if (strcmp(icon_name, name) == 0) {
+            if (!gtk_cache_read_u32(location, chain_offset + 8, &image_list_offset) ||
+                !gtk_cache_read_u32(location, image_list_offset, &num_images))
+                return;
+            for (guint32 i = 0; i < num_images; i++) {
+                guint16 dir_index, flags;
+                if (!gtk_cache_read_u16(location, image_list_offset + 4 + 8 * i, &dir_index) ||
+                    !gtk_cache_read_u16(location, image_list_offset + 6 + 8 * i, &flags))
+                    return;
+                if (dir_index < location->gtk_cache_num_dirs && location->gtk_cache_dirs[dir_index] &&
+                    (flags & suffix_flag))
+                    add_icon_match(matches, location->gtk_cache_dirs[dir_index], location, extension, extension_rank);
+            }
+            return;
+        }
+        if (!gtk_cache_read_u32(location, chain_offset, &chain_offset))
+            return;
+    }
+}
+
+static gint compare_icon_matches(gconstpointer a, gconstpointer b, gpointer size_query)
+{
+    int size = GPOINTER_TO_INT(size_query);
+    const IconMatch *ma = (const IconMatch *)a;
+    const IconMatch *mb = (const IconMatch *)b;
+    int result = abs(ma->dir->size - size) - abs(mb->dir->size - size);
+    if (result)
+        return result;
+    if (ma->dir->index != mb->dir->index)
+        return ma->dir->index - mb->dir->index;
+    if (ma->location->base_rank != mb->location->base_rank)
+        return ma->location->base_rank - mb->location->base_rank;
+    return ma->extension_rank - mb->extension_rank;
+}
+
+// Returns the list of IconMatch* for the files of the theme named icon_name + extension, for any of
+// the known extensions. The list is sorted by distance to size, then by the order of the theme directories,
+// icon locations and extensions.
+// Note: needs to be released with g_slist_free_full(matches, free).
+static GSList *find_icon_in_theme(IconTheme *theme, const char *icon_name, int size)
+{
+    index_icon_theme(theme);
+
+    GSList *matches = NULL;
+    for (GSList *l = theme->_locations; l; l = l->next) {
+        const IconThemeLocation *location = (const IconThemeLocation *)l->data;
+        int extension_rank = 0;
+        for (const GSList *ext = get_icon_extensions(); ext; ext = g_slist_next(ext), extension_rank++) {
+            const char *extension = (const char *)ext->data;
+            if (location->gtk_cache) {
+                // The GTK cache stores names without extension, plus flags for the extensions present
+                if (*extension) {
+                    gtk_cache_find_icon(location,
+                                        icon_name,
+                                        gtk_cache_suffix_flag(extension),
+                                        extension,
+                                        extension_rank,
+                                        &matches);
+                } else {
+                    const char *dot = strrchr(icon_name, '.');
+                    guint16 flag = dot ? gtk_cache_suffix_flag(dot) : 0;
+                    if (flag) {
+                        gchar *name = g_strndup(icon_name, (gsize)(dot - icon_name));
+                        gtk_cache_find_icon(location, name, flag, extension, extension_rank, &matches);
+                        g_free(name);
+                    }
+                }
+            } else {
+                gchar *file_name = g_strconcat(icon_name, extension, NULL);
+                for (GSList *dir = g_hash_table_lookup(location->files, file_name); dir; dir = dir->next)
+                    add_icon_match(&matches, (IconThemeDir *)dir->data, location, extension, extension_rank);
+                g_free(file_name);
+            }
+        }
+    }
+    return g_slist_sort_with_data(matches, compare_icon_matches, GINT_TO_POINTER(size));
+}
+
 void free_icon_theme(IconTheme *theme)
 {
     if (!theme)
@@ -316,6 +635,9 @@ void free_icon_theme(IconTheme *theme)
     }
     g_slist_free(theme->list_directories);
     theme->list_directories = NULL;
+    g_slist_free_full(theme->_locations, free_icon_theme_location);
+    theme->_locations = NULL;
+    theme->_indexed = FALSE;
 }
 
 void free_themes(IconThemeWrapper *wrapper)
@@ -542,14 +864,6 @@ int directory_size_distance(IconThemeDir *dir, int size)
     }
 }
 
-gint compare_theme_directories(gconstpointer a, gconstpointer b, gpointer size_query)
-{
-    int size = GPOINTER_TO_INT(size_query);
-    const IconThemeDir *da = (const IconThemeDir *)a;
-    const IconThemeDir *db = (const IconThemeDir *)b;
-    return abs(da->size - size) - abs(db->size - size);
-}
-
 Bool is_full_path(const char *s)
 {
     if (!s)
@@ -602,85 +916,51 @@ char *get_icon_path_helper(GSList *themes, const char *icon_name, int size)
     char *next_larger = NULL;
     GSList *next_larger_theme = NULL;
 
-    size_t file_name_size = 4096;
-    char *file_name = calloc(file_name_size, 1);
-
     for (theme = themes; theme; theme = g_slist_next(theme)) {
         if (debug_icons)
             fprintf(stderr, "tint2: Searching theme: %s\n", ((IconTheme *)theme->data)->name);
-        ((IconTheme *)theme->data)->list_directories =
-            g_slist_sort_with_data(((IconTheme *)theme->data)->list_directories,
-                                   compare_theme_directories,
-                                   GINT_TO_POINTER(size));
-        GSList *dir;
-        for (dir = ((IconTheme *)theme->data)->list_directories; dir; dir = g_slist_next(dir)) {
+        GSList *matches = find_icon_in_theme((IconTheme *)theme->data, icon_name, size);
+        for (GSList *m = matches; m; m = g_slist_next(m)) {
+            IconMatch *match = (IconMatch *)m->data;
+            IconThemeDir *dir = match->dir;
+            // filename = directory/$(themename)/subdirectory/iconname.extension
+            gchar *file_name = g_strdup_printf("%s/%s/%s/%s%s",
+                                               match->location->base,
+                                               ((IconTheme *)theme->data)->name,
+                                               dir->name,
+                                               icon_name,
+                                               match->extension);
+            if (debug_icons)
+                fprintf(stderr, "tint2: Found potential match: %s\n", file_name);
             // Closest match
-            gboolean possible = directory_size_distance((IconThemeDir *)dir->data, size) < minimal_size &&
-                                (!best_file_theme ? TRUE : theme == best_file_theme);
+            if (directory_size_distance(dir, size) < minimal_size && (!best_file_theme ? 1 : theme == best_file_theme)) {
+                if (best_file_name) {
+                    free(best_file_name);
+                    best_file_name = NULL;
+                }
+                best_file_name = strdup(file_name);
+                minimal_size = directory_size_distance(dir, size);
+                best_file_theme = theme;
+                if (debug_icons)
+                    fprintf(stderr, "tint2: best_file_name = %s; minimal_size = %d\n", best_file_name, minimal_size);
+            }
             // Next larger match
-            possible = possible || (((IconThemeDir *)dir->data)->size >= size &&
-                                    (next_larger_size == -1 || ((IconThemeDir *)dir->data)->size < next_larger_size) &&
-                                    (!next_larger_theme ? 1 : theme == next_larger_theme));
-            if (!possible)
-                continue;
-            if (debug_icons)
-                fprintf(stderr, "tint2: Searching directory: %s\n", ((IconThemeDir *)dir->data)->name);
-            const GSList *base;
-            for (base = basenames; base; base = g_slist_next(base)) {
-                for (const GSList *ext = extensions; ext; ext = g_slist_next(ext)) {
-                    char *base_name = (char *)base->data;
-                    char *theme_name = ((IconTheme *)theme->data)->name;
-                    char *dir_name = ((IconThemeDir *)dir->data)->name;
-                    char *extension = (char *)ext->data;
-                    if (strlen(base_name) + strlen(theme_name) + strlen(dir_name) + strlen(icon_name) +
-                            strlen(extension) + 100 >
-                        file_name_size) {
-                        file_name_size = strlen(base_name) + strlen(theme_name) + strlen(dir_name) + strlen(icon_name) +
-                                         strlen(extension) + 100;
-                        file_name = realloc(file_name, file_name_size);
-                    }
-                    file_name[0] = 0;
-                    // filename = directory/$(themename)/subdirectory/iconname.extension
-                    snprintf(file_name, (size_t)file_name_size, "%s/%s/%s/%s%s", base_name, theme_name, dir_name, icon_name, extension);
-                    if (debug_icons)
-                        fprintf(stderr, "tint2: Checking %s\n", file_name);
-                    if (g_file_test(file_name, G_FILE_TEST_EXISTS)) {
-                        if (debug_icons)
-                            fprintf(stderr, "tint2: Found potential match: %s\n", file_name);
-                        // Closest match
-                        if (directory_size_distance((IconThemeDir *)dir->data, size) < minimal_size &&
-                            (!best_file_theme ? 1 : theme == best_file_theme)) {
-                            if (best_file_name) {
-                                free(best_file_name);
-                                best_file_name = NULL;
-                            }
-                            best_file_name = strdup(file_name);
-                            minimal_size = directory_size_distance((IconThemeDir *)dir->data, size);
-                            best_file_theme = theme;
-                            if (debug_icons)
-                                fprintf(stderr, "tint2: best_file_name = %s; minimal_size = %d\n", best_file_name, minimal_size);
-                        }
-                        // Next larger match
-                        if (((IconThemeDir *)dir->data)->size >= size &&
-                            (next_larger_size == -1 || ((IconThemeDir *)dir->data)->size < next_larger_size) &&
-                            (!next_larger_theme ? 1 : theme == next_larger_theme)) {
-                            if (next_larger) {
-                                free(next_larger);
-                                next_larger = NULL;
-                            }
-                            next_larger = strdup(file_name);
-                            next_larger_size = ((IconThemeDir *)dir->data)->size;
-                            next_larger_theme = theme;
-                            if (debug_icons)
-                                fprintf(stderr, "tint2: next_larger = %s; next_larger_size = %d\n", next_larger, next_larger_size);
-                        }
-                    }
+            if (dir->size >= size && (next_larger_size == -1 || dir->size < next_larger_size) &&
+                (!next_larger_theme ? 1 : theme == next_larger_theme)) {
+                if (next_larger) {
+                    free(next_larger);
+                    next_larger = NULL;
                 }
+                next_larger = strdup(file_name);
+                next_larger_size = dir->size;
+                next_larger_theme = theme;
+                if (debug_icons)
+                    fprintf(stderr, "tint2: next_larger = %s; next_larger_size = %d\n", next_larger, next_larger_size);
             }
+            g_free(file_name);
         }
+        g_slist_free_full(matches, free);
     }
-    free(file_name);
-    file_name = NULL;
     if (next_larger) {
         free(best_file_name);
         return next_larger;
@@ -698,7 +978,7 @@ char *get_icon_path_helper(GSList *themes, const char *icon_name, int size)
                 char *base_name = (char *)base->data;
                 char *extension = (char *)ext->data;
                 size_t file_name_size2 = strlen(base_name) + strlen(icon_name) + strlen(extension) + 100;
-                file_name = calloc(file_name_size2, 1);
+                char *file_name = calloc(file_name_size2, 1);
                 // filename = directory/iconname.extension
                 snprintf(file_name, file_name_size2, "%s/%s%s", base_name, icon_name, extension);
                 if (debug_icons)
@@ -31,6 +31,10 @@ typedef struct IconTheme {
     char *description;
     GSList *list_inherits;    // each item is a char* (theme name)
     GSList *list_directories; // each item is an IconThemeDir*
+    // Index of the icon files of the theme, one IconThemeLocation* per icon location containing the theme.
+    // Built on the first lookup.
+    GSList *_locations;
+    gboolean _indexed;
 } IconTheme;
 
 // Parses a line of the form "key = value". Modifies the line.
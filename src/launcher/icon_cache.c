@@ -0,0 +1,178 @@
+/**************************************************************************
+*
+* Tint2 : icon cache
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "colors.h"
+#include "common.h"
+#include "icon-theme-common.h"
+#include "icon_cache.h"
+#include "launcher.h"
+#include "panel.h"
+
+// Key: CachedIcon::key, value: CachedIcon*
+static GHashTable *cached_icons = NULL;
+static unsigned long long num_hits = 0;
+static unsigned long long num_misses = 0;
+
+// Kinds of images that do not come from a file
+#define PLACEHOLDER_SOURCE "\n(placeholder)"
+#define BLANK_SOURCE "\n(blank)"
+
+static char *icon_key(const char *source, int size)
+{
+    struct stat st;
+    if (source[0] == '\n' || stat(source, &st) != 0)
+        memset(&st, 0, sizeof(st));
+    return g_strdup_printf("%s\t%lld\t%lld\t%d\t%d\t%d\t%d",
+                           source,
+                           (long long)st.st_mtime,
+                           (long long)st.st_size,
+                           size,
+                           launcher_alpha,
+                           launcher_saturation,
+                           launcher_brightness);
+}
+
+static CachedIcon *lookup_icon(const char *key)
+{
+    CachedIcon *icon = cached_icons ? g_hash_table_lookup(cached_icons, key) : NULL;
+    if (icon) {
+        icon->refcount++;
+        num_hits++;
+    }
+    return icon;
+}
+
+// Takes ownership of key. The original image is not freed.
+static CachedIcon *add_icon(char *key, Imlib_Image original, int size)
+{
+    num_misses++;
+    CachedIcon *icon = (CachedIcon *)calloc(1, sizeof(CachedIcon));
+    icon->refcount = 1;
+    icon->key = key;
+    icon->image = scale_icon(original, size);
+    if (panel_config.mouse_effects) {
+        icon->image_hover = adjust_icon(icon->image,
+                                        panel_config.mouse_over_alpha,
+                                        panel_config.mouse_over_saturation,
+                                        panel_config.mouse_over_brightness);
+        icon->image_pressed = adjust_icon(icon->image,
+                                          panel_config.mouse_pressed_alpha,
+                                          panel_config.mouse_pressed_saturation,
+                                          panel_config.mouse_pressed_brightness);
+    }
+    if (!cached_icons)
+        cached_icons = g_hash_table_new(g_str_hash, g_str_equal);
+    g_hash_table_insert(cached_icons, icon->key, icon);
+    return icon;
+}
+
+// Returns a new reference to the icon of the image file at path, or NULL if it cannot be loaded (yet).
+static CachedIcon *get_file_icon(const char *path,
+                                 int size,
+                                 ImageLoadedCallback *callback,
+                                 void *arg,
+                                 gboolean *pending)
+{
+    char *key = icon_key(path, size);
+    CachedIcon *icon = lookup_icon(key);
+    if (icon) {
+        g_free(key);
+        return icon;
+    }
+    Imlib_Image original =
+        callback ? load_image_async(path, size, callback, arg, pending) : load_image(path, TRUE);
+    if (!original) {
+        g_free(key);
+        return NULL;
+    }
+    icon = add_icon(key, original, size);
+    free_icon(original);
+    return icon;
+}
+
+static CachedIcon *get_generated_icon(const char *source, Imlib_Image original, int size)
+{
+    char *key = icon_key(source, size);
+    CachedIcon *icon = lookup_icon(key);
+    if (icon) {
+        g_free(key);
+        return icon;
+    }
+    return add_icon(key, original, size);
+}
+
+CachedIcon *get_cached_icon(const char *icon_name, int size, ImageLoadedCallback *callback, void *arg, char **path)
+{
+    CachedIcon *icon = NULL;
+    gboolean pending = FALSE;
+    char *icon_path = get_icon_path(icon_theme_wrapper, icon_name, size, TRUE);
+    if (icon_path)
+        icon = get_file_icon(icon_path, size, callback, arg, &pending);
+    if (!icon && pending && default_icon) {
+        // Show a placeholder until the icon is rendered
+        icon = get_generated_icon(PLACEHOLDER_SOURCE, default_icon, size);
+    }
+    // On loading error, fallback to default
+    if (!icon) {
+        free(icon_path);
+        icon_path = get_icon_path(icon_theme_wrapper, DEFAULT_ICON, size, TRUE);
+        if (icon_path)
+            icon = get_file_icon(icon_path, size, NULL, NULL, NULL);
+    }
+    if (!icon)
+        icon = get_generated_icon(BLANK_SOURCE, NULL, size);
+    if (path)
+        *path = icon_path;
+    else
+        free(icon_path);
+    return icon;
+}
+
+void cached_icon_unref(CachedIcon *icon)
+{
+    if (!icon)
+        return;
+    icon->refcount--;
+    if (icon->refcount > 0)
+        return;
+    g_hash_table_remove(cached_icons, icon->key);
+    if (g_hash_table_size(cached_icons) == 0) {
+        g_hash_table_destroy(cached_icons);
+        cached_icons = NULL;
+    }
+    free_icon(icon->image);
+    free_icon(icon->image_hover);
+    free_icon(icon->image_pressed);
+    g_free(icon->key);
+    free(icon);
+}
+
+void icon_cache_print_stats()
+{
+    fprintf(stderr,
+            BLUE "tint2: icon cache: %llu hits, %llu misses, %u icons" RESET "\n",
+            num_hits,
+            num_misses,
+            cached_icons ? g_hash_table_size(cached_icons) : 0);
+}
@@ -0,0 +1,33 @@
+#ifndef ICON_CACHE_H
+#define ICON_CACHE_H
+
+#include <glib.h>
+#include <Imlib2.h>
+
+#include "svg_loader.h"
+
+// Icon images shared between the launchers and buttons of all panels.
+// Images are looked up by resolved path, modification time, size and launcher alpha/saturation/brightness,
+// so the same icon on several monitors is decoded, scaled and adjusted only once.
+typedef struct CachedIcon {
+    int refcount;
+    char *key;
+    // The icon scaled to size, with the launcher alpha/saturation/brightness applied
+    Imlib_Image image;
+    // Variants for the mouse effects, NULL if they are disabled
+    Imlib_Image image_hover;
+    Imlib_Image image_pressed;
+} CachedIcon;
+
+// Returns a new reference to the icon named icon_name in the current icon theme, to be displayed at size.
+// SVG icons are rendered asynchronously: until the rendering finishes, a placeholder is returned and callback(arg)
+// is called once the icon is available (see load_image_async). If the icon cannot be loaded, the default icon
+// of the theme is returned. If path is not NULL, it is set to the resolved path of the icon (to be freed).
+CachedIcon *get_cached_icon(const char *icon_name, int size, ImageLoadedCallback *callback, void *arg, char **path);
+
+void cached_icon_unref(CachedIcon *icon);
+
+// Prints the cache statistics (hits, misses, icons) on stderr.
+void icon_cache_print_stats();
+
+#endif
@@ -39,7 +39,9 @@
 #include "taskbar.h"
 #include "launcher.h"
 #include "apps-common.h"
+#include "desktop_loader.h"
 #include "icon-theme-common.h"
+#include "svg_loader.h"
 
 int launcher_enabled;
 int launcher_max_icon_size;
@@ -61,6 +63,7 @@ void launcher_icon_dump_geometry(void *obj, int indent);
 void launcher_reload_icon(Launcher *launcher, LauncherIcon *launcherIcon);
 void launcher_reload_icon_image(Launcher *launcher, LauncherIcon *launcherIcon);
 void launcher_reload_hidden_icons(Launcher *launcher);
+void launcher_icon_desktop_entry_loaded(const DesktopEntry *entry, gboolean found, void *arg);
 void launcher_icon_on_change_layout(void *obj);
 int launcher_compute_desired_size(void *obj);
 
@@ -141,6 +144,7 @@ void cleanup_launcher()
     }
     g_slist_free(panel_config.launcher.list_apps);
     panel_config.launcher.list_apps = NULL;
+    cleanup_desktop_loader();
 
     free(icon_theme_name_config);
     icon_theme_name_config = NULL;
@@ -157,9 +161,9 @@ void cleanup_launcher_theme(Launcher *launcher)
     for (GSList *l = launcher->list_icons; l; l = l->next) {
         LauncherIcon *launcherIcon = (LauncherIcon *)l->data;
         if (launcherIcon) {
-            free_icon(launcherIcon->image);
-            free_icon(launcherIcon->image_hover);
-            free_icon(launcherIcon->image_pressed);
+            cancel_desktop_file_loads(launcherIcon);
+            cancel_image_loads(launcherIcon);
+            cached_icon_unref(launcherIcon->cached_icon);
             free(launcherIcon->icon_name);
             free(launcherIcon->icon_path);
             free(launcherIcon->cmd);
@@ -362,7 +366,7 @@ int launcher_icon_compute_desired_size(void *obj)
 char *launcher_icon_get_tooltip_text(void *obj)
 {
     LauncherIcon *launcherIcon = (LauncherIcon *)obj;
-    return strdup(launcherIcon->icon_tooltip);
+    return launcherIcon->icon_tooltip ? strdup(launcherIcon->icon_tooltip) : NULL;
 }
 
 void draw_launcher_icon(void *obj, cairo_t *c)
@@ -496,42 +500,48 @@ void launcher_load_icons(Launcher *launcher)
         add_area(&launcherIcon->area, (Area *)launcher);
         launcher->list_icons = g_slist_append(launcher->list_icons, launcherIcon);
         launcherIcon->icon_size = launcher->icon_size;
-        launcher_reload_icon(launcher, launcherIcon);
+        // Show the default icon until the desktop file is loaded
+        launcherIcon->icon_name = strdup(DEFAULT_ICON);
+        load_desktop_file_async(launcherIcon->config_path, launcher_icon_desktop_entry_loaded, launcherIcon);
         instantiate_area_gradients(&launcherIcon->area);
         app = g_slist_next(app);
     }
 }
 
-void launcher_reload_icon(Launcher *launcher, LauncherIcon *launcherIcon)
+static void launcher_apply_desktop_entry(Launcher *launcher,
+                                         LauncherIcon *launcherIcon,
+                                         const DesktopEntry *entry,
+                                         gboolean found)
 {
-    DesktopEntry entry;
-    if (read_desktop_file(launcherIcon->config_path, &entry) && entry.exec) {
+    if (found && entry->exec) {
         schedule_redraw(&launcherIcon->area);
         if (launcherIcon->cmd)
             free(launcherIcon->cmd);
-        launcherIcon->cmd = strdup(entry.exec);
+        launcherIcon->cmd = strdup(entry->exec);
         if (launcherIcon->cwd)
             free(launcherIcon->cwd);
-        if (entry.cwd)
-            launcherIcon->cwd = strdup(entry.cwd);
+        if (entry->cwd)
+            launcherIcon->cwd = strdup(entry->cwd);
         else
             launcherIcon->cwd = NULL;
-        launcherIcon->start_in_terminal = entry.start_in_terminal;
-        launcherIcon->startup_notification = entry.startup_notification;
+        launcherIcon->start_in_terminal = entry->start_in_terminal;
+        launcherIcon->startup_notification = entry->startup_notification;
         if (launcherIcon->icon_name)
             free(launcherIcon->icon_name);
-        launcherIcon->icon_name = entry.icon ? strdup(entry.icon) : strdup(DEFAULT_ICON);
-        if (entry.name) {
-            if (entry.generic_name) {
-                launcherIcon->icon_tooltip = g_strdup_printf("%s (%s)", entry.name, entry.generic_name);
+        launcherIcon->icon_name = entry->icon ? strdup(entry->icon) : strdup(DEFAULT_ICON);
+        g_free(launcherIcon->icon_tooltip);
+        launcherIcon->icon_tooltip = NULL;
+        if (entry->name) {
+            if (entry->generic_name) {
+                launcherIcon->icon_tooltip = g_strdup_printf("%s (%s)", entry->name, entry->generic_name);
             } else {
-                launcherIcon->icon_tooltip = g_strdup_printf("%s", entry.name);
+                launcherIcon->icon_tooltip = g_strdup_printf("%s", entry->name);
             }
         } else {
-            if (entry.generic_name) {
-                launcherIcon->icon_tooltip = g_strdup_printf("%s", entry.generic_name);
-            } else if (entry.exec) {
-                launcherIcon->icon_tooltip = g_strdup_printf("%s", entry.exec);
+            if (entry->generic_name) {
+                launcherIcon->icon_tooltip = g_strdup_printf("%s", entry->generic_name);
+            } else if (entry->exec) {
+                launcherIcon->icon_tooltip = g_strdup_printf("%s", entry->exec);
             }
         }
         launcher_reload_icon_image(launcher, launcherIcon);
@@ -539,9 +549,28 @@ void launcher_reload_icon(Launcher *launcher, LauncherIcon *launcherIcon)
     } else {
         hide(&launcherIcon->area);
     }
+}
+
+void launcher_reload_icon(Launcher *launcher, LauncherIcon *launcherIcon)
+{
+    cancel_desktop_file_loads(launcherIcon);
+    DesktopEntry entry;
+    gboolean found = read_desktop_file(launcherIcon->config_path, &entry);
+    launcher_apply_desktop_entry(launcher, launcherIcon, &entry, found);
     free_desktop_entry(&entry);
 }
 
+void launcher_icon_desktop_entry_loaded(const DesktopEntry *entry, gboolean found, void *arg)
+{
+    LauncherIcon *launcherIcon = (LauncherIcon *)arg;
+    Panel *panel = (Panel *)launcherIcon->area.panel;
+    launcher_apply_desktop_entry(&panel->launcher, launcherIcon, entry, found);
+    // The icon paths looked up for the whole batch are saved at once
+    if (!desktop_file_loads_pending())
+        save_icon_cache(icon_theme_wrapper);
+    schedule_panel_redraw();
+}
+
 void launcher_reload_hidden_icons(Launcher *launcher)
 {
     for (GSList *l = launcher->list_icons; l; l = l->next) {
@@ -551,40 +580,32 @@ void launcher_reload_hidden_icons(Launcher *launcher)
     }
 }
 
+void launcher_icon_image_loaded(void *arg)
+{
+    LauncherIcon *launcherIcon = (LauncherIcon *)arg;
+    Panel *panel = (Panel *)launcherIcon->area.panel;
+    launcher_reload_icon_image(&panel->launcher, launcherIcon);
+    schedule_panel_redraw();
+}
+
 void launcher_reload_icon_image(Launcher *launcher, LauncherIcon *launcherIcon)
 {
-    free_icon(launcherIcon->image);
-    free_icon(launcherIcon->image_hover);
-    free_icon(launcherIcon->image_pressed);
-    launcherIcon->image = NULL;
-
-    char *new_icon_path = get_icon_path(icon_theme_wrapper, launcherIcon->icon_name, launcherIcon->icon_size, TRUE);
-    if (new_icon_path)
-        launcherIcon->image = load_image(new_icon_path, TRUE);
-    // On loading error, fallback to default
-    if (!launcherIcon->image) {
-        free(new_icon_path);
-        new_icon_path = get_icon_path(icon_theme_wrapper, DEFAULT_ICON, launcherIcon->icon_size, TRUE);
-        if (new_icon_path)
-            launcherIcon->image = load_image(new_icon_path, TRUE);
-    }
-    Imlib_Image original = launcherIcon->image;
-    launcherIcon->image = scale_icon(launcherIcon->image, launcherIcon->icon_size);
-    free_icon(original);
+    CachedIcon *old_icon = launcherIcon->cached_icon;
+
+    cancel_image_loads(launcherIcon);
     free(launcherIcon->icon_path);
-    launcherIcon->icon_path = new_icon_path;
+    launcherIcon->cached_icon = get_cached_icon(launcherIcon->icon_name,
+                                                launcherIcon->icon_size,
+                                                launcher_icon_image_loaded,
+                                                launcherIcon,
+                                                &launcherIcon->icon_path);
+    launcherIcon->image = launcherIcon->cached_icon->image;
+    launcherIcon->image_hover = launcherIcon->cached_icon->image_hover;
+    launcherIcon->image_pressed = launcherIcon->cached_icon->image_pressed;
     // fprintf(stderr, "tint2: launcher.c %d: Using icon %s\n", __LINE__, launcherIcon->icon_path);
 
-    if (panel_config.mouse_effects) {
-        launcherIcon->image_hover = adjust_icon(launcherIcon->image,
-                                                panel_config.mouse_over_alpha,
-                                                panel_config.mouse_over_saturation,
-                                                panel_config.mouse_over_brightness);
-        launcherIcon->image_pressed = adjust_icon(launcherIcon->image,
-                                                  panel_config.mouse_pressed_alpha,
-                                                  panel_config.mouse_pressed_saturation,
-                                                  panel_config.mouse_pressed_brightness);
-    }
+    // Released after the lookup, so that reloading an icon that did not change reuses the cached images
+    cached_icon_unref(old_icon);
     schedule_redraw(&launcherIcon->area);
 }
 
@@ -11,6 +11,7 @@
 #include "area.h"
 #include "xsettings-client.h"
 #include "icon-theme-common.h"
+#include "icon_cache.h"
 
 extern IconThemeWrapper *icon_theme_wrapper;
 void load_icon_themes();
@@ -28,6 +29,8 @@ typedef struct LauncherIcon {
     // always start with area
     Area area;
     char *config_path;
+    // Shared with the other panels; the images below belong to it
+    CachedIcon *cached_icon;
     Imlib_Image image;
     Imlib_Image image_hover;
     Imlib_Image image_pressed;
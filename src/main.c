@@ -45,22 +45,29 @@
 
 #include "config.h"
 #include "drag_and_drop.h"
+#include "event_loop.h"
 #include "fps_distribution.h"
+#include "icon_cache.h"
 #include "init.h"
 #include "launcher.h"
 #include "mouse_actions.h"
 #include "panel.h"
+#include "pixmap_pool.h"
 #include "server.h"
 #include "signals.h"
+#include "startup_profile.h"
 #include "systraybar.h"
 #include "task.h"
 #include "taskbar.h"
+#include "svg_loader.h"
+#include "text_size_cache.h"
 #include "tooltip.h"
 #include "timer.h"
 #include "tracing.h"
 #include "uevent.h"
 #include "version.h"
 #include "window.h"
+#include "window_index.h"
 #include "xsettings-client.h"
 
 // Global process state variables
@@ -87,13 +94,13 @@ void handle_event_property_notify(XEvent *e)
 
     if (xsettings_client)
         xsettings_client_process_event(xsettings_client, e);
-    for (int i = 0; i < num_panels; i++) {
-        Panel *p = &panels[i];
-        if (win == p->main_win) {
-            if (at == server.atom._NET_WM_DESKTOP && get_window_desktop(p->main_win) != ALL_DESKTOPS)
-                replace_panel_all_desktops(p);
-            return;
-        }
+    void *object;
+    WindowKind kind = find_window(win, &object);
+    if (kind == WINDOW_PANEL) {
+        Panel *p = (Panel *)object;
+        if (at == server.atom._NET_WM_DESKTOP && get_window_desktop(p->main_win) != ALL_DESKTOPS)
+            replace_panel_all_desktops(p);
+        return;
     }
     if (win == server.root_win) {
         if (!server.got_root_win) {
@@ -223,13 +230,12 @@ void handle_event_property_notify(XEvent *e)
             schedule_panel_redraw();
         }
     } else {
-        TrayWindow *traywin = systray_find_icon(win);
-        if (traywin) {
-            systray_property_notify(traywin, e);
+        if (kind == WINDOW_TRAY_ICON) {
+            systray_property_notify((TrayWindow *)object, e);
             return;
         }
 
-        Task *task = get_task(win);
+        Task *task = kind == WINDOW_TASK ? (Task *)object : NULL;
         if (debug) {
             char *atom_name = XGetAtomName(server.display, at);
             fprintf(stderr,
@@ -331,6 +337,8 @@ void handle_event_expose(XEvent *e)
     panel = get_panel(e->xany.window);
     if (!panel)
         return;
+    // The back buffer is still valid, the exposed rectangle only has to be copied again to the window
+    add_panel_damage(panel, e->xexpose.x, e->xexpose.y, e->xexpose.width, e->xexpose.height);
     // TODO : one panel_refresh per panel ?
     schedule_panel_redraw();
 }
@@ -509,7 +517,7 @@ void handle_x_event(XEvent *e)
     case UnmapNotify:
         break;
 
-    case DestroyNotify:
+    case DestroyNotify: {
         if (e->xany.window == server.composite_manager) {
             // Stop real_transparency
             emit_self_restart("compositor shutdown");
@@ -517,13 +525,11 @@ void handle_x_event(XEvent *e)
         }
         if (e->xany.window == g_tooltip.window || !systray_enabled)
             break;
-        for (GSList *it = systray.list_icons; it; it = g_slist_next(it)) {
-            if (((TrayWindow *)it->data)->win == e->xany.window) {
-                systray_destroy_event((TrayWindow *)it->data);
-                break;
-            }
-        }
+        TrayWindow *traywin = systray_find_icon(e->xany.window);
+        if (traywin && traywin->win == e->xany.window)
+            systray_destroy_event(traywin);
         break;
+    }
 
     case ClientMessage: {
         XClientMessageEvent *ev = &e->xclient;
@@ -560,71 +566,59 @@ void handle_x_event(XEvent *e)
             TrayWindow *traywin = systray_find_icon(de->drawable);
             if (traywin)
                 systray_render_icon(traywin);
+            else
+                task_handle_damage(de->drawable);
         }
     }
 }
 
+#define MAX_X_EVENTS_PER_BATCH 512
+
+// Replaces a motion event with the latest one of the motion events queued right after it for the same window.
+// Only the final pointer position matters for hover effects and tooltips; events of other types are never
+// skipped or reordered.
+void compress_motion_events(XEvent *e)
+{
+    while (XEventsQueued(server.display, QueuedAfterReading) > 0) {
+        XEvent next;
+        XPeekEvent(server.display, &next);
+        if (next.type != MotionNotify || next.xmotion.window != e->xmotion.window)
+            break;
+        XNextEvent(server.display, e);
+    }
+}
+
 void handle_x_events()
 {
-    if (XPending(server.display) > 0) {
+    // Handle the pending events in one batch, so that bursts (e.g. the PropertyNotify events sent when switching
+    // desktops) are followed by a single redraw. The batch is bounded, so that timers still run during floods.
+    for (int count = 0; count < MAX_X_EVENTS_PER_BATCH && XEventsQueued(server.display, QueuedAfterReading) > 0;
+         count++) {
         XEvent e;
         XNextEvent(server.display, &e);
-        if (debug_fps)
+        if (debug_fps && ts_event_read == 0)
             ts_event_read = get_time();
+        if (e.type == MotionNotify)
+            compress_motion_events(&e);
 
         handle_x_event(&e);
     }
 }
 
-void prepare_fd_set(fd_set *set, int *max_fd)
-{
-    FD_ZERO(set);
-    FD_SET(server.x11_fd, set);
-    *max_fd = server.x11_fd;
-    if (sigchild_pipe_valid) {
-        FD_SET(sigchild_pipe[0], set);
-        *max_fd = MAX(*max_fd, sigchild_pipe[0]);
-    }
-    for (GList *l = panel_config.execp_list; l; l = l->next) {
-        Execp *execp = (Execp *)l->data;
-        int fd = execp->backend->child_pipe_stdout;
-        if (fd > 0) {
-            FD_SET(fd, set);
-            *max_fd = MAX(*max_fd, fd);
-        }
-        fd = execp->backend->child_pipe_stderr;
-        if (fd > 0) {
-            FD_SET(fd, set);
-            *max_fd = MAX(*max_fd, fd);
-        }
-    }
-    if (uevent_fd > 0) {
-        FD_SET(uevent_fd, set);
-        *max_fd = MAX(*max_fd, uevent_fd);
-    }
-}
-
 void handle_panel_refresh()
 {
     if (debug_fps)
         ts_event_processed = get_time();
     panel_refresh = FALSE;
+    panel_bytes_copied = 0;
 
     for (int i = 0; i < num_panels; i++) {
         Panel *panel = &panels[i];
         if (!first_render)
             shrink_panel(panel);
 
-        if (!panel->is_hidden || panel->area.resize_needed) {
-            if (panel->temp_pmap)
-                XFreePixmap(server.display, panel->temp_pmap);
-            panel->temp_pmap = XCreatePixmap(server.display,
-                                             server.root_win,
-                                             panel->area.width,
-                                             panel->area.height,
-                                             server.depth);
+        if (!panel->is_hidden || panel->area.resize_needed)
             render_panel(panel);
-        }
 
         if (panel->is_hidden) {
             if (!panel->hidden_pixmap) {
@@ -661,16 +655,24 @@ void handle_panel_refresh()
                       0);
             XSetWindowBackgroundPixmap(server.display, panel->main_win, panel->hidden_pixmap);
         } else {
-            XCopyArea(server.display,
-                      panel->temp_pmap,
-                      panel->main_win,
-                      server.gc,
-                      0,
-                      0,
-                      panel->area.width,
-                      panel->area.height,
-                      0,
-                      0);
+            // Copy only the damaged region to the window (composite_gc is clipped to it)
+            XRectangle box;
+            XClipBox(panel->damage, &box);
+            if (box.width > 0 && box.height > 0) {
+                XCopyArea(server.display,
+                          panel->temp_pmap,
+                          panel->main_win,
+                          panel->composite_gc,
+                          box.x,
+                          box.y,
+                          box.width,
+                          box.height,
+                          box.x,
+                          box.y);
+                if (debug_fps)
+                    count_panel_bytes_copied(panel, box.x, box.y, box.width, box.height);
+            }
+            XSubtractRegion(panel->damage, panel->damage, panel->damage);
             if (panel == (Panel *)systray.area.panel) {
                 if (refresh_systray && panel && !panel->is_hidden) {
                     refresh_systray = FALSE;
@@ -689,6 +691,7 @@ void handle_panel_refresh()
     if (debug_fps)
         ts_render_finished = get_time();
     XFlush(server.display);
+    startup_profile_end("first render_panel()");
 
     if (debug_fps && ts_event_read > 0) {
         ts_flush_finished = get_time();
@@ -703,7 +706,8 @@ void handle_panel_refresh()
         fprintf(stderr,
                 BLUE "frame %d: fps = %.0f (low %.0f, med %.0f, high %.0f, samples %.0f) : processing %.0f%%, "
                      "rendering %.0f%%, "
-                     "flushing %.0f%%" RESET "\n",
+                     "flushing %.0f%%, "
+                     "copied %.1f KB" RESET "\n",
                 frame,
                 fps,
                 fps_low,
@@ -712,11 +716,17 @@ void handle_panel_refresh()
                 fps_samples,
                 proc_ratio * 100,
                 render_ratio * 100,
-                flush_ratio * 100);
+                flush_ratio * 100,
+                panel_bytes_copied / 1024.0);
+        pixmap_pool_print_stats();
+        text_size_cache_print_stats();
+        icon_cache_print_stats();
 #ifdef HAVE_TRACING
         stop_tracing();
         if (fps <= tracing_fps_threshold) {
-            print_tracing_events();
+            char path[256];
+            snprintf(path, sizeof(path), "tint2-%d-trace-frame-%d.json", getpid(), frame);
+            save_tracing_events(path);
         }
 #endif
     }
@@ -730,6 +740,19 @@ void handle_panel_refresh()
     frame++;
 }
 
+// Handles a SIGUSR1 by applying the config changes in place when possible.
+// Returns TRUE if the event loop can carry on.
+gboolean reload_config_in_place()
+{
+    if (get_signal_pending() != SIGUSR1 || get_self_restart_pending())
+        return FALSE;
+    if (!config_reload())
+        return FALSE;
+    fprintf(stderr, "tint2: config reloaded without restarting\n");
+    // A signal received during the reload replaces the SIGUSR1 and is handled by the caller
+    return clear_signal_pending(SIGUSR1);
+}
+
 void run_tint2_event_loop()
 {
     ts_event_read = 0;
@@ -737,24 +760,20 @@ void run_tint2_event_loop()
     ts_render_finished = 0;
     ts_flush_finished = 0;
     first_render = TRUE;
+    watch_fd(server.x11_fd, NULL, NULL);
 
-    while (!get_signal_pending()) {
+    while (!get_signal_pending() || reload_config_in_place()) {
         if (panel_refresh)
             handle_panel_refresh();
 
-        fd_set fds;
-        int max_fd;
-        prepare_fd_set(&fds, &max_fd);
-
-        // Wait for an event and handle it
+        // Wait for events and handle them; events already queued by Xlib do not wake up the wait
         ts_event_read = 0;
-        if (XPending(server.display) > 0 || select(max_fd + 1, &fds, 0, 0, get_duration_to_next_timer_expiration()) >= 0) {
+        gboolean x_pending = XPending(server.display) > 0;
+        if (wait_for_fd_events(!x_pending) || x_pending) {
 #ifdef HAVE_TRACING
             start_tracing((void*)run_tint2_event_loop);
 #endif
-            uevent_handler();
-            handle_sigchld_events();
-            handle_execp_events();
+            handle_fd_events();
             handle_x_events();
         }
 
@@ -815,5 +834,6 @@ int main(int argc, char **argv)
         restart = FALSE;
         tint2(argc, argv, &restart);
     } while(restart);
+    free_config_cache();
     return 0;
 }
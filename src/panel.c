@@ -24,6 +24,7 @@
 #include <unistd.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/Xregion.h>
 #include <X11/Xatom.h>
 #include <cairo.h>
 #include <cairo-xlib.h>
@@ -32,6 +33,7 @@
 #include "server.h"
 #include "config.h"
 #include "window.h"
+#include "window_index.h"
 #include "task.h"
 #include "panel.h"
 #include "tooltip.h"
@@ -83,6 +85,8 @@ GArray *gradients;
 double ui_scale_dpi_ref;
 double ui_scale_monitor_size_ref;
 
+unsigned long long panel_bytes_copied;
+
 Imlib_Image default_icon;
 char *default_font = NULL;
 
@@ -110,8 +114,7 @@ void default_panel()
     wm_menu = FALSE;
     max_tick_urgent = 14;
     mouse_left = TOGGLE_ICONIFY;
-    backgrounds = g_array_new(0, 0, sizeof(Background));
-    gradients = g_array_new(0, 0, sizeof(GradientClass));
+    init_backgrounds();
 
     memset(&panel_config, 0, sizeof(Panel));
     snprintf(panel_config.area.name, sizeof(panel_config.area.name), "Panel");
@@ -122,6 +125,12 @@ void default_panel()
     panel_config.mouse_pressed_saturation = 0;
     panel_config.mouse_pressed_brightness = 0;
     panel_config.mouse_effects = 1;
+}
+
+void init_backgrounds()
+{
+    backgrounds = g_array_new(0, 0, sizeof(Background));
+    gradients = g_array_new(0, 0, sizeof(GradientClass));
 
     // First background is always fully transparent
     Background transparent_bg;
@@ -132,6 +141,69 @@ void default_panel()
     g_array_append_val(gradients, transparent_gradient);
 }
 
+static void free_gradients(GArray *array)
+{
+    for (guint i = 0; i < array->len; i++)
+        cleanup_gradient(&g_array_index(array, GradientClass, i));
+    g_array_free(array, TRUE);
+}
+
+static void free_area_tree_gradients(Area *a)
+{
+    free_area_gradient_instances(a);
+    for (GList *l = a->children; l; l = l->next)
+        free_area_tree_gradients((Area *)l->data);
+}
+
+static void refresh_area_tree_background(Area *a)
+{
+    if (a->bg)
+        instantiate_area_gradients(a);
+    // Border widths may have changed
+    a->resize_needed = TRUE;
+    for (GList *l = a->children; l; l = l->next)
+        refresh_area_tree_background((Area *)l->data);
+}
+
+gboolean update_backgrounds(GArray *new_backgrounds, GArray *new_gradients)
+{
+    // Areas point into the arrays in use, so they are updated in place.
+    // panel_compute_size() may have appended copies of the panel background, which cannot be updated.
+    if (new_backgrounds->len != backgrounds->len || new_gradients->len != gradients->len) {
+        g_array_free(new_backgrounds, TRUE);
+        free_gradients(new_gradients);
+        return FALSE;
+    }
+
+    for (int i = 0; i < num_panels; i++)
+        free_area_tree_gradients(&panels[i].area);
+
+    for (guint i = 0; i < gradients->len; i++) {
+        GradientClass *g = &g_array_index(gradients, GradientClass, i);
+        cleanup_gradient(g);
+        *g = g_array_index(new_gradients, GradientClass, i);
+    }
+    for (guint i = 0; i < backgrounds->len; i++) {
+        Background *bg = &g_array_index(backgrounds, Background, i);
+        *bg = g_array_index(new_backgrounds, Background, i);
+        for (int j = 0; j < MOUSE_STATE_COUNT; j++) {
+            if (bg->gradients[j]) {
+                guint index = bg->gradients[j] - &g_array_index(new_gradients, GradientClass, 0);
+                bg->gradients[j] = &g_array_index(gradients, GradientClass, index);
+            }
+        }
+    }
+    // The gradients now belong to the arrays in use
+    g_array_free(new_backgrounds, TRUE);
+    g_array_free(new_gradients, TRUE);
+
+    for (int i = 0; i < num_panels; i++) {
+        refresh_area_tree_background(&panels[i].area);
+        set_panel_background(&panels[i]);
+    }
+    return TRUE;
+}
+
 void cleanup_panel()
 {
     if (!panels)
@@ -141,14 +213,25 @@ void cleanup_panel()
         Panel *p = &panels[i];
 
         free_area(&p->area);
+        if (p->hit_index)
+            g_array_free(p->hit_index, TRUE);
+        p->hit_index = NULL;
         if (p->temp_pmap)
             XFreePixmap(server.display, p->temp_pmap);
         p->temp_pmap = 0;
+        if (p->damage)
+            XDestroyRegion(p->damage);
+        p->damage = NULL;
+        if (p->composite_gc)
+            XFreeGC(server.display, p->composite_gc);
+        p->composite_gc = NULL;
         if (p->hidden_pixmap)
             XFreePixmap(server.display, p->hidden_pixmap);
         p->hidden_pixmap = 0;
-        if (p->main_win)
+        if (p->main_win) {
+            unregister_window(p->main_win, p);
             XDestroyWindow(server.display, p->main_win);
+        }
         p->main_win = 0;
         destroy_timer(&p->autohide_timer);
         cleanup_freespace(p);
@@ -167,11 +250,8 @@ void cleanup_panel()
 
     g_array_free(backgrounds, TRUE);
     backgrounds = NULL;
-    if (gradients) {
-        for (guint i = 0; i < gradients->len; i++)
-            cleanup_gradient(&g_array_index(gradients, GradientClass, i));
-        g_array_free(gradients, TRUE);
-    }
+    if (gradients)
+        free_gradients(gradients);
     gradients = NULL;
     pango_font_description_free(panel_config.g_task.font_desc);
     panel_config.g_task.font_desc = NULL;
@@ -291,6 +371,7 @@ void init_panel()
                                     server.visual,
                                     mask,
                                     &att);
+        register_window(p->main_win, WINDOW_PANEL, p);
 
         long event_mask = ExposureMask | ButtonPressMask | ButtonReleaseMask | ButtonMotionMask | PropertyChangeMask;
         if (p->mouse_effects || p->g_task.tooltip_enabled || p->clock.area._get_tooltip_text ||
@@ -307,6 +388,8 @@ void init_panel()
             XGCValues gcv;
             server.gc = XCreateGC(server.display, p->main_win, 0, &gcv);
         }
+        p->damage = XCreateRegion();
+        p->composite_gc = XCreateGC(server.display, p->main_win, 0, NULL);
         // fprintf(stderr, "tint2: panel %d : %d, %d, %d, %d\n", i, p->posx, p->posy, p->area.width, p->area.height);
         set_panel_properties(p);
         set_panel_background(p);
@@ -694,6 +777,7 @@ void update_strut(Panel *p)
 
 void set_panel_items_order(Panel *p)
 {
+    invalidate_hit_index(&p->area);
     if (p->area.children) {
         g_list_free(p->area.children);
         p->area.children = 0;
@@ -1015,12 +1099,7 @@ void set_panel_background(Panel *p)
 
 Panel *get_panel(Window win)
 {
-    for (int i = 0; i < num_panels; i++) {
-        if (panels[i].main_win == win) {
-            return &panels[i];
-        }
-    }
-    return 0;
+    return (Panel *)find_window_object(win, WINDOW_PANEL);
 }
 
 Taskbar *click_taskbar(Panel *panel, int x, int y)
@@ -1124,6 +1203,8 @@ void autohide_show(void *p)
     XMapSubwindows(server.display, panel->main_win); // systray windows
     set_panel_window_geometry(panel);
     set_panel_layer(panel, TOP_LAYER);
+    // The window was showing hidden_pixmap
+    add_panel_damage(panel, 0, 0, panel->area.width, panel->area.height);
     refresh_systray = TRUE; // ugly hack, because we actually only need to call XSetBackgroundPixmap
     schedule_panel_redraw();
 }
@@ -1190,12 +1271,55 @@ void shrink_panel(Panel *panel)
     }
 }
 
+void add_panel_damage(Panel *panel, int x, int y, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+    XRectangle r = {.x = x, .y = y, .width = width, .height = height};
+    XUnionRectWithRegion(&r, panel->damage, panel->damage);
+}
+
+void count_panel_bytes_copied(Panel *panel, int x, int y, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+    // Only the damaged parts of the rectangle are copied, as the composite GC is clipped to the damage region
+    Region copied = XCreateRegion();
+    XRectangle r = {.x = x, .y = y, .width = width, .height = height};
+    XUnionRectWithRegion(&r, copied, copied);
+    XIntersectRegion(copied, panel->damage, copied);
+    unsigned long long pixels = 0;
+    for (long i = 0; i < copied->numRects; i++) {
+        BOX *box = &copied->rects[i];
+        pixels += (unsigned long long)(box->x2 - box->x1) * (box->y2 - box->y1);
+    }
+    XDestroyRegion(copied);
+    int bytes_per_pixel = server.depth > 16 ? 4 : server.depth > 8 ? 2 : 1;
+    panel_bytes_copied += pixels * bytes_per_pixel;
+}
+
 void render_panel(Panel *panel)
 {
     relayout(&panel->area);
+    rebuild_hit_index(&panel->area);
     if (debug_geometry)
         area_dump_geometry(&panel->area, 0);
     update_dependent_gradients(&panel->area);
+
+    if (!panel->temp_pmap || panel->temp_pmap_width != panel->area.width ||
+        panel->temp_pmap_height != panel->area.height) {
+        if (panel->temp_pmap)
+            XFreePixmap(server.display, panel->temp_pmap);
+        panel->temp_pmap =
+            XCreatePixmap(server.display, server.root_win, panel->area.width, panel->area.height, server.depth);
+        panel->temp_pmap_width = panel->area.width;
+        panel->temp_pmap_height = panel->area.height;
+        // The new back buffer has undefined contents
+        add_panel_damage(panel, 0, 0, panel->area.width, panel->area.height);
+    }
+
+    collect_damage(&panel->area);
+    XSetRegion(server.display, panel->composite_gc, panel->damage);
     draw_tree(&panel->area);
 }
 
@@ -1233,6 +1357,23 @@ void default_font_changed()
     tooltip_default_font_changed();
 }
 
+static void resize_area_tree(Area *a)
+{
+    a->resize_needed = TRUE;
+    schedule_redraw(a);
+    for (GList *l = a->children; l; l = l->next)
+        resize_area_tree((Area *)l->data);
+}
+
+void update_fonts()
+{
+    clock_fonts_changed();
+    for (int i = 0; i < num_panels; i++)
+        resize_area_tree(&panels[i].area);
+    tooltip_update();
+    schedule_panel_redraw();
+}
+
 void _schedule_panel_redraw(const char *file, const char *function, const int line)
 {
     panel_refresh = TRUE;
@@ -1289,8 +1430,6 @@ void save_screenshot(const char *path)
     if (panel->area.width > server.monitors[0].width)
         panel->area.width = server.monitors[0].width;
 
-    panel->temp_pmap =
-        XCreatePixmap(server.display, server.root_win, panel->area.width, panel->area.height, server.depth);
     render_panel(panel);
 
     XSync(server.display, False);
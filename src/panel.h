@@ -13,6 +13,7 @@
 
 #include <pango/pangocairo.h>
 #include <sys/time.h>
+#include <X11/Xutil.h>
 
 #include "common.h"
 #include "clock.h"
@@ -93,6 +94,8 @@ extern XSettingsClient *xsettings_client;
 extern gboolean startup_notifications;
 extern gboolean debug_geometry;
 extern gboolean debug_fps;
+// Number of bytes copied while compositing the current frame, reported when debug_fps is set
+extern unsigned long long panel_bytes_copied;
 extern double tracing_fps_threshold;
 extern gboolean debug_frames;
 extern gboolean debug_thumbnails;
@@ -105,7 +108,16 @@ typedef struct Panel {
     Area area;
 
     Window main_win;
+    // Back buffer. It is kept across frames, only the damaged region is recomposited.
     Pixmap temp_pmap;
+    int temp_pmap_width, temp_pmap_height;
+    // Region of the panel that has to be recomposited and copied to main_win on the next frame
+    Region damage;
+    // GC clipped to the damage region
+    GC composite_gc;
+    // Hit-test index (array of HitIndexEntry) used to find the Area under the mouse, or NULL if the Area tree
+    // changed since the last layout
+    GArray *hit_index;
 
     // position relative to root window
     int posx, posy;
@@ -160,6 +172,13 @@ extern int num_panels;
 // default global data
 void default_panel();
 
+// Allocates the backgrounds and gradients arrays, with their default entries
+void init_backgrounds();
+
+// Copies the backgrounds and gradients read again from the config over the ones in use, then redraws the panels.
+// Takes ownership of the arrays. Returns FALSE if their sizes do not match those in use.
+gboolean update_backgrounds(GArray *new_backgrounds, GArray *new_gradients);
+
 // freed memory
 void cleanup_panel();
 
@@ -170,6 +189,11 @@ void init_panel();
 void init_panel_size_and_position(Panel *panel);
 gboolean resize_panel(void *obj);
 void render_panel(Panel *panel);
+// Adds a rectangle (relative to the panel window) to the panel damage region.
+// The caller must also call schedule_panel_redraw().
+void add_panel_damage(Panel *panel, int x, int y, int width, int height);
+// Adds to panel_bytes_copied the size of the damaged part of a rectangle
+void count_panel_bytes_copied(Panel *panel, int x, int y, int width, int height);
 void shrink_panel(Panel *panel);
 void _schedule_panel_redraw(const char *file, const char *function, const int line);
 #define schedule_panel_redraw() _schedule_panel_redraw(__FILE__, __func__, __LINE__)
@@ -210,6 +234,8 @@ const char *get_default_font();
 
 void default_icon_theme_changed();
 void default_font_changed();
+// Measures the panels again after the config changed some of their fonts
+void update_fonts();
 
 void free_icon(Imlib_Image icon);
 Imlib_Image scale_icon(Imlib_Image original, int icon_size);
@@ -29,12 +29,17 @@
 #include <X11/extensions/Xdamage.h>
 #include <X11/extensions/Xcomposite.h>
 #include <X11/extensions/Xrender.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <unistd.h>
 
 #include "systraybar.h"
 #include "server.h"
 #include "panel.h"
+#include "pixmap_pool.h"
 #include "window.h"
+#include "window_index.h"
 
 GSList *icons;
 
@@ -70,6 +75,8 @@ const int max_bad_resize_events = 10;
 
 int systray_compute_desired_size(void *obj);
 void systray_dump_geometry(void *obj, int indent);
+static void cleanup_icon_rendering();
+static void free_icon_pictures(TrayWindow *traywin);
 
 void default_systray()
 {
@@ -97,7 +104,7 @@ void cleanup_systray()
     systray.area.on_screen = FALSE;
     free_area(&systray.area);
     if (render_background) {
-        XFreePixmap(server.display, render_background);
+        pixmap_pool_release(render_background);
         render_background = 0;
     }
     if (systray_hide_name_regex) {
@@ -230,10 +237,8 @@ void draw_systray(void *obj, cairo_t *c)
     if (systray_profile)
         fprintf(stderr, BLUE "tint2: [%f] %s:%d" RESET "\n", profiling_get_time(), __func__, __LINE__);
     if (systray_composited) {
-        if (render_background)
-            XFreePixmap(server.display, render_background);
         render_background =
-            XCreatePixmap(server.display, server.root_win, systray.area.width, systray.area.height, server.depth);
+            pixmap_pool_recycle(render_background, systray.area.width, systray.area.height, server.depth);
         XCopyArea(server.display,
                   systray.area.pix,
                   render_background,
@@ -375,17 +380,16 @@ void start_net()
     // freedesktop systray specification
     if (win != None) {
         // search pid
-        Atom _NET_WM_PID, actual_type;
+        Atom actual_type;
         int actual_format;
         unsigned long nitems;
         unsigned long bytes_after;
         unsigned char *prop = 0;
         int pid;
 
-        _NET_WM_PID = XInternAtom(server.display, "_NET_WM_PID", True);
         int ret = XGetWindowProperty(server.display,
                                      win,
-                                     _NET_WM_PID,
+                                     server.atom._NET_WM_PID,
                                      0,
                                      1024,
                                      False,
@@ -449,7 +453,7 @@ void start_net()
         vid = XVisualIDFromVisual(server.visual);
     XChangeProperty(server.display,
                     net_sel_win,
-                    XInternAtom(server.display, "_NET_SYSTEM_TRAY_VISUAL", False),
+                    server.atom._NET_SYSTEM_TRAY_VISUAL,
                     XA_VISUALID,
                     32,
                     PropModeReplace,
@@ -519,6 +523,7 @@ void stop_net()
         g_slist_free(systray.list_icons);
         systray.list_icons = NULL;
     }
+    cleanup_icon_rendering();
 
     if (net_sel_win != None) {
         XDestroyWindow(server.display, net_sel_win);
@@ -734,6 +739,8 @@ gboolean add_icon(Window win)
     INIT_TIMER(traywin->render_timer);
     INIT_TIMER(traywin->resize_timer);
     chrono++;
+    register_window(traywin->win, WINDOW_TRAY_ICON, traywin);
+    register_window(traywin->parent, WINDOW_TRAY_ICON, traywin);
 
     show(&systray.area);
 
@@ -830,6 +837,11 @@ gboolean reparent_icon(TrayWindow *traywin)
     }
 
     traywin->reparented = TRUE;
+    // The icon now has the geometry requested above, later changes are tracked from ConfigureNotify events
+    traywin->win_x = 0;
+    traywin->win_y = 0;
+    traywin->win_width = traywin->width;
+    traywin->win_height = traywin->height;
 
     if (systray_profile)
         fprintf(stderr,
@@ -865,8 +877,9 @@ gboolean embed_icon(TrayWindow *traywin)
     // Redirect rendering when using compositing
     if (systray_composited) {
         if (systray_profile)
-            fprintf(stderr, "tint2: XDamageCreate(server.display, traywin->parent, XDamageReportRawRectangles)\n");
-        traywin->damage = XDamageCreate(server.display, traywin->parent, XDamageReportRawRectangles);
+            fprintf(stderr, "tint2: XDamageCreate(server.display, traywin->parent, XDamageReportNonEmpty)\n");
+        // Reports only when the damage becomes non-empty; rendering subtracts it to get notified again
+        traywin->damage = XDamageCreate(server.display, traywin->parent, XDamageReportNonEmpty);
         if (systray_profile)
             fprintf(stderr, "tint2: XCompositeRedirectWindow(server.display, traywin->parent, CompositeRedirectManual)\n");
         XCompositeRedirectWindow(server.display, traywin->parent, CompositeRedirectManual);
@@ -928,6 +941,8 @@ void remove_icon(TrayWindow *traywin)
 
     // remove from our list
     systray.list_icons = g_slist_remove(systray.list_icons, traywin);
+    unregister_window(traywin->win, traywin);
+    unregister_window(traywin->parent, traywin);
     fprintf(stderr, YELLOW "tint2: remove_icon: %lu (%s)" RESET "\n", traywin->win, traywin->name);
 
     XSelectInput(server.display, traywin->win, NoEventMask);
@@ -938,6 +953,7 @@ void remove_icon(TrayWindow *traywin)
     XSync(server.display, False);
     error = FALSE;
     XErrorHandler old = XSetErrorHandler(window_error_handler);
+    free_icon_pictures(traywin);
     XUnmapWindow(server.display, traywin->win);
     XReparentWindow(server.display, traywin->win, server.root_win, 0, 0);
     XDestroyWindow(server.display, traywin->parent);
@@ -946,10 +962,6 @@ void remove_icon(TrayWindow *traywin)
     destroy_timer(&traywin->render_timer);
     destroy_timer(&traywin->resize_timer);
     free(traywin->name);
-    if (traywin->image) {
-        imlib_context_set_image(traywin->image);
-        imlib_free_image_and_decache();
-    }
     g_free(traywin);
 
     // check empty systray
@@ -1037,6 +1049,14 @@ void systray_reconfigure_event(TrayWindow *traywin, XEvent *e)
                 e->xconfigure.width,
                 e->xconfigure.height);
 
+    // Track the actual geometry; ignore the requests and the synthetic events sent by systray_resize_icon()
+    if (e->type == ConfigureNotify && e->xconfigure.window == traywin->win && !e->xconfigure.send_event) {
+        traywin->win_x = e->xconfigure.x;
+        traywin->win_y = e->xconfigure.y;
+        traywin->win_width = e->xconfigure.width;
+        traywin->win_height = e->xconfigure.height;
+    }
+
     if (!traywin->reparented)
         return;
 
@@ -1183,22 +1203,186 @@ void systray_destroy_event(TrayWindow *traywin)
     remove_icon(traywin);
 }
 
-void systray_render_icon_from_image(TrayWindow *traywin)
+// Solid fill used to apply the systray_asb alpha with XRender, created on first use
+static Picture asb_alpha_mask = None;
+// Image used to read back the icons that must be processed on the CPU, reused across icons
+static XImage *icon_ximage = NULL;
+static XShmSegmentInfo icon_shm = {.shmid = -1, .shmaddr = (char *)-1};
+// GC for the 32 bit icon pixmaps
+static GC icon_gc = NULL;
+
+static void release_icon_ximage()
 {
-    if (!traywin->image)
+    if (!icon_ximage)
         return;
-    imlib_context_set_image(traywin->image);
+    if (icon_shm.shmaddr != (char *)-1) {
+        XShmDetach(server.display, &icon_shm);
+        shmdt(icon_shm.shmaddr);
+        icon_shm.shmaddr = (char *)-1;
+        icon_shm.shmid = -1;
+        icon_ximage->data = NULL;
+    }
+    XDestroyImage(icon_ximage);
+    icon_ximage = NULL;
+}
+
+static void cleanup_icon_rendering()
+{
+    release_icon_ximage();
+    if (icon_gc)
+        XFreeGC(server.display, icon_gc);
+    icon_gc = NULL;
+    if (asb_alpha_mask)
+        XRenderFreePicture(server.display, asb_alpha_mask);
+    asb_alpha_mask = None;
+}
+
+static void free_icon_pictures(TrayWindow *traywin)
+{
+    if (traywin->picture)
+        XRenderFreePicture(server.display, traywin->picture);
+    traywin->picture = None;
+    if (traywin->pixmap_picture)
+        XRenderFreePicture(server.display, traywin->pixmap_picture);
+    traywin->pixmap_picture = None;
+    if (traywin->pixmap)
+        XFreePixmap(server.display, traywin->pixmap);
+    traywin->pixmap = None;
+    traywin->pixmap_width = traywin->pixmap_height = 0;
+    traywin->rendered = FALSE;
+}
+
+// Returns an image of the given size for reading back icon pixmaps, using shared memory when possible.
+static XImage *get_icon_ximage(int width, int height)
+{
+    if (icon_ximage && icon_ximage->width == width && icon_ximage->height == height)
+        return icon_ximage;
+    release_icon_ximage();
+
+    if (server.has_shm) {
+        icon_ximage =
+            XShmCreateImage(server.display, server.visual32, 32, ZPixmap, NULL, &icon_shm, width, height);
+        if (icon_ximage) {
+            icon_shm.shmid = shmget(IPC_PRIVATE, icon_ximage->bytes_per_line * height, IPC_CREAT | 0600);
+            if (icon_shm.shmid >= 0) {
+                icon_shm.shmaddr = icon_ximage->data = (char *)shmat(icon_shm.shmid, 0, 0);
+                icon_shm.readOnly = False;
+                if (icon_shm.shmaddr != (char *)-1 && XShmAttach(server.display, &icon_shm)) {
+                    // Once the server has attached, the segment can be marked for deletion
+                    XSync(server.display, False);
+                    shmctl(icon_shm.shmid, IPC_RMID, NULL);
+                    return icon_ximage;
+                }
+                if (icon_shm.shmaddr != (char *)-1)
+                    shmdt(icon_shm.shmaddr);
+                shmctl(icon_shm.shmid, IPC_RMID, NULL);
+            }
+            icon_shm.shmaddr = (char *)-1;
+            icon_shm.shmid = -1;
+            icon_ximage->data = NULL;
+            XDestroyImage(icon_ximage);
+            icon_ximage = NULL;
+        }
+    }
+
+    char *data = calloc((size_t)width * height, 4);
+    icon_ximage = XCreateImage(server.display, server.visual32, 32, ZPixmap, 0, data, width, height, 32, 0);
+    if (!icon_ximage)
+        free(data);
+    return icon_ximage;
+}
+
+// Applies the heuristic mask and the saturation/brightness adjustments to the icon pixmap on the CPU.
+static gboolean adjust_icon_pixels(TrayWindow *traywin)
+{
+    int w = traywin->width, h = traywin->height;
+    XImage *ximg = get_icon_ximage(w, h);
+    if (!ximg || ximg->bits_per_pixel != 32)
+        return FALSE;
+    if (icon_shm.shmaddr != (char *)-1) {
+        if (!XShmGetImage(server.display, traywin->pixmap, ximg, 0, 0, AllPlanes))
+            return FALSE;
+    } else {
+        if (!XGetSubImage(server.display, traywin->pixmap, 0, 0, w, h, AllPlanes, ZPixmap, ximg, 0, 0))
+            return FALSE;
+    }
+
+    // The pixmap is premultiplied, while the adjustments work on straight alpha
+    DATA32 *data = (DATA32 *)ximg->data;
+    for (int i = 0; i < w * h; i++) {
+        unsigned a = data[i] >> 24;
+        if (a == 0 || a == 255)
+            continue;
+        unsigned r = ((data[i] >> 16) & 0xff) * 255 / a;
+        unsigned g = ((data[i] >> 8) & 0xff) * 255 / a;
+        unsigned b = (data[i] & 0xff) * 255 / a;
+        data[i] = (a << 24) | (MIN(r, 255) << 16) | (MIN(g, 255) << 8) | MIN(b, 255);
+    }
+    if (traywin->depth == 24)
+        create_heuristic_mask(data, w, h);
+    if (systray.saturation != 0 || systray.brightness != 0)
+        adjust_asb(data, w, h, 1.0, systray.saturation / 100.0, systray.brightness / 100.0);
+    for (int i = 0; i < w * h; i++) {
+        unsigned a = data[i] >> 24;
+        if (a == 255)
+            continue;
+        unsigned r = ((data[i] >> 16) & 0xff) * a / 255;
+        unsigned g = ((data[i] >> 8) & 0xff) * a / 255;
+        unsigned b = (data[i] & 0xff) * a / 255;
+        data[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+
+    if (icon_shm.shmaddr != (char *)-1)
+        XShmPutImage(server.display, traywin->pixmap, icon_gc, ximg, 0, 0, 0, 0, w, h, False);
+    else
+        XPutImage(server.display, traywin->pixmap, icon_gc, ximg, 0, 0, 0, 0, w, h);
+    return TRUE;
+}
+
+// Draws the last rendered contents of the icon over the systray background
+void systray_draw_icon(TrayWindow *traywin)
+{
+    if (!traywin->rendered || !systray.area.pix || !render_background)
+        return;
+    int x = traywin->x - systray.area.posx;
+    int y = traywin->y - systray.area.posy;
     XCopyArea(server.display,
               render_background,
               systray.area.pix,
               server.gc,
-              traywin->x - systray.area.posx,
-              traywin->y - systray.area.posy,
+              x,
+              y,
               traywin->width,
               traywin->height,
-              traywin->x - systray.area.posx,
-              traywin->y - systray.area.posy);
-    render_image(systray.area.pix, traywin->x - systray.area.posx, traywin->y - systray.area.posy);
+              x,
+              y);
+
+    if (systray.alpha != 100 && !asb_alpha_mask) {
+        XRenderColor color = {0, 0, 0, (unsigned short)(systray.alpha / 100.0 * 0xffff)};
+        asb_alpha_mask = XRenderCreateSolidFill(server.display, &color);
+    }
+    Picture pict_drawable = XRenderCreatePicture(server.display,
+                                                 systray.area.pix,
+                                                 XRenderFindVisualFormat(server.display, server.visual),
+                                                 0,
+                                                 0);
+    XRenderComposite(server.display,
+                     PictOpOver,
+                     traywin->pixmap_picture,
+                     systray.alpha != 100 ? asb_alpha_mask : None,
+                     pict_drawable,
+                     0,
+                     0,
+                     0,
+                     0,
+                     x,
+                     y,
+                     traywin->width,
+                     traywin->height);
+    XRenderFreePicture(server.display, pict_drawable);
+
+    add_panel_damage((Panel *)systray.area.panel, traywin->x, traywin->y, traywin->width, traywin->height);
+    schedule_panel_redraw();
 }
 
 void systray_render_icon_composited(void *t)
@@ -1256,59 +1440,56 @@ void systray_render_icon_composited(void *t)
 
     stop_timer(&traywin->render_timer);
 
+    // Re-arm the damage notification before reading the contents, so that later changes are not missed
+    if (traywin->damage)
+        XDamageSubtract(server.display, traywin->damage, None, None);
+
     // good systray icons support 32 bit depth, but some icons are still 24 bit.
     // We create a heuristic mask for these icons, i.e. we get the rgb value in the top left corner, and
     // mask out all pixel with the same rgb value
-
-    // Very ugly hack, but somehow imlib2 is not able to get the image from the traywindow itself,
-    // so we first render the tray window onto a pixmap, and then we tell imlib2 to use this pixmap as
-    // drawable. If someone knows why it does not work with the traywindow itself, please tell me ;)
-    Pixmap tmp_pmap = XCreatePixmap(server.display, traywin->win, traywin->width, traywin->height, 32);
-    if (!tmp_pmap) {
-        goto on_systray_error;
-    }
-    XRenderPictFormat *f;
-    if (traywin->depth == 24) {
-        f = XRenderFindStandardFormat(server.display, PictStandardRGB24);
-    } else if (traywin->depth == 32) {
-        f = XRenderFindStandardFormat(server.display, PictStandardARGB32);
-    } else {
-        fprintf(stderr, RED "tint2: Strange tray icon found with depth: %d" RESET "\n", traywin->depth);
-        XFreePixmap(server.display, tmp_pmap);
-        return;
-    }
-    XRenderPictFormat *f32 = XRenderFindVisualFormat(server.display, server.visual32);
-    if (!f || !f32) {
-        XFreePixmap(server.display, tmp_pmap);
-        goto on_systray_error;
+    if (!traywin->picture) {
+        XRenderPictFormat *f;
+        if (traywin->depth == 24) {
+            f = XRenderFindStandardFormat(server.display, PictStandardRGB24);
+        } else if (traywin->depth == 32) {
+            f = XRenderFindStandardFormat(server.display, PictStandardARGB32);
+        } else {
+            fprintf(stderr, RED "tint2: Strange tray icon found with depth: %d" RESET "\n", traywin->depth);
+            return;
+        }
+        if (!f)
+            goto on_systray_error;
+        // if (server.real_transparency)
+        // Picture pict_image = XRenderCreatePicture(server.display, traywin->parent, f, 0, 0);
+        // reverted Rev 407 because here it's breaking alls icon with systray + xcompmgr
+        traywin->picture = XRenderCreatePicture(server.display, traywin->win, f, 0, 0);
+        if (!traywin->picture)
+            goto on_error;
     }
 
-    XSync(server.display, False);
-    error = FALSE;
-    XErrorHandler old = XSetErrorHandler(window_error_handler);
-
-    // if (server.real_transparency)
-    // Picture pict_image = XRenderCreatePicture(server.display, traywin->parent, f, 0, 0);
-    // reverted Rev 407 because here it's breaking alls icon with systray + xcompmgr
-    Picture pict_image = XRenderCreatePicture(server.display, traywin->win, f, 0, 0);
-    if (!pict_image) {
-        XFreePixmap(server.display, tmp_pmap);
-        XSetErrorHandler(old);
-        goto on_error;
-    }
-    Picture pict_drawable =
-        XRenderCreatePicture(server.display, tmp_pmap, XRenderFindVisualFormat(server.display, server.visual32), 0, 0);
-    if (!pict_drawable) {
-        XRenderFreePicture(server.display, pict_image);
-        XFreePixmap(server.display, tmp_pmap);
-        XSetErrorHandler(old);
-        goto on_error;
+    if (!traywin->pixmap || traywin->pixmap_width != traywin->width || traywin->pixmap_height != traywin->height) {
+        if (traywin->pixmap_picture)
+            XRenderFreePicture(server.display, traywin->pixmap_picture);
+        if (traywin->pixmap)
+            XFreePixmap(server.display, traywin->pixmap);
+        traywin->pixmap = XCreatePixmap(server.display, traywin->win, traywin->width, traywin->height, 32);
+        if (!traywin->pixmap)
+            goto on_systray_error;
+        XRenderPictFormat *f32 = XRenderFindStandardFormat(server.display, PictStandardARGB32);
+        if (!f32)
+            goto on_systray_error;
+        traywin->pixmap_picture = XRenderCreatePicture(server.display, traywin->pixmap, f32, 0, 0);
+        traywin->pixmap_width = traywin->width;
+        traywin->pixmap_height = traywin->height;
+        if (!icon_gc)
+            icon_gc = XCreateGC(server.display, traywin->pixmap, 0, NULL);
     }
+
     XRenderComposite(server.display,
                      PictOpSrc,
-                     pict_image,
+                     traywin->picture,
                      None,
-                     pict_drawable,
+                     traywin->pixmap_picture,
                      0,
                      0,
                      0,
@@ -1317,59 +1498,15 @@ void systray_render_icon_composited(void *t)
                      0,
                      traywin->width,
                      traywin->height);
-    XRenderFreePicture(server.display, pict_image);
-    XRenderFreePicture(server.display, pict_drawable);
-    // end of the ugly hack and we can continue as before
-
-    imlib_context_set_visual(server.visual32);
-    imlib_context_set_colormap(server.colormap32);
-    imlib_context_set_drawable(tmp_pmap);
-    Imlib_Image image = imlib_create_image_from_drawable(0, 0, 0, traywin->width, traywin->height, 1);
-    imlib_context_set_visual(server.visual);
-    imlib_context_set_colormap(server.colormap);
-    XFreePixmap(server.display, tmp_pmap);
-    if (!image) {
-        imlib_context_set_visual(server.visual);
-        imlib_context_set_colormap(server.colormap);
-        XSetErrorHandler(old);
-        goto on_error;
-    } else {
-        if (traywin->image) {
-            imlib_context_set_image(traywin->image);
-            imlib_free_image_and_decache();
-        }
-        traywin->image = image;
-    }
 
-    imlib_context_set_image(traywin->image);
-    // if (traywin->depth == 24)
-    // imlib_save_image("/home/thil77/test.jpg");
-    imlib_image_set_has_alpha(1);
-    DATA32 *data = imlib_image_get_data();
-    if (traywin->depth == 24) {
-        create_heuristic_mask(data, traywin->width, traywin->height);
+    // The heuristic mask, saturation and brightness need the pixels on the CPU; the alpha is applied when drawing
+    if (traywin->depth == 24 || systray.saturation != 0 || systray.brightness != 0) {
+        if (!adjust_icon_pixels(traywin))
+            goto on_error;
     }
+    traywin->rendered = TRUE;
 
-    if (systray.alpha != 100 || systray.brightness != 0 || systray.saturation != 0)
-        adjust_asb(data,
-                   traywin->width,
-                   traywin->height,
-                   systray.alpha / 100.0,
-                   systray.saturation / 100.0,
-                   systray.brightness / 100.0);
-    imlib_image_put_back_data(data);
-
-    systray_render_icon_from_image(traywin);
-
-    if (traywin->damage)
-        XDamageSubtract(server.display, traywin->damage, None, None);
-    XSync(server.display, False);
-    XSetErrorHandler(old);
-
-    if (error)
-        goto on_error;
-
-    schedule_panel_redraw();
+    systray_draw_icon(traywin);
 
     if (systray_profile)
         fprintf(stderr,
@@ -1431,36 +1568,22 @@ void systray_render_icon(void *t)
                 traywin->name);
 
     if (systray_composited) {
-        XSync(server.display, False);
-        error = FALSE;
-        XErrorHandler old = XSetErrorHandler(window_error_handler);
-
-        unsigned int border_width;
-        int xpos, ypos;
-        unsigned int width, height, depth;
-        Window root;
-        if (!XGetGeometry(server.display, traywin->win, &root, &xpos, &ypos, &width, &height, &border_width, &depth)) {
+        // Wait until the icon has the geometry we gave it (tracked from ConfigureNotify), meanwhile show the last
+        // rendering
+        if (traywin->win_x != 0 || traywin->win_y != 0 || traywin->win_width != traywin->width ||
+            traywin->win_height != traywin->height) {
             change_timer(&traywin->render_timer, true, min_refresh_period, 0, systray_render_icon, traywin);
-            systray_render_icon_from_image(traywin);
-            XSetErrorHandler(old);
+            systray_draw_icon(traywin);
+            if (systray_profile)
+                fprintf(stderr,
+                        YELLOW "[%f] %s:%d win = %lu (%s) delaying rendering" RESET "\n",
+                        profiling_get_time(),
+                        __func__,
+                        __LINE__,
+                        traywin->win,
+                        traywin->name);
             return;
-        } else {
-            if (xpos != 0 || ypos != 0 || width != traywin->width || height != traywin->height) {
-                change_timer(&traywin->render_timer, true, min_refresh_period, 0, systray_render_icon, traywin);
-                systray_render_icon_from_image(traywin);
-                if (systray_profile)
-                    fprintf(stderr,
-                            YELLOW "[%f] %s:%d win = %lu (%s) delaying rendering" RESET "\n",
-                            profiling_get_time(),
-                            __func__,
-                            __LINE__,
-                            traywin->win,
-                            traywin->name);
-                XSetErrorHandler(old);
-                return;
-            }
         }
-        XSetErrorHandler(old);
     }
 
     if (systray_profile)
@@ -1502,10 +1625,5 @@ gboolean systray_on_monitor(int i_monitor, int n_panels)
 
 TrayWindow *systray_find_icon(Window win)
 {
-    for (GSList *l = systray.list_icons; l; l = l->next) {
-        TrayWindow *traywin = (TrayWindow *)l->data;
-        if (traywin->win == win || traywin->parent == win)
-            return traywin;
-    }
-    return NULL;
+    return (TrayWindow *)find_window_object(win, WINDOW_TRAY_ICON);
 }
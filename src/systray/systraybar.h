@@ -14,6 +14,7 @@
 #include "area.h"
 #include "timer.h"
 #include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xrender.h>
 
 // XEMBED messages
 #define XEMBED_EMBEDDED_NOTIFY 0
@@ -44,6 +45,9 @@ typedef struct {
     Window parent;
     int x, y;
     int width, height;
+    // Geometry of the icon window, tracked from ConfigureNotify events
+    int win_x, win_y;
+    int win_width, win_height;
     int depth;
     gboolean reparented;
     gboolean embedded;
@@ -61,8 +65,14 @@ typedef struct {
     int bad_size_counter;
     struct timespec time_last_resize;
     Timer resize_timer;
-    // Icon contents if we are compositing the icon, otherwise null
-    Imlib_Image image;
+    // Members used for composited rendering, otherwise None
+    // Contents of the icon window
+    Picture picture;
+    // The icon with systray_asb applied (except the alpha, applied when drawing), premultiplied 32 bit ARGB
+    Pixmap pixmap;
+    Picture pixmap_picture;
+    int pixmap_width, pixmap_height;
+    gboolean rendered;
     // XDamage
     Damage damage;
 } TrayWindow;
@@ -30,10 +30,12 @@
 #include "panel.h"
 #include "server.h"
 #include "task.h"
+#include "task_icon.h"
 #include "taskbar.h"
 #include "timer.h"
 #include "tooltip.h"
 #include "window.h"
+#include "window_index.h"
 
 Timer urgent_timer;
 GSList *urgent_list;
@@ -70,6 +72,11 @@ Task *add_task(Window win)
     XSelectInput(server.display, win, PropertyChangeMask | StructureNotifyMask);
     XFlush(server.display);
 
+    return add_selected_task(win);
+}
+
+Task *add_selected_task(Window win)
+{
     int monitor = 0;
     if (num_panels > 1) {
         monitor = get_window_monitor(win);
@@ -92,13 +99,13 @@ Task *add_task(Window win)
     task_template.area.panel = &panels[monitor];
     task_template.current_state = window_is_iconified(win) ? TASK_ICONIFIED : TASK_NORMAL;
     get_window_coordinates(win, &task_template.win_x, &task_template.win_y, &task_template.win_w, &task_template.win_h);
+    if (panel_config.g_task.thumbnail_enabled)
+        task_template.damage = XDamageCreate(server.display, win, XDamageReportNonEmpty);
 
     // allocate only one title and one icon
     // even with task_on_all_desktop and with task_on_all_panel
     task_template.title = NULL;
-    for (int k = 0; k < TASK_STATE_COUNT; ++k) {
-        task_template.icon[k] = NULL;
-    }
+    task_template.icon = NULL;
     task_update_title(&task_template);
     task_update_icon(&task_template);
     snprintf(task_template.area.name,
@@ -109,18 +116,9 @@ Task *add_task(Window win)
 
     // get application name
     // use res_class property of WM_CLASS as res_name is easily overridable by user
-    XClassHint *classhint = XAllocClassHint();
-    if (classhint && XGetClassHint(server.display, win, classhint))
-        task_template.application = strdup(classhint->res_class);
-    else
+    task_template.application = get_window_class(win);
+    if (!task_template.application)
         task_template.application = strdup("Untitled");
-    if (classhint) {
-        if (classhint->res_name)
-            XFree(classhint->res_name);
-        if (classhint->res_class)
-            XFree(classhint->res_class);
-        XFree(classhint);
-    }
 
     GPtrArray *task_buttons = g_ptr_array_new();
     for (int j = 0; j < panels[monitor].num_desktops; j++) {
@@ -155,13 +153,10 @@ Task *add_task(Window win)
         task_instance->icon_color = task_template.icon_color;
         task_instance->icon_color_hover = task_template.icon_color_hover;
         task_instance->icon_color_press = task_template.icon_color_press;
-        for (int k = 0; k < TASK_STATE_COUNT; ++k) {
-            task_instance->icon[k] = task_template.icon[k];
-            task_instance->icon_hover[k] = task_template.icon_hover[k];
-            task_instance->icon_press[k] = task_template.icon_press[k];
-        }
+        task_instance->icon = task_template.icon;
         task_instance->icon_width = task_template.icon_width;
         task_instance->icon_height = task_template.icon_height;
+        task_instance->damage = task_template.damage;
 
         add_area(&task_instance->area, &taskbar->area);
         g_ptr_array_add(task_buttons, task_instance);
@@ -169,10 +164,12 @@ Task *add_task(Window win)
     Window *key = calloc(1, sizeof(Window));
     *key = task_template.win;
     g_hash_table_insert(win_to_task, key, task_buttons);
+    register_window(win, WINDOW_TASK, g_ptr_array_index(task_buttons, 0));
 
     set_task_state((Task *)g_ptr_array_index(task_buttons, 0), task_template.current_state);
 
-    sort_taskbar_for_win(win);
+    if (!taskbar_is_updating())
+        sort_taskbar_for_win(win);
 
     if (taskbar_mode == MULTI_DESKTOP) {
         Panel *panel = (Panel *)task_template.area.panel;
@@ -183,7 +180,7 @@ Task *add_task(Window win)
         add_urgent((Task *)g_ptr_array_index(task_buttons, 0));
     }
 
-    if (hide_taskbar_if_empty)
+    if (hide_taskbar_if_empty && !taskbar_is_updating())
         update_all_taskbars_visibility();
 
     return (Task *)g_ptr_array_index(task_buttons, 0);
@@ -193,23 +190,8 @@ void task_remove_icon(Task *task)
 {
     if (!task)
         return;
-    for (int k = 0; k < TASK_STATE_COUNT; ++k) {
-        if (task->icon[k]) {
-            imlib_context_set_image(task->icon[k]);
-            imlib_free_image();
-            task->icon[k] = 0;
-        }
-        if (task->icon_hover[k]) {
-            imlib_context_set_image(task->icon_hover[k]);
-            imlib_free_image();
-            task->icon_hover[k] = 0;
-        }
-        if (task->icon_press[k]) {
-            imlib_context_set_image(task->icon_press[k]);
-            imlib_free_image();
-            task->icon_press[k] = 0;
-        }
-    }
+    task_icon_unref(task->icon);
+    task->icon = NULL;
 }
 
 void remove_task(Task *task)
@@ -233,8 +215,11 @@ void remove_task(Task *task)
     if (task->application)
         free(task->application);
     task_remove_icon(task);
+    if (task->damage)
+        XDamageDestroy(server.display, task->damage);
 
     GPtrArray *task_buttons = g_hash_table_lookup(win_to_task, &win);
+    unregister_window(win, g_ptr_array_index(task_buttons, 0));
     for (int i = 0; i < task_buttons->len; ++i) {
         Task *task2 = g_ptr_array_index(task_buttons, i);
         if (task2 == active_task)
@@ -245,11 +230,12 @@ void remove_task(Task *task)
             del_urgent(task2);
         if (g_tooltip.area == &task2->area)
             tooltip_hide(NULL);
+        taskbar_forget_thumbnail_job(task2);
         remove_area((Area *)task2);
         free(task2);
     }
     g_hash_table_remove(win_to_task, &win);
-    if (hide_taskbar_if_empty)
+    if (hide_taskbar_if_empty && !taskbar_is_updating())
         update_all_taskbars_visibility();
 }
 
@@ -299,58 +285,9 @@ gboolean task_update_title(Task *task)
     return TRUE;
 }
 
-Imlib_Image task_get_icon(Window win, int icon_size)
+void task_set_icon_color(Task *task, const Color *color)
 {
-    Imlib_Image img = NULL;
-
-    if (!img) {
-        int len;
-        gulong *data = server_get_property(win, server.atom._NET_WM_ICON, XA_CARDINAL, &len);
-        if (data) {
-            if (len > 0) {
-                // get ARGB icon
-                int w, h;
-                gulong *tmp_data = get_best_icon(data, get_icon_count(data, len), len, &w, &h, icon_size);
-                if (tmp_data) {
-                    DATA32 icon_data[w * h];
-                    for (int j = 0; j < w * h; ++j)
-                        icon_data[j] = tmp_data[j];
-                    img = imlib_create_image_using_copied_data(w, h, icon_data);
-                }
-            }
-            XFree(data);
-        }
-    }
-
-    if (!img) {
-        XWMHints *hints = XGetWMHints(server.display, win);
-        if (hints) {
-            if (hints->flags & IconPixmapHint && hints->icon_pixmap != 0) {
-                // get width, height and depth for the pixmap
-                Window root;
-                int icon_x, icon_y;
-                unsigned border_width, bpp;
-                unsigned w, h;
-
-                XGetGeometry(server.display, hints->icon_pixmap, &root, &icon_x, &icon_y, &w, &h, &border_width, &bpp);
-                imlib_context_set_drawable(hints->icon_pixmap);
-                img = imlib_create_image_from_drawable(hints->icon_mask, 0, 0, w, h, 0);
-            }
-            XFree(hints);
-        }
-    }
-
-    if (img == NULL) {
-        imlib_context_set_image(default_icon);
-        img = imlib_clone_image();
-    }
-
-    return img;
-}
-
-void task_set_icon_color(Task *task, Imlib_Image icon)
-{
-    get_image_mean_color(icon, &task->icon_color);
+    task->icon_color = *color;
     if (panel_config.mouse_effects) {
         task->icon_color_hover = task->icon_color;
         adjust_color(&task->icon_color_hover,
@@ -368,51 +305,17 @@ void task_set_icon_color(Task *task, Imlib_Image icon)
 void task_update_icon(Task *task)
 {
     Panel *panel = task->area.panel;
-    if (!panel->g_task.has_icon) {
-        if (panel_config.g_task.has_content_tint) {
-            Imlib_Image img = task_get_icon(task->win, panel->g_task.icon_size1);
-            task_set_icon_color(task, img);
-            imlib_context_set_image(img);
-            imlib_free_image();
-        }
+    if (!panel->g_task.has_icon && !panel_config.g_task.has_content_tint)
         return;
-    }
 
+    // The icon is decoded once per distinct window icon; the scaled image and the variants for each state
+    // are derived when the task is drawn
+    TaskIcon *icon = get_task_icon(task->win, panel->g_task.icon_size1);
     task_remove_icon(task);
-
-    Imlib_Image img = task_get_icon(task->win, panel->g_task.icon_size1);
-    task_set_icon_color(task, img);
-
-    // transform icons
-    imlib_context_set_image(img);
-    imlib_image_set_has_alpha(1);
-    int w = imlib_image_get_width();
-    int h = imlib_image_get_height();
-    Imlib_Image orig_image =
-        imlib_create_cropped_scaled_image(0, 0, w, h, panel->g_task.icon_size1, panel->g_task.icon_size1);
-    imlib_free_image();
-
-    imlib_context_set_image(orig_image);
-    task->icon_width = imlib_image_get_width();
-    task->icon_height = imlib_image_get_height();
-    for (int k = 0; k < TASK_STATE_COUNT; ++k) {
-        task->icon[k] = adjust_icon(orig_image,
-                                    panel->g_task.alpha[k],
-                                    panel->g_task.saturation[k],
-                                    panel->g_task.brightness[k]);
-        if (panel_config.mouse_effects) {
-            task->icon_hover[k] = adjust_icon(task->icon[k],
-                                              panel_config.mouse_over_alpha,
-                                              panel_config.mouse_over_saturation,
-                                              panel_config.mouse_over_brightness);
-            task->icon_press[k] = adjust_icon(task->icon[k],
-                                              panel_config.mouse_pressed_alpha,
-                                              panel_config.mouse_pressed_saturation,
-                                              panel_config.mouse_pressed_brightness);
-        }
-    }
-    imlib_context_set_image(orig_image);
-    imlib_free_image();
+    task->icon = icon;
+    task_set_icon_color(task, &icon->color);
+    if (panel->g_task.has_icon)
+        task_icon_get_size(icon, &task->icon_width, &task->icon_height);
 
     GPtrArray *task_buttons = get_task_buttons(task->win);
     if (task_buttons) {
@@ -423,11 +326,7 @@ void task_update_icon(Task *task)
             task2->icon_color = task->icon_color;
             task2->icon_color_hover = task->icon_color_hover;
             task2->icon_color_press = task->icon_color_press;
-            for (int k = 0; k < TASK_STATE_COUNT; ++k) {
-                task2->icon[k] = task->icon[k];
-                task2->icon_hover[k] = task->icon_hover[k];
-                task2->icon_press[k] = task->icon_press[k];
-            }
+            task2->icon = task->icon;
             schedule_redraw(&task2->area);
         }
     }
@@ -436,7 +335,7 @@ void task_update_icon(Task *task)
 // TODO icons look too large when the panel is large
 void draw_task_icon(Task *task, int text_width)
 {
-    if (!task->icon[task->current_state])
+    if (!task->icon)
         return;
 
     // Find pos
@@ -452,18 +351,10 @@ void draw_task_icon(Task *task, int text_width)
 
     // Render
 
-    Imlib_Image image;
-    // Render
-    if (panel_config.mouse_effects) {
-        if (task->area.mouse_state == MOUSE_OVER)
-            image = task->icon_hover[task->current_state];
-        else if (task->area.mouse_state == MOUSE_DOWN)
-            image = task->icon_press[task->current_state];
-        else
-            image = task->icon[task->current_state];
-    } else {
-        image = task->icon[task->current_state];
-    }
+    Imlib_Image image = task_icon_get_image(task->icon,
+                                            &panel->g_task,
+                                            task->current_state,
+                                            panel_config.mouse_effects ? task->area.mouse_state : MOUSE_NORMAL);
 
     imlib_context_set_image(image);
     task->_icon_y = (task->area.height - panel->g_task.icon_size1) / 2;
@@ -674,14 +565,22 @@ void task_refresh_thumbnail(Task *task)
     if (task->current_state == TASK_ICONIFIED)
         return;
     Panel *panel = (Panel*)task->area.panel;
+    // Without damage tracking we cannot tell whether the window changed, so it is captured every time
+    if (task->thumbnail && task->damage && !task->thumbnail_dirty)
+        return;
     double now = get_time();
     if (now - task->thumbnail_last_update < 0.1)
         return;
     if (debug_thumbnails)
         fprintf(stderr, "tint2: thumbnail for window: %s" RESET "\n", task->title ? task->title : "");
+    if (task->damage) {
+        // Changes made while capturing are reported again
+        XDamageSubtract(server.display, task->damage, None, None);
+    }
     cairo_surface_t *thumbnail = get_window_thumbnail(task->win, panel_config.g_task.thumbnail_width * panel->scale);
     if (!thumbnail)
         return;
+    task->thumbnail_dirty = FALSE;
     if (task->thumbnail)
         cairo_surface_destroy(task->thumbnail);
     task->thumbnail = thumbnail;
@@ -698,6 +597,17 @@ void task_refresh_thumbnail(Task *task)
     }
 }
 
+void task_handle_damage(Window win)
+{
+    GPtrArray *task_buttons = get_task_buttons(win);
+    if (!task_buttons)
+        return;
+    for (int i = 0; i < task_buttons->len; ++i) {
+        Task *task = g_ptr_array_index(task_buttons, i);
+        task->thumbnail_dirty = TRUE;
+    }
+}
+
 void set_task_state(Task *task, TaskState state)
 {
     if (!task || state == TASK_UNDEFINED || state >= TASK_STATE_COUNT)
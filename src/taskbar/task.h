@@ -8,6 +8,7 @@
 #define TASK_H
 
 #include <X11/Xlib.h>
+#include <X11/extensions/Xdamage.h>
 #include <pango/pangocairo.h>
 #include <Imlib2.h>
 
@@ -59,9 +60,8 @@ typedef struct Task {
     Window win;
     int desktop;
     TaskState current_state;
-    Imlib_Image icon[TASK_STATE_COUNT];
-    Imlib_Image icon_hover[TASK_STATE_COUNT];
-    Imlib_Image icon_press[TASK_STATE_COUNT];
+    // Shared with the other windows that have the same icon, see task_icon.h
+    struct TaskIcon *icon;
     unsigned int icon_width;
     unsigned int icon_height;
     Color icon_color;
@@ -83,12 +83,19 @@ typedef struct Task {
     int _icon_y;
     cairo_surface_t *thumbnail;
     double thumbnail_last_update;
+    // Reports changes to the window contents, shared between the task buttons of the window (None if not tracked)
+    Damage damage;
+    // Set when the window contents changed since the thumbnail was captured
+    gboolean thumbnail_dirty;
 } Task;
 
 extern Timer urgent_timer;
 extern GSList *urgent_list;
 
 Task *add_task(Window win);
+// Like add_task(), for a window not hidden from the taskbar and already selected for property and structure events.
+// Does not flush the connection, so that the requests for a batch of windows are sent together.
+Task *add_selected_task(Window win);
 void remove_task(Task *task);
 
 void draw_task(void *obj, cairo_t *c);
@@ -101,6 +108,8 @@ void reset_active_task();
 void set_task_state(Task *task, TaskState state);
 void task_handle_mouse_event(Task *task, MouseAction action);
 void task_refresh_thumbnail(Task *task);
+// Called when the contents of the window change (XDamageNotify).
+void task_handle_damage(Window win);
 
 // Given a pointer to the task that is currently under the mouse (current_task),
 // returns a pointer to the Task for the active window on the same taskbar.
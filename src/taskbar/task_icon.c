@@ -0,0 +1,223 @@
+/**************************************************************************
+*
+* Tint2 : task icons
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/Xutil.h>
+
+#include "common.h"
+#include "panel.h"
+#include "server.h"
+#include "task_icon.h"
+#include "window.h"
+
+// Key: content hash, value: GSList of TaskIcon* with that hash
+static GHashTable *task_icons = NULL;
+
+static guint hash_argb(const guint32 *data, int w, int h, int size)
+{
+    guint hash = 2166136261u;
+    hash = (hash ^ (guint)w) * 16777619u;
+    hash = (hash ^ (guint)h) * 16777619u;
+    hash = (hash ^ (guint)size) * 16777619u;
+    for (long i = 0; i < (long)w * h; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+static TaskIcon *find_task_icon(guint hash, const guint32 *data, int w, int h, int size)
+{
+    if (!task_icons)
+        return NULL;
+    for (GSList *l = g_hash_table_lookup(task_icons, GUINT_TO_POINTER(hash)); l; l = l->next) {
+        TaskIcon *icon = (TaskIcon *)l->data;
+        if (icon->size != size)
+            continue;
+        imlib_context_set_image(icon->source);
+        if (imlib_image_get_width() != w || imlib_image_get_height() != h)
+            continue;
+        if (memcmp(imlib_image_get_data_for_reading_only(), data, (size_t)w * h * sizeof(DATA32)) == 0)
+            return icon;
+    }
+    return NULL;
+}
+
+static Imlib_Image get_wm_hints_icon(Window win)
+{
+    Imlib_Image img = NULL;
+    XWMHints *hints = XGetWMHints(server.display, win);
+    if (hints) {
+        if (hints->flags & IconPixmapHint && hints->icon_pixmap != 0) {
+            // get width, height and depth for the pixmap
+            Window root;
+            int icon_x, icon_y;
+            unsigned border_width, bpp;
+            unsigned w, h;
+
+            XGetGeometry(server.display, hints->icon_pixmap, &root, &icon_x, &icon_y, &w, &h, &border_width, &bpp);
+            imlib_context_set_drawable(hints->icon_pixmap);
+            img = imlib_create_image_from_drawable(hints->icon_mask, 0, 0, w, h, 0);
+        }
+        XFree(hints);
+    }
+    return img;
+}
+
+TaskIcon *get_task_icon(Window win, int icon_size)
+{
+    TaskIcon *icon = NULL;
+    Imlib_Image source = NULL;
+    int w, h;
+    guint hash = 0;
+
+    guint32 *data = get_window_icon_argb(win, icon_size, &w, &h);
+    if (data) {
+        // Hash the property before decoding it, so that shared icons are decoded only once
+        hash = hash_argb(data, w, h, icon_size);
+        icon = find_task_icon(hash, data, w, h, icon_size);
+        if (!icon)
+            source = imlib_create_image_using_copied_data(w, h, (DATA32 *)data);
+        free(data);
+        if (icon) {
+            icon->refcount++;
+            return icon;
+        }
+    }
+
+    gboolean hashed = source != NULL;
+    if (!source)
+        source = get_wm_hints_icon(win);
+    if (!source) {
+        imlib_context_set_image(default_icon);
+        source = imlib_clone_image();
+    }
+
+    imlib_context_set_image(source);
+    imlib_image_set_has_alpha(1);
+    if (!hashed) {
+        w = imlib_image_get_width();
+        h = imlib_image_get_height();
+        const guint32 *source_data = (const guint32 *)imlib_image_get_data_for_reading_only();
+        hash = hash_argb(source_data, w, h, icon_size);
+        icon = find_task_icon(hash, source_data, w, h, icon_size);
+        if (icon) {
+            imlib_context_set_image(source);
+            imlib_free_image();
+            icon->refcount++;
+            return icon;
+        }
+    }
+
+    icon = (TaskIcon *)calloc(1, sizeof(TaskIcon));
+    icon->refcount = 1;
+    icon->hash = hash;
+    icon->size = icon_size;
+    icon->source = source;
+    get_image_mean_color(source, &icon->color);
+
+    if (!task_icons)
+        task_icons = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_slist_free);
+    GSList *same_hash = g_hash_table_lookup(task_icons, GUINT_TO_POINTER(hash));
+    g_hash_table_steal(task_icons, GUINT_TO_POINTER(hash));
+    g_hash_table_insert(task_icons, GUINT_TO_POINTER(hash), g_slist_prepend(same_hash, icon));
+    return icon;
+}
+
+static void free_image(Imlib_Image *image)
+{
+    if (*image) {
+        imlib_context_set_image(*image);
+        imlib_free_image();
+        *image = NULL;
+    }
+}
+
+void task_icon_unref(TaskIcon *icon)
+{
+    if (!icon || --icon->refcount > 0)
+        return;
+
+    GSList *same_hash = g_hash_table_lookup(task_icons, GUINT_TO_POINTER(icon->hash));
+    g_hash_table_steal(task_icons, GUINT_TO_POINTER(icon->hash));
+    same_hash = g_slist_remove(same_hash, icon);
+    if (same_hash)
+        g_hash_table_insert(task_icons, GUINT_TO_POINTER(icon->hash), same_hash);
+    if (g_hash_table_size(task_icons) == 0) {
+        g_hash_table_destroy(task_icons);
+        task_icons = NULL;
+    }
+
+    for (int k = 0; k < TASK_STATE_COUNT; ++k) {
+        free_image(&icon->icon[k]);
+        free_image(&icon->icon_hover[k]);
+        free_image(&icon->icon_press[k]);
+    }
+    free_image(&icon->scaled);
+    free_image(&icon->source);
+    free(icon);
+}
+
+static Imlib_Image task_icon_get_scaled(TaskIcon *icon)
+{
+    if (!icon->scaled) {
+        imlib_context_set_image(icon->source);
+        icon->scaled = imlib_create_cropped_scaled_image(0,
+                                                         0,
+                                                         imlib_image_get_width(),
+                                                         imlib_image_get_height(),
+                                                         icon->size,
+                                                         icon->size);
+    }
+    return icon->scaled;
+}
+
+void task_icon_get_size(TaskIcon *icon, unsigned int *width, unsigned int *height)
+{
+    imlib_context_set_image(task_icon_get_scaled(icon));
+    *width = imlib_image_get_width();
+    *height = imlib_image_get_height();
+}
+
+Imlib_Image task_icon_get_image(TaskIcon *icon, const GlobalTask *g_task, TaskState state, MouseState mouse_state)
+{
+    // All panels derive g_task from the same configuration, so the variants can be shared between panels
+    if (!icon->icon[state])
+        icon->icon[state] = adjust_icon(task_icon_get_scaled(icon),
+                                        g_task->alpha[state],
+                                        g_task->saturation[state],
+                                        g_task->brightness[state]);
+    if (mouse_state == MOUSE_OVER) {
+        if (!icon->icon_hover[state])
+            icon->icon_hover[state] = adjust_icon(icon->icon[state],
+                                                  panel_config.mouse_over_alpha,
+                                                  panel_config.mouse_over_saturation,
+                                                  panel_config.mouse_over_brightness);
+        return icon->icon_hover[state];
+    }
+    if (mouse_state == MOUSE_DOWN) {
+        if (!icon->icon_press[state])
+            icon->icon_press[state] = adjust_icon(icon->icon[state],
+                                                  panel_config.mouse_pressed_alpha,
+                                                  panel_config.mouse_pressed_saturation,
+                                                  panel_config.mouse_pressed_brightness);
+        return icon->icon_press[state];
+    }
+    return icon->icon[state];
+}
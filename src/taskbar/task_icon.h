@@ -0,0 +1,43 @@
+#ifndef TASK_ICON_H
+#define TASK_ICON_H
+
+#include <glib.h>
+#include <X11/Xlib.h>
+#include <Imlib2.h>
+
+#include "area.h"
+#include "color.h"
+#include "task.h"
+
+// Window icons shared between tasks.
+// Icons are looked up by the content of the window icon, so all the windows of an application that publish
+// the same _NET_WM_ICON share a single decoded image and the variants derived from it.
+typedef struct TaskIcon {
+    int refcount;
+    guint hash;
+    int size;
+    // The decoded window icon, used to tell apart different icons with the same hash
+    Imlib_Image source;
+    // Mean color of the icon
+    Color color;
+    // The icon scaled to size, and the variants for each task state and mouse state.
+    // All of them are computed on first use.
+    Imlib_Image scaled;
+    Imlib_Image icon[TASK_STATE_COUNT];
+    Imlib_Image icon_hover[TASK_STATE_COUNT];
+    Imlib_Image icon_press[TASK_STATE_COUNT];
+} TaskIcon;
+
+// Returns a new reference to the icon of the window, to be displayed at icon_size.
+// Falls back to the WM_HINTS icon pixmap, then to the default icon.
+TaskIcon *get_task_icon(Window win, int icon_size);
+
+void task_icon_unref(TaskIcon *icon);
+
+// Returns the image to draw for a task state and mouse state, with the settings of g_task. It is owned by the icon.
+Imlib_Image task_icon_get_image(TaskIcon *icon, const GlobalTask *g_task, TaskState state, MouseState mouse_state);
+
+// Returns the dimensions of the scaled icon.
+void task_icon_get_size(TaskIcon *icon, unsigned int *width, unsigned int *height);
+
+#endif
@@ -30,6 +30,7 @@
 #include "taskbar.h"
 #include "server.h"
 #include "window.h"
+#include "async_property.h"
 #include "panel.h"
 #include "strnatcmp.h"
 #include "tooltip.h"
@@ -52,7 +53,13 @@ static Timer thumbnail_update_timer_active;
 static Timer thumbnail_update_timer_tooltip;
 
 static GList *taskbar_task_orderings = NULL;
-static GList *taskbar_thumbnail_jobs_done = NULL;
+// Set of the Task* already refreshed during the current THUMB_MODE_ALL pass
+static GHashTable *taskbar_thumbnail_jobs_done = NULL;
+// The _NET_CLIENT_LIST seen by the last taskbar_refresh_tasklist()
+static Window *client_list_snapshot = NULL;
+static int client_list_snapshot_len = 0;
+// Nesting depth of taskbar_begin_update()
+static int taskbar_update_depth = 0;
 
 void taskbar_init_fonts();
 int taskbar_compute_desired_size(void *obj);
@@ -60,6 +67,12 @@ int taskbar_compute_desired_size(void *obj);
 // Removes the task with &win = key. The other args are ignored.
 void taskbar_remove_task(Window *win);
 
+void taskbar_forget_thumbnail_job(Task *task)
+{
+    if (taskbar_thumbnail_jobs_done)
+        g_hash_table_remove(taskbar_thumbnail_jobs_done, task);
+}
+
 void taskbar_update_thumbnails(void *arg);
 
 guint win_hash(gconstpointer key)
@@ -133,8 +146,13 @@ void cleanup_taskbar()
     destroy_timer(&thumbnail_update_timer_all);
     destroy_timer(&thumbnail_update_timer_active);
     destroy_timer(&thumbnail_update_timer_tooltip);
-    g_list_free(taskbar_thumbnail_jobs_done);
+    if (taskbar_thumbnail_jobs_done)
+        g_hash_table_destroy(taskbar_thumbnail_jobs_done);
+    taskbar_thumbnail_jobs_done = NULL;
     taskbar_save_orderings();
+    free(client_list_snapshot);
+    client_list_snapshot = NULL;
+    client_list_snapshot_len = 0;
     if (win_to_task) {
         while (g_hash_table_size(win_to_task)) {
             GHashTableIter iter;
@@ -503,6 +521,29 @@ void sort_win_list(Window *windows, int count)
     sort_windows = NULL;
 }
 
+void taskbar_begin_update()
+{
+    taskbar_update_depth++;
+}
+
+void taskbar_end_update()
+{
+    if (taskbar_update_depth <= 0 || --taskbar_update_depth > 0)
+        return;
+    for (int i = 0; i < num_panels; i++) {
+        Panel *panel = &panels[i];
+        for (int j = 0; j < panel->num_desktops; j++)
+            sort_tasks(&panel->taskbar[j]);
+    }
+    if (hide_taskbar_if_empty)
+        update_all_taskbars_visibility();
+}
+
+gboolean taskbar_is_updating()
+{
+    return taskbar_update_depth > 0;
+}
+
 void taskbar_refresh_tasklist()
 {
     if (!taskbar_enabled)
@@ -510,31 +551,63 @@ void taskbar_refresh_tasklist()
 
     int num_results;
     Window *win = server_get_property(server.root_win, server.atom._NET_CLIENT_LIST, XA_WINDOW, &num_results);
-    Window *sorted = (Window *)calloc(num_results, sizeof(Window));
+    if (!win)
+        return;
+
+    // Skip the work if the client list did not change (window managers often republish it as is)
+    if (!taskbar_task_orderings && client_list_snapshot && num_results == client_list_snapshot_len &&
+        memcmp(win, client_list_snapshot, num_results * sizeof(Window)) == 0) {
+        XFree(win);
+        return;
+    }
+    free(client_list_snapshot);
+    client_list_snapshot = (Window *)calloc(MAX(num_results, 1), sizeof(Window));
+    memcpy(client_list_snapshot, win, num_results * sizeof(Window));
+    client_list_snapshot_len = num_results;
+
+    Window *sorted = (Window *)calloc(MAX(num_results, 1), sizeof(Window));
     memcpy(sorted, win, num_results * sizeof(Window));
     if (taskbar_task_orderings) {
         sort_win_list(sorted, num_results);
         taskbar_clear_orderings();
     }
-    if (!win)
-        return;
 
+    GHashTable *listed = g_hash_table_new(win_hash, win_compare);
+    for (int i = 0; i < num_results; i++)
+        g_hash_table_insert(listed, &sorted[i], &sorted[i]);
+
+    // Sort the taskbars and update their visibility once, after all the changes
+    taskbar_begin_update();
+
+    // Remove the tasks of the windows that are gone
     GList *win_list = g_hash_table_get_keys(win_to_task);
     for (GList *it = win_list; it; it = it->next) {
-        int i;
-        for (i = 0; i < num_results; i++)
-            if (*((Window *)it->data) == sorted[i])
-                break;
-        if (i == num_results)
+        if (!g_hash_table_lookup(listed, it->data))
             taskbar_remove_task(it->data);
     }
     g_list_free(win_list);
 
-    // Add any new
-    for (int i = 0; i < num_results; i++)
+    // Add any new, sending the queries for all of them at once
+    Window *added = (Window *)calloc(MAX(num_results, 1), sizeof(Window));
+    int num_added = 0;
+    for (int i = 0; i < num_results; i++) {
         if (!get_task(sorted[i]))
-            add_task(sorted[i]);
+            added[num_added++] = sorted[i];
+    }
+    prefetch_windows(added, num_added);
+    for (int i = 0; i < num_added; i++) {
+        // Only the windows that become tasks are selected for events, as add_task() does
+        if (window_is_hidden(added[i]))
+            continue;
+        XSelectInput(server.display, added[i], PropertyChangeMask | StructureNotifyMask);
+        add_selected_task(added[i]);
+    }
+    discard_prefetched_replies();
+    free(added);
+
+    taskbar_end_update();
 
+    g_hash_table_destroy(listed);
     XFree(win);
     free(sorted);
 }
@@ -836,6 +909,8 @@ void taskbar_update_thumbnails(void *arg)
     if (debug_thumbnails)
         fprintf(stderr, BLUE "tint2: taskbar_update_thumbnails %s" RESET "\n", mode == THUMB_MODE_ACTIVE_WINDOW ? "active" : mode == THUMB_MODE_TOOLTIP_WINDOW ? "tooltip" : "all");
     double start_time = get_time();
+    if (mode == THUMB_MODE_ALL && !taskbar_thumbnail_jobs_done)
+        taskbar_thumbnail_jobs_done = g_hash_table_new(g_direct_hash, g_direct_equal);
     for (int i = 0; i < num_panels; i++) {
         Panel *panel = &panels[i];
         for (int j = 0; j < panel->num_desktops; j++) {
@@ -845,12 +920,12 @@ void taskbar_update_thumbnails(void *arg)
                  c;
                  c = c->next) {
                 Task *t = (Task *)c->data;
-                if ((mode == THUMB_MODE_ALL && t->current_state == TASK_ACTIVE && !g_list_find(taskbar_thumbnail_jobs_done, t)) ||
+                if ((mode == THUMB_MODE_ALL && t->current_state == TASK_ACTIVE && !g_hash_table_contains(taskbar_thumbnail_jobs_done, t)) ||
                     (mode == THUMB_MODE_ACTIVE_WINDOW && t->current_state == TASK_ACTIVE) ||
                     (mode == THUMB_MODE_TOOLTIP_WINDOW && g_tooltip.mapped && g_tooltip.area == &t->area)) {
                     task_refresh_thumbnail(t);
                     if (mode == THUMB_MODE_ALL)
-                        taskbar_thumbnail_jobs_done = g_list_append(taskbar_thumbnail_jobs_done, t);
+                        g_hash_table_add(taskbar_thumbnail_jobs_done, t);
                     if (t->thumbnail && mode == THUMB_MODE_TOOLTIP_WINDOW) {
                         taskbar_start_thumbnail_timer(THUMB_MODE_TOOLTIP_WINDOW);
                     }
@@ -866,9 +941,8 @@ void taskbar_update_thumbnails(void *arg)
         }
     }
     if (mode == THUMB_MODE_ALL) {
-        if (taskbar_thumbnail_jobs_done) {
-            g_list_free(taskbar_thumbnail_jobs_done);
-            taskbar_thumbnail_jobs_done = NULL;
+        if (g_hash_table_size(taskbar_thumbnail_jobs_done)) {
+            g_hash_table_remove_all(taskbar_thumbnail_jobs_done);
             change_timer(&thumbnail_update_timer_all, true, 10 * 1000, 10 * 1000, taskbar_update_thumbnails, arg);
         }
     }
@@ -80,10 +80,18 @@ void init_taskbar_panel(void *p);
 gboolean resize_taskbar(void *obj);
 void taskbar_default_font_changed();
 void taskbar_start_thumbnail_timer(ThumbnailUpdateMode mode);
+// Must be called when a task is removed, so that the pending thumbnail pass does not track it anymore.
+void taskbar_forget_thumbnail_job(Task *task);
 
 // Reloads the entire list of tasks from the window manager and recreates the task buttons.
 void taskbar_refresh_tasklist();
 
+// Between these calls, add_task() and remove_task() do not sort the taskbars nor update their visibility;
+// taskbar_end_update() does it once for all the changes. Calls can be nested.
+void taskbar_begin_update();
+void taskbar_end_update();
+gboolean taskbar_is_updating();
+
 // Returns the task button for this window. If there are multiple buttons, returns the first one.
 Task *get_task(Window win);
 
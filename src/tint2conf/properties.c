@@ -4391,6 +4391,23 @@ void create_execp(GtkWidget *notebook, int i)
                            "displayed after it finishes executing."),
                          NULL);
     row++, col = 2;
+    label = gtk_label_new(_("Coprocess"));
+    gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+    gtk_widget_show(label);
+    gtk_table_attach(GTK_TABLE(table), label, col, col + 1, row, row + 1, GTK_FILL, 0, 0, 0);
+    col++;
+
+    executor->execp_coprocess = gtk_check_button_new();
+    gtk_widget_show(executor->execp_coprocess);
+    gtk_table_attach(GTK_TABLE(table), executor->execp_coprocess, col, col + 1, row, row + 1, GTK_FILL, 0, 0, 0);
+    col++;
+    gtk_tooltips_set_tip(tooltips,
+                         executor->execp_coprocess,
+                         _("If enabled, the command is started only once and kept running. At each update, "
+                           "a line is written to its standard input, and the command must answer by printing "
+                           "its output followed by an empty line. If the command exits, it is restarted."),
+                         NULL);
+    row++, col = 2;
     label = gtk_label_new(_("Display markup"));
     gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
     gtk_widget_show(label);
@@ -868,6 +868,9 @@ void config_write_execp(FILE *fp)
         fprintf(fp,
                 "execp_continuous = %d\n",
                 (int)gtk_spin_button_get_value(GTK_SPIN_BUTTON(executor->execp_continuous)));
+        fprintf(fp,
+                "execp_coprocess = %d\n",
+                gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(executor->execp_coprocess)) ? 1 : 0);
         fprintf(fp,
                 "execp_markup = %d\n",
                 gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(executor->execp_markup)) ? 1 : 0);
@@ -1960,6 +1963,8 @@ void add_entry(char *key, char *value)
         gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(execp_get_last()->execp_cache_icon), atoi(value));
     } else if (strcmp(key, "execp_continuous") == 0) {
         gtk_spin_button_set_value(GTK_SPIN_BUTTON(execp_get_last()->execp_continuous), atoi(value));
+    } else if (strcmp(key, "execp_coprocess") == 0) {
+        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(execp_get_last()->execp_coprocess), atoi(value));
     } else if (strcmp(key, "execp_markup") == 0) {
         gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(execp_get_last()->execp_markup), atoi(value));
     } else if (strcmp(key, "execp_tooltip") == 0) {
@@ -32,6 +32,7 @@
 #include "server.h"
 #include "panel.h"
 #include "common.h"
+#include "pixmap_pool.h"
 
 Area *mouse_over_area = NULL;
 
@@ -346,14 +347,15 @@ void schedule_redraw(Area *a)
     a->_redraw_needed = TRUE;
 
     if (a->has_mouse_over_effect) {
+        // The cached pixmaps go back to the pool, draw() gets them again since the size has not changed
         for (int i = 0; i < MOUSE_STATE_COUNT; i++) {
-            XFreePixmap(server.display, a->pix_by_state[i]);
+            pixmap_pool_release(a->pix_by_state[i]);
             if (a->pix == a->pix_by_state[i])
                 a->pix = None;
             a->pix_by_state[i] = None;
         }
         if (a->pix) {
-            XFreePixmap(server.display, a->pix);
+            pixmap_pool_release(a->pix);
             a->pix = None;
         }
     }
@@ -363,29 +365,79 @@ void schedule_redraw(Area *a)
     schedule_panel_redraw();
 }
 
+gboolean area_moved_since_composited(Area *a)
+{
+    return a->_composited_geometry.x != a->posx || a->_composited_geometry.y != a->posy ||
+           a->_composited_geometry.width != a->width || a->_composited_geometry.height != a->height;
+}
+
+void collect_damage(Area *a)
+{
+    Panel *panel = (Panel *)a->panel;
+
+    if (!a->on_screen) {
+        if (a->_composited) {
+            // Hidden since the last frame: whatever is below it must show through
+            add_panel_damage(panel,
+                             a->_composited_geometry.x,
+                             a->_composited_geometry.y,
+                             a->_composited_geometry.width,
+                             a->_composited_geometry.height);
+            a->_composited = FALSE;
+        }
+        return;
+    }
+
+    gboolean moved = !a->_composited || area_moved_since_composited(a);
+    if (a->_composited && moved)
+        add_panel_damage(panel,
+                         a->_composited_geometry.x,
+                         a->_composited_geometry.y,
+                         a->_composited_geometry.width,
+                         a->_composited_geometry.height);
+    if (a->_redraw_needed || moved)
+        add_panel_damage(panel, a->posx, a->posy, a->width, a->height);
+
+    for (GList *l = a->children; l; l = l->next)
+        collect_damage((Area *)l->data);
+}
+
 void draw_tree(Area *a)
 {
     if (!a->on_screen)
         return;
 
+    Panel *panel = (Panel *)a->panel;
+
     if (a->_redraw_needed) {
         a->_redraw_needed = FALSE;
         draw(a);
     }
 
-    if (a->pix)
-        XCopyArea(server.display,
-                  a->pix,
-                  ((Panel *)a->panel)->temp_pmap,
-                  server.gc,
-                  0,
-                  0,
-                  a->width,
-                  a->height,
-                  a->posx,
-                  a->posy);
-    else
-        fprintf(stderr, RED "tint2: %s %d: area %s has no pixmap!!!" RESET "\n", __FILE__, __LINE__, a->name);
+    if (XRectInRegion(panel->damage, a->posx, a->posy, a->width, a->height) != RectangleOut) {
+        if (a->pix) {
+            // composite_gc is clipped to the damage region, so only the damaged pixels are copied
+            XCopyArea(server.display,
+                      a->pix,
+                      panel->temp_pmap,
+                      panel->composite_gc,
+                      0,
+                      0,
+                      a->width,
+                      a->height,
+                      a->posx,
+                      a->posy);
+            if (debug_fps)
+                count_panel_bytes_copied(panel, a->posx, a->posy, a->width, a->height);
+        } else {
+            fprintf(stderr, RED "tint2: %s %d: area %s has no pixmap!!!" RESET "\n", __FILE__, __LINE__, a->name);
+        }
+    }
+    a->_composited = TRUE;
+    a->_composited_geometry.x = a->posx;
+    a->_composited_geometry.y = a->posy;
+    a->_composited_geometry.width = a->width;
+    a->_composited_geometry.height = a->height;
 
     for (GList *l = a->children; l; l = l->next)
         draw_tree((Area *)l->data);
@@ -398,6 +450,7 @@ void hide(Area *a)
     if (!a->on_screen)
         return;
     a->on_screen = FALSE;
+    invalidate_hit_index(a);
     if (parent)
         parent->resize_needed = TRUE;
     if (panel_horizontal)
@@ -413,6 +466,7 @@ void show(Area *a)
     if (a->on_screen)
         return;
     a->on_screen = TRUE;
+    invalidate_hit_index(a);
     if (parent)
         parent->resize_needed = TRUE;
     a->resize_needed = TRUE;
@@ -437,28 +491,29 @@ void update_dependent_gradients(Area *a)
 
 void draw(Area *a)
 {
+    int state = a->has_mouse_over_effect ? a->mouse_state : 0;
+
     if (a->_changed) {
-        // On resize/move, invalidate cached pixmaps
+        // On resize/move, invalidate cached pixmaps (except the current one, which is recycled below)
         for (int i = 0; i < MOUSE_STATE_COUNT; i++) {
-            XFreePixmap(server.display, a->pix_by_state[i]);
-            if (a->pix == a->pix_by_state[i]) {
-                a->pix = None;
-            }
+            if (a->pix_by_state[i] != a->pix)
+                pixmap_pool_release(a->pix_by_state[i]);
             a->pix_by_state[i] = None;
         }
-        if (a->pix) {
-            XFreePixmap(server.display, a->pix);
-            a->pix = None;
-        }
     }
 
-    if (a->pix) {
-        XFreePixmap(server.display, a->pix);
-        if (a->pix_by_state[a->has_mouse_over_effect ? a->mouse_state : 0] != a->pix)
-            XFreePixmap(server.display, a->pix_by_state[a->has_mouse_over_effect ? a->mouse_state : 0]);
+    if (a->pix_by_state[state] != a->pix) {
+        pixmap_pool_release(a->pix_by_state[state]);
+        a->pix_by_state[state] = None;
+    }
+    // Never recycle a pixmap that is still cached for another mouse state
+    for (int i = 0; i < MOUSE_STATE_COUNT; i++) {
+        if (i != state && a->pix && a->pix_by_state[i] == a->pix)
+            a->pix = None;
     }
-    a->pix = XCreatePixmap(server.display, server.root_win, a->width, a->height, server.depth);
-    a->pix_by_state[a->has_mouse_over_effect ? a->mouse_state : 0] = a->pix;
+    // Reuses the current pixmap if the size has not changed
+    a->pix = pixmap_pool_recycle(a->pix, a->width, a->height, server.depth);
+    a->pix_by_state[state] = a->pix;
 
     if (!a->_clear) {
         // Add layer of root pixmap (or clear pixmap if real_transparency==true)
@@ -601,11 +656,13 @@ void remove_area(Area *a)
     if (mouse_over_area == a) {
         mouse_out();
     }
+    invalidate_hit_index(a);
 }
 
 void add_area(Area *a, Area *parent)
 {
     g_assert_null(a->parent);
+    invalidate_hit_index(parent ? parent : a);
 
     a->parent = parent;
     if (parent) {
@@ -620,6 +677,8 @@ void free_area(Area *a)
     if (!a)
         return;
 
+    invalidate_hit_index(a);
+
     for (GList *l = a->children; l; l = l->next)
         free_area(l->data);
 
@@ -628,14 +687,14 @@ void free_area(Area *a)
         a->children = NULL;
     }
     for (int i = 0; i < MOUSE_STATE_COUNT; i++) {
-        XFreePixmap(server.display, a->pix_by_state[i]);
+        pixmap_pool_release(a->pix_by_state[i]);
         if (a->pix == a->pix_by_state[i]) {
             a->pix = None;
         }
         a->pix_by_state[i] = None;
     }
     if (a->pix) {
-        XFreePixmap(server.display, a->pix);
+        pixmap_pool_release(a->pix);
         a->pix = None;
     }
     if (mouse_over_area == a) {
@@ -670,6 +729,11 @@ void mouse_over(Area *area, gboolean pressed)
     mouse_over_area->pix = mouse_over_area->pix_by_state[mouse_over_area->mouse_state];
     if (!mouse_over_area->pix)
         mouse_over_area->_redraw_needed = TRUE;
+    add_panel_damage(mouse_over_area->panel,
+                     mouse_over_area->posx,
+                     mouse_over_area->posy,
+                     mouse_over_area->width,
+                     mouse_over_area->height);
     schedule_panel_redraw();
 }
 
@@ -681,6 +745,11 @@ void mouse_out()
     mouse_over_area->pix = mouse_over_area->pix_by_state[mouse_over_area->mouse_state];
     if (!mouse_over_area->pix)
         mouse_over_area->_redraw_needed = TRUE;
+    add_panel_damage(mouse_over_area->panel,
+                     mouse_over_area->posx,
+                     mouse_over_area->posy,
+                     mouse_over_area->width,
+                     mouse_over_area->height);
     schedule_panel_redraw();
     mouse_over_area = NULL;
 }
@@ -771,22 +840,119 @@ gboolean full_width_area_is_under_mouse(void *obj, int x, int y)
         return (y >= a->posy) && (y <= a->posy + a->height);
 }
 
+void invalidate_hit_index(Area *a)
+{
+    Panel *panel = (Panel *)a->panel;
+    if (!panel || !panel->hit_index)
+        return;
+    g_array_free(panel->hit_index, TRUE);
+    panel->hit_index = NULL;
+}
+
+static int compare_hit_index_entries(const void *a, const void *b)
+{
+    const HitIndexEntry *ea = (const HitIndexEntry *)a;
+    const HitIndexEntry *eb = (const HitIndexEntry *)b;
+    if (ea->start != eb->start)
+        return ea->start < eb->start ? -1 : 1;
+    return ea->order - eb->order;
+}
+
+static void add_to_hit_index(GArray *index, Area *a)
+{
+    // The binary search relies on the children being hit only within their extent along the panel,
+    // which holds for the default hit test and for full_width_area_is_under_mouse.
+    gboolean indexable = TRUE;
+    for (GList *l = a->children; l; l = l->next) {
+        Area *child = (Area *)l->data;
+        if (child->_is_under_mouse && child->_is_under_mouse != full_width_area_is_under_mouse)
+            indexable = FALSE;
+    }
+
+    a->_hit_index_first = index->len;
+    a->_hit_index_count = indexable ? 0 : -1;
+    if (indexable) {
+        int order = 0;
+        for (GList *l = a->children; l; l = l->next, order++) {
+            Area *child = (Area *)l->data;
+            if (!child->on_screen)
+                continue;
+            HitIndexEntry entry;
+            entry.area = child;
+            entry.start = panel_horizontal ? child->posx : child->posy;
+            entry.end = entry.start + (panel_horizontal ? child->width : child->height);
+            entry.order = order;
+            g_array_append_val(index, entry);
+            a->_hit_index_count++;
+        }
+        HitIndexEntry *entries = &g_array_index(index, HitIndexEntry, a->_hit_index_first);
+        qsort(entries, (size_t)a->_hit_index_count, sizeof(HitIndexEntry), compare_hit_index_entries);
+        for (int i = 0; i < a->_hit_index_count; i++)
+            entries[i].reach = i > 0 ? MAX(entries[i - 1].reach, entries[i].end) : entries[i].end;
+    }
+
+    for (GList *l = a->children; l; l = l->next) {
+        Area *child = (Area *)l->data;
+        if (child->on_screen)
+            add_to_hit_index(index, child);
+    }
+}
+
+void rebuild_hit_index(Area *panel_area)
+{
+    Panel *panel = (Panel *)panel_area;
+    if (panel->hit_index)
+        g_array_set_size(panel->hit_index, 0);
+    else
+        panel->hit_index = g_array_new(FALSE, FALSE, sizeof(HitIndexEntry));
+    add_to_hit_index(panel->hit_index, panel_area);
+}
+
+// Returns the first child (in the order of the list of children) under the mouse, or NULL.
+static Area *find_child_under_mouse(Area *a, GArray *index, int x, int y)
+{
+    if (!index || a->_hit_index_count < 0) {
+        for (GList *l = a->children; l; l = l->next) {
+            Area *child = (Area *)l->data;
+            if (area_is_under_mouse(child, x, y))
+                return child;
+        }
+        return NULL;
+    }
+
+    HitIndexEntry *entries = &g_array_index(index, HitIndexEntry, a->_hit_index_first);
+    int coord = panel_horizontal ? x : y;
+    // Find the first entry that starts after the mouse
+    int low = 0, high = a->_hit_index_count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (entries[middle].start <= coord)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    // Check the entries before it, until none of the remaining ones reaches the mouse
+    Area *result = NULL;
+    int result_order = 0;
+    for (int i = low - 1; i >= 0 && entries[i].reach >= coord; i--) {
+        if (entries[i].end < coord || (result && entries[i].order > result_order))
+            continue;
+        if (area_is_under_mouse(entries[i].area, x, y)) {
+            result = entries[i].area;
+            result_order = entries[i].order;
+        }
+    }
+    return result;
+}
+
 Area *find_area_under_mouse(void *root, int x, int y)
 {
     Area *result = root;
-    Area *new_result = result;
-    do {
-        result = new_result;
-        GList *it = result->children;
-        while (it) {
-            Area *a = (Area *)it->data;
-            if (area_is_under_mouse(a, x, y)) {
-                new_result = a;
-                break;
-            }
-            it = it->next;
-        }
-    } while (new_result != result);
+    Panel *panel = (Panel *)result->panel;
+    GArray *index = panel ? panel->hit_index : NULL;
+    for (Area *child = find_child_under_mouse(result, index, x, y); child;
+         child = find_child_under_mouse(result, index, x, y))
+        result = child;
     return result;
 }
 
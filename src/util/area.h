@@ -49,6 +49,12 @@
 // Redrawing an object (like the clock) could come from an 'external event' (date change)
 // or from a 'layout event' (position change).
 //
+// Each Area is drawn on its own pixmap, which is then composited onto the panel back buffer (Panel::temp_pmap).
+// The back buffer is kept across frames: only the damaged region of the panel is recomposited and copied to the
+// window. Redrawn, moved, resized and hidden Areas damage their rectangles automatically (see collect_damage());
+// code that changes what is shown on screen without a redraw (e.g. by swapping or rendering directly to an Area
+// pixmap) must call add_panel_damage().
+//
 //
 // WIDGET LIFECYCLE
 //
@@ -210,6 +216,14 @@ typedef struct Area {
     // This is the pixmap on which the Area is rendered. Render to it directly if needed.
     Pixmap pix;
     Pixmap pix_by_state[MOUSE_STATE_COUNT];
+    // Set to non-zero once the Area has been composited onto the panel back buffer.
+    // _composited_geometry is the position and size it had at that time; used for damage tracking.
+    gboolean _composited;
+    XRectangle _composited_geometry;
+    // The children of this Area in the hit-test index of the panel: _hit_index_count entries from _hit_index_first.
+    // Set to -1 if the children cannot be indexed. Only meaningful while the index of the panel is valid.
+    int _hit_index_first;
+    int _hit_index_count;
     char name[32];
 
     // Callbacks
@@ -325,8 +339,13 @@ void draw(Area *a);
 // Draws the background of the Area
 void draw_background(Area *a, cairo_t *c);
 
-// Explores the entire Area subtree (only if the on_screen flag set)
-// and draws the areas with the redraw_needed flag set
+// Explores the entire Area subtree and adds to the panel damage region the areas that have to be recomposited:
+// areas with the redraw_needed flag set, areas that moved or changed size and areas that have been hidden
+void collect_damage(Area *a);
+
+// Explores the entire Area subtree (only if the on_screen flag set),
+// draws the areas with the redraw_needed flag set and composites onto the panel back buffer
+// the areas that intersect the panel damage region
 void draw_tree(Area *a);
 
 // Clears the on_screen flag, sets the size to zero and triggers a parent resize
@@ -343,8 +362,27 @@ void free_area(Area *a);
 
 // Mouse events
 
+// Entry of the hit-test index of a panel. The children of each Area occupy a slice of the index,
+// sorted by their position along the panel.
+typedef struct HitIndexEntry {
+    Area *area;
+    // Extent along the panel (x for horizontal panels, y for vertical panels), inclusive
+    int start, end;
+    // Largest end of this entry and of the entries before it in the slice
+    int reach;
+    // Position in the list of children of the parent
+    int order;
+} HitIndexEntry;
+
+// Rebuilds the hit-test index of the panel. Must be called after the layout of the panel has been computed.
+void rebuild_hit_index(Area *panel_area);
+
+// Discards the hit-test index of the panel containing the Area, e.g. because Areas are being added or removed.
+// Until the index is rebuilt, the Area tree is explored without it.
+void invalidate_hit_index(Area *a);
+
 // Returns the area under the mouse for the given x, y mouse coordinates relative to the window.
-// If no area is found, returns the root.
+// If no area is found, returns the root. Uses the hit-test index of the panel if it is valid.
 Area *find_area_under_mouse(void *root, int x, int y);
 
 // Returns true if the Area handles a mouse event at the given x, y coordinates relative to the window.
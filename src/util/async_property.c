@@ -0,0 +1,305 @@
+/**************************************************************************
+*
+* Tint2 : asynchronous X requests
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "async_property.h"
+#include "server.h"
+
+typedef enum PrefetchKind {
+    PREFETCH_PROPERTY = 0,
+    PREFETCH_GEOMETRY,
+} PrefetchKind;
+
+typedef struct PrefetchKey {
+    Window win;
+    // None for PREFETCH_GEOMETRY
+    Atom atom;
+} PrefetchKey;
+
+typedef struct PrefetchedReply {
+    PrefetchKey key;
+    PrefetchKind kind;
+    gboolean received;
+    // PREFETCH_PROPERTY: GetProperty; PREFETCH_GEOMETRY: TranslateCoordinates and GetGeometry
+    unsigned int sequence;
+    unsigned int sequence2;
+    // Property request and value
+    Atom type;
+    long offset;
+    long length;
+    void *value;
+    size_t value_size;
+    int num_items;
+    unsigned long bytes_after;
+    // Geometry
+    gboolean has_position;
+    gboolean ok;
+    int x, y, w, h;
+} PrefetchedReply;
+
+// Key: PrefetchKey* (pointing inside the reply), value: PrefetchedReply* (owned)
+static GHashTable *prefetched_replies = NULL;
+
+static xcb_connection_t *get_connection()
+{
+    return XGetXCBConnection(server.display);
+}
+
+PropertyCookie request_property(Window win, Atom at, Atom type, long offset, long length)
+{
+    xcb_get_property_cookie_t cookie =
+        xcb_get_property(get_connection(), 0, (xcb_window_t)win, (xcb_atom_t)at, (xcb_atom_t)type, offset, length);
+    return cookie.sequence;
+}
+
+// Converts the reply to the layout of XGetWindowProperty: format 32 items are (sign extended) longs,
+// and a null byte is appended
+static void *convert_property_reply(xcb_get_property_reply_t *reply,
+                                    Atom type,
+                                    int *num_items,
+                                    unsigned long *bytes_after,
+                                    size_t *size)
+{
+    if (num_items)
+        *num_items = 0;
+    if (bytes_after)
+        *bytes_after = 0;
+    if (size)
+        *size = 0;
+    if (!reply || reply->type == XCB_NONE || (type != AnyPropertyType && reply->type != type))
+        return NULL;
+
+    int n = xcb_get_property_value_length(reply);
+    const void *data = xcb_get_property_value(reply);
+    size_t item_size;
+    switch (reply->format) {
+    case 8:
+        item_size = 1;
+        break;
+    case 16:
+        item_size = sizeof(short);
+        n /= 2;
+        break;
+    case 32:
+        item_size = sizeof(long);
+        n /= 4;
+        break;
+    default:
+        return NULL;
+    }
+
+    char *value = (char *)calloc(1, n * item_size + 1);
+    if (reply->format == 8) {
+        memcpy(value, data, n);
+    } else if (reply->format == 16) {
+        short *items = (short *)value;
+        for (int i = 0; i < n; i++)
+            items[i] = ((const int16_t *)data)[i];
+    } else {
+        long *items = (long *)value;
+        for (int i = 0; i < n; i++)
+            items[i] = ((const int32_t *)data)[i];
+    }
+    if (num_items)
+        *num_items = n;
+    if (bytes_after)
+        *bytes_after = reply->bytes_after;
+    if (size)
+        *size = n * item_size + 1;
+    return value;
+}
+
+static void *receive_property_reply(PropertyCookie cookie,
+                                    Atom type,
+                                    int *num_items,
+                                    unsigned long *bytes_after,
+                                    size_t *size)
+{
+    xcb_get_property_cookie_t c = {cookie};
+    xcb_generic_error_t *error = NULL;
+    xcb_get_property_reply_t *reply = xcb_get_property_reply(get_connection(), c, &error);
+    free(error);
+    void *value = convert_property_reply(reply, type, num_items, bytes_after, size);
+    free(reply);
+    return value;
+}
+
+void *get_property_reply(PropertyCookie cookie, Atom type, int *num_items, unsigned long *bytes_after)
+{
+    return receive_property_reply(cookie, type, num_items, bytes_after, NULL);
+}
+
+static guint prefetch_key_hash(gconstpointer key)
+{
+    const PrefetchKey *k = (const PrefetchKey *)key;
+    return (guint)(k->win * 2654435761u) ^ (guint)k->atom;
+}
+
+static gboolean prefetch_key_equal(gconstpointer a, gconstpointer b)
+{
+    const PrefetchKey *ka = (const PrefetchKey *)a;
+    const PrefetchKey *kb = (const PrefetchKey *)b;
+    return ka->win == kb->win && ka->atom == kb->atom;
+}
+
+static void free_prefetched_reply(gpointer data)
+{
+    PrefetchedReply *reply = (PrefetchedReply *)data;
+    if (!reply->received) {
+        xcb_discard_reply(get_connection(), reply->sequence);
+        if (reply->kind == PREFETCH_GEOMETRY)
+            xcb_discard_reply(get_connection(), reply->sequence2);
+    }
+    free(reply->value);
+    free(reply);
+}
+
+static PrefetchedReply *new_prefetched_reply(Window win, Atom atom, PrefetchKind kind)
+{
+    if (!prefetched_replies)
+        prefetched_replies =
+            g_hash_table_new_full(prefetch_key_hash, prefetch_key_equal, NULL, free_prefetched_reply);
+    PrefetchKey key = {win, atom};
+    // A newer request replaces the previous one
+    g_hash_table_remove(prefetched_replies, &key);
+    PrefetchedReply *reply = (PrefetchedReply *)calloc(1, sizeof(PrefetchedReply));
+    reply->key = key;
+    reply->kind = kind;
+    g_hash_table_insert(prefetched_replies, &reply->key, reply);
+    return reply;
+}
+
+static PrefetchedReply *lookup_prefetched_reply(Window win, Atom atom)
+{
+    if (!prefetched_replies)
+        return NULL;
+    PrefetchKey key = {win, atom};
+    return (PrefetchedReply *)g_hash_table_lookup(prefetched_replies, &key);
+}
+
+void prefetch_property(Window win, Atom at, Atom type, long offset, long length)
+{
+    if (!win || at == None)
+        return;
+    PrefetchedReply *reply = new_prefetched_reply(win, at, PREFETCH_PROPERTY);
+    reply->type = type;
+    reply->offset = offset;
+    reply->length = length;
+    reply->sequence = request_property(win, at, type, offset, length);
+}
+
+gboolean take_prefetched_property(Window win,
+                                  Atom at,
+                                  Atom type,
+                                  long offset,
+                                  long length,
+                                  void **value,
+                                  int *num_items,
+                                  unsigned long *bytes_after)
+{
+    PrefetchedReply *reply = lookup_prefetched_reply(win, at);
+    if (!reply || reply->type != type || reply->offset != offset || reply->length != length)
+        return FALSE;
+    if (!reply->received) {
+        reply->received = TRUE;
+        reply->value = receive_property_reply(reply->sequence,
+                                              type,
+                                              &reply->num_items,
+                                              &reply->bytes_after,
+                                              &reply->value_size);
+    }
+    *value = NULL;
+    if (reply->value) {
+        // Callers own (and XFree) the result, and the value may be taken again
+        size_t size = reply->value_size;
+        *value = malloc(size);
+        memcpy(*value, reply->value, size);
+    }
+    if (num_items)
+        *num_items = reply->num_items;
+    if (bytes_after)
+        *bytes_after = reply->bytes_after;
+    return TRUE;
+}
+
+void prefetch_window_geometry(Window win)
+{
+    if (!win)
+        return;
+    xcb_connection_t *c = get_connection();
+    PrefetchedReply *reply = new_prefetched_reply(win, None, PREFETCH_GEOMETRY);
+    reply->sequence = xcb_translate_coordinates(c, (xcb_window_t)win, (xcb_window_t)server.root_win, 0, 0).sequence;
+    reply->sequence2 = xcb_get_geometry(c, (xcb_drawable_t)win).sequence;
+}
+
+gboolean take_prefetched_geometry(Window win, gboolean *ok, int *x, int *y, int *w, int *h)
+{
+    PrefetchedReply *reply = lookup_prefetched_reply(win, None);
+    if (!reply)
+        return FALSE;
+    if (!reply->received) {
+        reply->received = TRUE;
+        xcb_connection_t *c = get_connection();
+        xcb_generic_error_t *error = NULL;
+        xcb_translate_coordinates_cookie_t translate_cookie = {reply->sequence};
+        xcb_translate_coordinates_reply_t *translate = xcb_translate_coordinates_reply(c, translate_cookie, &error);
+        free(error);
+        error = NULL;
+        xcb_get_geometry_cookie_t geometry_cookie = {reply->sequence2};
+        xcb_get_geometry_reply_t *geometry = xcb_get_geometry_reply(c, geometry_cookie, &error);
+        free(error);
+        // Same results as XTranslateCoordinates() and XGetGeometry() in get_window_coordinates()
+        if (translate) {
+            reply->has_position = TRUE;
+            reply->x = translate->dst_x;
+            reply->y = translate->dst_y;
+        }
+        reply->ok = translate && translate->same_screen && geometry;
+        if (reply->ok) {
+            reply->w = geometry->width + geometry->border_width;
+            reply->h = geometry->height + geometry->border_width;
+        }
+        free(translate);
+        free(geometry);
+    }
+    *ok = reply->ok;
+    if (reply->has_position) {
+        *x = reply->x;
+        *y = reply->y;
+    }
+    if (reply->ok) {
+        *w = reply->w;
+        *h = reply->h;
+    }
+    return TRUE;
+}
+
+void discard_prefetched_replies()
+{
+    if (prefetched_replies) {
+        g_hash_table_destroy(prefetched_replies);
+        prefetched_replies = NULL;
+    }
+}
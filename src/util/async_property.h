@@ -0,0 +1,46 @@
+#ifndef ASYNC_PROPERTY_H
+#define ASYNC_PROPERTY_H
+
+#include <glib.h>
+#include <X11/Xlib.h>
+
+// Asynchronous X requests, sent through the XCB connection underlying the Xlib display.
+// With Xlib every XGetWindowProperty() waits for its reply, so querying N windows costs N round-trips. Here the
+// requests for a whole batch of windows are sent at once (prefetch_*), and the replies are collected later, when the
+// code that needs them (server_get_property(), get_window_coordinates() etc.) asks for them (take_prefetched_*).
+
+typedef unsigned int PropertyCookie;
+
+// Sends a GetProperty request for `length` 32-bit units starting at unit `offset`, without waiting for the reply.
+PropertyCookie request_property(Window win, Atom at, Atom type, long offset, long length);
+
+// Waits for the reply of request_property(). Returns the value laid out like the result of XGetWindowProperty()
+// (format 32 items are stored as longs), or NULL if the property is not set or has another type.
+// Note: needs to be released with XFree(). The out parameters may be NULL.
+void *get_property_reply(PropertyCookie cookie, Atom type, int *num_items, unsigned long *bytes_after);
+
+// Requests a property of a window; the reply is kept until discard_prefetched_replies().
+void prefetch_property(Window win, Atom at, Atom type, long offset, long length);
+
+// If the property has been prefetched with the same type and range, sets *value (to be released with XFree(),
+// may be NULL like for get_property_reply()), num_items and bytes_after, and returns TRUE.
+gboolean take_prefetched_property(Window win,
+                                  Atom at,
+                                  Atom type,
+                                  long offset,
+                                  long length,
+                                  void **value,
+                                  int *num_items,
+                                  unsigned long *bytes_after);
+
+// Requests the geometry of a window and its position relative to the root window.
+void prefetch_window_geometry(Window win);
+
+// If the geometry has been prefetched, sets the coordinates like get_window_coordinates() and *ok to its result,
+// and returns TRUE.
+gboolean take_prefetched_geometry(Window win, gboolean *ok, int *x, int *y, int *w, int *h);
+
+// Drops the prefetched replies, including those not received yet.
+void discard_prefetched_replies();
+
+#endif
@@ -36,10 +36,11 @@ static void bt_add_frame(struct backtrace *bt, const char *fname)
         return;
     struct backtrace_frame *frame = &bt->frames[bt->frame_count];
     if (fname && *fname) {
-        strncpy(frame->name, fname, BT_FRAME_SIZE);
+        strncpy(frame->name, fname, BT_FRAME_SIZE - 1);
     } else {
-        strncpy(frame->name, "??", BT_FRAME_SIZE);
+        strncpy(frame->name, "??", BT_FRAME_SIZE - 1);
     }
+    frame->name[BT_FRAME_SIZE - 1] = '\0';
     bt->frame_count++;
 }
 
@@ -250,7 +251,8 @@ void get_backtrace(struct backtrace *bt, int skip)
     int size = backtrace(array, BT_MAX_FRAMES);
     char **strings = backtrace_symbols(array, size);
 
-    for (int i = 0; i < size; i++) {
+    // Skip this function too
+    for (int i = skip + 1; i < size; i++) {
         bt_add_frame(bt, strings[i]);
     }
 
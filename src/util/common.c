@@ -44,14 +44,12 @@
 #include <wordexp.h>
 #endif
 
-#ifdef HAVE_RSVG
-#include <librsvg/rsvg.h>
-#endif
-
 #include "../panel.h"
 #include "timer.h"
 #include "signals.h"
 #include "bt.h"
+#include "svg_loader.h"
+#include "text_size_cache.h"
 
 void write_string(int fd, const char *s)
 {
@@ -791,47 +789,19 @@ void draw_text(PangoLayout *layout, cairo_t *c, int posx, int posy, Color *color
 Imlib_Image load_image(const char *path, int cached)
 {
     Imlib_Image image;
-    static unsigned long counter = 0;
     if (debug_icons)
         fprintf(stderr, "tint2: loading icon %s\n", path);
-#ifdef HAVE_RSVG
     image = imlib_load_image(path);
+#ifdef HAVE_RSVG
     if (!image && g_str_has_suffix(path, ".svg")) {
-        char tmp_filename[128];
-        snprintf(tmp_filename, sizeof(tmp_filename), "/tmp/tint2-%d-%lu.png", (int)getpid(), counter);
-        counter++;
-        int fd = open(tmp_filename, O_CREAT | O_EXCL, 0600);
-        if (fd >= 0) {
-            // We fork here because librsvg allocates memory like crazy
-            pid_t pid = fork();
-            if (pid == 0) {
-                // Child
-                GError *err = NULL;
-                RsvgHandle *svg = rsvg_handle_new_from_file(path, &err);
-
-                if (err != NULL) {
-                    fprintf(stderr, "tint2: Could not load svg image!: %s", err->message);
-                    g_error_free(err);
-                } else {
-                    GdkPixbuf *pixbuf = rsvg_handle_get_pixbuf(svg);
-                    gdk_pixbuf_save(pixbuf, tmp_filename, "png", NULL, NULL);
-                }
-                _exit(0);
-            } else {
-                // Parent
-                close(fd);
-                waitpid(pid, 0, 0);
-                image = imlib_load_image_immediately(tmp_filename);
-                unlink(tmp_filename);
-            }
-        }
-    } else
+        // Rendered by the svg helper process, see svg_loader.h
+        image = load_svg_image(path, 0);
+    }
 #endif
-    {
-        image = imlib_load_image(path);
+    if (image) {
+        imlib_context_set_image(image);
+        imlib_image_set_changes_on_disk();
     }
-    imlib_context_set_image(image);
-    imlib_image_set_changes_on_disk();
     return image;
 }
 
@@ -942,22 +912,28 @@ void get_text_size(const PangoFontDescription *font,
 
     available_width = MAX(0, available_width);
     available_height = MAX(0, available_height);
+    text_len = MAX(0, text_len);
 
-    Pixmap pmap = XCreatePixmap(server.display, server.root_win, available_height, available_width, server.depth);
-    cairo_surface_t *cs =
-        cairo_xlib_surface_create(server.display, pmap, server.visual, available_height, available_width);
-    cairo_t *c = cairo_create(cs);
+    TextSizeQuery query = {.font = font,
+                           .text = text,
+                           .text_len = text_len,
+                           .available_width = available_width,
+                           .available_height = available_height,
+                           .wrap = wrap,
+                           .ellipsis = ellipsis,
+                           .alignment = alignment,
+                           .markup = markup,
+                           .scale = scale};
+    if (text_size_cache_lookup(&query, width, height))
+        return;
 
-    PangoContext *context = pango_cairo_create_context(c);
-    pango_cairo_context_set_resolution(context, 96 * scale);
-    PangoLayout *layout = pango_layout_new(context);
+    PangoLayout *layout = pango_layout_new(get_text_measurement_context(scale));
     pango_layout_set_width(layout, available_width * PANGO_SCALE);
     pango_layout_set_height(layout, available_height * PANGO_SCALE);
     pango_layout_set_alignment(layout, alignment);
     pango_layout_set_wrap(layout, wrap);
     pango_layout_set_ellipsize(layout, ellipsis);
     pango_layout_set_font_description(layout, font);
-    text_len = MAX(0, text_len);
     if (!markup)
         pango_layout_set_text(layout, text, text_len);
     else
@@ -970,10 +946,8 @@ void get_text_size(const PangoFontDescription *font,
     // fprintf(stderr, "tint2: dimension : %d - %d\n", rect_ink.height, rect.height);
 
     g_object_unref(layout);
-    g_object_unref(context);
-    cairo_destroy(c);
-    cairo_surface_destroy(cs);
-    XFreePixmap(server.display, pmap);
+
+    text_size_cache_insert(&query, *width, *height);
 }
 
 void get_text_size2(const PangoFontDescription *font,
@@ -0,0 +1,285 @@
+/**************************************************************************
+*
+* Tint2 : event loop
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#else
+#include <poll.h>
+#endif
+
+#include "colors.h"
+#include "event_loop.h"
+#include "timer.h"
+
+typedef struct FdWatch {
+    int fd;
+    FdCallback *callback;
+    void *arg;
+} FdWatch;
+
+// Key: fd, value: FdWatch* (owned)
+static GHashTable *watches = NULL;
+
+// The fds found ready by the last wait, consumed by handle_fd_events()
+static int *ready_fds = NULL;
+static int num_ready_fds = 0;
+static int ready_fds_capacity = 0;
+
+static void add_ready_fd(int fd)
+{
+    if (num_ready_fds == ready_fds_capacity) {
+        ready_fds_capacity = ready_fds_capacity ? 2 * ready_fds_capacity : 16;
+        ready_fds = (int *)realloc(ready_fds, ready_fds_capacity * sizeof(int));
+    }
+    ready_fds[num_ready_fds++] = fd;
+}
+
+// Converts the time to the next timer expiration to milliseconds; -1 if there is no active timer
+static int next_timer_timeout_ms()
+{
+    struct timeval *duration = get_duration_to_next_timer_expiration();
+    if (!duration)
+        return -1;
+    long long ms = duration->tv_sec * 1000LL + duration->tv_usec / 1000;
+    if (ms < 0)
+        return 0;
+    return ms > INT32_MAX ? INT32_MAX : (int)ms;
+}
+
+#ifdef __linux__
+
+#define MAX_EPOLL_EVENTS 32
+
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static gboolean timer_fd_armed = FALSE;
+
+static gboolean init_event_loop()
+{
+    if (epoll_fd >= 0)
+        return TRUE;
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        fprintf(stderr, RED "tint2: epoll_create1 failed: %s" RESET "\n", strerror(errno));
+        return FALSE;
+    }
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd >= 0) {
+        struct epoll_event ev = {.events = EPOLLIN, .data.fd = timer_fd};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+    } else {
+        fprintf(stderr, YELLOW "tint2: timerfd_create failed: %s" RESET "\n", strerror(errno));
+    }
+    timer_fd_armed = FALSE;
+    return TRUE;
+}
+
+static void backend_watch_fd(int fd)
+{
+    if (!init_event_loop())
+        return;
+    struct epoll_event ev = {.events = EPOLLIN, .data.fd = fd};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
+        fprintf(stderr, RED "tint2: Could not watch fd %d: %s" RESET "\n", fd, strerror(errno));
+}
+
+static void backend_unwatch_fd(int fd)
+{
+    if (epoll_fd >= 0)
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+// Arms the timerfd for the next timer expiration (a zero it_value disarms it)
+static void arm_timer_fd(int timeout_ms)
+{
+    if (timer_fd < 0)
+        return;
+    if (timeout_ms < 0 && !timer_fd_armed)
+        return;
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (timeout_ms >= 0) {
+        spec.it_value.tv_sec = timeout_ms / 1000;
+        spec.it_value.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        if (!timeout_ms)
+            spec.it_value.tv_nsec = 1;
+    }
+    timerfd_settime(timer_fd, 0, &spec, NULL);
+    timer_fd_armed = timeout_ms >= 0;
+}
+
+gboolean wait_for_fd_events(gboolean block)
+{
+    num_ready_fds = 0;
+    if (!init_event_loop())
+        return FALSE;
+
+    int timeout = 0;
+    if (block) {
+        int timer_timeout = next_timer_timeout_ms();
+        if (timer_timeout == 0) {
+            arm_timer_fd(-1);
+        } else if (timer_fd >= 0) {
+            arm_timer_fd(timer_timeout);
+            timeout = -1;
+        } else {
+            timeout = timer_timeout;
+        }
+    }
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int n = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, timeout);
+    for (int i = 0; i < n; i++) {
+        if (events[i].data.fd == timer_fd) {
+            uint64_t expirations;
+            ssize_t unused = read(timer_fd, &expirations, sizeof(expirations));
+            (void)unused;
+            timer_fd_armed = FALSE;
+            continue;
+        }
+        add_ready_fd(events[i].data.fd);
+    }
+    return num_ready_fds > 0;
+}
+
+static void backend_cleanup()
+{
+    if (timer_fd >= 0)
+        close(timer_fd);
+    timer_fd = -1;
+    timer_fd_armed = FALSE;
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+    epoll_fd = -1;
+}
+
+#else
+
+static struct pollfd *poll_fds = NULL;
+static int num_poll_fds = 0;
+// Set when the watched fds changed and poll_fds needs to be rebuilt
+static gboolean poll_fds_dirty = TRUE;
+
+static void backend_watch_fd(int fd)
+{
+    poll_fds_dirty = TRUE;
+}
+
+static void backend_unwatch_fd(int fd)
+{
+    poll_fds_dirty = TRUE;
+}
+
+static void rebuild_poll_fds()
+{
+    poll_fds_dirty = FALSE;
+    num_poll_fds = watches ? (int)g_hash_table_size(watches) : 0;
+    poll_fds = (struct pollfd *)realloc(poll_fds, (num_poll_fds + 1) * sizeof(struct pollfd));
+    if (!watches)
+        return;
+    int i = 0;
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, watches);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        poll_fds[i].fd = ((FdWatch *)value)->fd;
+        poll_fds[i].events = POLLIN;
+        poll_fds[i].revents = 0;
+        i++;
+    }
+}
+
+gboolean wait_for_fd_events(gboolean block)
+{
+    num_ready_fds = 0;
+    if (poll_fds_dirty)
+        rebuild_poll_fds();
+    int timeout = block ? next_timer_timeout_ms() : 0;
+    int n = poll(poll_fds, num_poll_fds, timeout);
+    for (int i = 0; n > 0 && i < num_poll_fds; i++) {
+        if (poll_fds[i].revents)
+            add_ready_fd(poll_fds[i].fd);
+    }
+    return num_ready_fds > 0;
+}
+
+static void backend_cleanup()
+{
+    free(poll_fds);
+    poll_fds = NULL;
+    num_poll_fds = 0;
+    poll_fds_dirty = TRUE;
+}
+
+#endif
+
+void watch_fd(int fd, FdCallback *callback, void *arg)
+{
+    if (fd < 0)
+        return;
+    if (!watches)
+        watches = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free);
+    FdWatch *watch = (FdWatch *)g_hash_table_lookup(watches, GINT_TO_POINTER(fd));
+    if (!watch) {
+        watch = (FdWatch *)calloc(1, sizeof(FdWatch));
+        watch->fd = fd;
+        g_hash_table_insert(watches, GINT_TO_POINTER(fd), watch);
+        backend_watch_fd(fd);
+    }
+    watch->callback = callback;
+    watch->arg = arg;
+}
+
+void unwatch_fd(int fd)
+{
+    if (fd < 0 || !watches)
+        return;
+    if (g_hash_table_remove(watches, GINT_TO_POINTER(fd)))
+        backend_unwatch_fd(fd);
+}
+
+void handle_fd_events()
+{
+    for (int i = 0; i < num_ready_fds; i++) {
+        // The callbacks may unwatch other fds, so look them up again
+        FdWatch *watch = watches ? (FdWatch *)g_hash_table_lookup(watches, GINT_TO_POINTER(ready_fds[i])) : NULL;
+        if (watch && watch->callback)
+            watch->callback(watch->fd, watch->arg);
+    }
+    num_ready_fds = 0;
+}
+
+void cleanup_event_loop()
+{
+    if (watches) {
+        g_hash_table_destroy(watches);
+        watches = NULL;
+    }
+    backend_cleanup();
+    free(ready_fds);
+    ready_fds = NULL;
+    num_ready_fds = ready_fds_capacity = 0;
+}
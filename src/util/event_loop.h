@@ -0,0 +1,31 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <glib.h>
+
+// File descriptor multiplexing for the main loop.
+// Event sources (the X connection, executor pipes, the SIGCHLD pipe, uevents etc.) register their file descriptors
+// once, instead of the main loop collecting them on every iteration. Under Linux this is backed by epoll, and the
+// timers by a single timerfd; elsewhere by poll().
+
+// Called from handle_fd_events() when fd is readable, or has been closed by the other end.
+typedef void FdCallback(int fd, void *arg);
+
+// Starts watching fd. The callback may be NULL if waking up the main loop is enough.
+// Watching an fd again replaces its callback.
+// Call unwatch_fd() before closing the fd.
+void watch_fd(int fd, FdCallback *callback, void *arg);
+
+void unwatch_fd(int fd);
+
+// Waits until a watched fd is ready or the next timer expires; if block is FALSE, only checks the fds.
+// Returns TRUE if some fds are ready. Returns early when a signal is received.
+gboolean wait_for_fd_events(gboolean block);
+
+// Calls the callbacks of the fds found ready by the last wait_for_fd_events().
+void handle_fd_events();
+
+// Stops watching all fds and releases the epoll/timer fds.
+void cleanup_event_loop();
+
+#endif
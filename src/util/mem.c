@@ -1,6 +1,5 @@
 #define _GNU_SOURCE
 #include <dlfcn.h>
-#include <endian.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <stdlib.h>
@@ -114,9 +113,65 @@ void load_func_or_crash(void **result, const char *name)
     }
 }
 
+// Sampling allocation profiler, loaded with LD_PRELOAD:
+//   gcc -shared -fPIC -O2 -DHAS_LIBUNWIND src/util/mem.c src/util/bt.c -o libtint2mem.so -ldl -lpthread -lunwind
+//   LD_PRELOAD=./libtint2mem.so tint2
+// On average one allocation every TINT2_MEM_SAMPLE_BYTES bytes (default 512 KiB; 1 samples every allocation)
+// has its backtrace taken; the samples are aggregated per call stack into estimated live bytes and counts,
+// and allocation churn. Sending SIGPROF (kill -PROF <pid>) writes, in the current directory:
+//   mem-<pid>-<n>.folded   live bytes per call stack, in the folded format of flamegraph.pl and speedscope
+//   mem-<pid>-<n>.txt      live, allocated and freed bytes and counts per call stack, by decreasing live bytes
+// A final report is written at exit.
+
+#define MEM_DEFAULT_SAMPLE_BYTES (512 * 1024)
+// Capacities of the tables, allocated with mmap (malloc cannot be used from within malloc); powers of 2
+#define MEM_MAX_SITES 8192
+#define MEM_MAX_SAMPLES 65536
+#define MEM_MAX_FRAMES 32
+
+typedef struct AllocSite {
+    u_int64_t hash;
+    // Estimated from the samples
+    u_int64_t live_bytes;
+    u_int64_t live_count;
+    u_int64_t alloc_bytes;
+    u_int64_t alloc_count;
+    u_int64_t free_bytes;
+    u_int64_t free_count;
+    size_t frame_count;
+    char frames[MEM_MAX_FRAMES][BT_FRAME_SIZE];
+} AllocSite;
+
+// A sampled allocation that has not been freed yet
+typedef struct AllocSample {
+    void *ptr;
+    u_int32_t site;
+    u_int64_t bytes;
+    u_int64_t count;
+} AllocSample;
+
+static AllocSite *sites = NULL;
+static size_t site_count = 0;
+static AllocSample *samples = NULL;
+static size_t sample_count = 0;
+static u_int64_t samples_dropped = 0;
+static u_int64_t sample_bytes = MEM_DEFAULT_SAMPLE_BYTES;
+// Bytes left to allocate until the next sample
+static long bytes_until_sample = 0;
+static u_int64_t random_state = 0;
+static volatile sig_atomic_t dump_requested = 0;
+static int dump_counter = 0;
+static bool profiler_ready = false;
+
 static int fd = -1;
-static u_int64_t tstart = 0;
-static bool stop_alloc_log = false;
+
+static u_int64_t current_time_ms()
+{
+    struct timespec t = {0, 0};
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    u_int64_t result = t.tv_sec * 1000 + t.tv_nsec / 1000 / 1000;
+    return result;
+}
 
 static void write_char(char c)
 {
@@ -127,7 +182,7 @@ static void write_char(char c)
     }
     if (!count)
         return;
-    if (c == '\n' || c == 0 || count >= sizeof(buffer)) {
+    if (c == 0 || count >= sizeof(buffer)) {
         ssize_t ret = write(fd, buffer, count);
         ASSERT(ret > 0);
         count = 0;
@@ -146,116 +201,310 @@ static void write_word(const char *s)
     write_string(" ");
 }
 
-static char hex(u_int8_t value)
+static void write_number(u_int64_t n)
 {
-    if (value < 10)
-        return '0' + (char)value;
-    return 'a' + (char)(value - 10);
+    char buf[32];
+    utoa(n, buf);
+    write_string(buf);
 }
 
-static void write_hex(u_int64_t v)
+static void write_frame(const char *name)
 {
-    write_string("0x");
-    if (!v) {
-        write_string("0 ");
-        return;
-    }
-    v = htobe64(v);
-    int leading_zero = 1;
-    while (v) {
-        u_int8_t byte = v & 0xff;
-        if (byte)
-            leading_zero = 0;
-        if (!leading_zero) {
-            write_char(hex(byte >> 4));
-            write_char(hex(byte & 0xf));
-        }
-        v = v >> 8;
+    // ';' separates the frames in the folded format
+    for (; *name; name++)
+        write_char(*name == ';' ? ':' : *name);
+}
+
+static void *map_zeroed(size_t size)
+{
+    void *result = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return result == MAP_FAILED ? NULL : result;
+}
+
+static u_int64_t next_random()
+{
+    // xorshift64
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+static void schedule_next_sample()
+{
+    // Uniform in [1, 2 * sample_bytes]: the samples are spread evenly over the allocated bytes,
+    // without locking on to periodic allocation patterns
+    bytes_until_sample = sample_bytes <= 1 ? 0 : (long)(1 + next_random() % (2 * sample_bytes));
+}
+
+static u_int64_t hash_bytes(u_int64_t h, const void *data, size_t size)
+{
+    // FNV-1a
+    const unsigned char *p = data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
     }
-    write_string(" ");
+    return h;
 }
 
-static void write_backtrace(int skip)
+static u_int64_t hash_pointer(void *ptr)
+{
+    u_int64_t h = (u_int64_t)ptr;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Returns the index of the site of the current call stack, or -1 if the table is full.
+__attribute__((noinline)) static long find_site(int skip)
 {
     struct backtrace bt;
+    // The profiler functions on the stack are not inlined, so that skip is exact.
+    // Frame names are cached by the backtrace module, so only new call sites pay for the symbol lookup
     get_backtrace(&bt, skip + 1);
-    for (size_t i = 0; i < bt.frame_count; i++) {
-        write_word(bt.frames[i].name);
+    size_t frame_count = bt.frame_count < MEM_MAX_FRAMES ? bt.frame_count : MEM_MAX_FRAMES;
+    u_int64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < frame_count; i++)
+        hash = hash_bytes(hash, bt.frames[i].name, strnlen(bt.frames[i].name, BT_FRAME_SIZE));
+    if (!hash)
+        hash = 1;
+
+    for (size_t i = hash & (MEM_MAX_SITES - 1);; i = (i + 1) & (MEM_MAX_SITES - 1)) {
+        AllocSite *site = &sites[i];
+        if (site->hash == hash)
+            return (long)i;
+        if (site->hash)
+            continue;
+        if (site_count >= MEM_MAX_SITES / 2)
+            return -1;
+        site->hash = hash;
+        site->frame_count = frame_count;
+        for (size_t f = 0; f < frame_count; f++)
+            memcpy(site->frames[f], bt.frames[f].name, BT_FRAME_SIZE);
+        site_count++;
+        return (long)i;
     }
 }
 
-static void log_alloc_finish(void);
+__attribute__((noinline)) static void add_sample_locked(void *ptr, size_t size)
+{
+    long site_index = find_site(3);
+    if (site_index < 0 || sample_count >= MEM_MAX_SAMPLES / 2) {
+        samples_dropped++;
+        return;
+    }
+    // An allocation of size bytes is sampled with a probability of about size / sample_bytes,
+    // so it stands for sample_bytes bytes, i.e. sample_bytes / size allocations of the same size
+    u_int64_t bytes = size > sample_bytes ? size : sample_bytes;
+    u_int64_t count = size ? bytes / size : 1;
+    AllocSite *site = &sites[site_index];
+    site->live_bytes += bytes;
+    site->live_count += count;
+    site->alloc_bytes += bytes;
+    site->alloc_count += count;
 
-static u_int64_t current_time_ms()
+    size_t i = hash_pointer(ptr) & (MEM_MAX_SAMPLES - 1);
+    while (samples[i].ptr && samples[i].ptr != ptr)
+        i = (i + 1) & (MEM_MAX_SAMPLES - 1);
+    if (!samples[i].ptr)
+        sample_count++;
+    samples[i].ptr = ptr;
+    samples[i].site = (u_int32_t)site_index;
+    samples[i].bytes = bytes;
+    samples[i].count = count;
+}
+
+static void remove_sample_locked(void *ptr)
 {
-    struct timespec t = {0, 0};
-    clock_gettime(CLOCK_MONOTONIC, &t);
-    u_int64_t result = t.tv_sec * 1000 + t.tv_nsec / 1000 / 1000;
-    return result;
+    size_t i = hash_pointer(ptr) & (MEM_MAX_SAMPLES - 1);
+    while (samples[i].ptr != ptr) {
+        if (!samples[i].ptr)
+            return;
+        i = (i + 1) & (MEM_MAX_SAMPLES - 1);
+    }
+    AllocSite *site = &sites[samples[i].site];
+    site->live_bytes -= samples[i].bytes;
+    site->live_count -= samples[i].count;
+    site->free_bytes += samples[i].bytes;
+    site->free_count += samples[i].count;
+    samples[i].ptr = NULL;
+    sample_count--;
+    // Backward shift deletion: move up the entries of the probe sequence that follows the hole
+    for (size_t hole = i, j = (i + 1) & (MEM_MAX_SAMPLES - 1); samples[j].ptr; j = (j + 1) & (MEM_MAX_SAMPLES - 1)) {
+        size_t home = hash_pointer(samples[j].ptr) & (MEM_MAX_SAMPLES - 1);
+        // Move the entry if its home slot is not in (hole, j]
+        if (((j - home) & (MEM_MAX_SAMPLES - 1)) >= ((j - hole) & (MEM_MAX_SAMPLES - 1))) {
+            samples[hole] = samples[j];
+            samples[j].ptr = NULL;
+            hole = j;
+        }
+    }
 }
 
-static void log_alloc_init(u_int64_t t)
+static int compare_sites_by_live_bytes(const void *a, const void *b)
 {
-    if (stop_alloc_log)
-        return;
+    const AllocSite *sa = &sites[*(const u_int32_t *)a];
+    const AllocSite *sb = &sites[*(const u_int32_t *)b];
+    if (sa->live_bytes != sb->live_bytes)
+        return sa->live_bytes > sb->live_bytes ? -1 : 1;
+    return sa->alloc_bytes > sb->alloc_bytes ? -1 : sa->alloc_bytes < sb->alloc_bytes ? 1 : 0;
+}
+
+static bool open_report(const char *extension)
+{
+    char path[256] = "mem-";
+    utoa((unsigned long)getpid(), path + strlen(path));
+    strcat(path, "-");
+    utoa((unsigned long)dump_counter, path + strlen(path));
+    strcat(path, extension);
+    fd = open(path, O_CLOEXEC | O_CREAT | O_WRONLY | O_TRUNC, 0600);
     if (fd == -1) {
-        int pfd[2] = {-1, -1};
-        ASSERT_OK(pipe(pfd));
-        pid_t child = fork();
-        ASSERT_PID(child);
-        if (child == 0) {
-            // child
-            close(pfd[1]);
-            ASSERT_FD(dup2(pfd[0], STDIN_FILENO));
-            ASSERT_OK(close(pfd[0]));
-            int out = open("mem.log.gz", O_APPEND | O_CLOEXEC | O_CREAT | O_WRONLY | O_TRUNC, 0600);
-            ASSERT_FD(out);
-            ASSERT_FD(dup2(out, STDOUT_FILENO));
-            sigset_t mask;
-            sigfillset(&mask);
-            sigprocmask(SIG_SETMASK, &mask, NULL);
-            ASSERT_OK(execlp("gzip", "gzip", "-c", NULL));
-            _exit(1);
-        } else {
-            // parent
-            close(pfd[0]);
-            fd = pfd[1];
+        ERR("tint2: could not write allocation profile ");
+        ERR(path);
+        ERR("\n");
+        return false;
+    }
+    return true;
+}
+
+static void close_report()
+{
+    write_char(0);
+    close(fd);
+    fd = -1;
+}
+
+static void dump_profile_locked()
+{
+    dump_requested = 0;
+    if (!profiler_ready)
+        return;
+    dump_counter++;
+
+    if (open_report(".folded")) {
+        for (size_t i = 0; i < MEM_MAX_SITES; i++) {
+            AllocSite *site = &sites[i];
+            if (!site->hash || !site->live_bytes)
+                continue;
+            // Outermost frame first
+            for (size_t f = site->frame_count; f > 0; f--) {
+                write_frame(site->frames[f - 1]);
+                if (f > 1)
+                    write_string(";");
+            }
+            write_string(" ");
+            write_number(site->live_bytes);
+            write_string("\n");
+        }
+        close_report();
+    }
+
+    if (open_report(".txt")) {
+        u_int32_t *order = map_zeroed(MEM_MAX_SITES * sizeof(u_int32_t));
+        size_t n = 0;
+        for (size_t i = 0; order && i < MEM_MAX_SITES; i++) {
+            if (sites[i].hash)
+                order[n++] = (u_int32_t)i;
+        }
+        if (order)
+            qsort(order, n, sizeof(*order), compare_sites_by_live_bytes);
+        write_string("# sample_bytes ");
+        write_number(sample_bytes);
+        write_string(" sites ");
+        write_number(site_count);
+        write_string(" live_samples ");
+        write_number(sample_count);
+        write_string(" dropped_samples ");
+        write_number(samples_dropped);
+        write_string("\n# live_bytes live_count alloc_bytes alloc_count freed_bytes freed_count backtrace\n");
+        for (size_t k = 0; k < n; k++) {
+            AllocSite *site = &sites[order[k]];
+            write_number(site->live_bytes);
+            write_string(" ");
+            write_number(site->live_count);
+            write_string(" ");
+            write_number(site->alloc_bytes);
+            write_string(" ");
+            write_number(site->alloc_count);
+            write_string(" ");
+            write_number(site->free_bytes);
+            write_string(" ");
+            write_number(site->free_count);
+            write_string(" ");
+            for (size_t f = 0; f < site->frame_count; f++)
+                write_word(site->frames[f]);
+            write_string("\n");
         }
-        atexit(log_alloc_finish);
-        tstart = t;
-        write_string("# function time_ms result ptr size count backtrace\n");
+        close_report();
+        if (order)
+            munmap(order, MEM_MAX_SITES * sizeof(u_int32_t));
     }
 }
 
-static void log_alloc_locked(const char *func_name, void *result, void *ptr, size_t size, size_t count)
+static void dump_signal_handler(int sig)
 {
-    if (stop_alloc_log)
+    // Dumped on the next allocation, outside of the signal handler
+    dump_requested = 1;
+}
+
+static void dump_profile_at_exit();
+
+static void profiler_init_locked()
+{
+    const char *s = getenv("TINT2_MEM_SAMPLE_BYTES");
+    if (s && *s) {
+        u_int64_t value = strtoull(s, NULL, 10);
+        sample_bytes = value ? value : 1;
+    }
+    sites = map_zeroed(MEM_MAX_SITES * sizeof(AllocSite));
+    samples = map_zeroed(MEM_MAX_SAMPLES * sizeof(AllocSample));
+    if (!sites || !samples) {
+        ERR("tint2: could not allocate the allocation profiler tables\n");
         return;
-    u_int64_t t = current_time_ms();
-    if (fd == -1)
-        log_alloc_init(t);
-    if (fd == -1)
+    }
+    random_state = current_time_ms() ^ ((u_int64_t)getpid() << 32) ^ 0x9e3779b97f4a7c15ULL;
+    schedule_next_sample();
+    struct sigaction sa = {.sa_handler = dump_signal_handler, .sa_flags = SA_RESTART};
+    sigaction(SIGPROF, &sa, 0);
+    atexit(dump_profile_at_exit);
+    profiler_ready = true;
+}
+
+// freed is NULL for allocations, allocated is NULL for frees and dumps.
+__attribute__((noinline)) static void log_alloc_locked(void *freed, void *allocated, size_t size)
+{
+    static bool initialized = false;
+    if (!initialized) {
+        initialized = true;
+        profiler_init_locked();
+        bytes_until_sample -= (long)size;
+    }
+    if (!profiler_ready)
         return;
-    if (func_name) {
-        write_word(func_name);
-        write_hex((u_int64_t)(t - tstart));
-        write_hex((u_int64_t)result);
-        write_hex((u_int64_t)ptr);
-        write_hex((u_int64_t)size);
-        write_hex((u_int64_t)count);
-        write_backtrace(2);
-        write_string("\n");
-    } else {
-        write_string("# done\n");
-        close(fd);
-        fd = -1;
-        stop_alloc_log = true;
+    if (freed && sample_count)
+        remove_sample_locked(freed);
+    if (allocated && bytes_until_sample <= 0) {
+        add_sample_locked(allocated, size);
+        schedule_next_sample();
     }
+    if (dump_requested)
+        dump_profile_locked();
 }
 
 static int pid = -1;
-static void log_alloc(const char *func_name, void *result, void *ptr, size_t size, size_t count)
+__attribute__((noinline)) static void log_alloc(void *freed, void *allocated, size_t size)
 {
+    if (profiler_ready) {
+        // Fast path, without locking: most calls neither free a sampled allocation nor complete a sampling interval
+        bool check_free = freed && __atomic_load_n(&sample_count, __ATOMIC_RELAXED);
+        bool check_alloc =
+            allocated && __atomic_sub_fetch(&bytes_until_sample, (long)size, __ATOMIC_RELAXED) <= 0;
+        if (!check_free && !check_alloc && !dump_requested)
+            return;
+    }
+
     static pthread_mutex_t mutex_global = PTHREAD_MUTEX_INITIALIZER;
     static pthread_mutex_t mutex_recursive;
     static pthread_mutex_t mutex_nonrecursive = PTHREAD_MUTEX_INITIALIZER;
@@ -274,22 +523,24 @@ static void log_alloc(const char *func_name, void *result, void *ptr, size_t siz
     }
     pthread_mutex_unlock(&mutex_global);
 
-    // Do not log from forked processes.
+    // Do not profile forked processes.
     if (pid != getpid())
         return;
 
+    // Allocations made by the profiler itself (e.g. while taking a backtrace) are not profiled
     pthread_mutex_lock(&mutex_recursive);
     int ret = pthread_mutex_trylock(&mutex_nonrecursive);
     if (ret == 0) {
-        log_alloc_locked(func_name, result, ptr, size, count);
+        log_alloc_locked(freed, allocated, size);
         pthread_mutex_unlock(&mutex_nonrecursive);
     }
     pthread_mutex_unlock(&mutex_recursive);
 }
 
-static void log_alloc_finish()
+static void dump_profile_at_exit()
 {
-    log_alloc(0, 0, 0, 0, 0);
+    dump_requested = 1;
+    log_alloc(0, 0, 0);
 }
 
 void *malloc(size_t size)
@@ -297,7 +548,7 @@ void *malloc(size_t size)
     static void *(*original)(size_t size) = 0;
     load_func_or_crash((void *)&original, __FUNCTION__);
     void *result = original(size);
-    log_alloc(__FUNCTION__, result, 0, size, 0);
+    log_alloc(0, result, size);
     return result;
 }
 
@@ -306,7 +557,9 @@ void *realloc(void *ptr, size_t size)
     static void *(*original)(void *p, size_t size) = 0;
     load_func_or_crash((void *)&original, __FUNCTION__);
     void *result = original(ptr, size);
-    log_alloc(__FUNCTION__, result, ptr, size, 0);
+    // Accounted as a free followed by an allocation
+    if (result || !size)
+        log_alloc(ptr, result, size);
     return result;
 }
 
@@ -315,7 +568,7 @@ void *calloc(size_t nmemb, size_t size)
     static void *(*original)(size_t nmemb, size_t size) = 0;
     load_func_or_crash((void *)&original, __FUNCTION__);
     void *result = original(nmemb, size);
-    log_alloc(__FUNCTION__, result, 0, size, nmemb);
+    log_alloc(0, result, nmemb * size);
     return result;
 }
 
@@ -326,6 +579,8 @@ void free(void *ptr)
     if (!original) {
         return;
     }
+    // Forget the sample before the address can be reused by another thread
+    if (ptr)
+        log_alloc(ptr, 0, 0);
     original(ptr);
-    log_alloc(__FUNCTION__, 0, ptr, 0, 0);
 }
@@ -0,0 +1,223 @@
+/**************************************************************************
+*
+* Tint2 : pixmap pool
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "colors.h"
+#include "pixmap_pool.h"
+#include "server.h"
+
+// Memory kept in released pixmaps; beyond it, the sizes not used for the longest time are freed first
+#define MAX_POOLED_BYTES (16 * 1024 * 1024)
+
+typedef struct PixmapGeometry {
+    int width, height, depth;
+} PixmapGeometry;
+
+typedef struct PixmapBucket {
+    PixmapGeometry geometry;
+    // Each element is a released Pixmap with this geometry
+    GSList *pixmaps;
+    // Node in the LRU queue, data points to the bucket
+    GList lru_link;
+} PixmapBucket;
+
+// Key: PixmapGeometry*, value: PixmapBucket* (owned)
+static GHashTable *released_pixmaps = NULL;
+// Buckets with released pixmaps, most recently used first
+static GQueue lru = G_QUEUE_INIT;
+// Key: Pixmap handed out by the pool, value: PixmapGeometry* (owned)
+static GHashTable *used_pixmaps = NULL;
+
+static unsigned long long num_hits, num_misses, num_frees;
+static unsigned long long pooled_bytes, used_bytes;
+
+static guint pixmap_geometry_hash(gconstpointer key)
+{
+    const PixmapGeometry *g = (const PixmapGeometry *)key;
+    return ((guint)g->width * 65599u) ^ ((guint)g->height * 257u) ^ (guint)g->depth;
+}
+
+static gboolean pixmap_geometry_equal(gconstpointer a, gconstpointer b)
+{
+    const PixmapGeometry *ga = (const PixmapGeometry *)a;
+    const PixmapGeometry *gb = (const PixmapGeometry *)b;
+    return ga->width == gb->width && ga->height == gb->height && ga->depth == gb->depth;
+}
+
+static unsigned long long pixmap_geometry_bytes(const PixmapGeometry *g)
+{
+    int bytes_per_pixel = g->depth > 16 ? 4 : g->depth > 8 ? 2 : 1;
+    return (unsigned long long)g->width * g->height * bytes_per_pixel;
+}
+
+static void remove_bucket(PixmapBucket *bucket)
+{
+    g_queue_unlink(&lru, &bucket->lru_link);
+    g_hash_table_remove(released_pixmaps, &bucket->geometry);
+}
+
+// Frees a pixmap of the size that has not been used for the longest time
+static void evict_oldest_pixmap()
+{
+    PixmapBucket *bucket = (PixmapBucket *)g_queue_peek_tail(&lru);
+    Pixmap pixmap = (Pixmap)GPOINTER_TO_SIZE(bucket->pixmaps->data);
+    bucket->pixmaps = g_slist_delete_link(bucket->pixmaps, bucket->pixmaps);
+    XFreePixmap(server.display, pixmap);
+    pooled_bytes -= pixmap_geometry_bytes(&bucket->geometry);
+    num_frees++;
+    if (!bucket->pixmaps)
+        remove_bucket(bucket);
+}
+
+static void init_pixmap_pool()
+{
+    if (released_pixmaps)
+        return;
+    released_pixmaps = g_hash_table_new_full(pixmap_geometry_hash, pixmap_geometry_equal, NULL, free);
+    used_pixmaps = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free);
+}
+
+Pixmap pixmap_pool_get(int width, int height, int depth)
+{
+    init_pixmap_pool();
+
+    PixmapGeometry *geometry = (PixmapGeometry *)calloc(1, sizeof(PixmapGeometry));
+    geometry->width = width;
+    geometry->height = height;
+    geometry->depth = depth;
+
+    Pixmap pixmap;
+    PixmapBucket *bucket = (PixmapBucket *)g_hash_table_lookup(released_pixmaps, geometry);
+    if (bucket && bucket->pixmaps) {
+        pixmap = (Pixmap)GPOINTER_TO_SIZE(bucket->pixmaps->data);
+        bucket->pixmaps = g_slist_delete_link(bucket->pixmaps, bucket->pixmaps);
+        if (!bucket->pixmaps) {
+            remove_bucket(bucket);
+        } else {
+            g_queue_unlink(&lru, &bucket->lru_link);
+            g_queue_push_head_link(&lru, &bucket->lru_link);
+        }
+        pooled_bytes -= pixmap_geometry_bytes(geometry);
+        num_hits++;
+    } else {
+        pixmap = XCreatePixmap(server.display, server.root_win, width, height, depth);
+        num_misses++;
+    }
+
+    used_bytes += pixmap_geometry_bytes(geometry);
+    g_hash_table_insert(used_pixmaps, GSIZE_TO_POINTER(pixmap), geometry);
+    return pixmap;
+}
+
+void pixmap_pool_release(Pixmap pixmap)
+{
+    if (!pixmap)
+        return;
+    init_pixmap_pool();
+
+    PixmapGeometry *geometry = (PixmapGeometry *)g_hash_table_lookup(used_pixmaps, GSIZE_TO_POINTER(pixmap));
+    if (!geometry) {
+        // Not allocated by the pool
+        XFreePixmap(server.display, pixmap);
+        return;
+    }
+    g_hash_table_steal(used_pixmaps, GSIZE_TO_POINTER(pixmap));
+
+    unsigned long long bytes = pixmap_geometry_bytes(geometry);
+    used_bytes -= bytes;
+
+    PixmapBucket *bucket = (PixmapBucket *)g_hash_table_lookup(released_pixmaps, geometry);
+    if (!bucket) {
+        bucket = (PixmapBucket *)calloc(1, sizeof(PixmapBucket));
+        bucket->geometry = *geometry;
+        bucket->lru_link.data = bucket;
+        g_hash_table_insert(released_pixmaps, &bucket->geometry, bucket);
+    } else {
+        g_queue_unlink(&lru, &bucket->lru_link);
+    }
+    g_queue_push_head_link(&lru, &bucket->lru_link);
+
+    // Sizes left over from a resize or a monitor change must not keep the current ones out of the pool
+    while (pooled_bytes + bytes > MAX_POOLED_BYTES && g_queue_peek_tail(&lru) != bucket)
+        evict_oldest_pixmap();
+    if (pooled_bytes + bytes > MAX_POOLED_BYTES) {
+        XFreePixmap(server.display, pixmap);
+        num_frees++;
+        if (!bucket->pixmaps)
+            remove_bucket(bucket);
+        free(geometry);
+        return;
+    }
+    bucket->pixmaps = g_slist_prepend(bucket->pixmaps, GSIZE_TO_POINTER(pixmap));
+    pooled_bytes += bytes;
+    free(geometry);
+}
+
+Pixmap pixmap_pool_recycle(Pixmap pixmap, int width, int height, int depth)
+{
+    if (pixmap && used_pixmaps) {
+        PixmapGeometry *geometry = (PixmapGeometry *)g_hash_table_lookup(used_pixmaps, GSIZE_TO_POINTER(pixmap));
+        if (geometry && geometry->width == width && geometry->height == height && geometry->depth == depth) {
+            num_hits++;
+            return pixmap;
+        }
+    }
+    pixmap_pool_release(pixmap);
+    return pixmap_pool_get(width, height, depth);
+}
+
+void cleanup_pixmap_pool()
+{
+    if (!released_pixmaps)
+        return;
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, released_pixmaps);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        PixmapBucket *bucket = (PixmapBucket *)value;
+        for (GSList *l = bucket->pixmaps; l; l = l->next)
+            XFreePixmap(server.display, (Pixmap)GPOINTER_TO_SIZE(l->data));
+        g_slist_free(bucket->pixmaps);
+        bucket->pixmaps = NULL;
+    }
+    g_hash_table_destroy(released_pixmaps);
+    released_pixmaps = NULL;
+    // The links are embedded in the buckets, which are freed
+    g_queue_init(&lru);
+    // Pixmaps still in use are freed by their owners with XFreePixmap/pixmap_pool_release
+    g_hash_table_destroy(used_pixmaps);
+    used_pixmaps = NULL;
+
+    num_hits = num_misses = num_frees = 0;
+    pooled_bytes = used_bytes = 0;
+}
+
+void pixmap_pool_print_stats()
+{
+    fprintf(stderr,
+            BLUE "tint2: pixmap pool: %llu hits, %llu misses, %llu frees, %.1f KB pooled, %.1f KB in use" RESET "\n",
+            num_hits,
+            num_misses,
+            num_frees,
+            pooled_bytes / 1024.0,
+            used_bytes / 1024.0);
+}
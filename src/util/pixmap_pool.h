@@ -0,0 +1,28 @@
+#ifndef PIXMAP_POOL_H
+#define PIXMAP_POOL_H
+
+#include <glib.h>
+#include <X11/Xlib.h>
+
+// A pool of server-side pixmaps, recycled by (width, height, depth).
+// Creating and freeing pixmaps costs a server allocation each time; Areas are redrawn very often with the same
+// size (e.g. on every mouse hover), so released pixmaps are kept and handed out again to the next request with
+// the same geometry. The contents of a recycled pixmap are undefined.
+
+// Returns a pixmap with the given size and depth, reusing a released one if possible.
+Pixmap pixmap_pool_get(int width, int height, int depth);
+
+// Returns a pixmap to the pool. The pixmap must have been obtained with pixmap_pool_get().
+// None is ignored.
+void pixmap_pool_release(Pixmap pixmap);
+
+// Returns pixmap itself if it has the requested size and depth, otherwise releases it and returns a new one.
+Pixmap pixmap_pool_recycle(Pixmap pixmap, int width, int height, int depth);
+
+// Frees all the pooled pixmaps. Pixmaps still in use are not affected.
+void cleanup_pixmap_pool();
+
+// Prints the pool statistics (hits, misses, memory) on stderr.
+void pixmap_pool_print_stats();
+
+#endif
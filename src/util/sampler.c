@@ -0,0 +1,482 @@
+/**************************************************************************
+*
+* Tint2 : system statistics sampler
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sampler.h"
+#include "test.h"
+#include "timer.h"
+
+#define SAMPLER_INTERVAL_MS 1000
+// /proc/diskstats sectors are always 512 bytes
+#define DISKSTATS_SECTOR_SIZE 512
+
+typedef enum SampledFile {
+    FILE_STAT = 0,
+    FILE_MEMINFO,
+    FILE_LOADAVG,
+    FILE_NET_DEV,
+    FILE_DISKSTATS,
+    FILE_TEMPERATURE,
+    SAMPLED_FILE_COUNT
+} SampledFile;
+
+static const char *sampled_file_paths[SAMPLED_FILE_COUNT] = {"/proc/stat",
+                                                            "/proc/meminfo",
+                                                            "/proc/loadavg",
+                                                            "/proc/net/dev",
+                                                            "/proc/diskstats",
+                                                            "/sys/class/thermal/thermal_zone0/temp"};
+
+typedef enum SampledValue {
+    VALUE_CPU = 0,
+    VALUE_MEM,
+    VALUE_MEM_USED,
+    VALUE_MEM_TOTAL,
+    VALUE_SWAP,
+    VALUE_LOAD,
+    VALUE_NET_RX,
+    VALUE_NET_TX,
+    VALUE_DISK_READ,
+    VALUE_DISK_WRITE,
+    VALUE_TEMPERATURE,
+    SAMPLED_VALUE_COUNT
+} SampledValue;
+
+typedef enum ValueFormat { FORMAT_INTEGER, FORMAT_DECIMAL, FORMAT_RATE } ValueFormat;
+
+typedef struct SamplerToken {
+    const char *name;
+    SampledValue value;
+    ValueFormat format;
+} SamplerToken;
+
+static const SamplerToken sampler_tokens[] = {
+    {"cpu", VALUE_CPU, FORMAT_INTEGER},
+    {"mem", VALUE_MEM, FORMAT_INTEGER},
+    {"mem_used", VALUE_MEM_USED, FORMAT_INTEGER},
+    {"mem_total", VALUE_MEM_TOTAL, FORMAT_INTEGER},
+    {"swap", VALUE_SWAP, FORMAT_INTEGER},
+    {"load", VALUE_LOAD, FORMAT_DECIMAL},
+    {"net_rx", VALUE_NET_RX, FORMAT_RATE},
+    {"net_tx", VALUE_NET_TX, FORMAT_RATE},
+    {"disk_read", VALUE_DISK_READ, FORMAT_RATE},
+    {"disk_write", VALUE_DISK_WRITE, FORMAT_RATE},
+    {"temp", VALUE_TEMPERATURE, FORMAT_INTEGER},
+};
+
+typedef struct SamplerSubscriber {
+    SamplerCallback *callback;
+    void *arg;
+} SamplerSubscriber;
+
+// Counters from the previous sample, to compute rates
+typedef struct SamplerCounters {
+    gboolean valid;
+    struct timespec time;
+    unsigned long long cpu_busy;
+    unsigned long long cpu_total;
+    unsigned long long net_rx;
+    unsigned long long net_tx;
+    unsigned long long disk_read;
+    unsigned long long disk_write;
+} SamplerCounters;
+
+// Each element is a SamplerSubscriber*
+static GList *subscribers = NULL;
+static Timer sampler_timer = DEFAULT_TIMER;
+// Kept open between samples, -1 if missing
+static int sampled_fds[SAMPLED_FILE_COUNT];
+static gboolean sampled_files_open = FALSE;
+// Names of the physical disks, so that partitions and virtual devices are not counted twice
+static GHashTable *physical_disks = NULL;
+static SamplerCounters counters;
+// Unknown values are negative
+static double values[SAMPLED_VALUE_COUNT];
+// All files are read in the same buffer, parsed in place
+// Grown as needed, since /proc/diskstats and /proc/net/dev are larger with many devices
+static char *sample_buffer = NULL;
+static size_t sample_buffer_size = 0;
+
+static void open_sampled_files()
+{
+    for (int i = 0; i < SAMPLED_FILE_COUNT; i++)
+        sampled_fds[i] = open(sampled_file_paths[i], O_RDONLY | O_CLOEXEC);
+
+    physical_disks = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    GDir *dir = g_dir_open("/sys/block", 0, NULL);
+    if (dir) {
+        const gchar *name;
+        while ((name = g_dir_read_name(dir))) {
+            // Virtual devices (loop, ram, device mapper, RAID) have no device link
+            gchar *device = g_build_filename("/sys/block", name, "device", NULL);
+            if (g_file_test(device, G_FILE_TEST_EXISTS))
+                g_hash_table_add(physical_disks, g_strdup(name));
+            g_free(device);
+        }
+        g_dir_close(dir);
+    }
+
+    memset(&counters, 0, sizeof(counters));
+    for (int i = 0; i < SAMPLED_VALUE_COUNT; i++)
+        values[i] = -1;
+    sampled_files_open = TRUE;
+}
+
+static void stop_sampler()
+{
+    if (!sampled_files_open)
+        return;
+    destroy_timer(&sampler_timer);
+    for (int i = 0; i < SAMPLED_FILE_COUNT; i++) {
+        if (sampled_fds[i] >= 0)
+            close(sampled_fds[i]);
+        sampled_fds[i] = -1;
+    }
+    g_hash_table_destroy(physical_disks);
+    physical_disks = NULL;
+    g_free(sample_buffer);
+    sample_buffer = NULL;
+    sample_buffer_size = 0;
+    sampled_files_open = FALSE;
+}
+
+// Reads the whole file into sample_buffer. Returns NULL on failure.
+static char *read_sampled_file(SampledFile file)
+{
+    if (sampled_fds[file] < 0)
+        return NULL;
+    if (!sample_buffer) {
+        sample_buffer_size = 16384;
+        sample_buffer = g_new(char, sample_buffer_size);
+    }
+    size_t length = 0;
+    while (TRUE) {
+        if (length == sample_buffer_size - 1) {
+            sample_buffer_size *= 2;
+            sample_buffer = g_renew(char, sample_buffer, sample_buffer_size);
+        }
+        ssize_t count = pread(sampled_fds[file], sample_buffer + length, sample_buffer_size - 1 - length, length);
+        if (count < 0)
+            return NULL;
+        if (count == 0)
+            break;
+        length += count;
+    }
+    if (length == 0)
+        return NULL;
+    sample_buffer[length] = '\0';
+    return sample_buffer;
+}
+
+// Parses count unsigned integers separated by whitespace. Returns the end of the last one.
+static char *parse_counters(char *s, unsigned long long *counters, int count)
+{
+    for (int i = 0; i < count; i++) {
+        char *end;
+        counters[i] = strtoull(s, &end, 10);
+        if (end == s)
+            return NULL;
+        s = end;
+    }
+    return s;
+}
+
+// Returns the value of a /proc/meminfo line, in kB, or -1.
+static double meminfo_value(const char *meminfo, const char *key)
+{
+    size_t key_length = strlen(key);
+    for (const char *line = meminfo; line && *line; line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+        if (strncmp(line, key, key_length) == 0 && line[key_length] == ':')
+            return strtod(line + key_length + 1, NULL);
+    }
+    return -1;
+}
+
+static double elapsed_seconds(const struct timespec *from, const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1.0e9;
+}
+
+static void sample_cpu(SamplerCounters *now)
+{
+    char *stat = read_sampled_file(FILE_STAT);
+    // user nice system idle iowait irq softirq steal
+    unsigned long long times[8];
+    if (!stat || strncmp(stat, "cpu ", 4) != 0 || !parse_counters(stat + 4, times, 8))
+        return;
+    now->cpu_total = 0;
+    for (int i = 0; i < 8; i++)
+        now->cpu_total += times[i];
+    now->cpu_busy = now->cpu_total - times[3] - times[4];
+    if (counters.valid && now->cpu_total > counters.cpu_total)
+        values[VALUE_CPU] = 100.0 * (now->cpu_busy - counters.cpu_busy) / (now->cpu_total - counters.cpu_total);
+}
+
+static void sample_memory()
+{
+    char *meminfo = read_sampled_file(FILE_MEMINFO);
+    if (!meminfo)
+        return;
+    double total = meminfo_value(meminfo, "MemTotal");
+    double available = meminfo_value(meminfo, "MemAvailable");
+    if (total > 0 && available >= 0) {
+        values[VALUE_MEM] = 100.0 * (total - available) / total;
+        values[VALUE_MEM_USED] = (total - available) / 1024;
+        values[VALUE_MEM_TOTAL] = total / 1024;
+    }
+    double swap_total = meminfo_value(meminfo, "SwapTotal");
+    double swap_free = meminfo_value(meminfo, "SwapFree");
+    if (swap_total >= 0 && swap_free >= 0)
+        values[VALUE_SWAP] = swap_total > 0 ? 100.0 * (swap_total - swap_free) / swap_total : 0;
+}
+
+static void sample_load()
+{
+    char *loadavg = read_sampled_file(FILE_LOADAVG);
+    if (loadavg)
+        values[VALUE_LOAD] = strtod(loadavg, NULL);
+}
+
+static void sample_network(SamplerCounters *now, double elapsed)
+{
+    char *net_dev = read_sampled_file(FILE_NET_DEV);
+    if (!net_dev)
+        return;
+    now->net_rx = now->net_tx = 0;
+    // Two header lines, then "name: rx_bytes packets errs drop fifo frame compressed multicast tx_bytes ..."
+    for (char *line = net_dev; line; line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+        char *colon = strchr(line, ':');
+        char *eol = strchr(line, '\n');
+        if (!colon || (eol && colon > eol))
+            continue;
+        char *name = line;
+        while (*name == ' ')
+            name++;
+        if (colon - name == 2 && strncmp(name, "lo", 2) == 0)
+            continue;
+        unsigned long long fields[9];
+        if (!parse_counters(colon + 1, fields, 9))
+            continue;
+        now->net_rx += fields[0];
+        now->net_tx += fields[8];
+    }
+    if (counters.valid && elapsed > 0 && now->net_rx >= counters.net_rx && now->net_tx >= counters.net_tx) {
+        values[VALUE_NET_RX] = (now->net_rx - counters.net_rx) / elapsed;
+        values[VALUE_NET_TX] = (now->net_tx - counters.net_tx) / elapsed;
+    }
+}
+
+static void sample_disks(SamplerCounters *now, double elapsed)
+{
+    char *diskstats = read_sampled_file(FILE_DISKSTATS);
+    if (!diskstats)
+        return;
+    now->disk_read = now->disk_write = 0;
+    // "major minor name reads merged sectors_read ms writes merged sectors_written ..."
+    for (char *line = diskstats; line && *line; line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+        unsigned long long device[2];
+        char *name = parse_counters(line, device, 2);
+        if (!name)
+            continue;
+        while (*name == ' ')
+            name++;
+        size_t name_length = strcspn(name, " \n");
+        char disk[64];
+        if (name_length == 0 || name_length >= sizeof(disk))
+            continue;
+        memcpy(disk, name, name_length);
+        disk[name_length] = '\0';
+        if (!g_hash_table_contains(physical_disks, disk))
+            continue;
+        unsigned long long fields[7];
+        if (!parse_counters(name + name_length, fields, 7))
+            continue;
+        now->disk_read += fields[2] * DISKSTATS_SECTOR_SIZE;
+        now->disk_write += fields[6] * DISKSTATS_SECTOR_SIZE;
+    }
+    if (counters.valid && elapsed > 0 && now->disk_read >= counters.disk_read &&
+        now->disk_write >= counters.disk_write) {
+        values[VALUE_DISK_READ] = (now->disk_read - counters.disk_read) / elapsed;
+        values[VALUE_DISK_WRITE] = (now->disk_write - counters.disk_write) / elapsed;
+    }
+}
+
+static void sample_temperature()
+{
+    char *temperature = read_sampled_file(FILE_TEMPERATURE);
+    if (temperature)
+        values[VALUE_TEMPERATURE] = strtod(temperature, NULL) / 1000.0;
+}
+
+static void take_sample()
+{
+    SamplerCounters now;
+    memset(&now, 0, sizeof(now));
+    clock_gettime(CLOCK_MONOTONIC, &now.time);
+    double elapsed = counters.valid ? elapsed_seconds(&counters.time, &now.time) : 0;
+
+    sample_cpu(&now);
+    sample_memory();
+    sample_load();
+    sample_network(&now, elapsed);
+    sample_disks(&now, elapsed);
+    sample_temperature();
+
+    now.valid = TRUE;
+    counters = now;
+}
+
+static void sampler_tick(void *arg)
+{
+    take_sample();
+    for (GList *l = subscribers; l;) {
+        SamplerSubscriber *subscriber = (SamplerSubscriber *)l->data;
+        // The callback may unsubscribe
+        l = l->next;
+        subscriber->callback(subscriber->arg);
+    }
+}
+
+static const SamplerToken *find_sampler_token(const char *name, size_t length)
+{
+    for (size_t i = 0; i < sizeof(sampler_tokens) / sizeof(sampler_tokens[0]); i++) {
+        if (strlen(sampler_tokens[i].name) == length && strncmp(sampler_tokens[i].name, name, length) == 0)
+            return &sampler_tokens[i];
+    }
+    return NULL;
+}
+
+// Returns the token starting at s ("%{name}"), or NULL
+static const SamplerToken *parse_sampler_token(const char *s, const char **end)
+{
+    if (s[0] != '%' || s[1] != '{')
+        return NULL;
+    const char *close = strchr(s + 2, '}');
+    if (!close)
+        return NULL;
+    *end = close + 1;
+    return find_sampler_token(s + 2, (size_t)(close - s - 2));
+}
+
+gboolean sampler_has_tokens(const char *text)
+{
+    if (!text)
+        return FALSE;
+    for (const char *p = strstr(text, "%{"); p; p = strstr(p + 1, "%{")) {
+        const char *end;
+        if (parse_sampler_token(p, &end))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void format_sampled_value(const SamplerToken *token, char *buffer, size_t buffer_size)
+{
+    double value = values[token->value];
+    if (value < 0) {
+        snprintf(buffer, buffer_size, "?");
+    } else if (token->format == FORMAT_INTEGER) {
+        snprintf(buffer, buffer_size, "%.0f", value);
+    } else if (token->format == FORMAT_DECIMAL) {
+        snprintf(buffer, buffer_size, "%.2f", value);
+    } else {
+        const char *units = "BKMGT";
+        int unit = 0;
+        while (value >= 1024 && units[unit + 1]) {
+            value /= 1024;
+            unit++;
+        }
+        snprintf(buffer, buffer_size, unit ? "%.1f%c" : "%.0f%c", value, units[unit]);
+    }
+}
+
+void sampler_expand(const char *text, char *buffer, size_t buffer_size)
+{
+    size_t length = 0;
+    for (const char *p = text; *p && length + 1 < buffer_size;) {
+        const char *end;
+        const SamplerToken *token = parse_sampler_token(p, &end);
+        if (token) {
+            format_sampled_value(token, buffer + length, buffer_size - length);
+            length += strlen(buffer + length);
+            p = end;
+        } else {
+            buffer[length++] = *p++;
+        }
+    }
+    buffer[length] = '\0';
+}
+
+void sampler_subscribe(SamplerCallback *callback, void *arg)
+{
+    if (!subscribers) {
+        open_sampled_files();
+        take_sample();
+        INIT_TIMER(sampler_timer);
+        change_timer(&sampler_timer, true, SAMPLER_INTERVAL_MS, SAMPLER_INTERVAL_MS, sampler_tick, NULL);
+    }
+    SamplerSubscriber *subscriber = (SamplerSubscriber *)calloc(1, sizeof(SamplerSubscriber));
+    subscriber->callback = callback;
+    subscriber->arg = arg;
+    subscribers = g_list_append(subscribers, subscriber);
+    callback(arg);
+}
+
+void sampler_unsubscribe(SamplerCallback *callback, void *arg)
+{
+    for (GList *l = subscribers; l; l = l->next) {
+        SamplerSubscriber *subscriber = (SamplerSubscriber *)l->data;
+        if (subscriber->callback == callback && subscriber->arg == arg) {
+            subscribers = g_list_delete_link(subscribers, l);
+            free(subscriber);
+            break;
+        }
+    }
+    if (!subscribers)
+        stop_sampler();
+}
+
+void cleanup_sampler()
+{
+    g_list_free_full(subscribers, free);
+    subscribers = NULL;
+    stop_sampler();
+}
+
+TEST(sampler_expand)
+{
+    for (int i = 0; i < SAMPLED_VALUE_COUNT; i++)
+        values[i] = -1;
+    values[VALUE_CPU] = 42.4;
+    values[VALUE_LOAD] = 0.5;
+    values[VALUE_NET_RX] = 1536;
+    char buffer[64];
+    sampler_expand("CPU %{cpu}% %{load} %{net_rx} %{temp} %{bogus} 100%", buffer, sizeof(buffer));
+    ASSERT_STR_EQUAL(buffer, "CPU 42% 0.50 1.5K ? %{bogus} 100%");
+    sampler_expand("%{cpu}%{cpu}", buffer, 3);
+    ASSERT_STR_EQUAL(buffer, "42");
+    ASSERT(sampler_has_tokens("a %{mem} b"));
+    ASSERT(!sampler_has_tokens("a %{memory} b %"));
+}
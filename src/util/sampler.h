@@ -0,0 +1,32 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <glib.h>
+#include <stddef.h>
+
+// Samples system statistics (CPU, memory, network, disk, load, temperature) in-process, once per second for all
+// panels, and expands them in text through tokens:
+//   %{cpu}         CPU usage in percent
+//   %{mem}         memory usage in percent; %{mem_used} and %{mem_total} in MiB
+//   %{swap}        swap usage in percent
+//   %{load}        load average over the last minute
+//   %{net_rx}      bytes received per second over all network interfaces except loopback; %{net_tx} for sent
+//   %{disk_read}   bytes read per second from all physical disks; %{disk_write} for written
+//   %{temp}        temperature of the first thermal zone, in degrees Celsius
+// Values that cannot be sampled (e.g. on systems without /proc) expand to "?".
+
+typedef void SamplerCallback(void *arg);
+
+// Returns TRUE if the text contains at least one sampler token.
+gboolean sampler_has_tokens(const char *text);
+
+// Registers a callback called after each sample. The sampler runs only while it has subscribers.
+void sampler_subscribe(SamplerCallback *callback, void *arg);
+void sampler_unsubscribe(SamplerCallback *callback, void *arg);
+
+// Writes the text with its tokens replaced by the last sampled values into buffer.
+void sampler_expand(const char *text, char *buffer, size_t buffer_size);
+
+void cleanup_sampler();
+
+#endif
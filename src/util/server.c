@@ -28,6 +28,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "async_property.h"
 #include "common.h"
 #include "config.h"
 #include "server.h"
@@ -41,89 +42,110 @@ int server_catch_error(Display *d, XErrorEvent *ev)
     return 0;
 }
 
+#define ATOM(field, atom_name) \
+    { &server.atom.field, atom_name }
+
 void server_init_atoms()
 {
-    server.atom._XROOTPMAP_ID = XInternAtom(server.display, "_XROOTPMAP_ID", False);
-    server.atom._XROOTMAP_ID = XInternAtom(server.display, "_XROOTMAP_ID", False);
-    server.atom._NET_CURRENT_DESKTOP = XInternAtom(server.display, "_NET_CURRENT_DESKTOP", False);
-    server.atom._NET_NUMBER_OF_DESKTOPS = XInternAtom(server.display, "_NET_NUMBER_OF_DESKTOPS", False);
-    server.atom._NET_DESKTOP_NAMES = XInternAtom(server.display, "_NET_DESKTOP_NAMES", False);
-    server.atom._NET_DESKTOP_GEOMETRY = XInternAtom(server.display, "_NET_DESKTOP_GEOMETRY", False);
-    server.atom._NET_DESKTOP_VIEWPORT = XInternAtom(server.display, "_NET_DESKTOP_VIEWPORT", False);
-    server.atom._NET_WORKAREA = XInternAtom(server.display, "_NET_WORKAREA", False);
-    server.atom._NET_ACTIVE_WINDOW = XInternAtom(server.display, "_NET_ACTIVE_WINDOW", False);
-    server.atom._NET_WM_WINDOW_TYPE = XInternAtom(server.display, "_NET_WM_WINDOW_TYPE", False);
-    server.atom._NET_WM_STATE_SKIP_PAGER = XInternAtom(server.display, "_NET_WM_STATE_SKIP_PAGER", False);
-    server.atom._NET_WM_STATE_SKIP_TASKBAR = XInternAtom(server.display, "_NET_WM_STATE_SKIP_TASKBAR", False);
-    server.atom._NET_WM_STATE_STICKY = XInternAtom(server.display, "_NET_WM_STATE_STICKY", False);
-    server.atom._NET_WM_STATE_DEMANDS_ATTENTION = XInternAtom(server.display, "_NET_WM_STATE_DEMANDS_ATTENTION", False);
-    server.atom._NET_WM_WINDOW_TYPE_DOCK = XInternAtom(server.display, "_NET_WM_WINDOW_TYPE_DOCK", False);
-    server.atom._NET_WM_WINDOW_TYPE_DESKTOP = XInternAtom(server.display, "_NET_WM_WINDOW_TYPE_DESKTOP", False);
-    server.atom._NET_WM_WINDOW_TYPE_TOOLBAR = XInternAtom(server.display, "_NET_WM_WINDOW_TYPE_TOOLBAR", False);
-    server.atom._NET_WM_WINDOW_TYPE_MENU = XInternAtom(server.display, "_NET_WM_WINDOW_TYPE_MENU", False);
-    server.atom._NET_WM_WINDOW_TYPE_SPLASH = XInternAtom(server.display, "_NET_WM_WINDOW_TYPE_SPLASH", False);
-    server.atom._NET_WM_WINDOW_TYPE_DIALOG = XInternAtom(server.display, "_NET_WM_WINDOW_TYPE_DIALOG", False);
-    server.atom._NET_WM_WINDOW_TYPE_NORMAL = XInternAtom(server.display, "_NET_WM_WINDOW_TYPE_NORMAL", False);
-    server.atom._NET_WM_DESKTOP = XInternAtom(server.display, "_NET_WM_DESKTOP", False);
-    server.atom.WM_STATE = XInternAtom(server.display, "WM_STATE", False);
-    server.atom._NET_WM_STATE = XInternAtom(server.display, "_NET_WM_STATE", False);
-    server.atom._NET_WM_STATE_MAXIMIZED_VERT = XInternAtom(server.display, "_NET_WM_STATE_MAXIMIZED_VERT", False);
-    server.atom._NET_WM_STATE_MAXIMIZED_HORZ = XInternAtom(server.display, "_NET_WM_STATE_MAXIMIZED_HORZ", False);
-    server.atom._NET_WM_STATE_SHADED = XInternAtom(server.display, "_NET_WM_STATE_SHADED", False);
-    server.atom._NET_WM_STATE_HIDDEN = XInternAtom(server.display, "_NET_WM_STATE_HIDDEN", False);
-    server.atom._NET_WM_STATE_BELOW = XInternAtom(server.display, "_NET_WM_STATE_BELOW", False);
-    server.atom._NET_WM_STATE_ABOVE = XInternAtom(server.display, "_NET_WM_STATE_ABOVE", False);
-    server.atom._NET_WM_STATE_MODAL = XInternAtom(server.display, "_NET_WM_STATE_MODAL", False);
-    server.atom._NET_CLIENT_LIST = XInternAtom(server.display, "_NET_CLIENT_LIST", False);
-    server.atom._NET_WM_VISIBLE_NAME = XInternAtom(server.display, "_NET_WM_VISIBLE_NAME", False);
-    server.atom._NET_WM_NAME = XInternAtom(server.display, "_NET_WM_NAME", False);
-    server.atom._NET_WM_STRUT = XInternAtom(server.display, "_NET_WM_STRUT", False);
-    server.atom._NET_WM_ICON = XInternAtom(server.display, "_NET_WM_ICON", False);
-    server.atom._NET_WM_ICON_GEOMETRY = XInternAtom(server.display, "_NET_WM_ICON_GEOMETRY", False);
-    server.atom._NET_WM_ICON_NAME = XInternAtom(server.display, "_NET_WM_ICON_NAME", False);
-    server.atom._NET_CLOSE_WINDOW = XInternAtom(server.display, "_NET_CLOSE_WINDOW", False);
-    server.atom.UTF8_STRING = XInternAtom(server.display, "UTF8_STRING", False);
-    server.atom._NET_SUPPORTING_WM_CHECK = XInternAtom(server.display, "_NET_SUPPORTING_WM_CHECK", False);
-    server.atom._NET_WM_CM_S0 = XInternAtom(server.display, "_NET_WM_CM_S0", False);
-    server.atom._NET_SUPPORTING_WM_CHECK = XInternAtom(server.display, "_NET_WM_NAME", False);
-    server.atom._NET_WM_STRUT_PARTIAL = XInternAtom(server.display, "_NET_WM_STRUT_PARTIAL", False);
-    server.atom.WM_NAME = XInternAtom(server.display, "WM_NAME", False);
-    server.atom.__SWM_VROOT = XInternAtom(server.display, "__SWM_VROOT", False);
-    server.atom._MOTIF_WM_HINTS = XInternAtom(server.display, "_MOTIF_WM_HINTS", False);
-    server.atom.WM_HINTS = XInternAtom(server.display, "WM_HINTS", False);
-    gchar *name = g_strdup_printf("_XSETTINGS_S%d", DefaultScreen(server.display));
-    server.atom._XSETTINGS_SCREEN = XInternAtom(server.display, name, False);
-    g_free(name);
-    server.atom._XSETTINGS_SETTINGS = XInternAtom(server.display, "_XSETTINGS_SETTINGS", False);
-
-    // systray protocol
-    name = g_strdup_printf("_NET_SYSTEM_TRAY_S%d", DefaultScreen(server.display));
-    server.atom._NET_SYSTEM_TRAY_SCREEN = XInternAtom(server.display, name, False);
-    g_free(name);
-    server.atom._NET_SYSTEM_TRAY_OPCODE = XInternAtom(server.display, "_NET_SYSTEM_TRAY_OPCODE", False);
-    server.atom.MANAGER = XInternAtom(server.display, "MANAGER", False);
-    server.atom._NET_SYSTEM_TRAY_MESSAGE_DATA = XInternAtom(server.display, "_NET_SYSTEM_TRAY_MESSAGE_DATA", False);
-    server.atom._NET_SYSTEM_TRAY_ORIENTATION = XInternAtom(server.display, "_NET_SYSTEM_TRAY_ORIENTATION", False);
-    server.atom._NET_SYSTEM_TRAY_ICON_SIZE = XInternAtom(server.display, "_NET_SYSTEM_TRAY_ICON_SIZE", False);
-    server.atom._NET_SYSTEM_TRAY_PADDING = XInternAtom(server.display, "_NET_SYSTEM_TRAY_PADDING", False);
-    server.atom._XEMBED = XInternAtom(server.display, "_XEMBED", False);
-    server.atom._XEMBED_INFO = XInternAtom(server.display, "_XEMBED_INFO", False);
-    server.atom._NET_WM_PID = XInternAtom(server.display, "_NET_WM_PID", True);
-
-    // drag 'n' drop
-    server.atom.XdndAware = XInternAtom(server.display, "XdndAware", False);
-    server.atom.XdndEnter = XInternAtom(server.display, "XdndEnter", False);
-    server.atom.XdndPosition = XInternAtom(server.display, "XdndPosition", False);
-    server.atom.XdndStatus = XInternAtom(server.display, "XdndStatus", False);
-    server.atom.XdndDrop = XInternAtom(server.display, "XdndDrop", False);
-    server.atom.XdndLeave = XInternAtom(server.display, "XdndLeave", False);
-    server.atom.XdndSelection = XInternAtom(server.display, "XdndSelection", False);
-    server.atom.XdndTypeList = XInternAtom(server.display, "XdndTypeList", False);
-    server.atom.XdndActionCopy = XInternAtom(server.display, "XdndActionCopy", False);
-    server.atom.XdndFinished = XInternAtom(server.display, "XdndFinished", False);
-    server.atom.TARGETS = XInternAtom(server.display, "TARGETS", False);
+    gchar *xsettings_screen = g_strdup_printf("_XSETTINGS_S%d", DefaultScreen(server.display));
+    gchar *systray_screen = g_strdup_printf("_NET_SYSTEM_TRAY_S%d", DefaultScreen(server.display));
+    struct {
+        Atom *atom;
+        const char *name;
+    } atoms[] = {
+        ATOM(_XROOTPMAP_ID, "_XROOTPMAP_ID"),
+        ATOM(_XROOTMAP_ID, "_XROOTMAP_ID"),
+        ATOM(_NET_CURRENT_DESKTOP, "_NET_CURRENT_DESKTOP"),
+        ATOM(_NET_NUMBER_OF_DESKTOPS, "_NET_NUMBER_OF_DESKTOPS"),
+        ATOM(_NET_DESKTOP_NAMES, "_NET_DESKTOP_NAMES"),
+        ATOM(_NET_DESKTOP_GEOMETRY, "_NET_DESKTOP_GEOMETRY"),
+        ATOM(_NET_DESKTOP_VIEWPORT, "_NET_DESKTOP_VIEWPORT"),
+        ATOM(_NET_WORKAREA, "_NET_WORKAREA"),
+        ATOM(_NET_ACTIVE_WINDOW, "_NET_ACTIVE_WINDOW"),
+        ATOM(_NET_WM_WINDOW_TYPE, "_NET_WM_WINDOW_TYPE"),
+        ATOM(_NET_WM_STATE_SKIP_PAGER, "_NET_WM_STATE_SKIP_PAGER"),
+        ATOM(_NET_WM_STATE_SKIP_TASKBAR, "_NET_WM_STATE_SKIP_TASKBAR"),
+        ATOM(_NET_WM_STATE_STICKY, "_NET_WM_STATE_STICKY"),
+        ATOM(_NET_WM_STATE_DEMANDS_ATTENTION, "_NET_WM_STATE_DEMANDS_ATTENTION"),
+        ATOM(_NET_WM_WINDOW_TYPE_DOCK, "_NET_WM_WINDOW_TYPE_DOCK"),
+        ATOM(_NET_WM_WINDOW_TYPE_DESKTOP, "_NET_WM_WINDOW_TYPE_DESKTOP"),
+        ATOM(_NET_WM_WINDOW_TYPE_TOOLBAR, "_NET_WM_WINDOW_TYPE_TOOLBAR"),
+        ATOM(_NET_WM_WINDOW_TYPE_MENU, "_NET_WM_WINDOW_TYPE_MENU"),
+        ATOM(_NET_WM_WINDOW_TYPE_SPLASH, "_NET_WM_WINDOW_TYPE_SPLASH"),
+        ATOM(_NET_WM_WINDOW_TYPE_DIALOG, "_NET_WM_WINDOW_TYPE_DIALOG"),
+        ATOM(_NET_WM_WINDOW_TYPE_NORMAL, "_NET_WM_WINDOW_TYPE_NORMAL"),
+        ATOM(_NET_WM_DESKTOP, "_NET_WM_DESKTOP"),
+        ATOM(WM_STATE, "WM_STATE"),
+        ATOM(_NET_WM_STATE, "_NET_WM_STATE"),
+        ATOM(_NET_WM_STATE_MAXIMIZED_VERT, "_NET_WM_STATE_MAXIMIZED_VERT"),
+        ATOM(_NET_WM_STATE_MAXIMIZED_HORZ, "_NET_WM_STATE_MAXIMIZED_HORZ"),
+        ATOM(_NET_WM_STATE_SHADED, "_NET_WM_STATE_SHADED"),
+        ATOM(_NET_WM_STATE_HIDDEN, "_NET_WM_STATE_HIDDEN"),
+        ATOM(_NET_WM_STATE_BELOW, "_NET_WM_STATE_BELOW"),
+        ATOM(_NET_WM_STATE_ABOVE, "_NET_WM_STATE_ABOVE"),
+        ATOM(_NET_WM_STATE_MODAL, "_NET_WM_STATE_MODAL"),
+        ATOM(_NET_CLIENT_LIST, "_NET_CLIENT_LIST"),
+        ATOM(_NET_WM_VISIBLE_NAME, "_NET_WM_VISIBLE_NAME"),
+        ATOM(_NET_WM_NAME, "_NET_WM_NAME"),
+        ATOM(_NET_WM_STRUT, "_NET_WM_STRUT"),
+        ATOM(_NET_WM_ICON, "_NET_WM_ICON"),
+        ATOM(_NET_WM_ICON_GEOMETRY, "_NET_WM_ICON_GEOMETRY"),
+        ATOM(_NET_WM_ICON_NAME, "_NET_WM_ICON_NAME"),
+        ATOM(_NET_CLOSE_WINDOW, "_NET_CLOSE_WINDOW"),
+        ATOM(UTF8_STRING, "UTF8_STRING"),
+        ATOM(_NET_SUPPORTING_WM_CHECK, "_NET_SUPPORTING_WM_CHECK"),
+        ATOM(_NET_WM_CM_S0, "_NET_WM_CM_S0"),
+        ATOM(_NET_WM_STRUT_PARTIAL, "_NET_WM_STRUT_PARTIAL"),
+        ATOM(WM_NAME, "WM_NAME"),
+        ATOM(__SWM_VROOT, "__SWM_VROOT"),
+        ATOM(_MOTIF_WM_HINTS, "_MOTIF_WM_HINTS"),
+        ATOM(WM_HINTS, "WM_HINTS"),
+        ATOM(_XSETTINGS_SCREEN, xsettings_screen),
+        ATOM(_XSETTINGS_SETTINGS, "_XSETTINGS_SETTINGS"),
+        // systray protocol
+        ATOM(_NET_SYSTEM_TRAY_SCREEN, systray_screen),
+        ATOM(_NET_SYSTEM_TRAY_OPCODE, "_NET_SYSTEM_TRAY_OPCODE"),
+        ATOM(MANAGER, "MANAGER"),
+        ATOM(_NET_SYSTEM_TRAY_MESSAGE_DATA, "_NET_SYSTEM_TRAY_MESSAGE_DATA"),
+        ATOM(_NET_SYSTEM_TRAY_ORIENTATION, "_NET_SYSTEM_TRAY_ORIENTATION"),
+        ATOM(_NET_SYSTEM_TRAY_ICON_SIZE, "_NET_SYSTEM_TRAY_ICON_SIZE"),
+        ATOM(_NET_SYSTEM_TRAY_PADDING, "_NET_SYSTEM_TRAY_PADDING"),
+        ATOM(_NET_SYSTEM_TRAY_VISUAL, "_NET_SYSTEM_TRAY_VISUAL"),
+        ATOM(_XEMBED, "_XEMBED"),
+        ATOM(_XEMBED_INFO, "_XEMBED_INFO"),
+        ATOM(_NET_WM_PID, "_NET_WM_PID"),
+        // drag 'n' drop
+        ATOM(XdndAware, "XdndAware"),
+        ATOM(XdndEnter, "XdndEnter"),
+        ATOM(XdndPosition, "XdndPosition"),
+        ATOM(XdndStatus, "XdndStatus"),
+        ATOM(XdndDrop, "XdndDrop"),
+        ATOM(XdndLeave, "XdndLeave"),
+        ATOM(XdndSelection, "XdndSelection"),
+        ATOM(XdndTypeList, "XdndTypeList"),
+        ATOM(XdndActionCopy, "XdndActionCopy"),
+        ATOM(XdndFinished, "XdndFinished"),
+        ATOM(TARGETS, "TARGETS"),
+    };
+    const int num_atoms = sizeof(atoms) / sizeof(atoms[0]);
+
+    // Intern all the atoms with a single round-trip
+    char *names[num_atoms];
+    Atom values[num_atoms];
+    for (int i = 0; i < num_atoms; i++)
+        names[i] = (char *)atoms[i].name;
+    if (!XInternAtoms(server.display, names, num_atoms, False, values)) {
+        fprintf(stderr, RED "tint2: could not intern the X atoms" RESET "\n");
+    }
+    for (int i = 0; i < num_atoms; i++)
+        *atoms[i].atom = values[i];
+
+    g_free(xsettings_screen);
+    g_free(systray_screen);
 }
 
+#undef ATOM
+
 const char *GetAtomName(Display *disp, Atom a)
 {
     if (a == None)
@@ -182,68 +204,28 @@ void send_event32(Window win, Atom at, long data1, long data2, long data3)
 
 int get_property32(Window win, Atom at, Atom type)
 {
-    Atom type_ret;
-    int format_ret = 0, data = 0;
-    unsigned long nitems_ret = 0;
-    unsigned long bafter_ret = 0;
-    unsigned char *prop_value = 0;
-    int result;
-
-    if (!win)
-        return 0;
-
-    result = XGetWindowProperty(server.display,
-                                win,
-                                at,
-                                0,
-                                0x7fffffff,
-                                False,
-                                type,
-                                &type_ret,
-                                &format_ret,
-                                &nitems_ret,
-                                &bafter_ret,
-                                &prop_value);
-
-    if (result == Success && prop_value) {
-        data = ((gulong *)prop_value)[0];
-        XFree(prop_value);
-    }
+    int num_results = 0;
+    gulong *value = (gulong *)server_get_property(win, at, type, &num_results);
+    int data = 0;
+    if (value && num_results > 0)
+        data = value[0];
+    XFree(value);
     return data;
 }
 
 void *server_get_property(Window win, Atom at, Atom type, int *num_results)
 {
-    Atom type_ret;
-    int format_ret = 0;
-    unsigned long nitems_ret = 0;
-    unsigned long bafter_ret = 0;
-    unsigned char *prop_value;
-
+    if (num_results)
+        *num_results = 0;
     if (!win)
         return NULL;
 
-    int result = XGetWindowProperty(server.display,
-                                    win,
-                                    at,
-                                    0,
-                                    0x7fffffff,
-                                    False,
-                                    type,
-                                    &type_ret,
-                                    &format_ret,
-                                    &nitems_ret,
-                                    &bafter_ret,
-                                    &prop_value);
-
-    // Send fill_color resultcount
-    if (num_results)
-        *num_results = (int)nitems_ret;
-
-    if (result == Success && prop_value)
-        return prop_value;
-    else
-        return NULL;
+    void *value;
+    if (!take_prefetched_property(win, at, type, 0, 0x7fffffff, &value, num_results, NULL)) {
+        PropertyCookie cookie = request_property(win, at, type, 0, 0x7fffffff);
+        value = get_property_reply(cookie, type, num_results, NULL);
+    }
+    return value;
 }
 
 void get_root_pixmap()
@@ -75,6 +75,7 @@ typedef struct Global_atom {
     Atom _NET_SYSTEM_TRAY_ORIENTATION;
     Atom _NET_SYSTEM_TRAY_ICON_SIZE;
     Atom _NET_SYSTEM_TRAY_PADDING;
+    Atom _NET_SYSTEM_TRAY_VISUAL;
     Atom _XEMBED;
     Atom _XEMBED_INFO;
     Atom _NET_WM_PID;
@@ -9,16 +9,20 @@
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
 #include "common.h"
+#include "event_loop.h"
 #include "panel.h"
 #include "launcher.h"
 #include "server.h"
 #include "signals.h"
 
 static sig_atomic_t signal_pending;
+// Set when the restart was requested by tint2 itself rather than by a SIGUSR1 from outside
+static gboolean self_restart;
 
 void signal_handler(int sig)
 {
@@ -41,6 +45,7 @@ void init_signals()
 {
     // Set signal handlers
     signal_pending = 0;
+    self_restart = FALSE;
 
     reset_signals();
 
@@ -94,7 +99,8 @@ void sigchld_handler_async()
     // Wait for all dead processes
     pid_t pid;
     int status;
-    while ((pid = waitpid(-1, &status, WNOHANG)) != -1 && pid != 0) {
+    struct rusage usage;
+    while ((pid = wait4(-1, &status, WNOHANG, &usage)) != -1 && pid != 0) {
 #ifdef HAVE_SN
         if (startup_notifications) {
             SnLauncherContext *ctx = (SnLauncherContext *)g_tree_lookup(server.pids, GINT_TO_POINTER(pid));
@@ -109,6 +115,8 @@ void sigchld_handler_async()
             Execp *execp = (Execp *)l->data;
             if (g_tree_lookup(execp->backend->cmd_pids, GINT_TO_POINTER(pid)))
                 execp_cmd_completed(execp, pid);
+            else if (execp->backend->command_pid == pid)
+                execp_command_reaped(execp, &usage);
         }
     }
 }
@@ -123,6 +131,11 @@ void handle_sigchld_events()
     }
 }
 
+static void sigchld_pipe_ready(int fd, void *arg)
+{
+    handle_sigchld_events();
+}
+
 void init_signals_postconfig()
 {
     gboolean need_sigchld = FALSE;
@@ -145,6 +158,7 @@ void init_signals_postconfig()
             fcntl(sigchild_pipe[0], F_SETFL, O_NONBLOCK | fcntl(sigchild_pipe[0], F_GETFL));
             fcntl(sigchild_pipe[1], F_SETFL, O_NONBLOCK | fcntl(sigchild_pipe[1], F_GETFL));
             sigchild_pipe_valid = 1;
+            watch_fd(sigchild_pipe[0], sigchld_pipe_ready, NULL);
             struct sigaction act = {.sa_handler = sigchld_handler, .sa_flags = SA_RESTART};
             if (sigaction(SIGCHLD, &act, 0)) {
                 perror("sigaction");
@@ -161,10 +175,36 @@ void emit_self_restart(const char *reason)
             __LINE__,
             reason);
     signal_pending = SIGUSR1;
+    self_restart = TRUE;
 }
 
 int get_signal_pending()
 {
     return signal_pending;
 }
+
+gboolean get_self_restart_pending()
+{
+    return signal_pending == SIGUSR1 && self_restart;
+}
+
+gboolean clear_signal_pending(int sig)
+{
+    // Block the handled signals, so that none can arrive between the check and the clear and be lost
+    sigset_t handled_signals, old_signals;
+    sigemptyset(&handled_signals);
+    sigaddset(&handled_signals, SIGUSR1);
+    sigaddset(&handled_signals, SIGUSR2);
+    sigaddset(&handled_signals, SIGINT);
+    sigaddset(&handled_signals, SIGTERM);
+    sigaddset(&handled_signals, SIGHUP);
+    sigprocmask(SIG_BLOCK, &handled_signals, &old_signals);
+    gboolean cleared = signal_pending == sig;
+    if (cleared) {
+        signal_pending = 0;
+        self_restart = FALSE;
+    }
+    sigprocmask(SIG_SETMASK, &old_signals, NULL);
+    return cleared;
+}
 #endif
@@ -1,10 +1,16 @@
 #ifndef SIGNALS_H
 #define SIGNALS_H
 
+#include <glib.h>
+
 void init_signals();
 void init_signals_postconfig();
 void emit_self_restart(const char *reason);
 int get_signal_pending();
+// TRUE if the pending SIGUSR1 comes from emit_self_restart()
+gboolean get_self_restart_pending();
+// Clears the pending signal if it is still sig. Returns FALSE if another signal arrived meanwhile.
+gboolean clear_signal_pending(int sig);
 void reset_signals();
 
 void handle_sigchld_events();
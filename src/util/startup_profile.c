@@ -0,0 +1,105 @@
+/**************************************************************************
+*
+* Tint2 : startup profiling
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <X11/Xlib.h>
+#include <X11/Xlibint.h>
+#include <stdio.h>
+
+#include "colors.h"
+#include "startup_profile.h"
+#include "timer.h"
+
+// Startups slower than this are reported as warnings
+#define STARTUP_BUDGET_MS 100
+
+gboolean profile_startup = FALSE;
+
+static gboolean profiling;
+static Display *profiled_display;
+static double startup_time, phase_time;
+static unsigned long phase_request;
+static unsigned long num_flushes, phase_flushes;
+static unsigned long total_requests;
+
+static void count_flush(Display *display, XExtCodes *codes, _Xconst char *data, long len)
+{
+    num_flushes++;
+}
+
+static unsigned long next_request()
+{
+    return profiled_display ? XNextRequest(profiled_display) : 0;
+}
+
+void startup_profile_begin()
+{
+    profiling = TRUE;
+    profiled_display = NULL;
+    startup_time = phase_time = get_time();
+    phase_request = 0;
+    num_flushes = phase_flushes = 0;
+    total_requests = 0;
+}
+
+void startup_profile_watch_display(Display *display)
+{
+    if (!profile_startup || !profiling)
+        return;
+    profiled_display = display;
+    phase_request = next_request();
+    // The extension record is only used to hook the flushes and is freed by XCloseDisplay
+    XExtCodes *codes = XAddExtension(display);
+    if (codes)
+        XESetBeforeFlush(display, codes->extension, count_flush);
+}
+
+void startup_profile_phase(const char *name)
+{
+    if (!profile_startup || !profiling)
+        return;
+    double now = get_time();
+    unsigned long request = next_request();
+    unsigned long requests = request - phase_request;
+    fprintf(stderr,
+            BLUE "tint2: startup: %-24s %7.1f ms, %5lu requests, %4lu round-trips" RESET "\n",
+            name,
+            (now - phase_time) * 1000,
+            requests,
+            num_flushes - phase_flushes);
+    total_requests += requests;
+    phase_time = now;
+    phase_request = request;
+    phase_flushes = num_flushes;
+}
+
+void startup_profile_end(const char *name)
+{
+    if (!profile_startup || !profiling)
+        return;
+    startup_profile_phase(name);
+    double total_ms = (phase_time - startup_time) * 1000;
+    fprintf(stderr,
+            "%stint2: startup: %-24s %7.1f ms, %5lu requests, %4lu round-trips" RESET "\n",
+            total_ms > STARTUP_BUDGET_MS ? YELLOW : BLUE,
+            "total",
+            total_ms,
+            total_requests,
+            num_flushes);
+    profiling = FALSE;
+}
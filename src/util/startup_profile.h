@@ -0,0 +1,25 @@
+#ifndef STARTUP_PROFILE_H
+#define STARTUP_PROFILE_H
+
+#include <X11/Xlib.h>
+#include <glib.h>
+
+// Startup latency profiling, enabled with --profile-startup.
+// Prints the duration of each startup phase, with the number of X requests and round-trips it made.
+// Round-trips are counted as the flushes of the Xlib output queue, which each blocking request causes.
+
+extern gboolean profile_startup;
+
+// Marks the beginning of the startup. Called at the beginning of init().
+void startup_profile_begin();
+
+// Starts counting the round-trips made on the display. Called right after the display is opened.
+void startup_profile_watch_display(Display *display);
+
+// Reports the phase that just finished and starts the next one.
+void startup_profile_phase(const char *name);
+
+// Reports the last phase and the total startup time. Further calls do nothing, until the next startup_profile_begin().
+void startup_profile_end(const char *name);
+
+#endif
@@ -0,0 +1,544 @@
+/**************************************************************************
+*
+* Tint2 : asynchronous SVG loader
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#ifdef HAVE_RSVG
+#include <cairo.h>
+#include <librsvg/rsvg.h>
+#endif
+
+#include "colors.h"
+#include "common.h"
+#include "event_loop.h"
+#include "icon-theme-common.h"
+#include "server.h"
+#include "svg_loader.h"
+#include "timer.h"
+
+#ifdef HAVE_RSVG
+
+// How long to wait for the helper when an image is needed synchronously
+#define SVG_RENDER_TIMEOUT_MS 5000
+// Rendered images that have not been read for this long are deleted when the helper starts
+#define SVG_CACHE_MAX_AGE_DAYS 30
+
+typedef struct SvgCallback {
+    ImageLoadedCallback *callback;
+    void *arg;
+} SvgCallback;
+
+typedef struct SvgRequest {
+    char *svg_path;
+    char *cache_path;
+    int size;
+    gboolean done;
+    gboolean ok;
+    // Each element is a SvgCallback*
+    GSList *callbacks;
+} SvgRequest;
+
+static pid_t helper_pid = -1;
+// Socket connected to the helper. Requests are answered in order, one line each.
+static int helper_fd = -1;
+static char reply_buffer[256];
+static int reply_buffer_len = 0;
+// Requests sent to the helper and not answered yet, oldest first
+static GQueue sent_requests = G_QUEUE_INIT;
+// Answered requests whose callbacks have not been called yet
+static GQueue done_requests = G_QUEUE_INIT;
+// Cache paths of the images that could not be rendered (not retried until restart)
+static GHashTable *failed_renders = NULL;
+// Calls the callbacks of requests answered outside the event loop handler
+static Timer dispatch_timer;
+static gboolean dispatch_timer_initialized = FALSE;
+
+// Helper process
+
+// Gets the size of the image in pixels, as defined by the document
+static gboolean get_svg_size(RsvgHandle *svg, double *width, double *height)
+{
+#if LIBRSVG_CHECK_VERSION(2, 52, 0)
+    if (rsvg_handle_get_intrinsic_size_in_pixels(svg, width, height))
+        return TRUE;
+    // Documents without an absolute size are rendered at the size of their viewBox
+    gboolean has_viewbox;
+    RsvgRectangle viewbox;
+    rsvg_handle_get_intrinsic_dimensions(svg, NULL, NULL, NULL, NULL, &has_viewbox, &viewbox);
+    if (!has_viewbox)
+        return FALSE;
+    *width = viewbox.width;
+    *height = viewbox.height;
+#else
+    RsvgDimensionData dimensions;
+    rsvg_handle_get_dimensions(svg, &dimensions);
+    *width = dimensions.width;
+    *height = dimensions.height;
+#endif
+    return TRUE;
+}
+
+static gboolean render_svg(const char *svg_path, int size, const char *cache_path)
+{
+    GError *err = NULL;
+    RsvgHandle *svg = rsvg_handle_new_from_file(svg_path, &err);
+    if (err != NULL) {
+        fprintf(stderr, "tint2: Could not load svg image %s: %s\n", svg_path, err->message);
+        g_error_free(err);
+        return FALSE;
+    }
+
+    double svg_width, svg_height;
+    if (!get_svg_size(svg, &svg_width, &svg_height) || svg_width < 1 || svg_height < 1) {
+        g_object_unref(svg);
+        return FALSE;
+    }
+    int w = (int)lround(svg_width);
+    int h = (int)lround(svg_height);
+    double scale = 1.0;
+    if (size > 0) {
+        scale = size / MAX(svg_width, svg_height);
+        w = MAX(1, (int)lround(svg_width * scale));
+        h = MAX(1, (int)lround(svg_height * scale));
+    }
+
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, h);
+    cairo_t *c = cairo_create(surface);
+#if LIBRSVG_CHECK_VERSION(2, 52, 0)
+    RsvgRectangle viewport = {0, 0, svg_width * scale, svg_height * scale};
+    gboolean ok = rsvg_handle_render_document(svg, c, &viewport, &err);
+    if (err != NULL) {
+        fprintf(stderr, "tint2: Could not render svg image %s: %s\n", svg_path, err->message);
+        g_error_free(err);
+    }
+#else
+    cairo_scale(c, scale, scale);
+    gboolean ok = rsvg_handle_render_cairo(svg, c);
+#endif
+    cairo_destroy(c);
+    g_object_unref(svg);
+
+    // Write to a temporary file first, so that tint2 never loads a partially written image
+    gchar *tmp_path = g_strdup_printf("%s.%d.tmp", cache_path, (int)getpid());
+    ok = ok && cairo_surface_write_to_png(surface, tmp_path) == CAIRO_STATUS_SUCCESS &&
+         rename(tmp_path, cache_path) == 0;
+    if (!ok)
+        unlink(tmp_path);
+    g_free(tmp_path);
+    cairo_surface_destroy(surface);
+    return ok;
+}
+
+// Deletes the rendered images of old icon themes, sizes no longer used and renders that were interrupted
+static void prune_svg_cache()
+{
+    gchar *cache_dir = g_build_filename(g_get_user_cache_dir(), "tint2", "svg", NULL);
+    GDir *dir = g_dir_open(cache_dir, 0, NULL);
+    if (dir) {
+        time_t now = time(NULL);
+        const gchar *name;
+        while ((name = g_dir_read_name(dir))) {
+            gchar *path = g_build_filename(cache_dir, name, NULL);
+            struct stat st;
+            // The access time is only updated about once a day (relatime), which is precise enough here
+            if (stat(path, &st) == 0 && S_ISREG(st.st_mode) &&
+                now - MAX(st.st_atime, st.st_mtime) > SVG_CACHE_MAX_AGE_DAYS * 24 * 3600)
+                unlink(path);
+            g_free(path);
+        }
+        g_dir_close(dir);
+    }
+    g_free(cache_dir);
+}
+
+static void svg_helper_main(int fd)
+{
+    // Done by the helper, so that tint2 does not wait for it
+    prune_svg_cache();
+    FILE *in = fdopen(fd, "r");
+    char *line = NULL;
+    size_t line_size = 0;
+    // Request: size TAB cache path TAB svg path NEWLINE; reply: 1 or 0 NEWLINE
+    while (in && getline(&line, &line_size, in) >= 0) {
+        char *cache_path = strchr(line, '\t');
+        char *svg_path = cache_path ? strchr(cache_path + 1, '\t') : NULL;
+        gboolean ok = FALSE;
+        if (svg_path) {
+            *cache_path++ = '\0';
+            *svg_path++ = '\0';
+            svg_path[strcspn(svg_path, "\n")] = '\0';
+            ok = render_svg(svg_path, atoi(line), cache_path);
+        }
+        write_string(fd, ok ? "1\n" : "0\n");
+    }
+    _exit(0);
+}
+
+static void svg_helper_fd_ready(int fd, void *arg)
+{
+    handle_svg_loader_events();
+}
+
+static gboolean start_helper()
+{
+    if (helper_fd >= 0)
+        return TRUE;
+
+    gchar *cache_dir = g_build_filename(g_get_user_cache_dir(), "tint2", "svg", NULL);
+    g_mkdir_with_parents(cache_dir, 0700);
+    g_free(cache_dir);
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        fprintf(stderr, RED "tint2: Could not create the svg helper socket: %s" RESET "\n", strerror(errno));
+        return FALSE;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, RED "tint2: Could not start the svg helper: %s" RESET "\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return FALSE;
+    }
+    if (pid == 0) {
+        // Child
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGHUP, SIG_DFL);
+        signal(SIGUSR1, SIG_DFL);
+        signal(SIGUSR2, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        close(fds[0]);
+        if (server.display)
+            close(ConnectionNumber(server.display));
+        svg_helper_main(fds[1]);
+    }
+    close(fds[1]);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK | fcntl(fds[0], F_GETFL));
+    helper_pid = pid;
+    helper_fd = fds[0];
+    watch_fd(helper_fd, svg_helper_fd_ready, NULL);
+    reply_buffer_len = 0;
+    if (debug_icons)
+        fprintf(stderr, "tint2: Started svg helper, pid %d\n", (int)pid);
+    return TRUE;
+}
+
+// Main process
+
+static void free_svg_request(SvgRequest *request)
+{
+    g_slist_free_full(request->callbacks, free);
+    free(request->svg_path);
+    free(request->cache_path);
+    free(request);
+}
+
+static void dispatch_done_requests(void *arg)
+{
+    SvgRequest *request;
+    while ((request = (SvgRequest *)g_queue_pop_head(&done_requests))) {
+        // Callbacks may queue new requests or cancel others; the request itself is no longer reachable
+        for (GSList *l = request->callbacks; l; l = l->next) {
+            SvgCallback *cb = (SvgCallback *)l->data;
+            if (cb->callback)
+                cb->callback(cb->arg);
+        }
+        free_svg_request(request);
+    }
+}
+
+static void complete_request(gboolean ok)
+{
+    SvgRequest *request = (SvgRequest *)g_queue_pop_head(&sent_requests);
+    if (!request)
+        return;
+    request->done = TRUE;
+    request->ok = ok;
+    if (!ok) {
+        if (!failed_renders)
+            failed_renders = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+        g_hash_table_insert(failed_renders, g_strdup(request->cache_path), GINT_TO_POINTER(1));
+    }
+    if (debug_icons)
+        fprintf(stderr, "tint2: Rendered %s at size %d: %s\n", request->svg_path, request->size, ok ? "ok" : "failed");
+    g_queue_push_tail(&done_requests, request);
+    if (!dispatch_timer_initialized) {
+        INIT_TIMER(dispatch_timer);
+        dispatch_timer_initialized = TRUE;
+    }
+    change_timer(&dispatch_timer, true, 0, 0, dispatch_done_requests, NULL);
+}
+
+static void stop_helper()
+{
+    if (helper_fd >= 0) {
+        unwatch_fd(helper_fd);
+        close(helper_fd);
+        helper_fd = -1;
+    }
+    if (helper_pid > 0) {
+        kill(helper_pid, SIGTERM);
+        waitpid(helper_pid, NULL, 0);
+        helper_pid = -1;
+    }
+    // Fail the requests in flight; they are retried after a restart of tint2
+    while (!g_queue_is_empty(&sent_requests))
+        complete_request(FALSE);
+}
+
+// Reads the available replies. Returns FALSE if the helper is gone.
+static gboolean read_helper_replies()
+{
+    while (helper_fd >= 0) {
+        ssize_t count = read(helper_fd, reply_buffer + reply_buffer_len, sizeof(reply_buffer) - reply_buffer_len);
+        if (count == 0 || (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) ||
+            reply_buffer_len == sizeof(reply_buffer)) {
+            fprintf(stderr, YELLOW "tint2: The svg helper exited" RESET "\n");
+            stop_helper();
+            return FALSE;
+        }
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0)
+            return TRUE;
+        reply_buffer_len += count;
+        int start = 0;
+        for (int i = 0; i < reply_buffer_len; i++) {
+            if (reply_buffer[i] == '\n') {
+                complete_request(reply_buffer[start] == '1');
+                start = i + 1;
+            }
+        }
+        memmove(reply_buffer, reply_buffer + start, reply_buffer_len - start);
+        reply_buffer_len -= start;
+    }
+    return FALSE;
+}
+
+static gchar *get_svg_cache_path(const char *path, int size)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return NULL;
+    gchar *key = g_strdup_printf("%s\t%lld\t%lld\t%d", path, (long long)st.st_mtime, (long long)st.st_size, size);
+    gchar *hash = g_compute_checksum_for_string(G_CHECKSUM_MD5, key, -1);
+    gchar *file_name = g_strdup_printf("%s.png", hash);
+    gchar *cache_path = g_build_filename(g_get_user_cache_dir(), "tint2", "svg", file_name, NULL);
+    g_free(file_name);
+    g_free(hash);
+    g_free(key);
+    return cache_path;
+}
+
+static Imlib_Image load_rendered_svg(const char *cache_path)
+{
+    if (!g_file_test(cache_path, G_FILE_TEST_EXISTS))
+        return NULL;
+    Imlib_Image image = imlib_load_image(cache_path);
+    if (image) {
+        imlib_context_set_image(image);
+        imlib_image_set_changes_on_disk();
+    }
+    return image;
+}
+
+static SvgRequest *find_request(GQueue *queue, const char *cache_path)
+{
+    for (GList *l = queue->head; l; l = l->next) {
+        SvgRequest *request = (SvgRequest *)l->data;
+        if (strcmp(request->cache_path, cache_path) == 0)
+            return request;
+    }
+    return NULL;
+}
+
+static SvgRequest *send_request(const char *path, int size, const char *cache_path)
+{
+    SvgRequest *request = find_request(&sent_requests, cache_path);
+    if (request)
+        return request;
+    if (strpbrk(path, "\t\n") || strpbrk(cache_path, "\t\n") || !start_helper())
+        return NULL;
+
+    gchar *message = g_strdup_printf("%d\t%s\t%s\n", size, cache_path, path);
+    size_t len = strlen(message);
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t count = send(helper_fd, message + sent, len - sent, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd pfd = {.fd = helper_fd, .events = POLLOUT};
+            poll(&pfd, 1, SVG_RENDER_TIMEOUT_MS);
+            continue;
+        }
+        if (count <= 0)
+            break;
+        sent += count;
+    }
+    g_free(message);
+    if (sent < len) {
+        stop_helper();
+        return NULL;
+    }
+
+    request = (SvgRequest *)calloc(1, sizeof(SvgRequest));
+    request->svg_path = strdup(path);
+    request->cache_path = strdup(cache_path);
+    request->size = size;
+    g_queue_push_tail(&sent_requests, request);
+    return request;
+}
+
+Imlib_Image load_image_async(const char *path, int size, ImageLoadedCallback *callback, void *arg, gboolean *pending)
+{
+    *pending = FALSE;
+    if (!g_str_has_suffix(path, ".svg"))
+        return load_image(path, TRUE);
+
+    gchar *cache_path = get_svg_cache_path(path, size);
+    if (!cache_path)
+        return NULL;
+    Imlib_Image image = load_rendered_svg(cache_path);
+    if (image || (failed_renders && g_hash_table_lookup(failed_renders, cache_path))) {
+        g_free(cache_path);
+        return image;
+    }
+
+    SvgRequest *request = send_request(path, size, cache_path);
+    g_free(cache_path);
+    if (!request)
+        return load_image(path, TRUE);
+    SvgCallback *cb = (SvgCallback *)calloc(1, sizeof(SvgCallback));
+    cb->callback = callback;
+    cb->arg = arg;
+    request->callbacks = g_slist_append(request->callbacks, cb);
+    *pending = TRUE;
+    return NULL;
+}
+
+Imlib_Image load_svg_image(const char *path, int size)
+{
+    gchar *cache_path = get_svg_cache_path(path, size);
+    if (!cache_path)
+        return NULL;
+    Imlib_Image image = load_rendered_svg(cache_path);
+    if (!image && !(failed_renders && g_hash_table_lookup(failed_renders, cache_path))) {
+        SvgRequest *request = send_request(path, size, cache_path);
+        // Replies come in order, so the request is answered once it is no longer in the queue
+        while (request && find_request(&sent_requests, cache_path) == request) {
+            struct pollfd pfd = {.fd = helper_fd, .events = POLLIN};
+            if (poll(&pfd, 1, SVG_RENDER_TIMEOUT_MS) == 0) {
+                fprintf(stderr, RED "tint2: The svg helper is not responding, restarting it" RESET "\n");
+                stop_helper();
+                break;
+            }
+            if (!read_helper_replies())
+                break;
+        }
+        image = load_rendered_svg(cache_path);
+    }
+    g_free(cache_path);
+    return image;
+}
+
+static void cancel_callbacks(GQueue *queue, void *arg)
+{
+    for (GList *l = queue->head; l; l = l->next) {
+        SvgRequest *request = (SvgRequest *)l->data;
+        for (GSList *c = request->callbacks; c; c = c->next) {
+            SvgCallback *cb = (SvgCallback *)c->data;
+            if (cb->arg == arg)
+                cb->callback = NULL;
+        }
+    }
+}
+
+void cancel_image_loads(void *arg)
+{
+    cancel_callbacks(&sent_requests, arg);
+    cancel_callbacks(&done_requests, arg);
+}
+
+void handle_svg_loader_events()
+{
+    if (helper_fd < 0)
+        return;
+    read_helper_replies();
+    dispatch_done_requests(NULL);
+}
+
+void cleanup_svg_loader()
+{
+    stop_helper();
+    SvgRequest *request;
+    while ((request = (SvgRequest *)g_queue_pop_head(&done_requests)))
+        free_svg_request(request);
+    if (dispatch_timer_initialized) {
+        destroy_timer(&dispatch_timer);
+        dispatch_timer_initialized = FALSE;
+    }
+    if (failed_renders) {
+        g_hash_table_destroy(failed_renders);
+        failed_renders = NULL;
+    }
+}
+
+#else
+
+Imlib_Image load_image_async(const char *path, int size, ImageLoadedCallback *callback, void *arg, gboolean *pending)
+{
+    *pending = FALSE;
+    return load_image(path, TRUE);
+}
+
+Imlib_Image load_svg_image(const char *path, int size)
+{
+    return NULL;
+}
+
+void cancel_image_loads(void *arg)
+{
+}
+
+void handle_svg_loader_events()
+{
+}
+
+void cleanup_svg_loader()
+{
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef SVG_LOADER_H
+#define SVG_LOADER_H
+
+#include <glib.h>
+#include <Imlib2.h>
+
+// Asynchronous SVG rendering.
+// SVG images are rendered by a long-lived helper process (librsvg allocates a lot of memory, which is kept out of
+// tint2). Rendered images are saved as PNG files in $XDG_CACHE_HOME/tint2/svg, keyed by the path, modification time
+// and size of the SVG, so each icon is rendered only once, even across restarts.
+
+typedef void ImageLoadedCallback(void *arg);
+
+// Loads an image to be displayed at size x size pixels.
+// Images other than SVG are loaded directly with load_image().
+// If an SVG is not rendered yet, returns NULL, sets *pending to TRUE and queues it; callback(arg) is then called from
+// the event loop once the rendering finishes, and calling load_image_async() again returns the image
+// (or NULL with *pending set to FALSE if the rendering failed).
+Imlib_Image load_image_async(const char *path, int size, ImageLoadedCallback *callback, void *arg, gboolean *pending);
+
+// Renders an SVG image and waits for the result. If size is 0, the natural size of the image is used.
+Imlib_Image load_svg_image(const char *path, int size);
+
+// Drops the callbacks registered with arg, e.g. when the object waiting for an image is destroyed.
+void cancel_image_loads(void *arg);
+
+// Handles the finished renderings. Does not block.
+// Called from the event loop when the helper replies.
+void handle_svg_loader_events();
+
+void cleanup_svg_loader();
+
+#endif
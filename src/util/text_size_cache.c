@@ -0,0 +1,189 @@
+/**************************************************************************
+*
+* Tint2 : text size cache
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <X11/Xlib.h>
+#include <cairo.h>
+#include <cairo-xlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "colors.h"
+#include "server.h"
+#include "text_size_cache.h"
+
+// Maximum number of measurements kept in the cache
+#define TEXT_SIZE_CACHE_CAPACITY 2048
+
+typedef struct MeasurementContext {
+    double scale;
+    PangoContext *context;
+} MeasurementContext;
+
+typedef struct TextSizeEntry {
+    // Owns copies of the font description and of the text
+    TextSizeQuery query;
+    int width;
+    int height;
+    // Node in the LRU queue, data points to the entry
+    GList lru_link;
+} TextSizeEntry;
+
+// Each element is a MeasurementContext
+static GList *measurement_contexts = NULL;
+// Key: TextSizeQuery* (pointing inside the entry), value: TextSizeEntry* (owned)
+static GHashTable *text_sizes = NULL;
+// Most recently used entries first
+static GQueue lru = G_QUEUE_INIT;
+
+static unsigned long long num_hits, num_misses, num_evictions;
+
+PangoContext *get_text_measurement_context(double scale)
+{
+    for (GList *l = measurement_contexts; l; l = l->next) {
+        MeasurementContext *mc = (MeasurementContext *)l->data;
+        if (mc->scale == scale)
+            return mc->context;
+    }
+
+    // The context copies the font options (antialiasing, hinting) of the display surface
+    Pixmap pmap = XCreatePixmap(server.display, server.root_win, 1, 1, server.depth);
+    cairo_surface_t *cs = cairo_xlib_surface_create(server.display, pmap, server.visual, 1, 1);
+    cairo_t *c = cairo_create(cs);
+
+    MeasurementContext *mc = (MeasurementContext *)calloc(1, sizeof(MeasurementContext));
+    mc->scale = scale;
+    mc->context = pango_cairo_create_context(c);
+    pango_cairo_context_set_resolution(mc->context, 96 * scale);
+    measurement_contexts = g_list_append(measurement_contexts, mc);
+
+    cairo_destroy(c);
+    cairo_surface_destroy(cs);
+    XFreePixmap(server.display, pmap);
+
+    return mc->context;
+}
+
+static guint text_size_query_hash(gconstpointer key)
+{
+    const TextSizeQuery *q = (const TextSizeQuery *)key;
+    guint hash = pango_font_description_hash(q->font);
+    for (int i = 0; i < q->text_len; i++)
+        hash = hash * 31 + (guchar)q->text[i];
+    hash = hash * 31 + (guint)q->available_width;
+    hash = hash * 31 + (guint)q->available_height;
+    hash = hash * 31 + (guint)q->wrap;
+    hash = hash * 31 + (guint)q->ellipsis;
+    hash = hash * 31 + (guint)q->alignment;
+    hash = hash * 31 + (guint)q->markup;
+    hash = hash * 31 + (guint)(q->scale * 1000);
+    return hash;
+}
+
+static gboolean text_size_query_equal(gconstpointer a, gconstpointer b)
+{
+    const TextSizeQuery *qa = (const TextSizeQuery *)a;
+    const TextSizeQuery *qb = (const TextSizeQuery *)b;
+    return qa->text_len == qb->text_len && qa->available_width == qb->available_width &&
+           qa->available_height == qb->available_height && qa->wrap == qb->wrap && qa->ellipsis == qb->ellipsis &&
+           qa->alignment == qb->alignment && !qa->markup == !qb->markup && qa->scale == qb->scale &&
+           memcmp(qa->text, qb->text, qa->text_len) == 0 && pango_font_description_equal(qa->font, qb->font);
+}
+
+static void free_text_size_entry(gpointer data)
+{
+    TextSizeEntry *entry = (TextSizeEntry *)data;
+    pango_font_description_free((PangoFontDescription *)entry->query.font);
+    free((char *)entry->query.text);
+    free(entry);
+}
+
+gboolean text_size_cache_lookup(const TextSizeQuery *query, int *width, int *height)
+{
+    if (!text_sizes) {
+        num_misses++;
+        return FALSE;
+    }
+    TextSizeEntry *entry = (TextSizeEntry *)g_hash_table_lookup(text_sizes, query);
+    if (!entry) {
+        num_misses++;
+        return FALSE;
+    }
+    g_queue_unlink(&lru, &entry->lru_link);
+    g_queue_push_head_link(&lru, &entry->lru_link);
+    *width = entry->width;
+    *height = entry->height;
+    num_hits++;
+    return TRUE;
+}
+
+void text_size_cache_insert(const TextSizeQuery *query, int width, int height)
+{
+    if (!text_sizes)
+        text_sizes = g_hash_table_new_full(text_size_query_hash, text_size_query_equal, NULL, free_text_size_entry);
+
+    if (g_hash_table_lookup(text_sizes, query))
+        return;
+
+    while (g_hash_table_size(text_sizes) >= TEXT_SIZE_CACHE_CAPACITY) {
+        GList *oldest = g_queue_peek_tail_link(&lru);
+        TextSizeEntry *victim = (TextSizeEntry *)oldest->data;
+        g_queue_unlink(&lru, oldest);
+        g_hash_table_remove(text_sizes, &victim->query);
+        num_evictions++;
+    }
+
+    TextSizeEntry *entry = (TextSizeEntry *)calloc(1, sizeof(TextSizeEntry));
+    entry->query = *query;
+    entry->query.font = pango_font_description_copy(query->font);
+    char *text = (char *)calloc(query->text_len + 1, 1);
+    memcpy(text, query->text, query->text_len);
+    entry->query.text = text;
+    entry->width = width;
+    entry->height = height;
+    entry->lru_link.data = entry;
+    g_queue_push_head_link(&lru, &entry->lru_link);
+    g_hash_table_insert(text_sizes, &entry->query, entry);
+}
+
+void cleanup_text_size_cache()
+{
+    if (text_sizes) {
+        g_queue_init(&lru);
+        g_hash_table_destroy(text_sizes);
+        text_sizes = NULL;
+    }
+    for (GList *l = measurement_contexts; l; l = l->next) {
+        MeasurementContext *mc = (MeasurementContext *)l->data;
+        g_object_unref(mc->context);
+    }
+    g_list_free_full(measurement_contexts, free);
+    measurement_contexts = NULL;
+    num_hits = num_misses = num_evictions = 0;
+}
+
+void text_size_cache_print_stats()
+{
+    fprintf(stderr,
+            BLUE "tint2: text size cache: %llu hits, %llu misses, %llu evictions, %u entries" RESET "\n",
+            num_hits,
+            num_misses,
+            num_evictions,
+            text_sizes ? g_hash_table_size(text_sizes) : 0);
+}
@@ -0,0 +1,42 @@
+#ifndef TEXT_SIZE_CACHE_H
+#define TEXT_SIZE_CACHE_H
+
+#include <glib.h>
+#include <pango/pangocairo.h>
+
+// Text measurement engine used by get_text_size().
+// Measuring text with Pango requires a PangoContext set up for the display; creating one per call is expensive,
+// and the same strings are measured over and over by the resize callbacks (clock, tasks, executors etc.).
+// This module keeps one long-lived PangoContext per scale and an LRU cache of the measured extents.
+
+typedef struct TextSizeQuery {
+    const PangoFontDescription *font;
+    const char *text;
+    int text_len;
+    int available_width;
+    int available_height;
+    PangoWrapMode wrap;
+    PangoEllipsizeMode ellipsis;
+    PangoAlignment alignment;
+    gboolean markup;
+    double scale;
+} TextSizeQuery;
+
+// Returns a PangoContext for measuring text at the given scale. It is owned by the cache, do not unref it.
+// The font options are taken from the display (they do not change while tint2 is running).
+PangoContext *get_text_measurement_context(double scale);
+
+// If the extents of the query are cached, sets width and height and returns TRUE.
+gboolean text_size_cache_lookup(const TextSizeQuery *query, int *width, int *height);
+
+// Adds the extents of a query to the cache, evicting the least recently used entry if the cache is full.
+// The query contents are copied.
+void text_size_cache_insert(const TextSizeQuery *query, int width, int height);
+
+// Releases the cache and the measurement contexts.
+void cleanup_text_size_cache();
+
+// Prints the cache statistics (hits, misses, evictions) on stderr.
+void text_size_cache_print_stats();
+
+#endif
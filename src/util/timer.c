@@ -29,49 +29,140 @@ bool warnings_for_timers = true;
 bool debug_timers = false;
 #define MOCK_ORIGIN 1000000
 
-// All active timers
-static GList *timers = NULL;
+// All registered timers (set of Timer*)
+static GHashTable *timers = NULL;
+// Binary min-heap of the enabled timers, ordered by expiration time.
+// Each timer stores its position in heap_index_ (-1 if it is not in the heap).
+// The array only grows, so rescheduling timers does not allocate.
+static Timer **timer_heap = NULL;
+static int timer_heap_len = 0;
+static int timer_heap_capacity = 0;
+// Serial number of the current (or last) handle_expired_timers() call
+static unsigned long long timer_pass = 0;
 
 long long get_time_ms();
 
 void default_timers()
 {
     timers = NULL;
+    timer_heap = NULL;
+    timer_heap_len = timer_heap_capacity = 0;
+    timer_pass = 0;
 }
 
 void cleanup_timers()
 {
     if (debug_timers)
         fprintf(stderr, "tint2: timers: %s\n", __FUNCTION__);
-    g_list_free(timers);
+    if (timers)
+        g_hash_table_destroy(timers);
     timers = NULL;
+    free(timer_heap);
+    timer_heap = NULL;
+    timer_heap_len = timer_heap_capacity = 0;
+}
+
+static bool timer_is_registered(Timer *timer)
+{
+    return timers && g_hash_table_contains(timers, timer);
+}
+
+static void timer_heap_set(int i, Timer *timer)
+{
+    timer_heap[i] = timer;
+    timer->heap_index_ = i;
+}
+
+static void timer_heap_sift_up(int i)
+{
+    Timer *timer = timer_heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (timer_heap[parent]->expiration_time_ms_ <= timer->expiration_time_ms_)
+            break;
+        timer_heap_set(i, timer_heap[parent]);
+        i = parent;
+    }
+    timer_heap_set(i, timer);
+}
+
+static void timer_heap_sift_down(int i)
+{
+    Timer *timer = timer_heap[i];
+    while (true) {
+        int child = 2 * i + 1;
+        if (child >= timer_heap_len)
+            break;
+        if (child + 1 < timer_heap_len &&
+            timer_heap[child + 1]->expiration_time_ms_ < timer_heap[child]->expiration_time_ms_)
+            child++;
+        if (timer->expiration_time_ms_ <= timer_heap[child]->expiration_time_ms_)
+            break;
+        timer_heap_set(i, timer_heap[child]);
+        i = child;
+    }
+    timer_heap_set(i, timer);
+}
+
+static void timer_heap_insert(Timer *timer)
+{
+    if (timer_heap_len == timer_heap_capacity) {
+        timer_heap_capacity = timer_heap_capacity ? 2 * timer_heap_capacity : 32;
+        timer_heap = (Timer **)realloc(timer_heap, timer_heap_capacity * sizeof(Timer *));
+    }
+    timer_heap_set(timer_heap_len++, timer);
+    timer_heap_sift_up(timer->heap_index_);
+}
+
+static void timer_heap_remove(Timer *timer)
+{
+    int i = timer->heap_index_;
+    if (i < 0)
+        return;
+    timer->heap_index_ = -1;
+    timer_heap_len--;
+    if (i == timer_heap_len)
+        return;
+    timer_heap_set(i, timer_heap[timer_heap_len]);
+    timer_heap_sift_up(i);
+    timer_heap_sift_down(timer_heap[i]->heap_index_);
 }
 
 void init_timer(Timer *timer, const char *name)
 {
     if (debug_timers)
         fprintf(stderr, "tint2: timers: %s: %s, %p\n", __FUNCTION__, name, (void *)timer);
+    bool registered = timer_is_registered(timer);
+    if (registered)
+        timer_heap_remove(timer);
     bzero(timer, sizeof(*timer));
     strncpy(timer->name_, name, sizeof(timer->name_));
-    if (!g_list_find(timers, timer)) {
-        timers = g_list_append(timers, timer);
+    timer->heap_index_ = -1;
+    // Timers created from a callback are not triggered before the next call to handle_expired_timers()
+    timer->handled_pass_ = timer_pass;
+    if (!registered) {
+        if (!timers)
+            timers = g_hash_table_new(g_direct_hash, g_direct_equal);
+        g_hash_table_add(timers, timer);
     }
 }
 
 void destroy_timer(Timer *timer)
 {
-    if (warnings_for_timers && !g_list_find(timers, timer)) {
-        fprintf(stderr, RED "tint2: Attempt to destroy nonexisting timer: %s" RESET "\n", timer->name_);
+    if (!timer_is_registered(timer)) {
+        if (warnings_for_timers)
+            fprintf(stderr, RED "tint2: Attempt to destroy nonexisting timer: %s" RESET "\n", timer->name_);
         return;
     }
     if (debug_timers)
         fprintf(stderr, "tint2: timers: %s: %s, %p\n", __FUNCTION__, timer->name_, (void *)timer);
-    timers = g_list_remove(timers, timer);
+    timer_heap_remove(timer);
+    g_hash_table_remove(timers, timer);
 }
 
 void change_timer(Timer *timer, bool enabled, int delay_ms, int period_ms, TimerCallback *callback, void *arg)
 {
-    if (!g_list_find(timers, timer)) {
+    if (!timer_is_registered(timer)) {
         fprintf(stderr, RED "tint2: Attempt to change unknown timer" RESET "\n");
         init_timer(timer, "unknown");
     }
@@ -80,6 +171,14 @@ void change_timer(Timer *timer, bool enabled, int delay_ms, int period_ms, Timer
     timer->period_ms_ = period_ms;
     timer->callback_ = callback;
     timer->arg_ = arg;
+    if (!enabled) {
+        timer_heap_remove(timer);
+    } else if (timer->heap_index_ < 0) {
+        timer_heap_insert(timer);
+    } else {
+        timer_heap_sift_up(timer->heap_index_);
+        timer_heap_sift_down(timer->heap_index_);
+    }
     if (debug_timers)
         fprintf(stderr,
                 "tint2: timers: %s: %s, %p: %s, expires %lld, period %d\n",
@@ -99,26 +198,16 @@ void stop_timer(Timer *timer)
 struct timeval *get_duration_to_next_timer_expiration()
 {
     static struct timeval result = {0, 0};
-    long long min_expiration_time = -1;
-    Timer *next_timer = NULL;
-    for (GList *it = timers; it; it = it->next) {
-        Timer *timer = (Timer *)it->data;
-        if (!timer->enabled_)
-            continue;
-        if (min_expiration_time < 0 || timer->expiration_time_ms_ < min_expiration_time) {
-            min_expiration_time = timer->expiration_time_ms_;
-            next_timer = timer;
-        }
-    }
-    if (min_expiration_time < 0) {
+    if (!timer_heap_len) {
         if (debug_timers)
             fprintf(stderr,
                     "tint2: timers: %s: no active timer\n",
                     __FUNCTION__);
         return NULL;
     }
+    Timer *next_timer = timer_heap[0];
     long long now = get_time_ms();
-    long long duration = min_expiration_time - now;
+    long long duration = next_timer->expiration_time_ms_ - now;
     if (debug_timers)
         fprintf(stderr,
                 "tint2: timers: %s: t=%lld, %lld to next timer: %s, %p: %s, expires %lld, period %d\n",
@@ -135,67 +224,61 @@ struct timeval *get_duration_to_next_timer_expiration()
     return &result;
 }
 
+// Returns the expired timer with the earliest expiration time that can be triggered in this pass, or NULL.
+// The expired timers form a subtree at the top of the heap, so only that subtree is visited.
+static Timer *find_triggerable_timer(int i, long long now)
+{
+    if (i >= timer_heap_len)
+        return NULL;
+    Timer *timer = timer_heap[i];
+    if (timer->expiration_time_ms_ > now)
+        return NULL;
+    if (timer->callback_ && timer->handled_pass_ != timer_pass)
+        return timer;
+    Timer *left = find_triggerable_timer(2 * i + 1, now);
+    Timer *right = find_triggerable_timer(2 * i + 2, now);
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+    return left->expiration_time_ms_ <= right->expiration_time_ms_ ? left : right;
+}
+
 void handle_expired_timers()
 {
     long long now = get_time_ms();
-    bool expired_timers = false;
-    for (GList *it = timers; it; it = it->next) {
-        Timer *timer = (Timer *)it->data;
-        if (timer->enabled_ && timer->callback_ && timer->expiration_time_ms_ <= now)
-            expired_timers = true;
-    }
-    if (!expired_timers)
+    if (!timer_heap_len || timer_heap[0]->expiration_time_ms_ > now)
         return;
 
-    // We make a copy of the timer list, as the callbacks may create new timers,
-    // which we don't want to trigger in this event loop iteration,
-    // to prevent infinite loops.
-    GList *current_timers = g_list_copy(timers);
-
-    // Mark all timers as not handled.
-    // This is to ensure not triggering a timer more than once per event loop iteration,
-    // in case it is modified from a callback.
-    for (GList *it = current_timers; it; it = it->next) {
-        Timer *timer = (Timer *)it->data;
-        timer->handled_ = false;
-    }
+    // Each timer is triggered at most once per call, even if it is modified from a callback;
+    // timers created by the callbacks wait for the next call, to prevent infinite loops.
+    timer_pass++;
 
-    bool triggered;
-    do {
-        triggered = false;
-        for (GList *it = current_timers; it; it = it->next) {
-            Timer *timer = (Timer *)it->data;
-            // Check that it is still registered.
-            if (!g_list_find(timers, timer))
-                continue;
-            if (!timer->enabled_ || timer->handled_ || !timer->callback_ || timer->expiration_time_ms_ > now)
-                continue;
-            timer->handled_ = true;
-            if (timer->period_ms_ == 0) {
-                // One shot timer, turn it off.
-                timer->enabled_ = false;
-            } else {
-                // Periodic timer, reschedule.
-                timer->expiration_time_ms_ = now + timer->period_ms_;
-            }
-            if (debug_timers)
-                fprintf(stderr,
-                        "tint2: timers: %s: t=%lld, triggering %s, %p: %s, expires %lld, period %d\n",
-                        __FUNCTION__,
-                        now,
-                        timer->name_,
-                        (void *)timer,
-                        timer->enabled_ ? "on" : "off",
-                        timer->expiration_time_ms_,
-                        timer->period_ms_);
-            timer->callback_(timer->arg_);
-            // The callback may have modified timers, so start from scratch
-            triggered = true;
-            break;
+    Timer *timer;
+    // The callbacks may modify the heap, so we search it again after each one
+    while ((timer = find_triggerable_timer(0, now))) {
+        timer->handled_pass_ = timer_pass;
+        if (timer->period_ms_ == 0) {
+            // One shot timer, turn it off.
+            timer->enabled_ = false;
+            timer_heap_remove(timer);
+        } else {
+            // Periodic timer, reschedule.
+            timer->expiration_time_ms_ = now + timer->period_ms_;
+            timer_heap_sift_down(timer->heap_index_);
         }
-    } while (triggered);
-
-    g_list_free(current_timers);
+        if (debug_timers)
+            fprintf(stderr,
+                    "tint2: timers: %s: t=%lld, triggering %s, %p: %s, expires %lld, period %d\n",
+                    __FUNCTION__,
+                    now,
+                    timer->name_,
+                    (void *)timer,
+                    timer->enabled_ ? "on" : "off",
+                    timer->expiration_time_ms_,
+                    timer->period_ms_);
+        timer->callback_(timer->arg_);
+    }
 }
 
 // Time helper functions
@@ -1652,6 +1735,60 @@ TEST(get_duration_to_next_timer_expiration_simple_multi)
     ASSERT_EQUAL(timeval_to_ms(get_duration_to_next_timer_expiration()), 40);
 }
 
+typedef struct {
+    int *order;
+    int id;
+} OrderedCallbackArg;
+
+static int ordered_count = 0;
+
+static void ordered_callback(void *arg)
+{
+    OrderedCallbackArg *a = (OrderedCallbackArg *)arg;
+    a->order[ordered_count++] = a->id;
+}
+
+TEST(change_timer_many_order)
+{
+    u_int64_t origin = MOCK_ORIGIN;
+    const int n = 100;
+    Timer timers_[100];
+    OrderedCallbackArg args[100];
+    int order[100];
+    ordered_count = 0;
+
+    set_mock_time_ms(origin + 0);
+    for (int i = 0; i < n; i++) {
+        init_timer(&timers_[i], "many");
+        args[i].order = order;
+        args[i].id = i;
+        // Deadlines are a permutation of 1..n
+        change_timer(&timers_[i], true, 1 + (i * 37) % n, 0, ordered_callback, &args[i]);
+    }
+    ASSERT_EQUAL(timeval_to_ms(get_duration_to_next_timer_expiration()), 1);
+
+    // Postpone the first timer to expire (deadline 1), disable the second one (deadline 2)
+    change_timer(&timers_[0], true, 500, 0, ordered_callback, &args[0]);
+    stop_timer(&timers_[73]);
+    ASSERT_EQUAL(timeval_to_ms(get_duration_to_next_timer_expiration()), 3);
+
+    for (int t = 1; t <= n; t++) {
+        set_mock_time_ms(origin + t);
+        handle_expired_timers();
+    }
+    ASSERT_EQUAL(ordered_count, n - 2);
+    for (int k = 1; k < n - 2; k++) {
+        int prev = order[k - 1];
+        int cur = order[k];
+        ASSERT((1 + (prev * 37) % n) < (1 + (cur * 37) % n));
+    }
+    ASSERT_EQUAL(timeval_to_ms(get_duration_to_next_timer_expiration()), 400);
+
+    for (int i = 0; i < n; i++)
+        destroy_timer(&timers_[i]);
+    ASSERT_EQUAL(timeval_to_ms(get_duration_to_next_timer_expiration()), -1);
+}
+
 TEST(cleanup_timers_simple)
 {
     u_int64_t origin = MOCK_ORIGIN;
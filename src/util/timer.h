@@ -35,10 +35,13 @@ typedef struct {
     int period_ms_;
     TimerCallback *callback_;
     void *arg_;
-    bool handled_;
+    // Position in the heap of enabled timers, or -1
+    int heap_index_;
+    // Last call of handle_expired_timers() during which the timer was triggered or created
+    unsigned long long handled_pass_;
 } Timer;
 
-#define DEFAULT_TIMER {"", 0, 0, 0, 0, 0, 0}
+#define DEFAULT_TIMER {"", 0, 0, 0, 0, 0, -1, 0}
 
 #define INIT_TIMER(t) init_timer(&t, #t)
 
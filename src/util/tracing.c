@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define GREEN "\033[1;32m"
 #define YELLOW "\033[1;33m"
@@ -16,8 +17,8 @@
 #define BLUE "\033[1;34m"
 #define RESET "\033[0m"
 
-static GList *tracing_events = NULL;
-static sig_atomic_t tracing = FALSE;
+// Number of events kept; when a frame records more, the oldest ones are overwritten. Must be a power of 2.
+#define TRACING_BUFFER_SIZE (1 << 18)
 
 typedef struct TracingEvent {
     void *address;
@@ -26,50 +27,42 @@ typedef struct TracingEvent {
     gboolean enter;
 } TracingEvent;
 
+// Preallocated ring buffer: recording an event only fills in a slot, symbols are resolved when saving
+static TracingEvent *tracing_events = NULL;
+// Number of events recorded since the tracing started, including the overwritten ones
+static unsigned long tracing_events_count = 0;
+static sig_atomic_t tracing = FALSE;
+
 void __attribute__ ((constructor)) init_tracing()
 {
     tracing_events = NULL;
+    tracing_events_count = 0;
     tracing = FALSE;
 }
 
 void cleanup_tracing()
 {
-    g_list_free_full(tracing_events, free);
-    tracing_events = NULL;
     tracing = FALSE;
+    free(tracing_events);
+    tracing_events = NULL;
+    tracing_events_count = 0;
 }
 
-char *addr2name(void *func)
-{
-#ifdef ENABLE_EXECINFO
-    void *array[1];
-    array[0] = func;
-    char **strings = backtrace_symbols(array, 1);
-    char *result = strdup(strings[0] ? strings[0] : "??");
-    free(strings);
-    return result;
-#else
-    const size_t buf_size = 32;
-    char *result = (char*) calloc(buf_size, 1);
-    snprintf(result, buf_size, "%p", func);
-    return result;
-#endif
-}
-
-void add_tracing_event(void *func, void *caller, gboolean enter)
+static void add_tracing_event(void *func, void *caller, gboolean enter)
 {
-    TracingEvent *entry = (TracingEvent *)calloc(sizeof(TracingEvent), 1);
+    unsigned long i = __atomic_fetch_add(&tracing_events_count, 1, __ATOMIC_RELAXED);
+    TracingEvent *entry = &tracing_events[i & (TRACING_BUFFER_SIZE - 1)];
     entry->address = func;
     entry->caller = caller;
     entry->time = get_time();
     entry->enter = enter;
-    tracing_events = g_list_append(tracing_events, entry);
 }
 
 void start_tracing(void *root)
 {
-    if (tracing_events)
-        cleanup_tracing();
+    if (!tracing_events)
+        tracing_events = (TracingEvent *)calloc(TRACING_BUFFER_SIZE, sizeof(TracingEvent));
+    tracing_events_count = 0;
     add_tracing_event(root, NULL, TRUE);
     tracing = TRUE;
 }
@@ -91,75 +84,143 @@ void __cyg_profile_func_exit(void *func, void *caller)
         add_tracing_event(func, caller, FALSE);
 }
 
-void print_tracing_events()
+// Returns the name of the function in a backtrace_symbols() string such as "tint2(draw+0x1f) [0x4a2b3c]",
+// or the whole string if it has no function name.
+static char *symbol_to_name(const char *symbol)
 {
-    GList *stack = NULL;
-    int depth = 0;
-    double now = get_time();
-    for (GList *i = tracing_events; i; i = i->next) {
-        TracingEvent *e = (TracingEvent *)i->data;
-        if (e->enter) {
-            // Push a new function on the stack
-            for (int d = 0; d < depth; d++)
-                fprintf(stderr, "tint2:  ");
-            char *name = addr2name(e->address);
-            char *caller = addr2name(e->caller);
-            fprintf(stderr,
-                    "%s called from %s\n",
-                    name,
-                    caller);
-            stack = g_list_append(stack, e);
-            depth++;
-        } else {
-            // Pop a function from the stack, if matching, and print
-            if (stack) {
-                TracingEvent *old = (TracingEvent *)g_list_last(stack)->data;
-                if (old->address == e->address) {
-                    depth--;
-                    for (int d = 0; d < depth; d++)
-                        fprintf(stderr, "tint2:  ");
-                    char *name = addr2name(e->address);
-                    double duration = (e->time - old->time) * 1.0e3;
-                    fprintf(stderr,
-                            "-- %s exited after %.1f ms",
-                            name,
-                            duration);
-                    if (duration >= 1.0) {
-                        fprintf(stderr, YELLOW "tint2:  ");
-                        for (int d = 0; d < duration; d++) {
-                            fprintf(stderr, "tint2: #");
-                        }
-                        fprintf(stderr, RESET);
-                    }
-                    fprintf(stderr, "tint2: \n");
-                    free(name);
-                    stack = g_list_delete_link(stack, g_list_last(stack));
-                }
+    const char *start = strchr(symbol, '(');
+    if (start) {
+        start++;
+        size_t len = strcspn(start, "+)");
+        if (len > 0)
+            return g_strndup(start, len);
+    }
+    return g_strdup(symbol);
+}
+
+// Resolves all the addresses in one call. Returns a table from address to name (owned).
+static GHashTable *resolve_tracing_symbols(unsigned long first, unsigned long last)
+{
+    GHashTable *names = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    GPtrArray *addresses = g_ptr_array_new();
+    for (unsigned long i = first; i < last; i++) {
+        TracingEvent *e = &tracing_events[i & (TRACING_BUFFER_SIZE - 1)];
+        void *both[2] = {e->address, e->caller};
+        for (int j = 0; j < 2; j++) {
+            if (both[j] && !g_hash_table_contains(names, both[j])) {
+                g_hash_table_insert(names, both[j], NULL);
+                g_ptr_array_add(addresses, both[j]);
             }
         }
     }
-    while (stack) {
-        TracingEvent *old = (TracingEvent *)g_list_last(stack)->data;
-        depth--;
-        for (int d = 0; d < depth; d++)
-            fprintf(stderr, "tint2:  ");
-        char *name = addr2name(old->address);
-        double duration = (now - old->time) * 1.0e3;
-        fprintf(stderr,
-                "-- %s exited after %.1f ms",
-                name,
-                duration);
-        if (duration >= 1.0) {
-            fprintf(stderr, YELLOW "tint2:  ");
-            for (int d = 0; d < duration; d++) {
-                fprintf(stderr, "tint2: #");
-            }
-            fprintf(stderr, RESET);
+#ifdef ENABLE_EXECINFO
+    char **strings = addresses->len ? backtrace_symbols(addresses->pdata, (int)addresses->len) : NULL;
+#endif
+    for (guint i = 0; i < addresses->len; i++) {
+        char *name;
+#ifdef ENABLE_EXECINFO
+        if (strings && strings[i])
+            name = symbol_to_name(strings[i]);
+        else
+#endif
+            name = g_strdup_printf("%p", addresses->pdata[i]);
+        g_hash_table_insert(names, addresses->pdata[i], name);
+    }
+#ifdef ENABLE_EXECINFO
+    free(strings);
+#endif
+    g_ptr_array_free(addresses, TRUE);
+    return names;
+}
+
+static void write_json_string(FILE *f, const char *s)
+{
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(f, "\\u%04x", *s);
+        else
+            fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void write_trace_event(FILE *f,
+                              gboolean *first_event,
+                              const char *phase,
+                              const char *name,
+                              const char *caller,
+                              double time,
+                              double start_time)
+{
+    fprintf(f,
+            "%s\n{\"ph\":\"%s\",\"pid\":%d,\"tid\":1,\"ts\":%.3f,\"name\":",
+            *first_event ? "" : ",",
+            phase,
+            getpid(),
+            (time - start_time) * 1.0e6);
+    write_json_string(f, name);
+    if (caller) {
+        fprintf(f, ",\"args\":{\"caller\":");
+        write_json_string(f, caller);
+        fprintf(f, "}");
+    }
+    fprintf(f, "}");
+    *first_event = FALSE;
+}
+
+void save_tracing_events(const char *path)
+{
+    unsigned long last = tracing_events_count;
+    if (!tracing_events || !last)
+        return;
+    unsigned long first = last > TRACING_BUFFER_SIZE ? last - TRACING_BUFFER_SIZE : 0;
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, RED "tint2: could not write trace %s" RESET "\n", path);
+        return;
+    }
+
+    GHashTable *names = resolve_tracing_symbols(first, last);
+    double start_time = tracing_events[first & (TRACING_BUFFER_SIZE - 1)].time;
+    double end_time = get_time();
+    // Stack of the functions entered, to drop the exits whose entry has been overwritten
+    // and to close the functions still running at the end
+    GArray *stack = g_array_new(FALSE, FALSE, sizeof(TracingEvent *));
+    gboolean first_event = TRUE;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (unsigned long i = first; i < last; i++) {
+        TracingEvent *e = &tracing_events[i & (TRACING_BUFFER_SIZE - 1)];
+        const char *name = g_hash_table_lookup(names, e->address);
+        if (e->enter) {
+            const char *caller = e->caller ? g_hash_table_lookup(names, e->caller) : NULL;
+            write_trace_event(f, &first_event, "B", name, caller, e->time, start_time);
+            g_array_append_val(stack, e);
+        } else if (stack->len &&
+                   g_array_index(stack, TracingEvent *, stack->len - 1)->address == e->address) {
+            write_trace_event(f, &first_event, "E", name, NULL, e->time, start_time);
+            g_array_set_size(stack, stack->len - 1);
         }
-        fprintf(stderr, "tint2: \n");
-        free(name);
-        stack = g_list_delete_link(stack, g_list_last(stack));
     }
+    while (stack->len) {
+        TracingEvent *e = g_array_index(stack, TracingEvent *, stack->len - 1);
+        write_trace_event(f, &first_event, "E", g_hash_table_lookup(names, e->address), NULL, end_time, start_time);
+        g_array_set_size(stack, stack->len - 1);
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    fprintf(stderr,
+            YELLOW "tint2: slow frame traced to %s (%lu events%s), open it in chrome://tracing or ui.perfetto.dev" RESET
+                   "\n",
+            path,
+            last - first,
+            first ? ", oldest ones dropped" : "");
+    g_array_free(stack, TRUE);
+    g_hash_table_destroy(names);
 }
 
 #endif
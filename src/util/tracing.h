@@ -8,7 +8,10 @@ void cleanup_tracing();
 
 void start_tracing(void *root);
 void stop_tracing();
-void print_tracing_events();
+
+// Writes the events recorded since start_tracing() to path, in the Chrome trace event JSON format
+// (viewable in chrome://tracing or ui.perfetto.dev).
+void save_tracing_events(const char *path);
 
 #endif
 
@@ -33,6 +33,7 @@ int uevent_fd = -1;
 #include <linux/netlink.h>
 
 #include "common.h"
+#include "event_loop.h"
 
 static struct sockaddr_nl nls;
 static GList *notifiers = NULL;
@@ -173,6 +174,11 @@ void uevent_handler()
     }
 }
 
+static void uevent_fd_ready(int fd, void *arg)
+{
+    uevent_handler();
+}
+
 int uevent_init()
 {
     /* Open hotplug event netlink socket */
@@ -194,6 +200,7 @@ int uevent_init()
         return -1;
     }
 
+    watch_fd(uevent_fd, uevent_fd_ready, NULL);
     fprintf(stderr, "tint2: Kernel uevent interface initialized...\n");
 
     return uevent_fd;
@@ -201,8 +208,11 @@ int uevent_init()
 
 void uevent_cleanup()
 {
-    if (uevent_fd >= 0)
+    if (uevent_fd >= 0) {
+        unwatch_fd(uevent_fd);
         close(uevent_fd);
+    }
+    uevent_fd = -1;
 }
 
 #endif
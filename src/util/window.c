@@ -35,6 +35,7 @@
 #include <sys/ipc.h>
 #include <sys/shm.h>
 
+#include "async_property.h"
 #include "common.h"
 #include "window.h"
 #include "server.h"
@@ -67,9 +68,17 @@ void toggle_window_maximized(Window win)
     send_event32(win, server.atom._NET_WM_STATE, 2, server.atom._NET_WM_STATE_MAXIMIZED_HORZ, 0);
 }
 
+static Window get_transient_for(Window win)
+{
+    int count;
+    Window *transient_for = server_get_property(win, XA_WM_TRANSIENT_FOR, XA_WINDOW, &count);
+    Window result = (transient_for && count > 0) ? transient_for[0] : None;
+    XFree(transient_for);
+    return result;
+}
+
 gboolean window_is_hidden(Window win)
 {
-    Window window;
     int count;
 
     Atom *at = server_get_property(win, server.atom._NET_WM_STATE, XA_ATOM, &count);
@@ -79,8 +88,7 @@ gboolean window_is_hidden(Window win)
             return TRUE;
         }
         // do not add transient_for windows if the transient window is already in the taskbar
-        window = win;
-        while (XGetTransientForHint(server.display, window, &window)) {
+        for (Window window = get_transient_for(win); window; window = get_transient_for(window)) {
             if (get_task_buttons(window)) {
                 XFree(at);
                 return TRUE;
@@ -199,6 +207,10 @@ int get_window_monitor(Window win)
 
 gboolean get_window_coordinates(Window win, int *x, int *y, int *w, int *h)
 {
+    gboolean ok;
+    if (take_prefetched_geometry(win, &ok, x, y, w, h))
+        return ok;
+
     int dummy_int;
     unsigned ww, wh, bw, bh;
     Window src;
@@ -267,71 +279,170 @@ gboolean window_is_active(Window win)
     return (win == get_property32(server.root_win, server.atom._NET_ACTIVE_WINDOW, XA_WINDOW));
 }
 
-int get_icon_count(gulong *data, int num)
+// Number of 32-bit items of _NET_WM_ICON read by the first request.
+// Properties that fit are fetched in a single round-trip; for larger ones only the image headers
+// and the selected image are transferred.
+#define ICON_PROPERTY_CHUNK 16384
+
+// Reads `length` items of the _NET_WM_ICON property starting at item `offset`.
+// Note: needs to be released with XFree().
+static gulong *read_icon_property(Window win, long offset, long length, long *num_items, long *num_after)
 {
-    int count, pos, w, h;
-
-    count = 0;
-    pos = 0;
-    while (pos + 2 < num) {
-        w = data[pos++];
-        h = data[pos++];
-        pos += w * h;
-        if (pos > num || w <= 0 || h <= 0)
-            break;
-        count++;
+    Atom type_ret;
+    int format_ret = 0;
+    unsigned long nitems_ret = 0;
+    unsigned long bafter_ret = 0;
+    unsigned char *prop_value = NULL;
+
+    int num_prefetched;
+    void *prefetched;
+    if (take_prefetched_property(win,
+                                 server.atom._NET_WM_ICON,
+                                 XA_CARDINAL,
+                                 offset,
+                                 length,
+                                 &prefetched,
+                                 &num_prefetched,
+                                 &bafter_ret)) {
+        if (!prefetched)
+            return NULL;
+        *num_items = num_prefetched;
+        if (num_after)
+            *num_after = (long)(bafter_ret / 4);
+        return (gulong *)prefetched;
+    }
+
+    int result = XGetWindowProperty(server.display,
+                                    win,
+                                    server.atom._NET_WM_ICON,
+                                    offset,
+                                    length,
+                                    False,
+                                    XA_CARDINAL,
+                                    &type_ret,
+                                    &format_ret,
+                                    &nitems_ret,
+                                    &bafter_ret,
+                                    &prop_value);
+    if (result != Success || !prop_value || type_ret != XA_CARDINAL || format_ret != 32) {
+        if (prop_value)
+            XFree(prop_value);
+        return NULL;
     }
-
-    return count;
+    *num_items = (long)nitems_ret;
+    if (num_after)
+        *num_after = (long)(bafter_ret / 4);
+    return (gulong *)prop_value;
 }
 
-gulong *get_best_icon(gulong *data, int icon_count, int num, int *iw, int *ih, int best_icon_size)
+guint32 *get_window_icon_argb(Window win, int best_icon_size, int *iw, int *ih)
 {
-    if (icon_count < 1 || num < 1)
+    if (!win)
         return NULL;
 
-    int width[icon_count], height[icon_count], pos, i, w, h;
-    gulong *icon_data[icon_count];
-
-    /* List up icons */
-    pos = 0;
-    i = icon_count;
-    while (i--) {
-        w = data[pos++];
-        h = data[pos++];
-        if (pos + w * h > num)
-            break;
-
-        width[i] = w;
-        height[i] = h;
-        icon_data[i] = &data[pos];
-
-        pos += w * h;
-    }
-
-    /* Try to find exact size */
-    int icon_num = -1;
-    for (i = 0; i < icon_count; i++) {
-        if (width[i] == best_icon_size) {
-            icon_num = i;
+    long chunk_len, num_after;
+    gulong *chunk = read_icon_property(win, 0, ICON_PROPERTY_CHUNK, &chunk_len, &num_after);
+    if (!chunk)
+        return NULL;
+    long total = chunk_len + num_after;
+
+    // Pick the image with the requested width, otherwise the smallest larger one, otherwise the largest one
+    long best_pos = -1;
+    int best_w = 0, best_h = 0;
+    long pos = 0;
+    while (pos + 2 <= total) {
+        long w, h;
+        if (pos + 2 <= chunk_len) {
+            w = (long)chunk[pos];
+            h = (long)chunk[pos + 1];
+        } else {
+            long n;
+            gulong *header = read_icon_property(win, pos, 2, &n, NULL);
+            if (!header)
+                break;
+            w = n == 2 ? (long)header[0] : 0;
+            h = n == 2 ? (long)header[1] : 0;
+            XFree(header);
+        }
+        if (w <= 0 || h <= 0 || w > 4096 || h > 4096 || w * h > total - pos - 2)
             break;
+        gboolean better;
+        if (best_pos < 0)
+            better = TRUE;
+        else if (best_w == best_icon_size)
+            better = FALSE;
+        else if (w == best_icon_size)
+            better = TRUE;
+        else if (best_w > best_icon_size)
+            better = w > best_icon_size && w < best_w;
+        else
+            better = w > best_w;
+        if (better) {
+            best_pos = pos;
+            best_w = (int)w;
+            best_h = (int)h;
         }
-    }
-
-    /* Take the biggest or whatever */
-    if (icon_num < 0) {
-        int highest = 0;
-        for (i = 0; i < icon_count; i++) {
-            if (width[i] > highest) {
-                icon_num = i;
-                highest = width[i];
-            }
+        pos += 2 + w * h;
+    }
+
+    guint32 *result = NULL;
+    if (best_pos >= 0) {
+        long num_pixels = (long)best_w * best_h;
+        gulong *pixels = NULL;
+        gulong *fetched = NULL;
+        if (best_pos + 2 + num_pixels <= chunk_len) {
+            pixels = chunk + best_pos + 2;
+        } else {
+            long n;
+            fetched = read_icon_property(win, best_pos + 2, num_pixels, &n, NULL);
+            if (fetched && n == num_pixels)
+                pixels = fetched;
+        }
+        if (pixels) {
+            result = malloc(num_pixels * sizeof(guint32));
+            // The property items are longs, only the low 32 bits are significant
+            for (long i = 0; i < num_pixels; i++)
+                result[i] = (guint32)pixels[i];
+            *iw = best_w;
+            *ih = best_h;
         }
+        if (fetched)
+            XFree(fetched);
     }
+    XFree(chunk);
+    return result;
+}
 
-    *iw = width[icon_num];
-    *ih = height[icon_num];
-    return icon_data[icon_num];
+char *get_window_class(Window win)
+{
+    // WM_CLASS contains the instance name and the class name, both null-terminated
+    int len;
+    char *wm_class = server_get_property(win, XA_WM_CLASS, XA_STRING, &len);
+    if (!wm_class)
+        return NULL;
+    size_t name_len = strnlen(wm_class, len);
+    char *result = name_len < (size_t)len ? strndup(wm_class + name_len + 1, len - name_len - 1) : strdup("");
+    XFree(wm_class);
+    return result;
+}
+
+void prefetch_windows(const Window *windows, int num_windows)
+{
+    Atom properties[][2] = {{server.atom._NET_WM_STATE, XA_ATOM},
+                            {server.atom._NET_WM_WINDOW_TYPE, XA_ATOM},
+                            {XA_WM_TRANSIENT_FOR, XA_WINDOW},
+                            {server.atom._NET_WM_DESKTOP, XA_CARDINAL},
+                            {server.atom._NET_WM_VISIBLE_NAME, server.atom.UTF8_STRING},
+                            {server.atom._NET_WM_NAME, server.atom.UTF8_STRING},
+                            {server.atom.WM_NAME, XA_STRING},
+                            {XA_WM_CLASS, XA_STRING}};
+    for (int i = 0; i < num_windows; i++) {
+        for (int j = 0; j < sizeof(properties) / sizeof(properties[0]); j++)
+            prefetch_property(windows[i], properties[j][0], properties[j][1], 0, 0x7fffffff);
+        if (panel_config.g_task.has_icon || panel_config.g_task.has_content_tint)
+            prefetch_property(windows[i], server.atom._NET_WM_ICON, XA_CARDINAL, 0, ICON_PROPERTY_CHUNK);
+        prefetch_window_geometry(windows[i]);
+    }
 }
 
 // Thanks zcodes!
@@ -363,29 +474,140 @@ char *get_window_name(Window win)
     return result;
 }
 
-void smooth_thumbnail(cairo_surface_t *image_surface)
+// A single shared memory segment is kept attached to the X server between captures.
+// It is grown to fit the largest window seen so far and released by cleanup_thumbnails().
+static XShmSegmentInfo thumbnail_shm = {.shmid = -1, .shmaddr = (char *)-1};
+static size_t thumbnail_shm_size = 0;
+
+static void release_thumbnail_shm()
+{
+    if (thumbnail_shm_size) {
+        XShmDetach(server.display, &thumbnail_shm);
+        XSync(server.display, False);
+    }
+    if (thumbnail_shm.shmaddr != (char *)-1)
+        shmdt(thumbnail_shm.shmaddr);
+    if (thumbnail_shm.shmid >= 0)
+        shmctl(thumbnail_shm.shmid, IPC_RMID, NULL);
+    thumbnail_shm.shmid = -1;
+    thumbnail_shm.shmaddr = (char *)-1;
+    thumbnail_shm_size = 0;
+}
+
+static gboolean reserve_thumbnail_shm(size_t size)
+{
+    if (size <= thumbnail_shm_size)
+        return TRUE;
+    release_thumbnail_shm();
+
+    // Round up to avoid reallocating for windows that grow by a few pixels
+    size = (size + 0xfffff) & ~(size_t)0xfffff;
+    thumbnail_shm.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+    if (thumbnail_shm.shmid < 0) {
+        fprintf(stderr, RED "tint2: !shmget" RESET "\n");
+        return FALSE;
+    }
+    thumbnail_shm.shmaddr = (char *)shmat(thumbnail_shm.shmid, 0, 0);
+    // Mark the segment for deletion right away, it is destroyed once tint2 and the X server detach from it
+    shmctl(thumbnail_shm.shmid, IPC_RMID, NULL);
+    if (thumbnail_shm.shmaddr == (char *)-1) {
+        fprintf(stderr, RED "tint2: !shmat" RESET "\n");
+        thumbnail_shm.shmid = -1;
+        return FALSE;
+    }
+    thumbnail_shm.readOnly = False;
+    if (!XShmAttach(server.display, &thumbnail_shm)) {
+        fprintf(stderr, RED "tint2: !xshmattach" RESET "\n");
+        shmdt(thumbnail_shm.shmaddr);
+        thumbnail_shm.shmaddr = (char *)-1;
+        thumbnail_shm.shmid = -1;
+        return FALSE;
+    }
+    thumbnail_shm_size = size;
+    if (debug_thumbnails)
+        fprintf(stderr, "tint2: thumbnail shm segment resized to %zu bytes\n", size);
+    return TRUE;
+}
+
+void cleanup_thumbnails()
+{
+    release_thumbnail_shm();
+}
+
+static int mask_shift(u_int32_t mask)
 {
-    u_int32_t *data = (u_int32_t *)cairo_image_surface_get_data(image_surface);
-    const size_t tw = cairo_image_surface_get_width(image_surface);
-    const size_t th = cairo_image_surface_get_height(image_surface);
-    const size_t rmask = 0xff0000;
-    const size_t gmask = 0xff00;
-    const size_t bmask = 0xff;
-    for (size_t i = 0; i < tw * (th - 1) - 1 && i < tw * th; i++) {
-        u_int32_t c1 = data[i];
-        u_int32_t c2 = data[i + 1];
-        u_int32_t c3 = data[i + tw];
-        u_int32_t c4 = data[i + tw + 1];
-        u_int32_t b = (5 * (c1 & bmask) + 1 * (c2 & bmask) + 1 * (c3 & bmask) + 1 * (c4 & bmask)) / 8;
-        u_int32_t g = (5 * (c1 & gmask) + 1 * (c2 & gmask) + 1 * (c3 & gmask) + 1 * (c4 & gmask)) / 8;
-        u_int32_t r = (5 * (c1 & rmask) + 1 * (c2 & rmask) + 1 * (c3 & rmask) + 1 * (c4 & rmask)) / 8;
-        data[i] = (r & rmask) | (g & gmask) | (b & bmask);
+    int shift = 0;
+    while (mask && !(mask & 1)) {
+        mask >>= 1;
+        shift++;
     }
+    return shift;
 }
 
-// This is measured to be slightly faster.
-#define GetPixel(ximg, x, y) ((u_int32_t *)&(ximg->data[y * ximg->bytes_per_line]))[x]
-//#define GetPixel XGetPixel
+// Downscales the w x h image to fw x th with a box filter, writing rgb24 pixels to dst at column ox.
+// Windows smaller than the thumbnail are upscaled: each box then covers a single source pixel.
+// Each source row is split into channels and accumulated column-wise, which the compiler can vectorize;
+// the columns are then reduced to the thumbnail pixels they cover.
+static void downscale_ximage(XImage *ximg,
+                             size_t w,
+                             size_t h,
+                             u_int32_t *dst,
+                             size_t dst_stride,
+                             size_t ox,
+                             size_t fw,
+                             size_t th)
+{
+    const u_int32_t rmask = (u_int32_t)ximg->red_mask;
+    const u_int32_t gmask = (u_int32_t)ximg->green_mask;
+    const u_int32_t bmask = (u_int32_t)ximg->blue_mask;
+    const int rshift = mask_shift(rmask);
+    const int gshift = mask_shift(gmask);
+    const int bshift = mask_shift(bmask);
+
+    u_int32_t *acc = (u_int32_t *)calloc(3 * w, sizeof(u_int32_t));
+    u_int32_t *acc_r = acc;
+    u_int32_t *acc_g = acc + w;
+    u_int32_t *acc_b = acc + 2 * w;
+    // Source column span of each thumbnail column: [x_start[xt], x_start[xt + 1])
+    size_t *x_start = (size_t *)calloc(fw + 1, sizeof(size_t));
+    for (size_t xt = 0; xt <= fw; xt++)
+        x_start[xt] = xt * w / fw;
+
+    for (size_t yt = 0; yt < th; yt++) {
+        size_t y0 = yt * h / th;
+        size_t y1 = (yt + 1) * h / th;
+        if (y1 <= y0)
+            y1 = y0 + 1;
+        memset(acc, 0, 3 * w * sizeof(u_int32_t));
+        for (size_t y = y0; y < y1; y++) {
+            const u_int32_t *restrict src = (const u_int32_t *)&ximg->data[y * ximg->bytes_per_line];
+            for (size_t x = 0; x < w; x++) {
+                u_int32_t c = src[x];
+                acc_r[x] += ((c & rmask) >> rshift) & 0xff;
+                acc_g[x] += ((c & gmask) >> gshift) & 0xff;
+                acc_b[x] += ((c & bmask) >> bshift) & 0xff;
+            }
+        }
+        u_int32_t *row = dst + yt * dst_stride + ox;
+        for (size_t xt = 0; xt < fw; xt++) {
+            size_t x0 = x_start[xt];
+            size_t x1 = x_start[xt + 1];
+            if (x1 <= x0)
+                x1 = x0 + 1;
+            u_int32_t r = 0, g = 0, b = 0;
+            for (size_t x = x0; x < x1; x++) {
+                r += acc_r[x];
+                g += acc_g[x];
+                b += acc_b[x];
+            }
+            u_int32_t n = (u_int32_t)((x1 - x0) * (y1 - y0));
+            row[xt] = ((r / n) << 16) | ((g / n) << 8) | (b / n);
+        }
+    }
+
+    free(x_start);
+    free(acc);
+}
 
 cairo_surface_t *get_window_thumbnail_ximage(Window win, size_t size, gboolean use_shm)
 {
@@ -443,7 +665,6 @@ cairo_surface_t *get_window_thumbnail_ximage(Window win, size_t size, gboolean u
         goto err0;
     }
 
-    XShmSegmentInfo shminfo;
     XImage *ximg;
     if (use_shm)
         ximg = XShmCreateImage(server.display,
@@ -451,7 +672,7 @@ cairo_surface_t *get_window_thumbnail_ximage(Window win, size_t size, gboolean u
                                (unsigned)wa.depth,
                                ZPixmap,
                                NULL,
-                               &shminfo,
+                               &thumbnail_shm,
                                (unsigned)w,
                                (unsigned)h);
     else
@@ -465,24 +686,12 @@ cairo_surface_t *get_window_thumbnail_ximage(Window win, size_t size, gboolean u
         goto err1;
     }
     if (use_shm) {
-        shminfo.shmid = shmget(IPC_PRIVATE, (size_t)(ximg->bytes_per_line * ximg->height), IPC_CREAT | 0777);
-        if (shminfo.shmid < 0) {
-            fprintf(stderr, RED "tint2: !shmget" RESET "\n");
+        if (!reserve_thumbnail_shm((size_t)ximg->bytes_per_line * (size_t)ximg->height))
             goto err1;
-        }
-        shminfo.shmaddr = ximg->data = (char *)shmat(shminfo.shmid, 0, 0);
-        if (shminfo.shmaddr == (void*)-1) {
-            fprintf(stderr, RED "tint2: !shmat" RESET "\n");
-            goto err2;
-        }
-        shminfo.readOnly = False;
-        if (!XShmAttach(server.display, &shminfo)) {
-            fprintf(stderr, RED "tint2: !xshmattach" RESET "\n");
-            goto err3;
-        }
+        ximg->data = thumbnail_shm.shmaddr;
         if (!XShmGetImage(server.display, win, ximg, 0, 0, AllPlanes)) {
             fprintf(stderr, RED "tint2: !xshmgetimage" RESET "\n");
-            goto err4;
+            goto err1;
         }
     }
 
@@ -491,7 +700,7 @@ cairo_surface_t *get_window_thumbnail_ximage(Window win, size_t size, gboolean u
         if (debug_thumbnails) {
             fprintf(stderr, "tint2: could not get thumbnail, window not viewable\n");
         }
-        goto err4;
+        goto err1;
     }
 
     if (debug_thumbnails) {
@@ -502,103 +711,17 @@ cairo_surface_t *get_window_thumbnail_ximage(Window win, size_t size, gboolean u
 
     result = cairo_image_surface_create(CAIRO_FORMAT_RGB24, (int)tw, (int)th);
     u_int32_t *data = (u_int32_t *)cairo_image_surface_get_data(result);
-    memset(data, 0, tw * th);
-
-    // Fixed-point precision
-    const size_t prec = 1 << 16;
-    const size_t xstep = w * prec / fw;
-    const size_t ystep = h * prec / th;
-
-    const size_t offset_y1 = 0 * ystep / 8;
-    const size_t offset_x1 = 3 * xstep / 8;
-
-    const size_t offset_y2 = 1 * ystep / 8;
-    const size_t offset_x2 = 6 * xstep / 8;
-
-    const size_t offset_y3 = 4 * ystep / 8;
-    const size_t offset_x3 = 2 * xstep / 8;
-
-    const size_t offset_y4 = 4 * ystep / 8;
-    const size_t offset_x4 = 4 * xstep / 8;
-
-    const size_t offset_y5 = 4 * ystep / 8;
-    const size_t offset_x5 = 7 * xstep / 8;
-
-    const size_t offset_y6 = 6 * ystep / 8;
-    const size_t offset_x6 = 1 * xstep / 8;
-
-    const size_t offset_y7 = 7 * ystep / 8;
-    const size_t offset_x7 = 6 * xstep / 8;
-
-    const u_int32_t rmask = (u_int32_t)ximg->red_mask;
-    const u_int32_t gmask = (u_int32_t)ximg->green_mask;
-    const u_int32_t bmask = (u_int32_t)ximg->blue_mask;
-    for (size_t yt = 0, y = 0; yt < th; yt++, y += ystep) {
-        for (size_t xt = 0, x = 0; xt < fw; xt++, x += xstep) {
-            size_t j = yt * tw + ox + xt;
-            if (j < tw * th) {
-                u_int32_t c1 = (u_int32_t)GetPixel(ximg, (int)((x + offset_x1) / prec), (int)((y + offset_y1) / prec));
-                u_int32_t c2 = (u_int32_t)GetPixel(ximg, (int)((x + offset_x2) / prec), (int)((y + offset_y2) / prec));
-                u_int32_t c3 = (u_int32_t)GetPixel(ximg, (int)((x + offset_x3) / prec), (int)((y + offset_y3) / prec));
-                u_int32_t c4 = (u_int32_t)GetPixel(ximg, (int)((x + offset_x4) / prec), (int)((y + offset_y4) / prec));
-                u_int32_t c5 = (u_int32_t)GetPixel(ximg, (int)((x + offset_x5) / prec), (int)((y + offset_y5) / prec));
-                u_int32_t c6 = (u_int32_t)GetPixel(ximg, (int)((x + offset_x6) / prec), (int)((y + offset_y6) / prec));
-                u_int32_t c7 = (u_int32_t)GetPixel(ximg, (int)((x + offset_x7) / prec), (int)((y + offset_y7) / prec));
-                u_int32_t b = ((c1 & bmask) + (c2 & bmask) + (c3 & bmask) + (c4 & bmask) + (c5 & bmask) * 2 + (c6 & bmask) +
-                               (c7 & bmask)) /
-                              8;
-                u_int32_t g = ((c1 & gmask) + (c2 & gmask) + (c3 & gmask) + (c4 & gmask) + (c5 & gmask) * 2 + (c6 & gmask) +
-                               (c7 & gmask)) /
-                              8;
-                u_int32_t r = ((c1 & rmask) + (c2 & rmask) + (c3 & rmask) + (c4 & rmask) + (c5 & rmask) * 2 + (c6 & rmask) +
-                               (c7 & rmask)) /
-                              8;
-                data[j] = (r & rmask) | (g & gmask) | (b & bmask);
-            }
-        }
-    }
-    // Convert to argb32
-    if (rmask & 0xff0000) {
-        // argb32 or rgb24 => Nothing to do
-    } else if (rmask & 0xff) {
-        // bgr24
-        for (size_t i = 0; i < tw * th; i++) {
-            u_int32_t r = (data[i] & rmask) << 16;
-            u_int32_t g = (data[i] & gmask);
-            u_int32_t b = (data[i] & bmask) >> 16;
-            data[i] = (r & 0xff0000) | (g & 0x00ff00) | (b & 0x0000ff);
-        }
-    } else if (rmask & 0xff00) {
-        // bgra32
-        for (size_t i = 0; i < tw * th; i++) {
-            u_int32_t r = (data[i] & rmask) << 8;
-            u_int32_t g = (data[i] & gmask) >> 8;
-            u_int32_t b = (data[i] & bmask) >> 24;
-            data[i] = (r & 0xff0000) | (g & 0x00ff00) | (b & 0x0000ff);
-        }
-    }
-
-    // 2nd pass
-    smooth_thumbnail(result);
+    size_t stride = (size_t)cairo_image_surface_get_stride(result) / sizeof(u_int32_t);
+    memset(data, 0, stride * th * sizeof(u_int32_t));
+    downscale_ximage(ximg, w, h, data, stride, ox, fw, th);
     cairo_surface_mark_dirty(result);
 
-    if (ximg) {
-        XDestroyImage(ximg);
-        ximg = NULL;
-    }
-err4:
-    if (use_shm)
-        XShmDetach(server.display, &shminfo);
-err3:
-    if (use_shm)
-        shmdt(shminfo.shmaddr);
-err2:
-    if (use_shm)
-        shmctl(shminfo.shmid, IPC_RMID, NULL);
 err1:
-    if (ximg)
-        XDestroyImage(ximg);
-err0:    
+    // The shared memory segment is owned by the pool, not by the image
+    if (use_shm)
+        ximg->data = NULL;
+    XDestroyImage(ximg);
+err0:
     return result;
 }
 
@@ -30,10 +30,23 @@ void toggle_window_maximized(Window win);
 void toggle_window_shade(Window win);
 void change_window_desktop(Window win, int desktop);
 
-int get_icon_count(gulong *data, int num);
-gulong *get_best_icon(gulong *data, int icon_count, int num, int *iw, int *ih, int best_icon_size);
+// Returns the ARGB pixels of the _NET_WM_ICON image closest in size to best_icon_size (preferring larger images),
+// and sets iw and ih to its size. Only the selected image is transferred when the property is large.
+// Note: needs to be released with free().
+guint32 *get_window_icon_argb(Window win, int best_icon_size, int *iw, int *ih);
 
 char *get_window_name(Window win);
+
+// Returns the class name of the window (the second string of WM_CLASS), or NULL if not set.
+// Note: needs to be released with free().
+char *get_window_class(Window win);
+
+// Sends at once the requests needed to add task buttons for these windows (state, type, title, icon, geometry
+// etc.), so that the following queries do not wait for a round-trip each.
+// Call discard_prefetched_replies() afterwards.
+void prefetch_windows(const Window *windows, int num_windows);
 cairo_surface_t *get_window_thumbnail(Window win, int size);
+// Releases the shared memory segment used to capture thumbnails.
+void cleanup_thumbnails();
 
 #endif
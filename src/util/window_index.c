@@ -0,0 +1,72 @@
+/**************************************************************************
+*
+* Tint2 : window index
+*
+* Copyright (C) 2017 tint2 authors
+*
+* This program is free software; you can redistribute it and/or
+* modify it under the terms of the GNU General Public License version 2
+* as published by the Free Software Foundation.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+* You should have received a copy of the GNU General Public License
+* along with this program; if not, write to the Free Software
+* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**************************************************************************/
+
+#include <stdlib.h>
+
+#include "window_index.h"
+
+typedef struct IndexedWindow {
+    WindowKind kind;
+    void *object;
+} IndexedWindow;
+
+// Key: Window, value: IndexedWindow* (owned)
+static GHashTable *windows = NULL;
+
+void register_window(Window win, WindowKind kind, void *object)
+{
+    if (!win)
+        return;
+    if (!windows)
+        windows = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free);
+    IndexedWindow *entry = (IndexedWindow *)calloc(1, sizeof(IndexedWindow));
+    entry->kind = kind;
+    entry->object = object;
+    g_hash_table_insert(windows, GSIZE_TO_POINTER(win), entry);
+}
+
+void unregister_window(Window win, void *object)
+{
+    if (!windows || !win)
+        return;
+    IndexedWindow *entry = (IndexedWindow *)g_hash_table_lookup(windows, GSIZE_TO_POINTER(win));
+    if (entry && entry->object == object)
+        g_hash_table_remove(windows, GSIZE_TO_POINTER(win));
+}
+
+WindowKind find_window(Window win, void **object)
+{
+    IndexedWindow *entry = windows ? (IndexedWindow *)g_hash_table_lookup(windows, GSIZE_TO_POINTER(win)) : NULL;
+    if (object)
+        *object = entry ? entry->object : NULL;
+    return entry ? entry->kind : WINDOW_UNKNOWN;
+}
+
+void *find_window_object(Window win, WindowKind kind)
+{
+    void *object;
+    return find_window(win, &object) == kind ? object : NULL;
+}
+
+void cleanup_window_index()
+{
+    if (windows)
+        g_hash_table_destroy(windows);
+    windows = NULL;
+}
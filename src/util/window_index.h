@@ -0,0 +1,32 @@
+#ifndef WINDOW_INDEX_H
+#define WINDOW_INDEX_H
+
+#include <X11/Xlib.h>
+#include <glib.h>
+
+// Index of the windows tint2 knows about, used to dispatch X events without scanning the panels, tasks and icons.
+
+typedef enum WindowKind {
+    WINDOW_UNKNOWN = 0,
+    // object is a Panel*, the window is its main_win
+    WINDOW_PANEL,
+    // object is the first Task* of the window, as returned by get_task()
+    WINDOW_TASK,
+    // object is a TrayWindow*, the window is the icon or the parent window created by tint2 to embed it
+    WINDOW_TRAY_ICON,
+} WindowKind;
+
+void register_window(Window win, WindowKind kind, void *object);
+
+// Removes the window from the index, unless it has been registered meanwhile for another object.
+void unregister_window(Window win, void *object);
+
+// Returns the kind of the window and sets *object (if not NULL), or returns WINDOW_UNKNOWN.
+WindowKind find_window(Window win, void **object);
+
+// Returns the object of the window if it is of the given kind, NULL otherwise.
+void *find_window_object(Window win, WindowKind kind);
+
+void cleanup_window_index();
+
+#endif